@@ -0,0 +1,386 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include <ql/cashflows/legsnapshot.hpp>
+#include <ql/cashflows/coupon.hpp>
+#include <ql/termstructures/yieldtermstructure.hpp>
+#include <ql/math/solvers1d/brent.hpp>
+#include <ql/math/solvers1d/newtonsafe.hpp>
+#include <ql/settings.hpp>
+#include <ql/utilities/dataformatters.hpp>
+#include <algorithm>
+
+using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
+
+namespace QuantLib {
+
+    namespace {
+
+        const Spread basisPoint_ = 1.0e-4;
+
+        template <class T>
+        Integer sign(T x) {
+            static T zero = T();
+            if (x == zero)
+                return 0;
+            else if (x > zero)
+                return 1;
+            else
+                return -1;
+        }
+
+        // npv of the cash flows of a leg under a flat yield, given
+        // the year fractions between consecutive payments
+        class IrrFinder : public std::unary_function<Rate, Real> {
+          public:
+            IrrFinder(const Real* amounts,
+                      const Time* periods,
+                      Size n,
+                      Real npv,
+                      const DayCounter& dayCounter,
+                      Compounding comp,
+                      Frequency freq)
+            : amounts_(amounts), periods_(periods), n_(n), npv_(npv),
+              dayCounter_(dayCounter), compounding_(comp), frequency_(freq) {
+                checkSign();
+            }
+            Real operator()(Rate y) const {
+                InterestRate yield(y, dayCounter_, compounding_, frequency_);
+                Real NPV = 0.0;
+                DiscountFactor discount = 1.0;
+                for (Size k=0; k<n_; ++k) {
+                    discount *= yield.discountFactor(periods_[k]);
+                    NPV += amounts_[k] * discount;
+                }
+                return npv_ - NPV;
+            }
+            Real derivative(Rate y) const {
+                // the discount factor is a product of one factor per
+                // period, its log-derivative is the sum of theirs
+                InterestRate yield(y, dayCounter_, compounding_, frequency_);
+                Real N = yield.frequency();
+                DiscountFactor discount = 1.0;
+                Real dLogB = 0.0, dPdy = 0.0;
+                for (Size k=0; k<n_; ++k) {
+                    Time p = periods_[k];
+                    discount *= yield.discountFactor(p);
+                    switch (compounding_) {
+                      case Simple:
+                        dLogB -= p/(1.0+y*p);
+                        break;
+                      case Compounded:
+                        dLogB -= p/(1.0+y/N);
+                        break;
+                      case Continuous:
+                        dLogB -= p;
+                        break;
+                      case SimpleThenCompounded:
+                        if (p<=1.0/N)
+                            dLogB -= p/(1.0+y*p);
+                        else
+                            dLogB -= p/(1.0+y/N);
+                        break;
+                      default:
+                        QL_FAIL("unknown compounding convention (" <<
+                                Integer(compounding_) << ")");
+                    }
+                    dPdy += amounts_[k] * discount * dLogB;
+                }
+                return -dPdy;
+            }
+          private:
+            void checkSign() const {
+                // see CashFlows::yield
+                Integer lastSign = sign(-npv_),
+                        signChanges = 0;
+                for (Size k=0; k<n_; ++k) {
+                    Integer thisSign = sign(amounts_[k]);
+                    if (lastSign * thisSign < 0)
+                        signChanges++;
+                    if (thisSign != 0)
+                        lastSign = thisSign;
+                }
+                QL_REQUIRE(signChanges > 0,
+                           "the given cash flows cannot result in the given "
+                           "market price due to their sign");
+            }
+            const Real* amounts_;
+            const Time* periods_;
+            Size n_;
+            Real npv_;
+            DayCounter dayCounter_;
+            Compounding compounding_;
+            Frequency frequency_;
+        };
+
+        // npv of the cash flows of a leg on a zero-spreaded curve,
+        // given the zero rates of the curve on the time grid
+        class ZSpreadFinder : public std::unary_function<Rate, Real> {
+          public:
+            ZSpreadFinder(const Real* amounts,
+                          const Size* timeIndex,
+                          Size n,
+                          Size npvTimeIndex,
+                          Real npv,
+                          const std::vector<Time>& times,
+                          const std::vector<Rate>& zeroRates,
+                          const DayCounter& dayCounter,
+                          Compounding comp,
+                          Frequency freq)
+            : amounts_(amounts), timeIndex_(timeIndex), n_(n),
+              npvTimeIndex_(npvTimeIndex), npv_(npv), times_(times),
+              zeroRates_(zeroRates), dayCounter_(dayCounter),
+              compounding_(comp), frequency_(freq) {}
+            Real operator()(Rate zSpread) const {
+                Real NPV = 0.0;
+                for (Size k=0; k<n_; ++k)
+                    NPV += amounts_[k] * discount(timeIndex_[k], zSpread);
+                return npv_ - NPV/discount(npvTimeIndex_, zSpread);
+            }
+          private:
+            DiscountFactor discount(Size j, Spread zSpread) const {
+                // see ZeroSpreadedTermStructure and ZeroYieldStructure
+                if (times_[j] == 0.0)
+                    return 1.0;
+                InterestRate r(zeroRates_[j] + zSpread, dayCounter_,
+                               compounding_, frequency_);
+                return r.discountFactor(times_[j]);
+            }
+            const Real* amounts_;
+            const Size* timeIndex_;
+            Size n_, npvTimeIndex_;
+            Real npv_;
+            const std::vector<Time>& times_;
+            const std::vector<Rate>& zeroRates_;
+            DayCounter dayCounter_;
+            Compounding compounding_;
+            Frequency frequency_;
+        };
+
+    }
+
+    LegSnapshot::LegSnapshot(const std::vector<Leg>& legs,
+                             const Date& referenceDate,
+                             const DayCounter& dayCounter,
+                             bool includeSettlementDateFlows,
+                             Date settlementDate,
+                             Date npvDate)
+    : referenceDate_(referenceDate), dayCounter_(dayCounter) {
+
+        if (settlementDate == Date())
+            settlementDate = Settings::instance().evaluationDate();
+
+        if (npvDate == Date())
+            npvDate = settlementDate;
+        npvDate_ = npvDate;
+
+        offsets_.push_back(0);
+        for (Size i=0; i<legs.size(); ++i) {
+            const Leg& leg = legs[i];
+            Date lastDate = npvDate;
+            Date refStartDate, refEndDate;
+            for (Size j=0; j<leg.size(); ++j) {
+                if (leg[j]->hasOccurred(settlementDate,
+                                        includeSettlementDateFlows))
+                    continue;
+
+                Date couponDate = leg[j]->date();
+                bool exCoupon = leg[j]->tradingExCoupon(settlementDate);
+                shared_ptr<Coupon> coupon =
+                    dynamic_pointer_cast<Coupon>(leg[j]);
+                if (coupon) {
+                    refStartDate = coupon->referencePeriodStart();
+                    refEndDate = coupon->referencePeriodEnd();
+                } else {
+                    if (lastDate == npvDate) {
+                        // we don't have a previous coupon date,
+                        // so we fake it
+                        refStartDate = couponDate - 1*Years;
+                    } else  {
+                        refStartDate = lastDate;
+                    }
+                    refEndDate = couponDate;
+                }
+
+                amounts_.push_back(exCoupon ? 0.0 : leg[j]->amount());
+                bpsWeights_.push_back(coupon && !exCoupon ?
+                                      coupon->nominal() *
+                                      coupon->accrualPeriod() : 0.0);
+                dates_.push_back(couponDate);
+                refStartDates_.push_back(refStartDate);
+                refEndDates_.push_back(refEndDate);
+                lastDate = couponDate;
+            }
+            offsets_.push_back(amounts_.size());
+        }
+
+        // merge the payment dates of all legs into one time grid
+        std::vector<Date> gridDates(dates_);
+        gridDates.push_back(npvDate);
+        std::sort(gridDates.begin(), gridDates.end());
+        gridDates.erase(std::unique(gridDates.begin(), gridDates.end()),
+                        gridDates.end());
+
+        times_.resize(gridDates.size());
+        for (Size j=0; j<gridDates.size(); ++j)
+            times_[j] = dayCounter_.yearFraction(referenceDate_, gridDates[j]);
+
+        timeIndex_.resize(dates_.size());
+        for (Size k=0; k<dates_.size(); ++k)
+            timeIndex_[k] = std::lower_bound(gridDates.begin(),
+                                             gridDates.end(), dates_[k]) -
+                            gridDates.begin();
+        npvTimeIndex_ = std::lower_bound(gridDates.begin(), gridDates.end(),
+                                         npvDate) - gridDates.begin();
+    }
+
+    void LegSnapshot::checkCurve(
+                             const YieldTermStructure& discountCurve) const {
+        QL_REQUIRE(discountCurve.referenceDate() == referenceDate_,
+                   "curve reference date (" <<
+                   discountCurve.referenceDate() <<
+                   ") differs from snapshot reference date (" <<
+                   referenceDate_ << ")");
+        QL_REQUIRE(discountCurve.dayCounter() == dayCounter_,
+                   "curve day counter (" << discountCurve.dayCounter() <<
+                   ") differs from snapshot day counter (" <<
+                   dayCounter_ << ")");
+    }
+
+    void LegSnapshot::npvbps(const YieldTermStructure& discountCurve,
+                             Array& npv,
+                             Array& bps) const {
+        checkCurve(discountCurve);
+        std::vector<DiscountFactor> discounts;
+        discountCurve.discount(times_, discounts);
+
+        npv = Array(legs());
+        bps = Array(legs());
+        DiscountFactor d = discounts[npvTimeIndex_];
+        for (Size i=0; i<legs(); ++i) {
+            Real legNpv = 0.0, legBps = 0.0;
+            for (Size k=offsets_[i]; k<offsets_[i+1]; ++k) {
+                DiscountFactor df = discounts[timeIndex_[k]];
+                legNpv += amounts_[k] * df;
+                legBps += bpsWeights_[k] * df;
+            }
+            npv[i] = legNpv / d;
+            bps[i] = basisPoint_ * legBps / d;
+        }
+    }
+
+    Disposable<Array>
+    LegSnapshot::npv(const YieldTermStructure& discountCurve) const {
+        Array npv, bps;
+        npvbps(discountCurve, npv, bps);
+        return npv;
+    }
+
+    Disposable<Array>
+    LegSnapshot::bps(const YieldTermStructure& discountCurve) const {
+        Array npv, bps;
+        npvbps(discountCurve, npv, bps);
+        return bps;
+    }
+
+    Disposable<Array> LegSnapshot::yield(const Array& npv,
+                                         const DayCounter& dayCounter,
+                                         Compounding compounding,
+                                         Frequency frequency,
+                                         Real accuracy,
+                                         Size maxIterations,
+                                         Rate guess) const {
+        QL_REQUIRE(npv.size() == legs(),
+                   "number of npvs (" << npv.size() <<
+                   ") must be equal to the number of legs (" <<
+                   legs() << ")");
+
+        // the year fractions between consecutive payments do not
+        // depend on the yield, so we compute them once
+        std::vector<Time> periods(dates_.size());
+        for (Size i=0; i<legs(); ++i) {
+            Date lastDate = npvDate_;
+            for (Size k=offsets_[i]; k<offsets_[i+1]; ++k) {
+                periods[k] = dayCounter.yearFraction(lastDate, dates_[k],
+                                                     refStartDates_[k],
+                                                     refEndDates_[k]);
+                lastDate = dates_[k];
+            }
+        }
+
+        Array result(legs());
+        NewtonSafe solver;
+        solver.setMaxEvaluations(maxIterations);
+        for (Size i=0; i<legs(); ++i) {
+            Size first = offsets_[i], n = offsets_[i+1]-first;
+            QL_REQUIRE(n > 0, io::ordinal(i+1) << " leg has no cash flows");
+            IrrFinder objFunction(&amounts_[first], &periods[first], n,
+                                  npv[i], dayCounter, compounding, frequency);
+            result[i] = solver.solve(objFunction, accuracy,
+                                     guess, guess/10.0);
+        }
+        return result;
+    }
+
+    Disposable<Array> LegSnapshot::zSpread(
+                                   const Array& npv,
+                                   const YieldTermStructure& discountCurve,
+                                   Compounding compounding,
+                                   Frequency frequency,
+                                   Real accuracy,
+                                   Size maxIterations,
+                                   Rate guess) const {
+        QL_REQUIRE(npv.size() == legs(),
+                   "number of npvs (" << npv.size() <<
+                   ") must be equal to the number of legs (" <<
+                   legs() << ")");
+        checkCurve(discountCurve);
+
+        // the zero rates of the curve are computed once, the spread
+        // is then added in the solver
+        std::vector<DiscountFactor> discounts;
+        discountCurve.discount(times_, discounts);
+        std::vector<Rate> zeroRates(times_.size(), 0.0);
+        for (Size j=0; j<times_.size(); ++j) {
+            if (times_[j] != 0.0)
+                zeroRates[j] = InterestRate::impliedRate(1.0/discounts[j],
+                                                         dayCounter_,
+                                                         compounding,
+                                                         frequency,
+                                                         times_[j]);
+        }
+
+        Array result(legs());
+        Brent solver;
+        solver.setMaxEvaluations(maxIterations);
+        Real step = 0.01;
+        for (Size i=0; i<legs(); ++i) {
+            Size first = offsets_[i], n = offsets_[i+1]-first;
+            QL_REQUIRE(n > 0, io::ordinal(i+1) << " leg has no cash flows");
+            ZSpreadFinder objFunction(&amounts_[first], &timeIndex_[first], n,
+                                      npvTimeIndex_, npv[i], times_,
+                                      zeroRates, dayCounter_, compounding,
+                                      frequency);
+            result[i] = solver.solve(objFunction, accuracy, guess, step);
+        }
+        return result;
+    }
+
+}
@@ -0,0 +1,126 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file legsnapshot.hpp
+    \brief compiled representation of a set of legs
+*/
+
+#ifndef quantlib_leg_snapshot_hpp
+#define quantlib_leg_snapshot_hpp
+
+#include <ql/cashflow.hpp>
+#include <ql/interestrate.hpp>
+#include <ql/math/array.hpp>
+
+namespace QuantLib {
+
+    class YieldTermStructure;
+
+    //! compiled representation of a set of legs
+    /*! The cash flows of the given legs which did not occur at the
+        settlement date are compiled into flat arrays of amounts,
+        basis-point sensitivities, payment times and reference
+        periods. The payment times of all legs are merged into a
+        single sorted grid, so that the discount factors needed for a
+        whole book of legs are retrieved with one call to the batched
+        YieldTermStructure::discount() method.
+
+        The results reproduce the corresponding methods of the
+        CashFlows class, with the settlement and npv dates and the
+        treatment of settlement-date flows fixed at construction.
+
+        \warning the amounts are evaluated at construction, so that
+                 the snapshot is suited for fixed legs; it has to be
+                 recreated when the amounts of the cash flows change.
+                 The discount curves passed must have the reference
+                 date and day counter given at construction.
+    */
+    class LegSnapshot {
+      public:
+        LegSnapshot(const std::vector<Leg>& legs,
+                    const Date& referenceDate,
+                    const DayCounter& dayCounter,
+                    bool includeSettlementDateFlows,
+                    Date settlementDate = Date(),
+                    Date npvDate = Date());
+        //! \name Inspectors
+        //@{
+        Size legs() const { return offsets_.size()-1; }
+        Size cashFlows() const { return amounts_.size(); }
+        //! payment times (and npv time) from the reference date
+        const std::vector<Time>& times() const { return times_; }
+        //@}
+        //! \name YieldTermStructure functions
+        //@{
+        //! npv of each leg, see CashFlows::npv
+        Disposable<Array> npv(const YieldTermStructure& discountCurve) const;
+        //! basis-point sensitivity of each leg, see CashFlows::bps
+        Disposable<Array> bps(const YieldTermStructure& discountCurve) const;
+        //! npv and bps of each leg, see CashFlows::npvbps
+        void npvbps(const YieldTermStructure& discountCurve,
+                    Array& npv,
+                    Array& bps) const;
+        //@}
+        //! \name Yield (a.k.a. Internal Rate of Return, i.e. IRR) functions
+        //@{
+        //! implied yield of each leg, see CashFlows::yield
+        Disposable<Array> yield(const Array& npv,
+                                const DayCounter& dayCounter,
+                                Compounding compounding,
+                                Frequency frequency,
+                                Real accuracy = 1.0e-10,
+                                Size maxIterations = 100,
+                                Rate guess = 0.05) const;
+        //@}
+        //! \name Z-spread functions
+        //@{
+        /*! implied Z-spread of each leg, see CashFlows::zSpread. As
+            in ZeroSpreadedTermStructure, the spread is added to the
+            zero rates of the curve w.r.t. its own day counter.
+        */
+        Disposable<Array> zSpread(const Array& npv,
+                                  const YieldTermStructure& discountCurve,
+                                  Compounding compounding,
+                                  Frequency frequency,
+                                  Real accuracy = 1.0e-10,
+                                  Size maxIterations = 100,
+                                  Rate guess = 0.0) const;
+        //@}
+      private:
+        void checkCurve(const YieldTermStructure& discountCurve) const;
+        Date referenceDate_;
+        DayCounter dayCounter_;
+        Date npvDate_;
+        // cash flows of the i-th leg: offsets_[i] to offsets_[i+1]-1
+        std::vector<Size> offsets_;
+        // amounts (zero when trading ex-coupon), nominal times accrual
+        // period for coupons (zero otherwise) and index of the payment
+        // time in times_
+        std::vector<Real> amounts_, bpsWeights_;
+        std::vector<Size> timeIndex_;
+        // dates entering the yield calculation for each cash flow
+        std::vector<Date> dates_, refStartDates_, refEndDates_;
+        // sorted payment times and npv date time
+        std::vector<Time> times_;
+        Size npvTimeIndex_;
+    };
+
+}
+
+#endif
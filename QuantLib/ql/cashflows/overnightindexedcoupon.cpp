@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2009 Roland Lichters
  Copyright (C) 2009 Ferdinando Ametrano
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -53,10 +54,11 @@ namespace QuantLib {
 
                 // already fixed part
                 Date today = Settings::instance().evaluationDate();
+                const FixingHistory& fixings =
+                    IndexManager::instance().getFixingHistory(index->name());
                 while (i<n && fixingDates[i]<today) {
                     // rate must have been fixed
-                    Rate pastFixing = IndexManager::instance().getHistory(
-                                                index->name())[fixingDates[i]];
+                    Rate pastFixing = fixings[fixingDates[i]];
                     QL_REQUIRE(pastFixing != Null<Real>(),
                                "Missing " << index->name() <<
                                " fixing for " << fixingDates[i]);
@@ -68,8 +70,7 @@ namespace QuantLib {
                 if (i<n && fixingDates[i] == today) {
                     // might have been fixed
                     try {
-                        Rate pastFixing = IndexManager::instance().getHistory(
-                                                index->name())[fixingDates[i]];
+                        Rate pastFixing = fixings[fixingDates[i]];
                         if (pastFixing != Null<Real>()) {
                             compoundFactor *= (1.0 + pastFixing*dt[i]);
                             ++i;
@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2008 Roland Lichters
  Copyright (C) 2009, 2014 Jose Aparicio
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -68,15 +69,60 @@ namespace QuantLib {
     template <class simEventOwner> struct simEvent;
 
 
+    namespace detail {
+
+        /* Factor samplers for the blocks of simulations of RandomLM. By
+        default each block uses its own seed, derived from the model seed;
+        the first block uses the model seed itself, so that a single block
+        reproduces the monothread simulation. Low discrepancy sequences are
+        skipped to the first simulation of the block instead, so that the
+        results do not depend on the number of blocks.
+        */
+        template <class Sampler, class USNG>
+        struct RandomLMSubstream {
+            template <class C>
+            static boost::shared_ptr<Sampler> sampler(const C& copula,
+                BigNatural seed, Size block, Size /* firstSim */) {
+                if(block > 0) {
+                    MersenneTwisterUniformRng seeds(seed);
+                    for(Size i=0; i<block; i++)
+                        seed = seeds.nextInt32();
+                }
+                return boost::make_shared<Sampler>(copula, seed);
+            }
+        };
+
+        template <class Sampler>
+        struct RandomLMSubstream<Sampler, SobolRsg> {
+            template <class C>
+            static boost::shared_ptr<Sampler> sampler(const C& copula,
+                BigNatural seed, Size /* block */, Size firstSim) {
+                SobolRsg sobol(copula.numFactors(), seed);
+                if(firstSim > 0)
+                    sobol.skipTo(firstSim);
+                return boost::make_shared<Sampler>(copula, sobol);
+            }
+        };
+
+    }
+
+
     /*! Base class for latent model monte carlo simulation. Independent of the
     copula type and the generator.
     Generates the factors and variable samples and determines event threshold
     but it is not responsible for actual event specification; thats the derived
     classes responsibility according to what they model.
-    Derived classes need mainly to implement nextSample (Worker::nextSample in
-    the multithreaded version) to compute the simulation event generated, if
-    any, from the latent variables sample. They also have the accompanying
-    event trait to specify.
+    Derived classes need mainly to implement nextSample to compute the
+    simulation events generated, if any, from the latent variables sample.
+    They also have the accompanying event trait to specify.
+
+    The simulations can be run on several threads: they are split into
+    nThreads contiguous blocks, each one generated from its own substream of
+    the generator (see detail::RandomLMSubstream) into its own buffer. The
+    statistics access the buffers in place through getSim and run on the
+    same number of threads. Sobol sequences give the same results for any
+    number of threads, other generators use a different seed for each
+    block.
     */
     /* CRTP used for performance to avoid virtual table resolution in the Monte
     Carlo. Not only in sample generation but access; quite an amount of time can
@@ -105,9 +151,12 @@ namespace QuantLib {
             Size numLMVars,
             const copulaPolicy& copula,
             Size nSims,
-            BigNatural seed)
+            BigNatural seed,
+            Size nThreads = 1)
         : seed_(seed), numFactors_(numFactors), numLMVars_(numLMVars),
-          nSims_(nSims), copula_(copula) {}
+          nSims_(nSims), nThreads_(nThreads), blockSize_(0), copula_(copula) {
+            QL_REQUIRE(nThreads_ > 0, "at least one thread required");
+        }
 
         void update() {
             simsBuffer_.clear();
@@ -117,31 +166,69 @@ namespace QuantLib {
         }
 
         void performCalculations() const {
+            // also fills the caches read concurrently by nextSample
             static_cast<const derivedRandomLM<copulaPolicy, USNG>* >(
                 this)->initDates();//in update?
-            copulasRng_ = boost::make_shared<copulaRNG_type>(copula_, seed_);
             performSimulations();
         }
 
         void performSimulations() const {
-            // Next sequence should determine the event and push it into buffer
-            for(Size i=nSims_; i; i--) {
-                const std::vector<Real>& sample =
-                    copulasRng_->nextSequence().value;
+            blockSize_ = std::max<Size>((nSims_ + nThreads_ - 1) / nThreads_,
+                1);
+            simsBuffer_.assign(nThreads_, std::vector<std::vector<
+                simEvent<derivedRandomLM<copulaPolicy, USNG> > > >());
+            std::vector<std::string> errors(nThreads_);
+
+            #pragma omp parallel for schedule(static, 1) num_threads(static_cast<int>(nThreads_)) if(nThreads_ > 1)
+            for(Size iBlock=0; iBlock < nThreads_; iBlock++) {
+                try {
+                    simulateBlock(iBlock);
+                } catch (std::exception& e) {
+                    errors[iBlock] = e.what();
+                } catch (...) {
+                    errors[iBlock] = "unknown error";
+                }
+            }
+
+            for(Size iBlock=0; iBlock < nThreads_; iBlock++)
+                QL_REQUIRE(errors[iBlock].empty(),
+                    "error in simulation block #" << iBlock << ": " <<
+                    errors[iBlock]);
+        }
+
+        void simulateBlock(Size iBlock) const {
+            Size firstSim = iBlock * blockSize_;
+            Size endSim = std::min(firstSim + blockSize_, nSims_);
+            if(firstSim >= endSim) return;
+
+            boost::shared_ptr<copulaRNG_type> copulasRng =
+                detail::RandomLMSubstream<copulaRNG_type, USNG>::sampler(
+                    copula_, seed_, iBlock, firstSim);
+            std::vector<std::vector<simEvent<derivedRandomLM<copulaPolicy,
+                USNG> > > >& buffer = simsBuffer_[iBlock];
+            buffer.reserve(endSim - firstSim);
+            // Next sequence should determine the events and push them into
+            //   the buffer
+            for(Size i=firstSim; i<endSim; i++) {
+                buffer.push_back(std::vector<simEvent<
+                    derivedRandomLM<copulaPolicy, USNG> > >());
                 static_cast<const derivedRandomLM<copulaPolicy, USNG>* >(
-                    this)->nextSample(sample);
-            // alternatively make call an explicit local method...
+                    this)->nextSample(copulasRng->nextSequence().value,
+                        buffer.back());
             }
         }
 
         /* Method to access simulation results and avoiding a copy of
         each thread results buffer. PerformCalculations should have been called.
-        Here in the monothread version this method is redundant/trivial but
-        serves to detach the statistics access to the way the simulations are
-        stored.
         */
         const std::vector<simEvent<derivedRandomLM<copulaPolicy, USNG> > >&
-            getSim(const Size iSim) const { return simsBuffer_[iSim]; }
+            getSim(const Size iSim) const {
+            return simsBuffer_[iSim / blockSize_][iSim % blockSize_];
+        }
+
+        /* Tranched portfolio loss of each simulation up to the given date,
+        computed on the simulation threads. */
+        void trancheLosses(const Date& d, std::vector<Real>& losses) const;
 
         /* Allows statistics to be written generically for fixed and random
         recovery rates. */
@@ -211,12 +298,14 @@ namespace QuantLib {
         const Size numLMVars_;
 
         const Size nSims_;
+        const Size nThreads_;
 
-        mutable std::vector<std::vector<simEvent<derivedRandomLM<copulaPolicy,
-            USNG > > > > simsBuffer_;
+        // one buffer per block of simulations
+        mutable Size blockSize_;
+        mutable std::vector<std::vector<std::vector<simEvent<
+            derivedRandomLM<copulaPolicy, USNG > > > > > simsBuffer_;
 
         mutable copulaPolicy copula_;
-        mutable boost::shared_ptr<copulaRNG_type> copulasRng_;
 
         // Maximum time inversion horizon
         static const Size maxHorizon_ = 4050; // over 11 years
@@ -240,6 +329,7 @@ namespace QuantLib {
         if(n==0) return 1.;
 
         Real counts = 0.;
+        #pragma omp parallel for reduction(+:counts) num_threads(static_cast<int>(nThreads_)) if(nThreads_ > 1)
         for(Size iSim=0; iSim < nSims_; iSim++) {
             Size simCount = 0;
             const std::vector<simEvent<D<C, URNG> > >& events =
@@ -313,6 +403,7 @@ namespace QuantLib {
         //   would distort the simulation results.
         Real expectedDefi = 0.;
         Real expectedDefj = 0.;
+        #pragma omp parallel for reduction(+:expectedDefiDefj,expectedDefi,expectedDefj) num_threads(static_cast<int>(nThreads_)) if(nThreads_ > 1)
         for(Size iSim=0; iSim < nSims_; iSim++) {
             const std::vector<simEvent<D<C, URNG> > >& events = getSim(iSim);
             Real imatch = 0., jmatch = 0.;
@@ -349,34 +440,12 @@ namespace QuantLib {
         const Date& d, Probability confidencePerc) const
     {
         calculate();
-        Date today = Settings::instance().evaluationDate();
-        BigInteger val = d.serialNumber() - today.serialNumber();
 
-        Real attachAmount = basket_->attachmentAmount();
-        Real detachAmount = basket_->detachmentAmount();
-
-        // Real trancheLoss= 0.;
+        std::vector<Real> losses;
+        trancheLosses(d, losses);
+        // dates? current losses? realized defaults, not yet
         GeneralStatistics lossStats;
-        for(Size iSim=0; iSim < nSims_; iSim++) {
-            const std::vector<simEvent<D<C, URNG> > >& events = getSim(iSim);
-
-            Real portfSimLoss=0.;
-            for(Size iEvt=0; iEvt < events.size(); iEvt++) {
-                // if event is within time horizon...
-                if(val > static_cast<BigInteger>(events[iEvt].dayFromRef)) {
-                    Size iName = events[iEvt].nameIdx;
-                    // ...and is contained in the basket.
-                        portfSimLoss +=
-                            basket_->exposure(basket_->names()[iName],
-                                Date(events[iEvt].dayFromRef +
-                                    today.serialNumber())) *
-                                        (1.-getEventRecovery(events[iEvt]));
-               }
-            }
-            lossStats.add(// d  ates? current losses? realized defaults, not yet
-                std::min(std::max(portfSimLoss - attachAmount, 0.),
-                    detachAmount - attachAmount) );
-        }
+        lossStats.addSequence(losses.begin(), losses.end());
         return std::make_pair(lossStats.mean(), lossStats.errorEstimate() *
             InverseCumulativeNormal::standard_value(0.5*(1.+confidencePerc)));
     }
@@ -402,39 +471,14 @@ namespace QuantLib {
 
     template<template <class, class> class D, class C, class URNG>
     Histogram RandomLM<D, C, URNG>::computeHistogram(const Date& d) const {
-        std::vector<Real> data;
-        std::set<Real> keys;// attainable loss values
-        keys.insert(0.);
         Date today = Settings::instance().evaluationDate();
-        BigInteger val = d.serialNumber() - today.serialNumber();
         // redundant test? should have been tested by the basket caller?
         QL_REQUIRE(d >= today,
             "Requested percentile date must lie after computation date.");
         calculate();
 
-        Real attachAmount = basket_->attachmentAmount();
-        Real detachAmount = basket_->detachmentAmount();
-
-        for(Size iSim=0; iSim < nSims_; iSim++) {
-            const std::vector<simEvent<D<C, URNG> > >& events = getSim(iSim);
-
-            Real portfSimLoss=0.;
-            for(Size iEvt=0; iEvt < events.size(); iEvt++) {
-                if(val > static_cast<BigInteger>(events[iEvt].dayFromRef)) {
-                    Size iName = events[iEvt].nameIdx;
-          // test needed (here and the others) to reuse simulations:
-          //          if(basket_->pool()->has(copula_->pool()->names()[iName]))
-                        portfSimLoss +=
-                            basket_->exposure(basket_->names()[iName],
-                                Date(events[iEvt].dayFromRef +
-                                    today.serialNumber())) *
-                                        (1.-getEventRecovery(events[iEvt]));
-                }
-            }
-            data.push_back(std::min(std::max(portfSimLoss - attachAmount, 0.),
-                detachAmount - attachAmount));
-            keys.insert(data.back());
-        }
+        std::vector<Real> data;
+        trancheLosses(d, data);
         // avoid using as many points as in the simulation.
         Size nPts = std::min<Size>(data.size(), 150);// fix
         return Histogram(data.begin(), data.end(), nPts);
@@ -450,33 +494,12 @@ namespace QuantLib {
             "Requested percentile date must lie after computation date.");
         calculate();
 
-        Real attachAmount = basket_->attachmentAmount();
-        Real detachAmount = basket_->detachmentAmount();
-
         BigInteger val = d.serialNumber() - today.serialNumber();
         if(val <= 0) return 0.;// plus basket realized losses
 
         //GenericRiskStatistics<GeneralStatistics> statsX;
         std::vector<Real> losses;
-        for(Size iSim=0; iSim < nSims_; iSim++) {
-            const std::vector<simEvent<D<C, URNG> > >& events = getSim(iSim);
-            Real portfSimLoss=0.;
-            for(Size iEvt=0; iEvt < events.size(); iEvt++) {
-                if(val > static_cast<BigInteger>(events[iEvt].dayFromRef)) {
-                    Size iName = events[iEvt].nameIdx;
-                    // ...and is contained in the basket.
-                    //if(basket_->pool()->has(copula_->pool()->names()[iName]))
-                        portfSimLoss +=
-                            basket_->exposure(basket_->names()[iName],
-                                Date(events[iEvt].dayFromRef +
-                                    today.serialNumber())) *
-                                        (1.-getEventRecovery(events[iEvt]));
-                }
-            }
-            portfSimLoss = std::min(std::max(portfSimLoss - attachAmount, 0.),
-                detachAmount - attachAmount);
-            losses.push_back(portfSimLoss);
-        }
+        trancheLosses(d, losses);
 
         std::sort(losses.begin(), losses.end());
         Real posit = std::ceil(percent * nSims_);
@@ -543,31 +566,9 @@ namespace QuantLib {
             "Incorrect percentile");
         calculate();
 
-        Real attachAmount = basket_->attachmentAmount();
-        Real detachAmount = basket_->detachmentAmount();
-
+        // dataset for rank stat:
         std::vector<Real> rankLosses;
-        Date today = Settings::instance().evaluationDate();
-        BigInteger val = d.serialNumber() - today.serialNumber();
-        for(Size iSim=0; iSim < nSims_; iSim++) {
-            const std::vector<simEvent<D<C, URNG> > >& events = getSim(iSim);
-            Real portfSimLoss=0.;
-            for(Size iEvt=0; iEvt < events.size(); iEvt++) {
-                if(val > static_cast<BigInteger>(events[iEvt].dayFromRef)) {
-                    Size iName = events[iEvt].nameIdx;
-                 //   if(basket_->pool()->has(copula_->pool()->names()[iName]))
-                        portfSimLoss +=
-                            basket_->exposure(basket_->names()[iName],
-                                Date(events[iEvt].dayFromRef +
-                                    today.serialNumber())) *
-                                        (1.-getEventRecovery(events[iEvt]));
-                }
-            }
-            portfSimLoss = std::min(std::max(portfSimLoss - attachAmount, 0.),
-                detachAmount - attachAmount);
-            // update dataset for rank stat:
-            rankLosses.push_back(portfSimLoss);
-        }
+        trancheLosses(d, rankLosses);
 
         std::sort(rankLosses.begin(), rankLosses.end());
         Size quantilePosition = static_cast<Size>(floor(nSims_*percentile));
@@ -618,6 +619,40 @@ namespace QuantLib {
     }
 
 
+    template<template <class, class> class D, class C, class URNG>
+    void RandomLM<D, C, URNG>::trancheLosses(const Date& d,
+        std::vector<Real>& losses) const
+    {
+        Date today = Settings::instance().evaluationDate();
+        BigInteger val = d.serialNumber() - today.serialNumber();
+
+        Real attachAmount = basket_->attachmentAmount();
+        Real detachAmount = basket_->detachmentAmount();
+
+        losses.resize(nSims_);
+        #pragma omp parallel for num_threads(static_cast<int>(nThreads_)) if(nThreads_ > 1)
+        for(Size iSim=0; iSim < nSims_; iSim++) {
+            const std::vector<simEvent<D<C, URNG> > >& events = getSim(iSim);
+            Real portfSimLoss=0.;
+            for(Size iEvt=0; iEvt < events.size(); iEvt++) {
+                // if event is within time horizon...
+                if(val > static_cast<BigInteger>(events[iEvt].dayFromRef)) {
+                    Size iName = events[iEvt].nameIdx;
+          // test needed (here and the others) to reuse simulations:
+          //          if(basket_->pool()->has(copula_->pool()->names()[iName]))
+                        portfSimLoss +=
+                            basket_->exposure(basket_->names()[iName],
+                                Date(events[iEvt].dayFromRef +
+                                    today.serialNumber())) *
+                                        (1.-getEventRecovery(events[iEvt]));
+                }
+            }
+            losses[iSim] = std::min(std::max(portfSimLoss - attachAmount, 0.),
+                detachAmount - attachAmount);
+        }
+    }
+
+
     template<template <class, class> class D, class C, class URNG>
     Disposable<std::vector<Real> > RandomLM<D, C, URNG>::splitVaRLevel(
         const Date& date, Real loss) const
@@ -821,10 +856,11 @@ namespace QuantLib {
             const std::vector<Real>& recoveries = std::vector<Real>(),
             Size nSims = 0,// stats will crash on div by zero, FIX ME.
             Real accuracy = 1.e-6,
-            BigNatural seed = 2863311530)
+            BigNatural seed = 2863311530,
+            Size nThreads = 1)
         : RandomLM< ::QuantLib::RandomDefaultLM, copulaPolicy, USNG>
             (copula->numFactors(), copula->size(), copula->copula(),
-                nSims, seed ),
+                nSims, seed, nThreads),
           copula_(copula), //<- renmae to latentModel_ or defautlLM_;
           recoveries_(recoveries.size()==0 ? std::vector<Real>(copula->size(),
             0.) : recoveries),
@@ -839,10 +875,11 @@ namespace QuantLib {
                 copula,
             Size nSims = 0,// stats will crash on div by zero, FIX ME.
             Real accuracy = 1.e-6,
-            BigNatural seed = 2863311530)
+            BigNatural seed = 2863311530,
+            Size nThreads = 1)
         : RandomLM< ::QuantLib::RandomDefaultLM, copulaPolicy, USNG>
             (copula->numFactors(), copula->size(), copula->copula(),
-                nSims, seed ),
+                nSims, seed, nThreads),
           copula_(copula),
           recoveries_(copula->recoveries()),
           accuracy_(accuracy)
@@ -865,7 +902,8 @@ namespace QuantLib {
         */
         friend class RandomLM< ::QuantLib::RandomDefaultLM, copulaPolicy, USNG>;
     protected:
-        void nextSample(const std::vector<Real>& values) const;
+        void nextSample(const std::vector<Real>& values,
+            std::vector<defaultSimEvent>& events) const;
         void initDates() const {
             /* Precalculate horizon time default probabilities (used to
               determine if the default took place and subsequently compute its
@@ -875,6 +913,7 @@ namespace QuantLib {
             Date maxHorizonDate = today  + Period(this->maxHorizon_, Days);
 
             const boost::shared_ptr<Pool>& pool = this->basket_->pool();
+            horizonDefaultPs_.clear();
             for(Size iName=0; iName < this->basket_->size(); ++iName)//use'live'
                 horizonDefaultPs_.push_back(pool->get(pool->names()[iName]).
                     defaultProbability(this->basket_->defaultKeys()[iName])
@@ -924,11 +963,10 @@ namespace QuantLib {
 
     template<class C, class URNG>
     void RandomDefaultLM<C, URNG>::nextSample(
-        const std::vector<Real>& values) const
+        const std::vector<Real>& values,
+        std::vector<defaultSimEvent>& events) const
     {
         const boost::shared_ptr<Pool>& pool = this->basket_->pool();
-        // starts with no events
-        this->simsBuffer_.push_back(std::vector<defaultSimEvent> ());
 
         for(Size iName=0; iName<copula_->size(); iName++) {
             Real latentVarSample =
@@ -956,8 +994,7 @@ namespace QuantLib {
                                         std::log(1.-simDefaultProb)
                     /std::log(1.-data_.horizonDefaultPs_[iName])));
                    */
-                this->simsBuffer_.back().push_back(defaultSimEvent(iName,
-                    dateSTride));
+                events.push_back(defaultSimEvent(iName, dateSTride));
                //emplace_back
             }
         /* Used to remove sims with no events. Uses less memory, faster
@@ -971,7 +1008,7 @@ namespace QuantLib {
 
 
 
-    // Common usage typedefs (notice they vary in the multithread version)
+    // Common usage typedefs
     // ---------- Gaussian default generators options ------------------------
     /* Uses copula direct normal inversion and MT generator
     typedef RandomDefaultLM<GaussianCopulaPolicy,
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2014 Jose Aparicio
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -81,10 +82,11 @@ namespace QuantLib {
                 copula,
             Size nSims = 0,
             Real accuracy = 1.e-6, 
-            BigNatural seed = 2863311530)
+            BigNatural seed = 2863311530,
+            Size nThreads = 1)
         : RandomLM< ::QuantLib::RandomLossLM, copulaPolicy, USNG>
             (copula->numFactors(), copula->size(), copula->copula(), 
-                nSims, seed),
+                nSims, seed, nThreads),
           copula_(copula), accuracy_(accuracy)
     {
         // redundant through basket?
@@ -100,7 +102,8 @@ namespace QuantLib {
         */
         friend class RandomLM< ::QuantLib::RandomLossLM, copulaPolicy, USNG>;
     protected:
-        void nextSample(const std::vector<Real>& values) const;
+        void nextSample(const std::vector<Real>& values,
+            std::vector<defaultSimEvent>& events) const;
 
         // see note on randomdefaultlatentmodel
         void initDates() const {
@@ -108,10 +111,11 @@ namespace QuantLib {
               determine if the default took place and subsequently compute its 
               event time)
             */
-            Date today = Settings::instance().evaluationDate();
-            Date maxHorizonDate = today  + Period(this->maxHorizon_, Days);
+            today_ = Settings::instance().evaluationDate();
+            Date maxHorizonDate = today_  + Period(this->maxHorizon_, Days);
 
             const boost::shared_ptr<Pool>& pool = this->basket_->pool();
+            horizonDefaultPs_.clear();
             for(Size iName=0; iName < this->basket_->size(); ++iName)//use'live'
                 horizonDefaultPs_.push_back(pool->get(pool->names()[iName]).
                     defaultProbability(this->basket_->defaultKeys()[iName])
@@ -145,6 +149,9 @@ namespace QuantLib {
         // Default probabilities for each name at the time of the maximun 
         //   horizon date. Cached for perf.
         mutable std::vector<Probability> horizonDefaultPs_;
+        // evaluation date of the simulation, read by nextSample on the
+        //   simulation threads
+        mutable Date today_;
     };
 
 
@@ -153,10 +160,10 @@ namespace QuantLib {
 
     template<class C, class URNG>
     void RandomLossLM<C, URNG>::nextSample(
-        const std::vector<Real>& values) const 
+        const std::vector<Real>& values,
+        std::vector<defaultSimEvent>& events) const 
     {
         const boost::shared_ptr<Pool>& pool = this->basket_->pool();
-        this->simsBuffer_.push_back(std::vector<defaultSimEvent> ());
 
         // half the model is defaults, the other half are RRs...
         for(Size iName=0; iName<copula_->size()/2; iName++) {
@@ -200,8 +207,7 @@ namespace QuantLib {
                 probability the date is moved to the TS date 
                 Unless the gap is ridiculous this has no practical effect for 
                 the RR value*/
-                Date today = Settings::instance().evaluationDate();
-                Date eventDate = today+Period(static_cast<Integer>(dateSTride), 
+                Date eventDate = today_+Period(static_cast<Integer>(dateSTride), 
                     Days);
                 if(eventDate<dfts->referenceDate()) 
                     eventDate = dfts->referenceDate();
@@ -210,7 +216,7 @@ namespace QuantLib {
                 Real recovery = 
                     copula_->conditionalRecovery(latentRRVarSample,
                         iName, eventDate);
-                this->simsBuffer_.back().push_back(
+                events.push_back(
                   defaultSimEvent(iName, dateSTride, recovery));
                 //emplace_back
             }
@@ -227,7 +233,7 @@ namespace QuantLib {
     }
 
 
-    // Common uses: Not valid in multithread version.
+    // Common uses
     // ---------- Gaussian default generators options ------------------------
     /* Uses copula direct normal inversion and MT generator 
     typedef RandomLossLM<GaussianCopulaPolicy,
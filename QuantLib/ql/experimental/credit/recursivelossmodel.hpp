@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2009, 2014 Jose Aparicio
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -33,6 +34,7 @@
 #endif
 #include <map>
 #include <algorithm>
+#include <numeric>
 
 namespace QuantLib {
 
@@ -49,8 +51,6 @@ namespace QuantLib {
         portfolio loss weights (notionals and recoveries). As it is now this
         is ok for pricing but not for risk metrics. See the discussion in O'Kane
         18.3.2
-        \todo Intengrands should all use the inverted probabilities for 
-        performance instead of calling the copula inversion with the same vals.
     */
     template<class copulaPolicy> 
     class RecursiveLossModel : public DefaultLossModel {
@@ -59,31 +59,29 @@ namespace QuantLib {
             const boost::shared_ptr<ConstantLossLatentmodel<copulaPolicy> >& m,
 // nope! use max common divisor. See O'Kane. Or give both options at least.
             Size nbuckets  = 1)
-        : copula_(m), nBuckets_(nbuckets), wk_() { }
+        : copula_(m), nBuckets_(nbuckets), wk_(), lossUnit_(0.),
+          maxLossUnits_(0) { }
       private:
-          /*!
-          @param pDefDate Vector of unconditional default probabilities for each
-          live name (at the current evaluation date). This is passed instead of 
-          the date for performance reasons (if in the future other magnitudes 
-          -e.g. lgd- are contingent on the date they shouldd be passed too).
-          */
-        Disposable<std::map<Real, Probability> > conditionalLossDistrib(
-            const std::vector<Probability>& pDefDate, 
-            const std::vector<Real>& mktFactor) const;
-        Real expectedConditionalLoss(const std::vector<Probability>& pDefDate, //<< never used!!
-            const std::vector<Real>& mktFactor) const;
-        Disposable<std::vector<Real> > conditionalLossProb(
-            const std::vector<Probability>& pDefDate, 
-            //const Date& date,
-            const std::vector<Real>& mktFactor) const;
-        //versions using the P-inverse, deprecate the former
-        Disposable<std::map<Real, Probability> > conditionalLossDistribInvP(
-            const std::vector<Real>& pDefDate, 
-            //const Date& date,
-            const std::vector<Real>& mktFactor) const;
-        Real expectedConditionalLossInvP(const std::vector<Real>& pDefDate, 
-            //const Date& date,
-            const std::vector<Real>& mktFactor) const;
+        /*! Loss distribution conditional to the market factor value, in
+          loss units. The losses not attainable by the pool have a null
+          probability.
+          @param invpDefDate Vector of inverted unconditional default
+          probabilities for each live name (at the current evaluation date).
+          This is passed instead of the date for performance reasons (if in 
+          the future other magnitudes -e.g. lgd- are contingent on the date 
+          they shouldd be passed too).
+        */
+        void conditionalLossProbInvP(
+            const std::vector<Real>& invpDefDate, 
+            const std::vector<Real>& mktFactor,
+            std::vector<Probability>& probs) const;
+        /*! Unconditional loss distribution, in loss units, at the given
+          date. It does not depend on the tranche, so it is cached and
+          shared by all the statistics and dates requested and by the
+          baskets (tranches) on the same pool the model is set on.
+        */
+        const std::vector<Probability>& lossProbabilities(
+            const Date& date) const;
     protected:
         void resetModel();
     public:
@@ -94,13 +92,10 @@ namespace QuantLib {
             EL(t) = \sum_{l_k}l_k P(l;t) =
               \sum_{l_k}l_k \int P(l_k;t|\omega) d\omega q(\omega)
             \f]
-            One can invert the sumation and the integral order to:
-            \f[
-            EL(t) = \int\,q(\omega)\,d\omega\,\sum_{l_k}\,l_k\,P(l_k;t|\omega) =
-              \int\,q(\omega)\,d\omega\,EL(t|\omega)
-            \f]
-            and this is the way it is integrated here. The recursion formula 
-            makes it easier this way.
+            The unconditional loss probabilities are integrated once for
+            each date and cached, so that the tranche payoff is summed
+            outside the integral; this is the same since the integration
+            is linear.
         */
        Real expectedTrancheLoss(const Date& date) const;
        Disposable<std::vector<Real> > lossProbability(const Date& date) const;
@@ -117,8 +112,10 @@ namespace QuantLib {
     private:
         // loss model descriptor members
         const Size nBuckets_;
-        mutable std::vector<Real> wk_;
+        // loss given default of each name in loss units
+        mutable std::vector<Size> wk_;
         mutable Real lossUnit_;
+        mutable Size maxLossUnits_;
         //! name to name factor. In the single factor copula:
         //    correl = beta * beta
         // When constructing through a single correlation number the factor is
@@ -130,6 +127,15 @@ namespace QuantLib {
             notional_;
         mutable Size remainingBsktSize_;
         mutable std::vector<Real> notionals_;
+        // cached unconditional loss distributions by date, valid for the
+        //   inverted default probabilities they were computed with
+        struct LossProbabilities {
+            std::vector<Real> invProbs;
+            std::vector<Probability> probs;
+        };
+        mutable std::map<Date, LossProbabilities> lossProbabilities_;
+        // factor weights the cached distributions were computed with
+        mutable std::vector<std::vector<Real> > factorWeights_;
     };
 
 
@@ -141,79 +147,65 @@ namespace QuantLib {
     inline Real RecursiveLossModel<CP>::expectedTrancheLoss(
         const Date& date) const 
     {
-/*
-        std::map<Real, Probability> dist = lossDistribution(date);
+        const std::vector<Probability>& probs = lossProbabilities(date);
 
         Real expLoss = 0.;
-        std::map<Real, Probability>::iterator distIt = dist.begin();
-
-        while(distIt != dist.end()) {
-            Real loss = distIt->first * lossUnit_;
-            loss = std::max(std::min(loss, detachAmount_)-attachAmount_, 0.);
-            // MIN MAX BUGS ....??
-            expLoss += loss * distIt->second;
-            distIt++;
+        for(Size k=0; k<probs.size(); k++) {
+            Real loss = k * lossUnit_;
+            loss = std::min(std::max(loss - attachAmount_, 0.), 
+                detachAmount_ - attachAmount_);
+            expLoss += loss * probs[k];
         }
-        return expLoss ;
-
-
-
-
-    ///////////////////////////////////////////////////////////////////////
-
-        // calculate inverted unconditional Ps first so we save the inversion:
-        // TO DO : turn to STL algorithm code
-        std::vector<Probability> uncDefProb = 
-            basket_->remainingProbabilities(date);
-
-        return copula_->integratedExpectedValue(
-            boost::function<Real (const std::vector<Real>& v1)>(
-                boost::bind(
-                    &RecursiveLossModel::expectedConditionalLoss,
-                    this,
-                    boost::cref(uncDefProb),
-                    _1)
-                )
-            );
-            */
-/**/
-        std::vector<Probability> uncDefProb = 
-            basket_->remainingProbabilities(date);
-        std::vector<Real> invProb;
-        for(Size i=0; i<uncDefProb.size(); i++)
-           invProb.push_back(copula_->inverseCumulativeY(uncDefProb[i], i));
-           ///  invProb.push_back(CP::inverseCumulativeY(uncDefProb[i], i));//<-static call
-        return copula_->integratedExpectedValue(
-            boost::function<Real (const std::vector<Real>& v1)>(
-                boost::bind(
-                    &RecursiveLossModel::expectedConditionalLossInvP,
-                    this,
-                    boost::cref(invProb),
-                    _1)
-                )
-            );
-            
+        return expLoss;
     }
 
     template<class CP>
     inline Disposable<std::vector<Real> > 
         RecursiveLossModel<CP>::lossProbability(const Date& date) const {
+        std::vector<Real> probs = lossProbabilities(date);
+        return probs;
+    }
 
+    // -------------------------------------------------------------------
+
+    template<class CP>
+    const std::vector<Probability>& 
+        RecursiveLossModel<CP>::lossProbabilities(const Date& date) const 
+    {
+        // invert the unconditional probabilities once for all the 
+        //   integration nodes
         std::vector<Probability> uncDefProb = 
             basket_->remainingProbabilities(date);
-        return copula_->integratedExpectedValue(
-            boost::function<Disposable<std::vector<Real> > (const std::vector<Real>& v1)>(
+        std::vector<Real> invProb(uncDefProb.size());
+        for(Size i=0; i<uncDefProb.size(); i++)
+            invProb[i] = copula_->inverseCumulativeY(uncDefProb[i], i);
+
+        // the correlation might have changed
+        if(copula_->factorWeights() != factorWeights_) {
+            lossProbabilities_.clear();
+            factorWeights_ = copula_->factorWeights();
+        }
+
+        typename std::map<Date, LossProbabilities>::iterator cached =
+            lossProbabilities_.find(date);
+        if(cached != lossProbabilities_.end() && 
+            cached->second.invProbs == invProb)
+            return cached->second.probs;
+
+        std::vector<Probability> probs = 
+            copula_->integratedExpectedValueInPlace(
                 boost::bind(
-                    &RecursiveLossModel::conditionalLossProb,
+                    &RecursiveLossModel::conditionalLossProbInvP,
                     this,
-                    boost::cref(uncDefProb),
-                    _1)
-                )
+                    boost::cref(invProb),
+                    _1, _2)
             );
+        LossProbabilities& entry = lossProbabilities_[date];
+        entry.invProbs.swap(invProb);
+        entry.probs.swap(probs);
+        return entry.probs;
     }
 
-    // -------------------------------------------------------------------
-
     template<class CP>
     void RecursiveLossModel<CP>::resetModel() {
         // basket update:
@@ -234,8 +226,17 @@ namespace QuantLib {
         lgds.erase(std::remove(lgds.begin(), lgds.end(), 0.), lgds.end());
         lossUnit_ = *(std::min_element(lgds.begin(), lgds.end()))
             / nBuckets_;
+        std::vector<Size> wk;
         for(Size i=0; i<remainingBsktSize_; i++)
-            wk_.push_back(std::floor(lgdsTmp[i]/lossUnit_ + .5));
+            wk.push_back(static_cast<Size>(
+                std::floor(lgdsTmp[i]/lossUnit_ + .5)));
+        maxLossUnits_ = std::accumulate(wk.begin(), wk.end(), Size(0));
+        // the cached distributions only depend on the pool losses in loss
+        //   units; keep them if the tranche alone has changed
+        if(wk != wk_) {
+            wk_.swap(wk);
+            lossProbabilities_.clear();
+        }
     }
 
     // make it return a distribution object?
@@ -244,12 +245,13 @@ namespace QuantLib {
         RecursiveLossModel<CP>::lossDistribution(const Date& d) const 
     {
         std::map<Real, Probability> distrib;
-        std::vector<Real> values  = lossProbability(d);
+        const std::vector<Probability>& values = lossProbabilities(d);
         Real sum = 0.;
         for(Size i=0; i<values.size(); i++) {
-            distrib.insert(std::make_pair<Real, Probability>(i * lossUnit_, 
-                sum + values[i]));
+            // skip the losses not attainable by the pool
+            if(i > 0 && values[i] == 0.) continue;
             sum += values[i];
+            distrib.insert(std::make_pair(i * lossUnit_, sum));
         }
         return distrib;
     }
@@ -326,206 +328,34 @@ namespace QuantLib {
     }
 
     template<class CP>
-    Disposable<std::map<Real, Probability> >
-        RecursiveLossModel<CP>::conditionalLossDistrib(
-            const std::vector<Probability>& pDefDate, 
-            //const Date& date,
-            const std::vector<Real>& mktFactor) const 
-    {
-        //eq. 10 p.68
-        //attainable losses distribution, recursive algorithm
-        const std::vector<Probability>& uncDefProb = pDefDate;// alias, remove
-
-        std::map<Real, Probability> pIndepDistrib;
-        ////////  K=0
-        pIndepDistrib.insert(std::make_pair(0., 1.));
-        for(Size iName=0; iName<remainingBsktSize_; iName++) {
-            Probability pDef =
-                copula_->conditionalDefaultProbability(uncDefProb[iName], iName,
-                                                mktFactor);
-            ////// iterate on all possible losses in the distribution:
-            std::map<Real, Probability> pDistTemp;
-            std::map<Real, Probability>::iterator distIt =
-                pIndepDistrib.begin();
-            while(distIt != pIndepDistrib.end()) {
-              ///   update prob if this name does not default
-                std::map<Real, Probability>::iterator matchIt
-                    = pDistTemp.find(distIt->first);
-                if(matchIt != pDistTemp.end()) {
-                    matchIt->second += distIt->second * (1.-pDef);
-                }else{
-                    pDistTemp.insert(std::make_pair(distIt->first,
-                        distIt->second * (1.-pDef)));
-                }
-              ////   and if it does
-                matchIt = pDistTemp.find(distIt->first + wk_[iName]);
-                if(matchIt != pDistTemp.end()) {
-                    matchIt->second += distIt->second * pDef;
-                }else{
-                    pDistTemp.insert(std::make_pair(
-                        distIt->first+wk_[iName], distIt->second * pDef));
-                }
-                distIt++;
-            }
-           /////  copy back
-            pIndepDistrib = pDistTemp;
-        }
-        /* Apply tranche limits now .... mind you this could be done outside*/
-        ////  to be done....
-        return pIndepDistrib;
-    }
-
-    template<class CP>
-    Disposable<std::map<Real, Probability> >
-        // twice?! rewrite one in terms of the other, this is a duplicate!
-        RecursiveLossModel<CP>::conditionalLossDistribInvP(
+    void RecursiveLossModel<CP>::conditionalLossProbInvP(
             const std::vector<Real>& invpDefDate, 
-            //const Date& date,
-            const std::vector<Real>& mktFactor) const 
+            const std::vector<Real>& mktFactor,
+            std::vector<Probability>& probs) const 
     {
         // eq. 10 p.68
-        // attainable losses distribution, recursive algorithm
-
-        std::map<Real, Probability> pIndepDistrib;
+        // attainable losses distribution, recursive algorithm on the loss
+        //   units, the losses of the names are integer multiples of the unit
+        probs.assign(maxLossUnits_ + 1, 0.);
         // K=0
-        pIndepDistrib.insert(std::make_pair(0., 1.));
+        probs[0] = 1.;
+        Size maxLoss = 0;
         for(Size iName=0; iName<remainingBsktSize_; iName++) {
+            const Size w = wk_[iName];
+            if(w == 0) continue;
             Probability pDef =
                 copula_->conditionalDefaultProbabilityInvP(invpDefDate[iName], 
                     iName, mktFactor);
-
-            // iterate on all possible losses in the distribution:
-            std::map<Real, Probability> pDistTemp;
-            std::map<Real, Probability>::iterator distIt =
-                pIndepDistrib.begin();
-            while(distIt != pIndepDistrib.end()) {
-                // update prob if this name does not default
-                std::map<Real, Probability>::iterator matchIt
-                    = pDistTemp.find(distIt->first);
-                if(matchIt != pDistTemp.end()) {
-                    matchIt->second += distIt->second * (1.-pDef);
-                }else{
-                    pDistTemp.insert(std::make_pair(distIt->first,
-                        distIt->second * (1.-pDef)));
-                }
-                // and if it does
-                matchIt = pDistTemp.find(distIt->first + wk_[iName]);
-                if(matchIt != pDistTemp.end()) {
-                    matchIt->second += distIt->second * pDef;
-                }else{
-                    pDistTemp.insert(std::make_pair(
-                        distIt->first+wk_[iName], distIt->second * pDef));
-                }
-                distIt++;
+            // update from the largest loss down, so that the losses
+            //   reached by this name default are not counted twice
+            for(Size k=maxLoss+1; k-- > 0; ) {
+                probs[k+w] += probs[k] * pDef;
+                probs[k] *= 1.-pDef;
             }
-            // copy back
-            pIndepDistrib = pDistTemp;
+            maxLoss += w;
         }
-        /* Apply tranche limits now .... mind you this could be done outside*/
-        return pIndepDistrib;
     }
 
-
-
-
-    /*
-    Bugs here???. The max min on the tranche looks 
-    wrong. It is better to have a tranche function since that way we can avoid 
-    adding up losses over all the posible losses rather than just over the 
-    tranche limits.
-    */
-    //! Portfolio loss conditional to the market factor value
-    template<class CP>
-    Real RecursiveLossModel<CP>::expectedConditionalLoss(
-        const std::vector<Probability>& pDefDate, 
-        //const Date& date,
-        const std::vector<Real>& mktFactor) const 
-    {
-        std::map<Real, Probability> pIndepDistrib =
-            conditionalLossDistrib(pDefDate, mktFactor);
-
-        // get the expected value subject to the value of the market
-        //   factor.
-        Real expLoss = 0.;
-        //---------------------------------------------------------------
-        /* This is the original (easy to read) loop which I have partially
-             unroll below to take profit of the fact that once we go over
-             the tranche top the loss amount is fixed:
-        */
-        std::map<Real, Probability>::iterator distIt =
-            pIndepDistrib.begin();
-
-        while(distIt != pIndepDistrib.end()) {
-            Real loss = distIt->first * lossUnit_;
-     //       loss = std::max(std::min(loss, detachAmount_)-attachAmount_, 0.);
-            loss = std::min(std::max(loss - attachAmount_, 0.), 
-                detachAmount_ - attachAmount_);
-            // MIN MAX BUGS ....??
-            expLoss += loss * distIt->second;
-            distIt++;
-        }
-        return expLoss ;
-    }
-
-    template<class CP>
-    // again, I am duplicating code.
-    Real RecursiveLossModel<CP>::expectedConditionalLossInvP(
-                                 const std::vector<Real>& invPDefDate, 
-                                 //const Date& date,
-                                 const std::vector<Real>& mktFactor) const 
-    {
-        std::map<Real, Probability> pIndepDistrib =
-            conditionalLossDistribInvP(invPDefDate, mktFactor);
-
-        // get the expected value subject to the value of the market
-        //   factor.
-        Real expLoss = 0.;
-        //---------------------------------------------------------------
-        /* This is the original (easy to read) loop which I have partially
-             unroll below to take profit of the fact that once we go over
-             the tranche top the loss amount is fixed:
-        */
-        std::map<Real, Probability>::iterator distIt =
-            pIndepDistrib.begin();
-
-        while(distIt != pIndepDistrib.end()) {
-            Real loss = distIt->first * lossUnit_;
-   //         loss = std::max(std::min(loss, detachAmount_)-attachAmount_, 0.);
-            loss = std::min(std::max(loss - attachAmount_, 0.), 
-                detachAmount_ - attachAmount_);
-            // MIN MAX BUGS ....???
-            expLoss += loss * distIt->second;
-            distIt++;
-        }
-        return expLoss ;
-    }
-
-    template<class CP>
-    Disposable<std::vector<Real> > RecursiveLossModel<CP>::conditionalLossProb(
-        const std::vector<Probability>& pDefDate, 
-        //const Date& date,
-        const std::vector<Real>& mktFactor) const 
-    {
-        std::map<Real, Probability> pIndepDistrib =
-            conditionalLossDistrib(pDefDate, mktFactor);
-
-        std::vector<Real> results;
-        std::map<Real, Probability>::iterator distIt = pIndepDistrib.begin();
-        while(distIt != pIndepDistrib.end()) {
-            //Real loss = distIt->first * loss_unit_
-            //                    ;
-            //loss = std::max(std::min(loss,
-            //    results_.xMax)-results_.xMin, 0.);
-            //expLoss += loss * distIt->second;
-
-            results.push_back(distIt->second);
-             distIt++;
-       }
-        return results;
-    }
-
-
-
 }
 
 #endif
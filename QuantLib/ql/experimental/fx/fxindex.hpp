@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -114,7 +114,7 @@ inline Date FxIndex::valueDate(const Date &fixingDate) const {
 inline Real FxIndex::pastFixing(const Date &fixingDate) const {
     QL_REQUIRE(isValidFixingDate(fixingDate),
                fixingDate << " is not a valid fixing date");
-    return timeSeries()[fixingDate];
+    return storedFixing(fixingDate);
 }
 }
 
@@ -16,6 +16,8 @@
 #include <ql/experimental/math/multidimintegrator.hpp>
 #include <ql/experimental/math/multidimquadrature.hpp>
 #include <ql/experimental/math/numericaldifferentiation.hpp>
+#include <ql/experimental/math/philox_multithreaded.hpp>
+#include <ql/experimental/math/philoxrng.hpp>
 #include <ql/experimental/math/piecewisefunction.hpp>
 #include <ql/experimental/math/piecewiseintegral.hpp>
 #include <ql/experimental/math/polarstudenttrng.hpp>
@@ -58,6 +58,9 @@ template <class RNG_MT, class IC> class InverseCumulativeRngMultiThreaded {
         const RNG_MT &uniformGeneratorMultiThreaded);
     //! returns a sample from a Gaussian distribution
     sample_type next(unsigned int threadId = 0) const;
+    Size numberOfThreads() const {
+        return uniformGeneratorMultiThreaded_.numberOfThreads();
+    }
 
   private:
     RNG_MT uniformGeneratorMultiThreaded_;
@@ -41,6 +41,7 @@ namespace QuantLib {
     \code
         USG_MT::sample_type USG::nextSequence(int threadId) const;
         Size USG_MT::dimension() const;
+        Size USG_MT::numberOfThreads() const;
     \endcode
 
     The inverse cumulative distribution is supplied by IC.
@@ -64,12 +65,13 @@ template <class USG_MT, class IC> class InverseCumulativeRsgMultiThreaded {
     //! returns next sample from the inverse cumulative distribution
     const sample_type &nextSequence(unsigned int threadId) const;
     const sample_type &lastSequence(unsigned int threadId) const {
-        QL_REQUIRE(threadId < USG_MT::maxNumberOfThreads,
+        QL_REQUIRE(threadId < x_.size(),
                    "thread id (" << threadId << ") out of bounds [0..."
-                                 << USG_MT::maxNumberOfThreads - 1 << "]");
+                                 << x_.size() - 1 << "]");
         return x_[threadId];
     }
     Size dimension() const { return dimension_; }
+    Size numberOfThreads() const { return x_.size(); }
 
   private:
     USG_MT uniformSequenceGeneratorMultiThreaded_;
@@ -84,7 +86,7 @@ InverseCumulativeRsgMultiThreaded<
     : uniformSequenceGeneratorMultiThreaded_(usg_mt),
       dimension_(uniformSequenceGeneratorMultiThreaded_.dimension()),
       x_(std::vector<sample_type>(
-          USG_MT::maxNumberOfThreads,
+          uniformSequenceGeneratorMultiThreaded_.numberOfThreads(),
           sample_type(std::vector<Real>(dimension_), 1.0))) {}
 
 template <class USG_MT, class IC>
@@ -94,7 +96,7 @@ InverseCumulativeRsgMultiThreaded<
     : uniformSequenceGeneratorMultiThreaded_(usg_mt),
       dimension_(uniformSequenceGeneratorMultiThreaded_.dimension()),
       x_(std::vector<sample_type>(
-          USG_MT::maxNumberOfThreads,
+          uniformSequenceGeneratorMultiThreaded_.numberOfThreads(),
           sample_type(std::vector<Real>(dimension_), 1.0))),
       ICD_(inverseCum) {}
 
@@ -104,9 +106,9 @@ inline const typename InverseCumulativeRsgMultiThreaded<USG_MT,
 InverseCumulativeRsgMultiThreaded<USG_MT, IC>::nextSequence(
     unsigned int threadId) const {
 
-    QL_REQUIRE(threadId < USG_MT::maxNumberOfThreads,
+    QL_REQUIRE(threadId < x_.size(),
                "thread id (" << threadId << ") out of bounds [0..."
-               << USG_MT::maxNumberOfThreads - 1 << "]");
+               << x_.size() - 1 << "]");
     typename USG_MT::sample_type sample =
         uniformSequenceGeneratorMultiThreaded_.nextSequence(threadId);
     x_[threadId].weight = sample.weight;
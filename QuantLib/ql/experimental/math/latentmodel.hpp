@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2008 Roland Lichters
  Copyright (C) 2014 Jose Aparicio
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -56,6 +57,17 @@ namespace QuantLib {
                 return v;
             }
         };
+        // adapts a vector integrand to the in-place integration
+        struct assignV {
+            typedef void result_type;
+            void operator()(const boost::function<Disposable<std::vector<Real> >(
+                                const std::vector<Real>& v1)>& f,
+                            const std::vector<Real>& arg,
+                            std::vector<Real>& value) const {
+                std::vector<Real> v = f(arg);
+                value.swap(v);
+            }
+        };
     }
 
     //! \name Latent model direct integration facility.
@@ -88,6 +100,14 @@ namespace QuantLib {
             const std::vector<Real>& arg)>& f) const {
             QL_FAIL("No vector integration provided");
         }
+        /* integral of a vector function writing its value into the vector
+        passed instead of returning it, which avoids allocating a vector on
+        each node */
+        virtual Disposable<std::vector<Real> > integrateVInPlace(
+            const boost::function<void (const std::vector<Real>& arg,
+                std::vector<Real>& value)>& f) const {
+            QL_FAIL("No in-place vector integration provided");
+        }
         virtual ~LMIntegration() {}
     };
 
@@ -107,30 +127,50 @@ namespace QuantLib {
         typedef 
         enum LatentModelIntegrationType {
             GaussianQuadrature,
-            Trapezoid
+            Trapezoid,
+            /* Gaussian quadrature on the tensor grid of nodes, spread over
+            the OpenMP threads; the integrands must be thread safe. */
+            ParallelGaussianQuadrature
             // etc....
         } LatentModelIntegrationType;
     }
 
     /* class template specializations. I havent use CRTP type cast directly
     because the signature of the integrators is different, grid integration
-    needs the domain. */
+    needs the domain. 
+    The quadrature integrates on nThreads threads over the tensor grid of
+    nodes (all the OpenMP threads if null); with one thread the scalar and
+    vector integrations keep the recursion along the dimensions. */
     template<> class IntegrationBase<GaussianQuadMultidimIntegrator> : 
     public GaussianQuadMultidimIntegrator, public LMIntegration {
     public:
-        IntegrationBase(Size dimension, Size order) 
-        : GaussianQuadMultidimIntegrator(dimension, order) {}
+        IntegrationBase(Size dimension, Size order, Size nThreads = 1) 
+        : GaussianQuadMultidimIntegrator(dimension, order),
+          nThreads_(nThreads) {}
         Real integrate(const boost::function<Real (
             const std::vector<Real>& arg)>& f) const {
-                return GaussianQuadMultidimIntegrator::integrate<Real>(f);
+                if(nThreads_ == 1)
+                    return GaussianQuadMultidimIntegrator::integrate<Real>(f);
+                return integrateGrid(f, nThreads_);
         }
         Disposable<std::vector<Real> > integrateV(
             const boost::function<Disposable<std::vector<Real> >  (
                 const std::vector<Real>& arg)>& f) const {
-                return GaussianQuadMultidimIntegrator::
-                    integrate<Disposable<std::vector<Real> > >(f);
+                if(nThreads_ == 1)
+                    return GaussianQuadMultidimIntegrator::
+                        integrate<Disposable<std::vector<Real> > >(f);
+                return integrateGridV(
+                    boost::bind(detail::assignV(), boost::cref(f), _1, _2),
+                    nThreads_);
+        }
+        Disposable<std::vector<Real> > integrateVInPlace(
+            const boost::function<void (const std::vector<Real>& arg,
+                std::vector<Real>& value)>& f) const {
+                return integrateGridV(f, nThreads_);
         }
         virtual ~IntegrationBase() {}
+    private:
+        Size nThreads_;
     };
 
     template<> class IntegrationBase<MultidimIntegral> : 
@@ -416,6 +456,13 @@ namespace QuantLib {
             : sequenceGen_(copula.numFactors(), seed), // base case construction
               x_(std::vector<Real>(copula.numFactors()), 1.0),
               copula_(copula) { }
+            /*! Uses a copy of the given sequence generator, e.g. one
+                positioned at the start of a substream in a multithreaded
+                simulation. */
+            FactorSampler(const copulaType& copula, const USNG& sequenceGen)
+            : sequenceGen_(sequenceGen),
+              x_(std::vector<Real>(copula.numFactors()), 1.0),
+              copula_(copula) { }
             /*! Returns a sample of the factor set \f$ M_k\,Z_i\f$. 
             This method has the vocation of being specialized at particular 
             types of the copula with a more efficient inversion to generate the 
@@ -463,6 +510,12 @@ namespace QuantLib {
                             IntegrationBase<GaussianQuadMultidimIntegrator> >(
                                 dimension, 25);
                         break;
+                    case LatentModelIntegrationType::ParallelGaussianQuadrature:
+                        return 
+                            boost::make_shared<
+                            IntegrationBase<GaussianQuadMultidimIntegrator> >(
+                                dimension, 25, Null<Size>());
+                        break;
                     case LatentModelIntegrationType::Trapezoid:
                         {
                         std::vector<boost::shared_ptr<Integrator> > integrals;
@@ -599,6 +652,29 @@ namespace QuantLib {
                         boost::bind(&copulaPolicyImpl::density, copula_, _1),
                         boost::bind(boost::cref(f), _1)));
         }
+        /*! Integrates an arbitrary vector function over the density domain.
+         The function writes its value into the vector passed, which saves
+         the allocation of a vector on each integration node. Only the
+         quadrature integrations provide it.
+        */
+        Disposable<std::vector<Real> > integratedExpectedValueInPlace(
+            const boost::function<void (const std::vector<Real>& v1,
+                std::vector<Real>& value)>& f) const {
+            return
+                integration()->integrateVInPlace(
+                    boost::bind(&LatentModel::densityWeightedValue, this,
+                        boost::cref(f), _1, _2));
+        }
+    private:
+        void densityWeightedValue(
+            const boost::function<void (const std::vector<Real>& v1,
+                std::vector<Real>& value)>& f,
+            const std::vector<Real>& arg, std::vector<Real>& value) const {
+            f(arg, value);
+            const Real density = copula_.density(arg);
+            for(Size i=0; i<value.size(); i++)
+                value[i] *= density;
+        }
     protected:
         // Integrable models must provide their integrator.
         // Arguable, not having the integration in the LM class saves that 
@@ -29,6 +29,11 @@
 
 namespace QuantLib {
 
+/*! \warning the number of threads is limited by the tabulated dynamic
+             creator parameter sets, use PhiloxMultiThreaded if more
+             threads are needed
+*/
+
 class MersenneTwisterMultiThreaded {
   public:
     typedef Sample<Real> sample_type;
@@ -37,6 +42,8 @@ class MersenneTwisterMultiThreaded {
     // if given seed is 0 then a clock based seed is used
     MersenneTwisterMultiThreaded(const unsigned long seed = 0);
 
+    Size numberOfThreads() const { return maxNumberOfThreads; }
+
     sample_type next(unsigned int threadId) const;
     Real nextReal(unsigned int threadId) const;
     unsigned long operator()(unsigned int threadId) const;
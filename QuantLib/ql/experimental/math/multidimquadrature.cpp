@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2014 Jose Aparicio
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -19,8 +20,25 @@
 
 #include <ql/experimental/math/multidimquadrature.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace QuantLib {
 
+    namespace {
+
+        Size numberOfThreads(Size nThreads, Size blocks) {
+            Size n = 1;
+            #ifdef _OPENMP
+            n = nThreads == Null<Size>() ?
+                static_cast<Size>(omp_get_max_threads()) : nThreads;
+            #endif
+            return std::max<Size>(1, std::min(n, blocks));
+        }
+
+    }
+
     GaussianQuadMultidimIntegrator::GaussianQuadMultidimIntegrator(
         Size dimension, Size quadOrder, Real mu) 
         : integral_(quadOrder, mu),
@@ -31,6 +49,127 @@ namespace QuantLib {
           varBuffer_(dimension_, 0.)
     {
         spawnFcts<maxDimensions_>();
+        nodes_.assign(integral_.x().begin(), integral_.x().end());
+        weights_.assign(integral_.weights().begin(),
+                        integral_.weights().end());
+    }
+
+    Real GaussianQuadMultidimIntegrator::integrateGrid(
+        const boost::function<Real (const std::vector<Real>& v1)>& f,
+        Size nThreads) const
+    {
+        const Size n = nodes_.size();
+        const Size inner = dimension_ - 1;
+        const Size threads = numberOfThreads(nThreads, n);
+        std::vector<Real> partialSums(n, 0.0);
+        std::vector<std::string> errors(n);
+
+        #pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(threads)) if(threads > 1)
+        for (Size i=0; i<n; ++i) {
+            try {
+                std::vector<Real> arg(dimension_, nodes_[0]);
+                std::vector<Size> index(inner, 0);
+                arg[inner] = nodes_[i];
+                Real sum = 0.0;
+                for (;;) {
+                    Real w = weights_[i];
+                    for (Size k=0; k<inner; ++k)
+                        w *= weights_[index[k]];
+                    sum += w * f(arg);
+                    // next node of the block
+                    Size k = 0;
+                    while (k < inner && ++index[k] == n) {
+                        index[k] = 0;
+                        arg[k] = nodes_[0];
+                        ++k;
+                    }
+                    if (k == inner)
+                        break;
+                    arg[k] = nodes_[index[k]];
+                }
+                partialSums[i] = sum;
+            } catch (std::exception& e) {
+                errors[i] = e.what();
+            } catch (...) {
+                errors[i] = "unknown error";
+            }
+        }
+
+        Real result = 0.0;
+        for (Size i=0; i<n; ++i) {
+            QL_REQUIRE(errors[i].empty(),
+                       "error in integration block #" << i << ": " <<
+                       errors[i]);
+            result += partialSums[i];
+        }
+        return result;
+    }
+
+    Disposable<std::vector<Real> > GaussianQuadMultidimIntegrator::integrateGridV(
+        const boost::function<void (const std::vector<Real>& v1,
+                                    std::vector<Real>& value)>& f,
+        Size nThreads) const
+    {
+        const Size n = nodes_.size();
+        const Size inner = dimension_ - 1;
+        const Size threads = numberOfThreads(nThreads, n);
+        std::vector<std::vector<Real> > partialSums(n);
+        std::vector<std::string> errors(n);
+
+        #pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(threads)) if(threads > 1)
+        for (Size i=0; i<n; ++i) {
+            try {
+                std::vector<Real> arg(dimension_, nodes_[0]);
+                std::vector<Size> index(inner, 0);
+                arg[inner] = nodes_[i];
+                std::vector<Real> value;
+                std::vector<Real>& sum = partialSums[i];
+                for (;;) {
+                    Real w = weights_[i];
+                    for (Size k=0; k<inner; ++k)
+                        w *= weights_[index[k]];
+                    f(arg, value);
+                    if (sum.empty())
+                        sum.resize(value.size(), 0.0);
+                    QL_REQUIRE(value.size() == sum.size(),
+                               "integrand size changed from " << sum.size() <<
+                               " to " << value.size());
+                    for (Size j=0; j<sum.size(); ++j)
+                        sum[j] += w * value[j];
+                    // next node of the block
+                    Size k = 0;
+                    while (k < inner && ++index[k] == n) {
+                        index[k] = 0;
+                        arg[k] = nodes_[0];
+                        ++k;
+                    }
+                    if (k == inner)
+                        break;
+                    arg[k] = nodes_[index[k]];
+                }
+            } catch (std::exception& e) {
+                errors[i] = e.what();
+            } catch (...) {
+                errors[i] = "unknown error";
+            }
+        }
+
+        std::vector<Real> result;
+        for (Size i=0; i<n; ++i) {
+            QL_REQUIRE(errors[i].empty(),
+                       "error in integration block #" << i << ": " <<
+                       errors[i]);
+            if (i == 0)
+                result = partialSums[0];
+            else {
+                QL_REQUIRE(partialSums[i].size() == result.size(),
+                           "integrand size changed from " << result.size() <<
+                           " to " << partialSums[i].size());
+                for (Size j=0; j<result.size(); ++j)
+                    result[j] += partialSums[i][j];
+            }
+        }
+        return result;
     }
 
 }
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2014 Jose Aparicio
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -21,6 +22,7 @@
 #define quantlib_math_multidimquadrature_hpp
 
 #include <ql/math/integrals/gaussianquadratures.hpp>
+#include <ql/utilities/null.hpp>
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 #include <boost/lambda/bind.hpp>
@@ -112,6 +114,27 @@ namespace QuantLib {
         RetType_T integrate(const boost::function<RetType_T (
             const std::vector<Real>& v1)>& f) const;
 
+        //! \name Tensor grid integration
+        /*! The integrand is evaluated on the tensor grid of the quadrature
+            nodes, in blocks of nodes sharing the value of the last
+            variable. The blocks are spread over nThreads threads (the
+            OpenMP default if null) and their partial sums are added in a
+            fixed order, so that the results do not depend on the number
+            of threads. The integrand must be safe to call concurrently.
+        */
+        //@{
+        Real integrateGrid(
+            const boost::function<Real (const std::vector<Real>& v1)>& f,
+            Size nThreads = Null<Size>()) const;
+        /*! The integrand writes its value into the vector passed, which
+            is reused for all the nodes of a block.
+        */
+        Disposable<std::vector<Real> > integrateGridV(
+            const boost::function<void (const std::vector<Real>& v1,
+                                        std::vector<Real>& value)>& f,
+            Size nThreads = Null<Size>()) const;
+        //@}
+
     private:
         /* The maximum number of dimensions of the integration variable domain
             A higher than this number of dimension would presumably be 
@@ -191,6 +214,8 @@ namespace QuantLib {
         Size dimension_;
         // integration veriable buffer
         mutable std::vector<Real> varBuffer_;
+        // one dimensional nodes and weights for the tensor grid
+        std::vector<Real> nodes_, weights_;
     };
 
 
@@ -0,0 +1,120 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file philox_multithreaded.hpp
+    \brief multi threaded philox generator (for an arbitrary number of
+           threads)
+*/
+
+#ifndef quantlib_philox_multithreaded_hpp
+#define quantlib_philox_multithreaded_hpp
+
+#include <ql/experimental/math/philoxrng.hpp>
+#include <ql/utilities/null.hpp>
+#include <ql/errors.hpp>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace QuantLib {
+
+/*! Multi threaded uniform generator with the same interface as
+    MersenneTwisterMultiThreaded, but with a number of streams chosen
+    at run time. Thread i draws from the Philox stream with id i, all
+    streams share the same seed, so that stream i is the same for any
+    number of streams. The streams are padded to separate cache lines,
+    so that threads do not share state.
+
+    If no number of streams is given, one stream per thread available
+    to OpenMP at construction is created (a single one if OpenMP is not
+    enabled). Since the streams are not limited at compile time,
+    maxNumberOfThreads only flags the generator as multithreaded, the
+    actual limit is given by numberOfThreads().
+*/
+
+class PhiloxMultiThreaded {
+  public:
+    typedef Sample<Real> sample_type;
+    static const Size maxNumberOfThreads = QL_MAX_INTEGER;
+
+    // if given seed is 0 then a clock based seed is used
+    explicit PhiloxMultiThreaded(const unsigned long seed = 0,
+                                 Size numberOfStreams = Null<Size>());
+
+    //! number of streams, i.e. of threads that can draw concurrently
+    Size numberOfThreads() const { return streams_.size(); }
+
+    sample_type next(unsigned int threadId) const {
+        return stream(threadId).next();
+    }
+    Real nextReal(unsigned int threadId) const {
+        return stream(threadId).nextReal();
+    }
+    unsigned long operator()(unsigned int threadId) const {
+        return stream(threadId).nextInt32();
+    }
+    unsigned long nextInt32(unsigned int threadId) const {
+        return stream(threadId).nextInt32();
+    }
+    //! skips the next z numbers of the given thread's stream in O(1)
+    void discard(unsigned int threadId, uint64_t z) const {
+        stream(threadId).discard(z);
+    }
+
+  private:
+    struct PaddedStream {
+        PhiloxRng rng;
+        char padding[64];
+    };
+    PhiloxRng &stream(unsigned int threadId) const {
+        QL_REQUIRE(threadId < streams_.size(),
+                   "thread " << threadId << " out of range [0..."
+                             << streams_.size() - 1 << "]");
+        return streams_[threadId].rng;
+    }
+    mutable std::vector<PaddedStream> streams_;
+};
+
+inline PhiloxMultiThreaded::PhiloxMultiThreaded(const unsigned long seed,
+                                                Size numberOfStreams) {
+    if (numberOfStreams == Null<Size>()) {
+#ifdef _OPENMP
+        numberOfStreams = static_cast<Size>(omp_get_max_threads());
+#else
+        numberOfStreams = 1;
+#endif
+    }
+    QL_REQUIRE(numberOfStreams > 0, "at least one stream required");
+    streams_.resize(numberOfStreams);
+    // resolve a clock based seed once, so that the streams only differ
+    // in their stream id
+    uint64_t s = seed == 0
+                     ? static_cast<uint64_t>(SeedGenerator::instance().get())
+                     : static_cast<uint64_t>(seed);
+    if (s == 0)
+        s = 1;
+    for (Size i = 0; i < numberOfStreams; ++i)
+        streams_[i].rng.resetSeed(s, static_cast<uint32_t>(i));
+}
+
+} // namespace QuantLib
+
+#endif
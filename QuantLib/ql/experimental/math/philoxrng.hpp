@@ -0,0 +1,142 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file philoxrng.hpp
+    \brief counter based Philox4x32-10 uniform random number generator
+*/
+
+#ifndef quantlib_philox_rng_hpp
+#define quantlib_philox_rng_hpp
+
+#include <ql/methods/montecarlo/sample.hpp>
+#include <ql/math/randomnumbers/seedgenerator.hpp>
+#include <boost/cstdint.hpp>
+
+namespace QuantLib {
+
+/*! Counter based random number generator Philox4x32 with 10 rounds, see
+
+    J. K. Salmon, M. A. Moraes, R. O. Dror, D. E. Shaw: Parallel random
+    numbers: as easy as 1, 2, 3, Proceedings of 2011 International
+    Conference for High Performance Computing, Networking, Storage and
+    Analysis
+
+    The n-th number of a stream is a function of n, the seed and the
+    stream id, so that discard() is O(1) and the streams for different
+    ids are independent. This makes the generator suitable to set up
+    an arbitrary number of parallel streams. The full 64 bit seed is
+    used as the Philox key, the stream id and the position within the
+    stream form the counter.
+
+    \test the generator is checked against the known answer tests of the
+          reference implementation
+*/
+
+class PhiloxRng {
+  public:
+    typedef Sample<Real> sample_type;
+
+    // if given seed is 0 then a clock based seed is used
+    PhiloxRng(const uint64_t seed = 0, const uint32_t stream = 0);
+
+    void resetSeed(const uint64_t seed, const uint32_t stream = 0);
+    sample_type next();
+    Real nextReal();
+    unsigned long operator()();
+    unsigned long nextInt32();
+    void discard(uint64_t z);
+
+    //! the raw Philox4x32-10 bijection
+    static void block(const uint32_t counter[4], const uint32_t key[2],
+                      uint32_t result[4]);
+
+  private:
+    uint32_t key_[2], stream_, buffer_[4];
+    uint64_t position_, bufferBlock_;
+};
+
+// inline definitions
+
+inline PhiloxRng::PhiloxRng(const uint64_t seed, const uint32_t stream) {
+    resetSeed(seed, stream);
+}
+
+inline void PhiloxRng::resetSeed(const uint64_t seed, const uint32_t stream) {
+    uint64_t s =
+        seed == 0 ? static_cast<uint64_t>(SeedGenerator::instance().get())
+                  : seed;
+    key_[0] = static_cast<uint32_t>(s);
+    key_[1] = static_cast<uint32_t>(s >> 32);
+    stream_ = stream;
+    position_ = 0;
+    bufferBlock_ = ~UINT64_C(0);
+}
+
+inline PhiloxRng::sample_type PhiloxRng::next() {
+    return sample_type(nextReal(), 1.0);
+}
+
+inline Real PhiloxRng::nextReal() {
+    return (Real(nextInt32()) + 0.5) / 4294967296.0;
+}
+
+inline unsigned long PhiloxRng::operator()() { return nextInt32(); }
+
+inline unsigned long PhiloxRng::nextInt32() {
+    uint64_t b = position_ >> 2;
+    if (b != bufferBlock_) {
+        uint32_t counter[4] = {static_cast<uint32_t>(b),
+                               static_cast<uint32_t>(b >> 32), stream_, 0};
+        block(counter, key_, buffer_);
+        bufferBlock_ = b;
+    }
+    return static_cast<unsigned long>(buffer_[position_++ & 3]);
+}
+
+inline void PhiloxRng::discard(uint64_t z) { position_ += z; }
+
+inline void PhiloxRng::block(const uint32_t counter[4], const uint32_t key[2],
+                             uint32_t result[4]) {
+    const uint32_t m0 = UINT32_C(0xD2511F53), m1 = UINT32_C(0xCD9E8D57);
+    const uint32_t w0 = UINT32_C(0x9E3779B9), w1 = UINT32_C(0xBB67AE85);
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2],
+             c3 = counter[3], k0 = key[0], k1 = key[1];
+    for (int r = 0; r < 10; ++r) {
+        uint64_t p0 = static_cast<uint64_t>(m0) * c0;
+        uint64_t p1 = static_cast<uint64_t>(m1) * c2;
+        uint32_t hi0 = static_cast<uint32_t>(p0 >> 32),
+                 lo0 = static_cast<uint32_t>(p0);
+        uint32_t hi1 = static_cast<uint32_t>(p1 >> 32),
+                 lo1 = static_cast<uint32_t>(p1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += w0;
+        k1 += w1;
+    }
+    result[0] = c0;
+    result[1] = c1;
+    result[2] = c2;
+    result[3] = c3;
+}
+
+} // namespace QuantLib
+
+#endif
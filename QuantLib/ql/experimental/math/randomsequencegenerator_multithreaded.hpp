@@ -39,6 +39,7 @@ namespace QuantLib {
     Class RNG_MT must implement the following interface:
     \code
         RNG_MT::sample_type RNG::next(int threadId) const;
+        Size RNG_MT::numberOfThreads() const;
     \endcode
     If a client of this class wants to use the nextInt32Sequence method,
     class RNG must also implement
@@ -57,10 +58,10 @@ template <class RNG_MT> class RandomSequenceGeneratorMultiThreaded {
                                          const RNG_MT &rng_mt)
         : dimensionality_(dimensionality), rng_mt_(rng_mt),
           sequence_(std::vector<sample_type>(
-              maxNumberOfThreads,
+              rng_mt_.numberOfThreads(),
               sample_type(std::vector<Real>(dimensionality), 1.0))),
           int32Sequence_(std::vector<std::vector<BigNatural> >(
-              RNG_MT::maxNumberOfThreads,
+              rng_mt_.numberOfThreads(),
               std::vector<BigNatural>(dimensionality))) {
         QL_REQUIRE(dimensionality > 0, "dimensionality must be greater than 0");
     }
@@ -69,16 +70,16 @@ template <class RNG_MT> class RandomSequenceGeneratorMultiThreaded {
                                          BigNatural seed = 0)
         : dimensionality_(dimensionality), rng_mt_(seed),
           sequence_(std::vector<sample_type>(
-              maxNumberOfThreads,
+              rng_mt_.numberOfThreads(),
               sample_type(std::vector<Real>(dimensionality), 1.0))),
           int32Sequence_(std::vector<std::vector<BigNatural> >(
-              RNG_MT::maxNumberOfThreads,
+              rng_mt_.numberOfThreads(),
               std::vector<BigNatural>(dimensionality))) {}
 
     const sample_type &nextSequence(unsigned int threadId) const {
-        QL_REQUIRE(threadId < RNG_MT::maxNumberOfThreads,
+        QL_REQUIRE(threadId < sequence_.size(),
                    "thread id (" << threadId << ") out of bounds [0..."
-                                 << RNG_MT::maxNumberOfThreads - 1 << "]");
+                                 << sequence_.size() - 1 << "]");
         sequence_[threadId].weight = 1.0;
         for (Size i = 0; i < dimensionality_; i++) {
             typename RNG_MT::sample_type x(rng_mt_.next(threadId));
@@ -89,9 +90,9 @@ template <class RNG_MT> class RandomSequenceGeneratorMultiThreaded {
     }
 
     std::vector<BigNatural> nextInt32Sequence(unsigned int threadId) const {
-        QL_REQUIRE(threadId < RNG_MT::maxNumberOfThreads,
+        QL_REQUIRE(threadId < sequence_.size(),
                    "thread id (" << threadId << ") out of bounds [0..."
-                                 << RNG_MT::maxNumberOfThreads - 1 << "]");
+                                 << sequence_.size() - 1 << "]");
         for (Size i = 0; i < dimensionality_; i++) {
             int32Sequence_[threadId][i] = rng_mt_[threadId].nextInt32(threadId);
         }
@@ -99,13 +100,14 @@ template <class RNG_MT> class RandomSequenceGeneratorMultiThreaded {
     }
 
     const sample_type &lastSequence(unsigned int threadId) const {
-        QL_REQUIRE(threadId < RNG_MT::maxNumberOfThreads,
+        QL_REQUIRE(threadId < sequence_.size(),
                    "thread id (" << threadId << ") out of bounds [0..."
-                                 << RNG_MT::maxNumberOfThreads - 1 << "]");
+                                 << sequence_.size() - 1 << "]");
         return sequence_[threadId];
     }
 
     Size dimension() const { return dimensionality_; }
+    Size numberOfThreads() const { return sequence_.size(); }
 
   private:
     Size dimensionality_;
@@ -25,6 +25,7 @@
 #define quantlib_rng_traits_multithreaded_hpp
 
 #include <ql/experimental/math/mersennetwister_multithreaded.hpp>
+#include <ql/experimental/math/philox_multithreaded.hpp>
 #include <ql/experimental/math/inversecumulativerng_multithreaded.hpp>
 #include <ql/experimental/math/randomsequencegenerator_multithreaded.hpp>
 #include <ql/experimental/math/inversecumulativersg_multithreaded.hpp>
@@ -66,6 +67,10 @@ typedef GenericPseudoRandomMultiThreaded<MersenneTwisterMultiThreaded,
 typedef GenericPseudoRandomMultiThreaded<
     MersenneTwisterMultiThreaded, InverseCumulativePoisson> PoissonPseudoRandomMultiThreaded;
 
+//! pseudo-random number generator traits with one philox stream per thread
+typedef GenericPseudoRandomMultiThreaded<
+    PhiloxMultiThreaded, InverseCumulativeNormal> PseudoRandomPhiloxMultiThreaded;
+
 
 } // namespace QuantLib
 
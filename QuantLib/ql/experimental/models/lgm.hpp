@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -70,9 +70,25 @@ template <class Impl> class Lgm : public Gaussian1dModel {
                          const Handle<YieldTermStructure> &yts,
                          const Handle<YieldTermStructure> &ytsNumeraire,
                          const bool adjusted) const;
+    const Disposable<Array>
+    numeraireImpl(const Time t, const Array &y,
+                  const Handle<YieldTermStructure> &yts) const;
+    const Disposable<Array> zerobondImpl(const Time T, const Time t,
+                                         const Array &y,
+                                         const Handle<YieldTermStructure> &yts,
+                                         const bool adjusted) const;
+    const Disposable<Array>
+    deflatedZerobondImpl(const Time T, const Time t, const Array &y,
+                         const Handle<YieldTermStructure> &yts,
+                         const Handle<YieldTermStructure> &ytsNumeraire,
+                         const bool adjusted) const;
     bool preferDeflatedZerobond() const {
         return true;
     }
+    bool affineRepresentation(const std::vector<Time> &times,
+                              std::vector<Real> &H, std::vector<Real> &m,
+                              std::vector<Real> &s, std::vector<Real> &zeta,
+                              Time &numeraireTime, Real &numeraireH) const;
 
   private:
     boost::shared_ptr<detail::LgmParametrization<Impl> > parametrization_;
@@ -121,6 +137,81 @@ inline const Real Lgm<Impl>::zerobondImpl(const Time T, const Time t,
            numeraire(t, y, yts);
 }
 
+template <class Impl>
+inline const Disposable<Array>
+Lgm<Impl>::numeraireImpl(const Time t, const Array &y,
+                         const Handle<YieldTermStructure> &yts) const {
+    calculate();
+    Handle<YieldTermStructure> tmp = yts.empty() ? this->termStructure() : yts;
+    Real sd = stateProcess()->stdDeviation(0.0, 0.0, t);
+    Real e = stateProcess()->expectation(0.0, 0.0, t);
+    Real h = parametrization_->H(t);
+    Real z = parametrization_->zeta(t);
+    Real d = 1.0 / tmp->discount(t);
+    Array res(y.size());
+    for (Size i = 0; i < y.size(); ++i) {
+        Real x = y[i] * sd + e;
+        res[i] = d * std::exp(h * x + 0.5 * h * h * z);
+    }
+    return res;
+}
+
+template <class Impl>
+inline const Disposable<Array>
+Lgm<Impl>::deflatedZerobondImpl(const Time T, const Time t, const Array &y,
+                                const Handle<YieldTermStructure> &yts,
+                                const Handle<YieldTermStructure> &ytsNumeraire,
+                                const bool) const {
+    calculate();
+    Handle<YieldTermStructure> tmp = yts.empty() ? termStructure() : yts;
+    Handle<YieldTermStructure> tmp2 =
+        ytsNumeraire.empty() ? termStructure() : ytsNumeraire;
+    Real sd = stateProcess()->stdDeviation(0.0, 0.0, t);
+    Real e = stateProcess()->expectation(0.0, 0.0, t);
+    Real hT = parametrization_->H(T);
+    Real z = parametrization_->zeta(t);
+    Real d = tmp->discount(T) / tmp->discount(t) * tmp2->discount(t);
+    Array res(y.size());
+    for (Size i = 0; i < y.size(); ++i) {
+        Real x = y[i] * sd + e;
+        res[i] = d * std::exp(-hT * x - 0.5 * hT * hT * z);
+    }
+    return res;
+}
+
+template <class Impl>
+inline const Disposable<Array>
+Lgm<Impl>::zerobondImpl(const Time T, const Time t, const Array &y,
+                        const Handle<YieldTermStructure> &yts,
+                        const bool adjusted) const {
+    calculate();
+    return deflatedZerobondImpl(T, t, y, yts, yts, adjusted) *
+           numeraire(t, y, yts);
+}
+
+template <class Impl>
+inline bool Lgm<Impl>::affineRepresentation(
+    const std::vector<Time> &times, std::vector<Real> &H, std::vector<Real> &m,
+    std::vector<Real> &s, std::vector<Real> &zeta, Time &numeraireTime,
+    Real &numeraireH) const {
+    calculate();
+    H.resize(times.size());
+    m.resize(times.size());
+    s.resize(times.size());
+    zeta.resize(times.size());
+    for (Size i = 0; i < times.size(); ++i) {
+        H[i] = parametrization_->H(times[i]);
+        zeta[i] = parametrization_->zeta(times[i]);
+        m[i] = stateProcess()->expectation(0.0, 0.0, times[i]) +
+               H[i] * zeta[i];
+        s[i] = stateProcess()->stdDeviation(0.0, 0.0, times[i]);
+    }
+    // the numeraire is 1 / P(0,t) exp(H(t)x + 0.5 H(t)^2 zeta(t))
+    numeraireTime = 0.0;
+    numeraireH = 0.0;
+    return true;
+}
+
 template <class Impl>
 inline void Lgm<Impl>::setParametrization(
     const boost::shared_ptr<detail::LgmParametrization<Impl> >
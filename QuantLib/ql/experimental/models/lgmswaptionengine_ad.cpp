@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -18,29 +18,103 @@
 */
 
 #include <ql/experimental/models/lgmswaptionengine_ad.hpp>
+#include <ql/math/distributions/normaldistribution.hpp>
 #include <ql/payoff.hpp>
 
 namespace QuantLib {
 
 namespace {
-// ad library interface
-// for the plain interface, remove ad_ from the method name
-// and the parameter dres from the parameter list, and below
-// in the invokation.
-// for a stub interface remove extern "C" and add a dummy
-// implementation (with just a return statement).
-extern "C" void lgm_swaption_engine_ad_(
-    int *n_times, double *times, double *modpar, int *n_expiries, int *expiries,
-    int *callput, int *n_floats, int *float_startidxes, double *float_mults,
-    double *index_acctimes, double *float_spreads, int *float_t1s,
-    int *float_t2s, int *float_tps, int *fix_startidxes, int *n_fixs,
-    double *fix_cpn, int *fix_tps, int *integration_points, double *stddevs,
-    double *res, double *dres);
+
+// model data and trade description on the joint time grid
+struct LgmSwaptionData {
+    std::vector<Real> H, zeta, discount;
+    std::vector<int> expiries, fixStartIdxes, floatStartIdxes;
+    std::vector<int> floatT1s, floatT2s, floatTps, fixTps;
+    std::vector<Real> floatMults, indexAccTimes, floatSpreads, fixCpn;
+    Real callPut;
+};
+
+// deflated zerobond P(t1) / N(t0) given x(t0) = x
+inline Real deflatedZerobond(const LgmSwaptionData &d, const Size t1,
+                             const Size t0, const Real x) {
+    return d.discount[t1] *
+           std::exp(-d.H[t1] * (x + 0.5 * d.zeta[t0] * d.H[t1]));
 }
 
-void LgmSwaptionEngineAD::calculate() const {
+// adds w times the gradient of the deflated zerobond to the adjoints
+inline void deflatedZerobondAdjoint(const LgmSwaptionData &d, const Size t1,
+                                    const Size t0, const Real x, const Real w,
+                                    std::vector<Real> &dH,
+                                    std::vector<Real> &dZeta,
+                                    std::vector<Real> &dDiscount, Real &dx) {
+    Real e = std::exp(-d.H[t1] * (x + 0.5 * d.zeta[t0] * d.H[t1]));
+    Real p = d.discount[t1] * e;
+    dDiscount[t1] += w * e;
+    dH[t1] -= w * p * (x + d.zeta[t0] * d.H[t1]);
+    dZeta[t0] -= w * p * 0.5 * d.H[t1] * d.H[t1];
+    dx -= w * p * d.H[t1];
+}
+
+// deflated value of the underlying swap at the exercise date with
+// index idx, given x at this date
+Real exerciseValue(const LgmSwaptionData &d, const Size idx, const Real x) {
+    Size e = d.expiries[idx];
+    Real floatLegNpv = 0.0;
+    for (Size l = d.floatStartIdxes[idx]; l < d.floatMults.size(); ++l) {
+        Real forward = (deflatedZerobond(d, d.floatT1s[l], e, x) /
+                            deflatedZerobond(d, d.floatT2s[l], e, x) -
+                        1.0) /
+                       d.indexAccTimes[l];
+        floatLegNpv += d.floatMults[l] * (d.floatSpreads[l] + forward) *
+                       deflatedZerobond(d, d.floatTps[l], e, x);
+    }
+    Real fixLegNpv = 0.0;
+    for (Size l = d.fixStartIdxes[idx]; l < d.fixCpn.size(); ++l)
+        fixLegNpv += d.fixCpn[l] * deflatedZerobond(d, d.fixTps[l], e, x);
+    return d.callPut * (floatLegNpv - fixLegNpv);
+}
+
+// adds w times the gradient of the exercise value to the adjoints
+void exerciseValueAdjoint(const LgmSwaptionData &d, const Size idx,
+                          const Real x, const Real w, std::vector<Real> &dH,
+                          std::vector<Real> &dZeta,
+                          std::vector<Real> &dDiscount, Real &dx) {
+    Size e = d.expiries[idx];
+    Real wFloat = w * d.callPut, wFix = -w * d.callPut;
+    for (Size l = d.floatStartIdxes[idx]; l < d.floatMults.size(); ++l) {
+        Real p1 = deflatedZerobond(d, d.floatT1s[l], e, x);
+        Real p2 = deflatedZerobond(d, d.floatT2s[l], e, x);
+        Real pp = deflatedZerobond(d, d.floatTps[l], e, x);
+        Real forward = (p1 / p2 - 1.0) / d.indexAccTimes[l];
+        Real wForward = wFloat * d.floatMults[l] * pp / d.indexAccTimes[l];
+        deflatedZerobondAdjoint(d, d.floatTps[l], e, x,
+                                wFloat * d.floatMults[l] *
+                                    (d.floatSpreads[l] + forward),
+                                dH, dZeta, dDiscount, dx);
+        deflatedZerobondAdjoint(d, d.floatT1s[l], e, x, wForward / p2, dH,
+                                dZeta, dDiscount, dx);
+        deflatedZerobondAdjoint(d, d.floatT2s[l], e, x,
+                                -wForward * p1 / (p2 * p2), dH, dZeta,
+                                dDiscount, dx);
+    }
+    for (Size l = d.fixStartIdxes[idx]; l < d.fixCpn.size(); ++l)
+        deflatedZerobondAdjoint(d, d.fixTps[l], e, x, wFix * d.fixCpn[l], dH,
+                                dZeta, dDiscount, dx);
+}
 
-    // collect data needed for core computation routine
+// the values computed in one step of the backward induction, which
+// are needed again in the adjoint sweep
+struct RollbackStep {
+    int idx;
+    Size e0, e1;
+    Real s0, s1, s01;
+    Array npv;
+    std::vector<bool> exercised;
+};
+
+} // anonymous namespace
+
+void LgmSwaptionEngineAD::calculate() const {
 
     QL_REQUIRE(arguments_.settlementType == Settlement::Physical,
                "cash-settled swaptions not yet implemented ...");
@@ -54,6 +128,8 @@ void LgmSwaptionEngineAD::calculate() const {
         return;
     }
 
+    // collect the data needed for the computation
+
     int idxMax = static_cast<int>(arguments_.exercise->dates().size()) - 1;
     int minIdxAlive = static_cast<int>(
         std::upper_bound(arguments_.exercise->dates().begin(),
@@ -62,18 +138,16 @@ void LgmSwaptionEngineAD::calculate() const {
 
     VanillaSwap swap = *arguments_.swap;
 
-    int callput = arguments_.type == VanillaSwap::Payer ? 1 : -1;
+    LgmSwaptionData d;
+    d.callPut = arguments_.type == VanillaSwap::Payer ? 1.0 : -1.0;
 
     Schedule fixedSchedule = swap.fixedSchedule();
     Schedule floatSchedule = swap.floatingSchedule();
 
-    Date expiry0;
-
-    std::vector<int> fix_startidxes, float_startidxes;
     std::vector<Date> expiryDates;
 
     for (int idx = minIdxAlive; idx <= idxMax; ++idx) {
-        expiry0 = arguments_.exercise->dates()[idx];
+        Date expiry0 = arguments_.exercise->dates()[idx];
         expiryDates.push_back(expiry0);
 
         Size j1 = std::upper_bound(fixedSchedule.dates().begin(),
@@ -83,47 +157,41 @@ void LgmSwaptionEngineAD::calculate() const {
                                    floatSchedule.dates().end(), expiry0 - 1) -
                   floatSchedule.dates().begin();
 
-        fix_startidxes.push_back(j1);
-        float_startidxes.push_back(k1);
+        d.fixStartIdxes.push_back(j1);
+        d.floatStartIdxes.push_back(k1);
     }
 
-    std::vector<double> float_mults, index_acctimes, float_spreads, fix_cpn;
     std::vector<Date> floatt1Dates, floatt2Dates, floattpDates;
     std::vector<Date> fixtpDates;
 
     for (Size i = 0; i < arguments_.floatingFixingDates.size(); ++i) {
-        float_mults.push_back(arguments_.nominal *
-                              arguments_.floatingAccrualTimes[i]);
-        float_spreads.push_back(arguments_.floatingSpreads[i]);
+        d.floatMults.push_back(arguments_.nominal *
+                               arguments_.floatingAccrualTimes[i]);
+        d.floatSpreads.push_back(arguments_.floatingSpreads[i]);
         boost::shared_ptr<IborIndex> index = arguments_.swap->iborIndex();
         Date d1 = index->valueDate(arguments_.floatingFixingDates[i]);
         Date d2 = index->maturityDate(d1);
-        double acctime = index->dayCounter().yearFraction(d1, d2, d1, d2);
         floatt1Dates.push_back(d1);
         floatt2Dates.push_back(d2);
         floattpDates.push_back(arguments_.floatingPayDates[i]);
-        index_acctimes.push_back(acctime);
+        d.indexAccTimes.push_back(
+            index->dayCounter().yearFraction(d1, d2, d1, d2));
     }
 
     for (Size i = 0; i < arguments_.fixedCoupons.size(); ++i) {
-        fix_cpn.push_back(arguments_.fixedCoupons[i]);
+        d.fixCpn.push_back(arguments_.fixedCoupons[i]);
         fixtpDates.push_back(arguments_.fixedPayDates[i]);
     }
 
     // join all dates and fill index vectors
 
     std::vector<Date> allDates;
-    std::vector<double> allTimes; // with settlement as first entry !
-    std::vector<int> expiries, floatt1s, floatt2s, floattps, fixtps;
-    std::vector<double> modpar;
+    std::vector<Real> allTimes; // with settlement as first entry !
 
-    allDates.reserve(expiryDates.size() + floatt1Dates.size() +
+    allDates.reserve(1 + expiryDates.size() + floatt1Dates.size() +
                      floatt2Dates.size() + floattpDates.size() +
                      fixtpDates.size());
 
-    allTimes.reserve(allDates.size());
-    modpar.reserve(3 * allDates.size());
-
     allDates.push_back(settlement);
     allDates.insert(allDates.end(), expiryDates.begin(), expiryDates.end());
     allDates.insert(allDates.end(), floatt1Dates.begin(), floatt1Dates.end());
@@ -134,76 +202,208 @@ void LgmSwaptionEngineAD::calculate() const {
     std::sort(allDates.begin(), allDates.end());
     allDates.erase(unique(allDates.begin(), allDates.end()), allDates.end());
 
-    for (Size i = 0; i < allDates.size(); ++i) {
-        allTimes.push_back(
-            model_->termStructure()->timeFromReference(allDates[i]));
-    }
-
-    for (Size i = 0; i < allDates.size(); ++i) {
-        modpar.push_back(model_->parametrization()->H(allTimes[i]));
-    }
-    for (Size i = 0; i < allDates.size(); ++i) {
-        modpar.push_back(model_->parametrization()->zeta(allTimes[i]));
-    }
-    for (Size i = 0; i < allDates.size(); ++i) {
-        modpar.push_back(model_->termStructure()->discount(allTimes[i]));
+    Size ntimes = allDates.size();
+    for (Size i = 0; i < ntimes; ++i) {
+        Time t = model_->termStructure()->timeFromReference(allDates[i]);
+        allTimes.push_back(t);
+        d.H.push_back(model_->parametrization()->H(t));
+        d.zeta.push_back(model_->parametrization()->zeta(t));
+        d.discount.push_back(model_->termStructure()->discount(t));
     }
 
     for (Size i = 0; i < expiryDates.size(); ++i) {
-        expiries.push_back(
+        d.expiries.push_back(
             std::find(allDates.begin(), allDates.end(), expiryDates[i]) -
             allDates.begin());
     }
     for (Size i = 0; i < floatt1Dates.size(); ++i) {
-        floatt1s.push_back(
+        d.floatT1s.push_back(
             std::find(allDates.begin(), allDates.end(), floatt1Dates[i]) -
             allDates.begin());
-    }
-    for (Size i = 0; i < floatt2Dates.size(); ++i) {
-        floatt2s.push_back(
+        d.floatT2s.push_back(
             std::find(allDates.begin(), allDates.end(), floatt2Dates[i]) -
             allDates.begin());
-    }
-    for (Size i = 0; i < floattpDates.size(); ++i) {
-        floattps.push_back(
+        d.floatTps.push_back(
             std::find(allDates.begin(), allDates.end(), floattpDates[i]) -
             allDates.begin());
     }
     for (Size i = 0; i < fixtpDates.size(); ++i) {
-        fixtps.push_back(
+        d.fixTps.push_back(
             std::find(allDates.begin(), allDates.end(), fixtpDates[i]) -
             allDates.begin());
     }
 
-    // call core computation routine and set results
-
-    int ntimes = allTimes.size();
-    int nexpiries = expiries.size();
-    int nfloats = floatt1s.size();
-    int nfixs = fix_cpn.size();
+    // integration grid and the weights of the integral of the
+    // linearly interpolated values against the standard normal density
+    // (the integral over [z_i, z_{i+1}] of d*y+e is e*A + d*B with
+    // A = Phi(z_{i+1})-Phi(z_i) and B = phi(z_i)-phi(z_{i+1}))
+
+    Size n = static_cast<Size>(integrationPoints_), nz = 2 * n + 1;
+    Real h = stddevs_ / static_cast<Real>(integrationPoints_);
+    Array z(nz), weights(nz, 0.0);
+    for (Size k = 0; k < nz; ++k)
+        z[k] = -stddevs_ + static_cast<Real>(k) * h;
+    CumulativeNormalDistribution Phi;
+    NormalDistribution phi;
+    for (Size i = 0; i + 1 < nz; ++i) {
+        Real dz = z[i + 1] - z[i];
+        Real A = Phi(z[i + 1]) - Phi(z[i]);
+        Real B = phi(z[i]) - phi(z[i + 1]);
+        weights[i] += (A * z[i + 1] - B) / dz;
+        weights[i + 1] += (B - A * z[i]) / dz;
+    }
 
-    double res = 0.0;
-    std::vector<Real> dres(3*ntimes);
-    int integration_pts = integrationPoints_;
-    double std_devs = stddevs_;
-    lgm_swaption_engine_ad_(&ntimes, &allTimes[0], &modpar[0], &nexpiries,
-                         &expiries[0], &callput, &nfloats, &float_startidxes[0],
-                         &float_mults[0], &index_acctimes[0], &float_spreads[0],
-                         &floatt1s[0], &floatt2s[0], &floattps[0],
-                         &fix_startidxes[0], &nfixs, &fix_cpn[0], &fixtps[0],
-                         &integration_pts, &std_devs, &res, &dres[0]);
+    // backward induction, the values are rolled back by integrating
+    // their linear interpolation (with flat extrapolation) over the
+    // grid
+
+    std::vector<RollbackStep> steps;
+    Array npv0(nz, 0.0), npv1(nz, 0.0);
+    Size expiry1idx = 0;
+
+    for (int idx = static_cast<int>(d.expiries.size()) - 1; idx >= -1;
+         --idx) {
+        RollbackStep st;
+        st.idx = idx;
+        st.e0 = idx == -1 ? 0 : d.expiries[idx];
+        st.e1 = expiry1idx;
+        st.s0 = std::sqrt(d.zeta[st.e0]);
+        st.s1 = st.s01 = 0.0;
+        if (st.e1 != 0) {
+            st.s1 = std::sqrt(d.zeta[st.e1]);
+            st.s01 = std::sqrt(d.zeta[st.e1] - d.zeta[st.e0]);
+        }
+        st.npv = npv1;
+        Size m = idx == -1 ? 1 : nz;
+        st.exercised.resize(m, false);
+        for (Size k = 0; k < m; ++k) {
+            Real center = idx == -1 ? 0.0 : z[k];
+            Real price = 0.0;
+            if (st.e1 != 0) {
+                for (Size i = 0; i < nz; ++i) {
+                    Real a = (static_cast<Real>(i) - static_cast<Real>(n)) /
+                             static_cast<Real>(n) * stddevs_;
+                    Real y = ((center * st.s0 + a * st.s01) / st.s1 +
+                              stddevs_) *
+                             static_cast<Real>(n) / stddevs_;
+                    Real y0 = std::floor(y);
+                    Size c0 = static_cast<Size>(std::min(
+                        std::max(y0, 0.0), static_cast<Real>(nz - 1)));
+                    Size c1 = static_cast<Size>(std::min(
+                        std::max(y0 + 1.0, 0.0), static_cast<Real>(nz - 1)));
+                    price += weights[i] * ((y0 + 1.0 - y) * npv1[c0] +
+                                           (y - y0) * npv1[c1]);
+                }
+            }
+            if (idx >= 0) {
+                Real ev = exerciseValue(d, idx, z[k] * st.s0);
+                if (ev > price) {
+                    price = ev;
+                    st.exercised[k] = true;
+                }
+            }
+            npv0[k] = price;
+        }
+        steps.push_back(st);
+        npv1.swap(npv0);
+        expiry1idx = st.e0;
+    }
 
-    results_.value = res;
+    results_.value = npv1[0];
+
+    // adjoint sweep
+
+    std::vector<Real> dH(ntimes, 0.0), dZeta(ntimes, 0.0),
+        dDiscount(ntimes, 0.0);
+    Array bar(nz, 0.0), barIn(nz);
+    bar[0] = 1.0;
+
+    for (Size s = steps.size(); s > 0; --s) {
+        const RollbackStep &st = steps[s - 1];
+        std::fill(barIn.begin(), barIn.end(), 0.0);
+        Real bs0 = 0.0, bs1 = 0.0, bs01 = 0.0;
+        for (Size k = 0; k < st.exercised.size(); ++k) {
+            if (bar[k] == 0.0)
+                continue;
+            Real center = st.idx == -1 ? 0.0 : z[k];
+            if (st.exercised[k]) {
+                Real dx = 0.0;
+                exerciseValueAdjoint(d, st.idx, z[k] * st.s0, bar[k], dH,
+                                     dZeta, dDiscount, dx);
+                bs0 += dx * z[k];
+                continue;
+            }
+            if (st.e1 != 0) {
+                for (Size i = 0; i < nz; ++i) {
+                    Real bv = bar[k] * weights[i];
+                    Real a = (static_cast<Real>(i) - static_cast<Real>(n)) /
+                             static_cast<Real>(n) * stddevs_;
+                    Real q = center * st.s0 + a * st.s01;
+                    Real y = (q / st.s1 + stddevs_) * static_cast<Real>(n) /
+                             stddevs_;
+                    Real y0 = std::floor(y);
+                    Size c0 = static_cast<Size>(std::min(
+                        std::max(y0, 0.0), static_cast<Real>(nz - 1)));
+                    Size c1 = static_cast<Size>(std::min(
+                        std::max(y0 + 1.0, 0.0), static_cast<Real>(nz - 1)));
+                    barIn[c0] += bv * (y0 + 1.0 - y);
+                    barIn[c1] += bv * (y - y0);
+                    Real by = bv * (st.npv[c1] - st.npv[c0]) *
+                              static_cast<Real>(n) / stddevs_;
+                    bs1 -= by * q / (st.s1 * st.s1);
+                    bs0 += by / st.s1 * center;
+                    bs01 += by / st.s1 * a;
+                }
+            }
+        }
+        if (st.s0 > 0.0)
+            dZeta[st.e0] += 0.5 * bs0 / st.s0;
+        if (st.e1 != 0) {
+            dZeta[st.e1] += 0.5 * bs1 / st.s1;
+            if (st.s01 > 0.0) {
+                dZeta[st.e1] += 0.5 * bs01 / st.s01;
+                dZeta[st.e0] -= 0.5 * bs01 / st.s01;
+            }
+        }
+        bar.swap(barIn);
+    }
 
-    std::vector<Real> H_sensitivity(dres.begin(),dres.begin()+ntimes);
-    std::vector<Real> zeta_sensitivity(dres.begin()+ntimes,dres.begin()+2*ntimes);
-    std::vector<Real> discount_sensitivity(dres.begin()+2*ntimes,dres.begin()+3*ntimes);
+    // chain rule for the model parameters, see
+    // LgmPiecewiseAlphaConstantKappa for the definition of zeta and H
+
+    const Array &volTimes = model_->parametrization()->times();
+    const Array &alpha = model_->alpha();
+    Real kappa = model_->kappa();
+    std::vector<Real> alphaSensitivity(alpha.size(), 0.0);
+    Real kappaSensitivity = 0.0;
+    for (Size j = 0; j < ntimes; ++j) {
+        Time t = allTimes[j];
+        if (t < 0.0)
+            continue;
+        Size i = std::upper_bound(volTimes.begin(), volTimes.end(), t) -
+                 volTimes.begin();
+        for (Size l = 0; l < std::min(i, volTimes.size()); ++l)
+            alphaSensitivity[l] +=
+                dZeta[j] * 2.0 * alpha[l] *
+                (volTimes[l] - (l == 0 ? 0.0 : volTimes[l - 1]));
+        Size l = std::min(i, alpha.size() - 1);
+        alphaSensitivity[l] += dZeta[j] * 2.0 * alpha[l] *
+                               (t - (i == 0 ? 0.0 : volTimes[i - 1]));
+        // for small kappa H(t) = t is used, we take the limit of the
+        // derivative for kappa -> 0 in this case
+        kappaSensitivity +=
+            dH[j] * (std::fabs(kappa) < 1E-4
+                         ? -0.5 * t * t
+                         : t * std::exp(-kappa * t) / kappa -
+                               (1.0 - std::exp(-kappa * t)) / (kappa * kappa));
+    }
 
     results_.additionalResults["sensitivityTimes"] = allTimes;
-    results_.additionalResults["sensitivityH"] = H_sensitivity;
-    results_.additionalResults["sensitivityZeta"] = zeta_sensitivity;
-    results_.additionalResults["sensitivityDiscount"] = discount_sensitivity;
-
+    results_.additionalResults["sensitivityH"] = dH;
+    results_.additionalResults["sensitivityZeta"] = dZeta;
+    results_.additionalResults["sensitivityDiscount"] = dDiscount;
+    results_.additionalResults["sensitivityAlpha"] = alphaSensitivity;
+    results_.additionalResults["sensitivityKappa"] = kappaSensitivity;
 }
 
 } // namespace QuantLib
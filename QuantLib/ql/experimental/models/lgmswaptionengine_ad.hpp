@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -18,7 +18,7 @@
 */
 
 /*! \file lgmswaptionengine_ad.hpp
-    \brief
+    \brief LGM swaption engine with adjoint sensitivities
 */
 
 #ifndef quantlib_pricers_lgm_swaption_ad_hpp
@@ -33,9 +33,21 @@ namespace QuantLib {
 //! LGM swaption engine with AD support
 /*! \ingroup swaptionengines
 
-    this class uses the QuantLibOAD library to generate
-    sensitivities to the model parameters by automatic
-    differentiation
+    this class computes the price together with its sensitivities
+    to the model parameters in one backward induction and one
+    adjoint (reverse) sweep, the cost of which is independent of
+    the number of parameters. The values are rolled back by
+    integrating their linear interpolation on the grid exactly
+    against the normal density, with flat extrapolation and no
+    contribution from outside the grid.
+
+    The additional results are
+    - sensitivityTimes: the times on which the model is evaluated
+    - sensitivityH, sensitivityZeta, sensitivityDiscount: the
+      derivatives w.r.t. \f$ H \f$, \f$ \zeta \f$ and the model
+      curve's discount factors on these times
+    - sensitivityAlpha, sensitivityKappa: the derivatives w.r.t.
+      the model parameters (the former with one entry per alpha)
 
     see Gaussian1dSwaptionEngine for other remarks
 
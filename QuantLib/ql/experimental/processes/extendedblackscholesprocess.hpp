@@ -48,6 +48,11 @@ namespace QuantLib {
         Real drift(Time t, Real x) const;
         Real diffusion(Time t, Real x) const;
         Real evolve(Time t0, Real x0, Time dt, Real dw) const;
+        //! evolves the paths one by one using the scheme above
+        void evolveBlock(Time t0, const Real* x0, Time dt,
+                         const Real* dw, Real* x, Size n) const {
+            StochasticProcess1D::evolveBlock(t0, x0, dt, dw, x, n);
+        }
       private:
         const Discretization discretization_;
     };
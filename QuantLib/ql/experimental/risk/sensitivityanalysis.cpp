@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2008 Ferdinando Ametrano
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -20,6 +21,14 @@
 #include <ql/experimental/risk/sensitivityanalysis.hpp>
 #include <ql/quotes/simplequote.hpp>
 #include <ql/instrument.hpp>
+#include <ql/patterns/observable.hpp>
+#include <ql/patterns/threadsession.hpp>
+#include <boost/make_shared.hpp>
+#include <set>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using std::vector;
 using std::pair;
@@ -27,6 +36,100 @@ using boost::shared_ptr;
 
 namespace QuantLib {
 
+    namespace {
+
+        struct MarketCopy {
+            vector<Handle<SimpleQuote> > quotes;
+            vector<shared_ptr<Instrument> > instruments;
+            vector<shared_ptr<NotificationFlag> > flags;
+            vector<Real> referenceNpv;
+            // instruments not recalculated since the last restore of a
+            // quote, they do not forward notifications
+            vector<bool> stale;
+        };
+
+        void lowerFlags(MarketCopy& market) {
+            for (Size k=0; k<market.flags.size(); ++k)
+                market.flags[k]->notified = false;
+        }
+
+        vector<BucketSensitivity> bumpQuote(MarketCopy& market,
+                                            Size i,
+                                            Real shift,
+                                            SensitivityAnalysis type) {
+            vector<BucketSensitivity> result;
+            const Handle<SimpleQuote>& quote = market.quotes[i];
+            Real quoteValue = quote->value();
+
+            try {
+                // the candidates are the instruments notified by the
+                // tweak and the stale ones, which might depend on the
+                // quote without being notified
+                lowerFlags(market);
+                quote->setValue(quoteValue+shift);
+                vector<Size> candidates;
+                for (Size k=0; k<market.flags.size(); ++k)
+                    if (market.flags[k]->notified || market.stale[k])
+                        candidates.push_back(k);
+                vector<Real> npv(candidates.size());
+                for (Size j=0; j<candidates.size(); ++j)
+                    npv[j] = market.instruments[candidates[j]]->NPV();
+
+                // all candidates are calculated now, so the next change
+                // of the quote notifies exactly the dependent ones
+                lowerFlags(market);
+                quote->setValue(type == Centered ? quoteValue-shift
+                                                 : quoteValue);
+                vector<Size> dependent;
+                vector<Real> npv1;
+                for (Size j=0; j<candidates.size(); ++j) {
+                    if (market.flags[candidates[j]]->notified) {
+                        dependent.push_back(candidates[j]);
+                        npv1.push_back(npv[j]);
+                    }
+                }
+                Size m = dependent.size();
+
+                vector<Real> npv2(m);
+                if (type == Centered) {
+                    for (Size j=0; j<m; ++j)
+                        npv2[j] = market.instruments[dependent[j]]->NPV();
+                    quote->setValue(quoteValue);
+                }
+
+                // the dependent instruments are not revalued after the
+                // restore, they become stale instead; the other
+                // candidates were recalculated above
+                for (Size j=0; j<candidates.size(); ++j)
+                    market.stale[candidates[j]] = false;
+                for (Size j=0; j<m; ++j)
+                    market.stale[dependent[j]] = true;
+
+                result.resize(m);
+                for (Size j=0; j<m; ++j) {
+                    Size k = dependent[j];
+                    Real ref = market.referenceNpv[k];
+                    result[j].instrument = k;
+                    result[j].quote = i;
+                    if (type == Centered) {
+                        result[j].delta = (npv1[j]-npv2[j])/(2.0*shift);
+                        result[j].gamma =
+                            (npv1[j]-2.0*ref+npv2[j])/(shift*shift);
+                    } else {
+                        result[j].delta = (npv1[j]-ref)/shift;
+                        result[j].gamma = Null<Real>();
+                    }
+                }
+            } catch (...) {
+                quote->setValue(quoteValue);
+                throw;
+            }
+
+            return result;
+        }
+
+    }
+
     std::ostream& operator<<(std::ostream& out,
                              SensitivityAnalysis s) {
         switch (s) {
@@ -351,4 +454,94 @@ namespace QuantLib {
         return result;
     }
 
+    vector<BucketSensitivity>
+    bucketJacobian(const SensitivityMarket& market,
+                   Real shift,
+                   SensitivityAnalysis type,
+                   Size numberOfThreads)
+    {
+        QL_REQUIRE(shift!=0.0, "zero shift not allowed");
+        QL_REQUIRE(type==OneSide || type==Centered,
+                   "unknown SensitivityAnalysis (" << Integer(type) << ")");
+
+        vector<MarketCopy> copies(1);
+        market.build(copies[0].quotes, copies[0].instruments);
+        Size n = copies[0].quotes.size();
+        Size m = copies[0].instruments.size();
+        if (n==0 || m==0) return vector<BucketSensitivity>();
+
+        Size nThreads = 1;
+#ifdef _OPENMP
+        nThreads = numberOfThreads == Null<Size>() ?
+            static_cast<Size>(omp_get_max_threads()) : numberOfThreads;
+#endif
+        nThreads = std::max<Size>(1, std::min(nThreads, n));
+
+        // market copies and initial valuation, the latter arms the
+        // notification flags and triggers all lazy initializations
+        copies.resize(nThreads);
+        for (Size t=0; t<nThreads; ++t) {
+            MarketCopy& c = copies[t];
+            if (t > 0) {
+                market.build(c.quotes, c.instruments);
+                QL_REQUIRE(c.quotes.size()==n && c.instruments.size()==m,
+                           "market copy #" << t << " has " <<
+                           c.quotes.size() << " quotes and " <<
+                           c.instruments.size() << " instruments, expected " <<
+                           n << " and " << m);
+            }
+            for (Size k=0; k<m; ++k) {
+                c.flags.push_back(boost::make_shared<NotificationFlag>());
+                c.flags.back()->registerWith(c.instruments[k]);
+                c.referenceNpv.push_back(c.instruments[k]->NPV());
+            }
+            c.stale.resize(m, false);
+        }
+
+        // the copies must not share quotes or instruments
+        std::set<const void*> objects;
+        for (Size t=0; t<nThreads; ++t) {
+            for (Size i=0; i<n; ++i)
+                objects.insert(copies[t].quotes[i].currentLink().get());
+            for (Size k=0; k<m; ++k)
+                objects.insert(copies[t].instruments[k].get());
+        }
+        QL_REQUIRE(objects.size() == nThreads*(n+m),
+                   "market copies share quotes or instruments");
+
+        vector<vector<BucketSensitivity> > results(n);
+        vector<std::string> errors(n);
+
+#if defined(QL_ENABLE_SESSIONS)
+        Integer session = ThreadSession::id();
+#endif
+        #pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(nThreads))
+        for (Size i=0; i<n; ++i) {
+            unsigned int threadId = 0;
+#ifdef _OPENMP
+            threadId = omp_get_thread_num();
+#endif
+#if defined(QL_ENABLE_SESSIONS)
+            // the copies belong to the session of the calling thread
+            ThreadSession threadSession(session);
+#endif
+            try {
+                results[i] = bumpQuote(copies[threadId], i, shift, type);
+            } catch (std::exception& e) {
+                errors[i] = e.what();
+            } catch (...) {
+                errors[i] = "unknown error";
+            }
+        }
+
+        vector<BucketSensitivity> result;
+        for (Size i=0; i<n; ++i) {
+            QL_REQUIRE(errors[i].empty(),
+                       "error while tweaking quote #" << i << ": " <<
+                       errors[i]);
+            result.insert(result.end(), results[i].begin(), results[i].end());
+        }
+        return result;
+    }
+
 }
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2008, 2010 Ferdinando Ametrano
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -175,6 +176,65 @@ namespace QuantLib {
                    Real shift = 0.0001,
                    SensitivityAnalysis type = Centered);
 
+    //! market and portfolio for bucketJacobian
+    /*! Each call to build() must create a new, independent set of quotes
+        and instruments (including the term structures, indices,
+        engines, etc. linking them), always in the same order.
+    */
+    class SensitivityMarket {
+      public:
+        virtual ~SensitivityMarket() {}
+        virtual void build(
+            std::vector<Handle<SimpleQuote> >& quotes,
+            std::vector<boost::shared_ptr<Instrument> >& instruments)
+                                                                   const = 0;
+    };
+
+    //! entry of the jacobian returned by bucketJacobian
+    struct BucketSensitivity {
+        Size instrument, quote;
+        Real delta, gamma;
+    };
+
+    //! bucket sensitivities of single instrument NPVs w.r.t. a quote vector
+    /*! returns the non-trivial entries of the jacobian of the
+        instruments' NPVs w.r.t. the quotes, ordered by quote and
+        instrument index. First and second derivatives are calculated
+        as prescribed by SensitivityAnalysis, the latter are null for
+        one-sided differences.
+
+        The (bucket) SimpleQuotes are tweaked one by one separately.
+        After each tweak only the instruments that are notified by the
+        tweaked quote are revalued, all other instruments are
+        considered to be independent of it and do not appear in the
+        result. The dependent instruments are not revalued after the
+        quote is restored, but with the next tweak.
+
+        By default the quotes are tweaked serially on a single market
+        built by SensitivityMarket::build(). If more than one thread is
+        requested (numberOfThreads = Null stands for the number of
+        threads provided by OpenMP), the quotes are distributed over
+        the threads, each working on its own copy of the market. The
+        copies are built and valued once in the calling thread before
+        the parallel part starts, it is checked that they do not share
+        quotes or instruments.
+
+        \warning in the parallel case the copies must be independent
+                 also beyond the quotes and instruments, i.e. they must
+                 not share any observable or anything else modified
+                 during a calculation. In particular the calculations
+                 must neither create nor destroy objects registering
+                 with global observables like the evaluation date or
+                 the fixings held by the IndexManager, since this
+                 modifies their (shared) list of observers. The
+                 evaluation date must not be changed.
+    */
+    std::vector<BucketSensitivity>
+    bucketJacobian(const SensitivityMarket& market,
+                   Real shift = 0.0001,
+                   SensitivityAnalysis type = Centered,
+                   Size numberOfThreads = 1);
+
 }
 
 #endif
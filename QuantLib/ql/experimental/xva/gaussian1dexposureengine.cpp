@@ -0,0 +1,357 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include <ql/experimental/xva/gaussian1dexposureengine.hpp>
+#include <ql/cashflows/coupon.hpp>
+#include <ql/cashflows/iborcoupon.hpp>
+#include <ql/math/interpolations/cubicinterpolation.hpp>
+#include <ql/exercise.hpp>
+#include <boost/make_shared.hpp>
+#include <set>
+
+namespace QuantLib {
+
+Gaussian1dExposureEngine::Gaussian1dExposureEngine(
+    const boost::shared_ptr<Gaussian1dModel> &model,
+    const std::vector<boost::shared_ptr<VanillaSwap> > &swaps,
+    const std::vector<boost::shared_ptr<Swaption> > &swaptions,
+    const std::vector<Date> &horizonDates, const Size paths,
+    const unsigned long seed, const Real pfeQuantile, const Size blockSize,
+    const int integrationPoints, const Real stddevs)
+    : model_(model), swaps_(swaps), swaptions_(swaptions),
+      horizonDates_(horizonDates), paths_(paths), seed_(seed),
+      pfeQuantile_(pfeQuantile), blockSize_(blockSize),
+      integrationPoints_(integrationPoints), stddevs_(stddevs) {
+
+    QL_REQUIRE(!horizonDates_.empty(), "no horizon dates given");
+    for (Size i = 1; i < horizonDates_.size(); ++i)
+        QL_REQUIRE(horizonDates_[i] > horizonDates_[i - 1],
+                   "horizon dates must be increasing ("
+                       << horizonDates_[i - 1] << "@" << i - 1 << ", "
+                       << horizonDates_[i] << "@" << i << ")");
+    QL_REQUIRE(paths_ > 0, "at least one path required");
+    QL_REQUIRE(blockSize_ > 0, "block size must be positive");
+    QL_REQUIRE(pfeQuantile_ > 0.0 && pfeQuantile_ < 1.0,
+               "pfe quantile (" << pfeQuantile_ << ") must be in (0,1)");
+
+    registerWith(model_);
+    for (Size i = 0; i < swaps_.size(); ++i)
+        registerWith(swaps_[i]);
+    for (Size i = 0; i < swaptions_.size(); ++i) {
+        QL_REQUIRE(swaptions_[i]->exercise()->type() == Exercise::European,
+                   "swaption #" << i << " is not european");
+        registerWith(swaptions_[i]);
+    }
+}
+
+void Gaussian1dExposureEngine::performCalculations() const {
+
+    Date evalDate = Settings::instance().evaluationDate();
+    QL_REQUIRE(model_->termStructure()->referenceDate() == evalDate,
+               "model term structure's reference date ("
+                   << model_->termStructure()->referenceDate()
+                   << ") must be equal to the evaluation date (" << evalDate
+                   << ")");
+    QL_REQUIRE(horizonDates_.front() >= evalDate,
+               "first horizon date (" << horizonDates_.front()
+                                      << ") is before the evaluation date ("
+                                      << evalDate << ")");
+
+    // set up the simulation grid, which consists of the horizon dates,
+    // the fixing dates of coupons not yet fixed and the swaption expiries,
+    // as far as they are relevant for the revaluation on the horizon dates
+
+    Date lastDate = horizonDates_.back();
+    std::set<Date> grid(horizonDates_.begin(), horizonDates_.end());
+    std::vector<boost::shared_ptr<VanillaSwap> > underlyings(swaps_);
+    std::vector<Date> expiries(swaps_.size(), Null<Date>());
+    for (Size i = 0; i < swaptions_.size(); ++i) {
+        Date expiry = swaptions_[i]->exercise()->date(0);
+        QL_REQUIRE(expiry > evalDate, "swaption #" << i << " expired ("
+                                                   << expiry << ")");
+        if (expiry <= lastDate)
+            grid.insert(expiry);
+        underlyings.push_back(swaptions_[i]->underlyingSwap());
+        expiries.push_back(expiry);
+    }
+    for (Size i = 0; i < underlyings.size(); ++i) {
+        const Leg &leg = underlyings[i]->floatingLeg();
+        for (Size j = 0; j < leg.size(); ++j) {
+            boost::shared_ptr<FloatingRateCoupon> c =
+                boost::dynamic_pointer_cast<FloatingRateCoupon>(leg[j]);
+            if (c != NULL && c->fixingDate() > evalDate &&
+                c->fixingDate() <= lastDate)
+                grid.insert(c->fixingDate());
+        }
+    }
+
+    gridDates_ = std::vector<Date>(grid.begin(), grid.end());
+    gridTimes_.resize(gridDates_.size());
+    for (Size j = 0; j < gridDates_.size(); ++j)
+        gridTimes_[j] = model_->termStructure()->timeFromReference(gridDates_[j]);
+    horizonIndex_.resize(horizonDates_.size());
+    horizonTimes_.resize(horizonDates_.size());
+    for (Size h = 0; h < horizonDates_.size(); ++h) {
+        horizonIndex_[h] =
+            std::lower_bound(gridDates_.begin(), gridDates_.end(),
+                             horizonDates_[h]) -
+            gridDates_.begin();
+        horizonTimes_[h] = gridTimes_[horizonIndex_[h]];
+    }
+
+    trades_.clear();
+    for (Size i = 0; i < swaps_.size(); ++i)
+        addTrade(swaps_[i], Null<Date>(), false);
+    for (Size i = 0; i < swaptions_.size(); ++i)
+        addTrade(swaptions_[i]->underlyingSwap(), expiries[swaps_.size() + i],
+                 swaptions_[i]->settlementType() == Settlement::Physical);
+
+    // all model quantities needed for the revaluation are taken from a
+    // snapshot, which can be read concurrently; the state times are the
+    // grid times and the swaption expiries, the times furthermore
+    // contain the payment and index start and end times of the flows
+    std::vector<Time> stateTimes(gridTimes_), times(gridTimes_);
+    for (Size k = 0; k < trades_.size(); ++k) {
+        const Trade &trade = trades_[k];
+        if (trade.isSwaption)
+            stateTimes.push_back(trade.expiry);
+        for (Size l = 0; l < trade.flows.size(); ++l) {
+            const Flow &f = trade.flows[l];
+            times.push_back(f.pay);
+            if (f.fixing != Null<Real>()) {
+                times.push_back(f.start);
+                times.push_back(f.end);
+            }
+        }
+    }
+    times.insert(times.end(), stateTimes.begin(), stateTimes.end());
+    snapshot_ = boost::make_shared<Gaussian1dModelSnapshot>(model_, times,
+                                                            stateTimes);
+    z_ = model_->yGrid(stddevs_, integrationPoints_);
+
+    // the paths are generated block by block within the parallel
+    // revaluation, each path is drawn from its own substream so that
+    // the results do not depend on the number of threads or the block
+    // size; the generator only reads its transition coefficients then
+    Gaussian1dSingleCurveScenarioGenerator generator(model_, seed_);
+    generator.setHorizonDates(gridDates_);
+    Matrix states(paths_, gridDates_.size());
+
+    Size nHorizons = horizonDates_.size();
+    cube_ = std::vector<Matrix>(trades_.size(), Matrix(paths_, nHorizons));
+    npv_ = Matrix(paths_, nHorizons);
+    numeraires_ = Matrix(paths_, nHorizons);
+
+    Size nBlocks = (paths_ + blockSize_ - 1) / blockSize_;
+    std::vector<std::string> errors(nBlocks);
+
+#pragma omp parallel for schedule(dynamic)
+    for (Size b = 0; b < nBlocks; ++b) {
+        try {
+            Size firstPath = b * blockSize_;
+            Size n = std::min(blockSize_, paths_ - firstPath);
+            generator.generateStates(states, firstPath, n, firstPath);
+            for (Size i = firstPath; i < firstPath + n; ++i) {
+                const Real *path = states.row_begin(i);
+                for (Size h = 0; h < nHorizons; ++h) {
+                    Size j = horizonIndex_[h];
+                    numeraires_[i][h] =
+                        snapshot_->numeraire(gridTimes_[j], path[j]);
+                    Real v = 0.0;
+                    for (Size k = 0; k < trades_.size(); ++k) {
+                        Real vk = tradeValue(trades_[k], j, path);
+                        cube_[k][i][h] = vk;
+                        v += vk;
+                    }
+                    npv_[i][h] = v;
+                }
+            }
+        } catch (std::exception &e) {
+            errors[b] = e.what();
+        } catch (...) {
+            errors[b] = "unknown error";
+        }
+    }
+
+    for (Size b = 0; b < nBlocks; ++b)
+        QL_REQUIRE(errors[b].empty(),
+                   "error in revaluation of path block #" << b << ": "
+                                                          << errors[b]);
+
+    // aggregation in path order, so the results are reproducible
+    Real n0 = snapshot_->numeraire(0.0, 0.0);
+    ee_ = std::vector<Real>(nHorizons, 0.0);
+    ene_ = std::vector<Real>(nHorizons, 0.0);
+    pfe_ = std::vector<Real>(nHorizons, 0.0);
+    Size q = std::min(
+        static_cast<Size>(std::ceil(pfeQuantile_ * static_cast<Real>(paths_))),
+        paths_);
+    q = q > 0 ? q - 1 : 0;
+    std::vector<Real> exposure(paths_);
+    for (Size h = 0; h < nHorizons; ++h) {
+        for (Size i = 0; i < paths_; ++i) {
+            Real v = npv_[i][h];
+            ee_[h] += std::max(v, 0.0) / numeraires_[i][h];
+            ene_[h] += std::max(-v, 0.0) / numeraires_[i][h];
+            exposure[i] = std::max(v, 0.0);
+        }
+        ee_[h] *= n0 / static_cast<Real>(paths_);
+        ene_[h] *= n0 / static_cast<Real>(paths_);
+        std::nth_element(exposure.begin(), exposure.begin() + q,
+                         exposure.end());
+        pfe_[h] = exposure[q];
+    }
+}
+
+void Gaussian1dExposureEngine::addTrade(
+    const boost::shared_ptr<VanillaSwap> &swap, const Date &expiry,
+    const bool physical) const {
+
+    Date evalDate = Settings::instance().evaluationDate();
+    boost::shared_ptr<YieldTermStructure> yts = *model_->termStructure();
+
+    Trade trade;
+    trade.isSwaption = expiry != Null<Date>();
+    trade.physical = physical;
+    trade.expiry =
+        trade.isSwaption ? yts->timeFromReference(expiry) : Null<Real>();
+    trade.expiryIndex =
+        trade.isSwaption && expiry <= horizonDates_.back()
+            ? std::lower_bound(gridDates_.begin(), gridDates_.end(), expiry) -
+                  gridDates_.begin()
+            : Null<Size>();
+
+    Real payer = swap->type() == VanillaSwap::Payer ? 1.0 : -1.0;
+
+    for (Size l = 0; l < 2; ++l) {
+        const Leg &leg = l == 0 ? swap->fixedLeg() : swap->floatingLeg();
+        Real sign = l == 0 ? -payer : payer;
+        for (Size j = 0; j < leg.size(); ++j) {
+            if (leg[j]->date() <= evalDate)
+                continue;
+            boost::shared_ptr<Coupon> c =
+                boost::dynamic_pointer_cast<Coupon>(leg[j]);
+            QL_REQUIRE(c != NULL, "coupon expected");
+            // for swaptions only the coupons belonging to the exercise
+            // into the underlying are relevant
+            if (trade.isSwaption && c->accrualStartDate() < expiry)
+                continue;
+            Flow f;
+            f.accrualStart = c->accrualStartDate();
+            f.pay = yts->timeFromReference(c->date());
+            f.fixing = Null<Real>();
+            f.fixingIndex = Null<Size>();
+            boost::shared_ptr<FloatingRateCoupon> fc =
+                boost::dynamic_pointer_cast<FloatingRateCoupon>(c);
+            if (fc == NULL || fc->fixingDate() <= evalDate) {
+                f.amount = sign * c->amount();
+            } else {
+                boost::shared_ptr<InterestRateIndex> index = fc->index();
+                Date valueDate = index->valueDate(fc->fixingDate());
+                Date endDate = index->maturityDate(valueDate);
+                f.fixing = yts->timeFromReference(fc->fixingDate());
+                f.start = yts->timeFromReference(valueDate);
+                f.end = yts->timeFromReference(endDate);
+                f.indexDcf =
+                    index->dayCounter().yearFraction(valueDate, endDate);
+                f.nominalAccrual = sign * fc->nominal() * fc->accrualPeriod();
+                f.gearing = fc->gearing();
+                f.spread = fc->spread();
+                if (fc->fixingDate() <= horizonDates_.back())
+                    f.fixingIndex =
+                        std::lower_bound(gridDates_.begin(), gridDates_.end(),
+                                         fc->fixingDate()) -
+                        gridDates_.begin();
+            }
+            trade.flows.push_back(f);
+        }
+    }
+
+    trades_.push_back(trade);
+}
+
+Real Gaussian1dExposureEngine::underlyingValue(const Trade &trade,
+                                               const Time t, const Real y,
+                                               const Real *path) const {
+    Real value = 0.0;
+    for (Size l = 0; l < trade.flows.size(); ++l) {
+        const Flow &f = trade.flows[l];
+        if (f.pay <= t)
+            continue;
+        Real amount = f.amount;
+        if (f.fixing != Null<Real>()) {
+            // use the fixing on the path if the coupon is already fixed,
+            // otherwise the forward rate as seen from (t,y)
+            Time tf = t;
+            Real yf = y;
+            if (f.fixing <= t && path != NULL &&
+                f.fixingIndex != Null<Size>()) {
+                tf = gridTimes_[f.fixingIndex];
+                yf = path[f.fixingIndex];
+            }
+            Real rate = (snapshot_->zerobond(f.start, tf, yf) /
+                             snapshot_->zerobond(f.end, tf, yf) -
+                         1.0) /
+                        f.indexDcf;
+            amount = f.nominalAccrual * (f.gearing * rate + f.spread);
+        }
+        value += amount * snapshot_->zerobond(f.pay, t, y);
+    }
+    return value;
+}
+
+Real Gaussian1dExposureEngine::swaptionValue(const Trade &trade, const Time t,
+                                             const Real y) const {
+    Array yg =
+        snapshot_->yGrid(stddevs_, integrationPoints_, trade.expiry, t, y);
+    Array p(yg.size());
+    for (Size i = 0; i < yg.size(); ++i) {
+        p[i] = std::max(underlyingValue(trade, trade.expiry, yg[i], NULL),
+                        0.0) /
+               snapshot_->numeraire(trade.expiry, yg[i]);
+    }
+    CubicInterpolation payoff(
+        z_.begin(), z_.end(), p.begin(), CubicInterpolation::Spline, true,
+        CubicInterpolation::Lagrange, 0.0, CubicInterpolation::Lagrange, 0.0);
+    Real price = 0.0;
+    for (Size i = 0; i < z_.size() - 1; ++i) {
+        price += Gaussian1dModel::gaussianShiftedPolynomialIntegral(
+            0.0, payoff.cCoefficients()[i], payoff.bCoefficients()[i],
+            payoff.aCoefficients()[i], p[i], z_[i], z_[i], z_[i + 1]);
+    }
+    return price * snapshot_->numeraire(t, y);
+}
+
+Real Gaussian1dExposureEngine::tradeValue(const Trade &trade, const Size j,
+                                          const Real *path) const {
+    Time t = gridTimes_[j];
+    if (!trade.isSwaption)
+        return underlyingValue(trade, t, path[j], path);
+    if (t < trade.expiry)
+        return swaptionValue(trade, t, path[j]);
+    if (!trade.physical)
+        return 0.0;
+    // exercise decision on the path
+    if (underlyingValue(trade, trade.expiry, path[trade.expiryIndex], path) >
+        0.0)
+        return underlyingValue(trade, t, path[j], path);
+    return 0.0;
+}
+
+} // namespace QuantLib
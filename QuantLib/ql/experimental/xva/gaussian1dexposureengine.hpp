@@ -0,0 +1,189 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file gaussian1dexposureengine.hpp
+    \brief exposure cube for swaps and swaptions in a gaussian1d model
+*/
+
+#ifndef quantlib_xva_gaussian1dexposureengine_hpp
+#define quantlib_xva_gaussian1dexposureengine_hpp
+
+#include <ql/experimental/xva/gaussian1dscenariogenerator.hpp>
+#include <ql/models/shortrate/onefactormodels/gaussian1dmodelsnapshot.hpp>
+#include <ql/instruments/vanillaswap.hpp>
+#include <ql/instruments/swaption.hpp>
+#include <ql/patterns/lazyobject.hpp>
+
+namespace QuantLib {
+
+/*! Exposure cube for a portfolio (netting set) of vanilla swaps and
+    european swaptions. The paths are generated by a
+    Gaussian1dSingleCurveScenarioGenerator in its batched mode, each
+    path being drawn from its own substream. The generation and the
+    revaluation are distributed in blocks of paths over the available
+    threads if OpenMP is enabled, the results are identical for any
+    number of threads and any block size.
+
+    The trades are revalued on each path and horizon date in the model,
+    i.e. using the model curve for both forwarding and discounting.
+    Coupons which are fixed between the evaluation date and the horizon
+    date use the fixing on the path, the corresponding fixing dates (as
+    well as the swaption expiries) are therefore added to the simulation
+    grid. A swaption is valued by integrating the deflated exercise value
+    over the conditional distribution of the state at expiry. After the
+    expiry a physically settled swaption turns into the underlying swap on
+    the paths where it is exercised, a cash settled swaption is worth zero.
+
+    The expected exposure is discounted to the evaluation date, i.e.
+    \f[ EE(t) = N(0) E( \max(V(t),0) / N(t) ) \f]
+    and similarly for the expected negative exposure. The potential
+    future exposure is the given quantile of the (undiscounted) exposure
+    \f$ \max(V(t),0) \f$.
+
+    All model quantities used in the revaluation, including the
+    numeraires, are read from a Gaussian1dModelSnapshot, which is set
+    up before the parallel revaluation, so the model itself is never
+    accessed concurrently.
+    For models without an affine representation (e.g. MarkovFunctional)
+    the snapshot's interpolation on the state grid applies.
+
+    \warning the model's term structure must have the evaluation date as
+             its reference date
+*/
+
+class Gaussian1dExposureEngine : public LazyObject {
+  public:
+    Gaussian1dExposureEngine(
+        const boost::shared_ptr<Gaussian1dModel> &model,
+        const std::vector<boost::shared_ptr<VanillaSwap> > &swaps,
+        const std::vector<boost::shared_ptr<Swaption> > &swaptions,
+        const std::vector<Date> &horizonDates, const Size paths,
+        const unsigned long seed = 42, const Real pfeQuantile = 0.95,
+        const Size blockSize = 256, const int integrationPoints = 32,
+        const Real stddevs = 7.0);
+
+    const std::vector<Date> &horizonDates() const { return horizonDates_; }
+    const std::vector<Time> &horizonTimes() const;
+
+    /*! npv cube, the k-th matrix contains the npvs of the k-th trade
+        (swaps first, then swaptions) for all paths (rows) and horizon
+        dates (columns) */
+    const std::vector<Matrix> &cube() const;
+    //! portfolio npv, paths x horizon dates
+    const Matrix &npv() const;
+    //! numeraire, paths x horizon dates
+    const Matrix &numeraires() const;
+
+    const std::vector<Real> &expectedExposure() const;
+    const std::vector<Real> &expectedNegativeExposure() const;
+    const std::vector<Real> &potentialFutureExposure() const;
+
+  private:
+    // flat representation of a cashflow, floating coupons are
+    // identified by a non null fixing time
+    struct Flow {
+        Date accrualStart;
+        Time pay, fixing, start, end;
+        Real amount, nominalAccrual, gearing, spread, indexDcf;
+        Size fixingIndex;
+    };
+    struct Trade {
+        std::vector<Flow> flows;
+        bool isSwaption, physical;
+        Time expiry;
+        Size expiryIndex;
+    };
+
+    void performCalculations() const;
+    void addTrade(const boost::shared_ptr<VanillaSwap> &swap,
+                  const Date &expiry, const bool physical) const;
+    Real underlyingValue(const Trade &trade, const Time t, const Real y,
+                         const Real *path) const;
+    Real swaptionValue(const Trade &trade, const Time t, const Real y) const;
+    Real tradeValue(const Trade &trade, const Size j,
+                    const Real *path) const;
+
+    const boost::shared_ptr<Gaussian1dModel> model_;
+    const std::vector<boost::shared_ptr<VanillaSwap> > swaps_;
+    const std::vector<boost::shared_ptr<Swaption> > swaptions_;
+    const std::vector<Date> horizonDates_;
+    const Size paths_;
+    const unsigned long seed_;
+    const Real pfeQuantile_;
+    const Size blockSize_;
+    const int integrationPoints_;
+    const Real stddevs_;
+
+    // simulation grid (horizon, fixing and expiry dates)
+    mutable std::vector<Date> gridDates_;
+    mutable std::vector<Time> gridTimes_, horizonTimes_;
+    mutable std::vector<Size> horizonIndex_;
+    mutable std::vector<Trade> trades_;
+    mutable Array z_;
+    mutable boost::shared_ptr<Gaussian1dModelSnapshot> snapshot_;
+
+    mutable std::vector<Matrix> cube_;
+    mutable Matrix npv_, numeraires_;
+    mutable std::vector<Real> ee_, ene_, pfe_;
+};
+
+// inline
+
+inline const std::vector<Time> &
+Gaussian1dExposureEngine::horizonTimes() const {
+    calculate();
+    return horizonTimes_;
+}
+
+inline const std::vector<Matrix> &Gaussian1dExposureEngine::cube() const {
+    calculate();
+    return cube_;
+}
+
+inline const Matrix &Gaussian1dExposureEngine::npv() const {
+    calculate();
+    return npv_;
+}
+
+inline const Matrix &Gaussian1dExposureEngine::numeraires() const {
+    calculate();
+    return numeraires_;
+}
+
+inline const std::vector<Real> &
+Gaussian1dExposureEngine::expectedExposure() const {
+    calculate();
+    return ee_;
+}
+
+inline const std::vector<Real> &
+Gaussian1dExposureEngine::expectedNegativeExposure() const {
+    calculate();
+    return ene_;
+}
+
+inline const std::vector<Real> &
+Gaussian1dExposureEngine::potentialFutureExposure() const {
+    calculate();
+    return pfe_;
+}
+
+} // namespace QuantLib
+
+#endif
@@ -29,7 +29,7 @@ Gaussian1dSingleCurveScenarioGenerator::Gaussian1dSingleCurveScenarioGenerator(
     : ScenarioGenerator<YieldTermStructure>(
           model->termStructure()->calendar(),
           model->termStructure()->dayCounter()),
-      model_(model) {
+      model_(model), seed_(seed) {
     modelTime_ = time();
     modelState_ = model_->stateProcess()->x0();
     mt_ = boost::make_shared<MersenneTwisterUniformRng>(seed);
@@ -38,9 +38,28 @@ Gaussian1dSingleCurveScenarioGenerator::Gaussian1dSingleCurveScenarioGenerator(
         *mt_);
 }
 
+void Gaussian1dSingleCurveScenarioGenerator::resetRng(const Size path) {
+    std::vector<unsigned long> seeds(2);
+    seeds[0] = seed_;
+    seeds[1] = static_cast<unsigned long>(path);
+    mt_ = boost::make_shared<MersenneTwisterUniformRng>(seeds);
+    icrng_ = boost::make_shared<InverseCumulativeRng<MersenneTwisterUniformRng,
+                                                     InverseCumulativeNormal> >(
+        *mt_);
+}
+
+void Gaussian1dSingleCurveScenarioGenerator::resetPath(const Size path) {
+    resetRng(path);
+    pathNumber_ = path;
+    resetHorizonDate();
+    modelTime_ = time();
+    modelState_ = model_->stateProcess()->x0();
+}
+
 bool Gaussian1dSingleCurveScenarioGenerator::nextPath() {
     ScenarioGenerator<YieldTermStructure>::nextPath();
     modelTime_ = time();
+    modelState_ = model_->stateProcess()->x0();
     return true;
 }
 
@@ -48,15 +67,16 @@ const Date
 Gaussian1dSingleCurveScenarioGenerator::advance(const Period &suggestedStep) {
     ScenarioGenerator<YieldTermStructure>::advance(suggestedStep);
     Real newModelTime_ = time();
-    boost::shared_ptr<ForwardMeasureProcess> fmp =
-        boost::dynamic_pointer_cast<ForwardMeasureProcess>(
+    boost::shared_ptr<ForwardMeasureProcess1D> fmp =
+        boost::dynamic_pointer_cast<ForwardMeasureProcess1D>(
             model_->stateProcess());
     if (fmp != NULL)
         if (newModelTime_ > fmp->getForwardMeasureTime())
             validHorizonDate_ = false;
     if (validHorizonDate_) {
         Real dt = newModelTime_ - modelTime_;
-        Real dw = std::sqrt(dt) * icrng_->next().value;
+        // evolve expects a standard normal variate
+        Real dw = icrng_->next().value;
         modelState_ =
             model_->stateProcess()->evolve(modelTime_, modelState_, dt, dw);
     }
@@ -69,4 +89,139 @@ Gaussian1dSingleCurveScenarioGenerator::state() const {
     return boost::make_shared<Gaussian1dYieldTermStructure>(
         model_, modelTime_, model_->y(modelState_, modelTime_));
 }
+
+void Gaussian1dSingleCurveScenarioGenerator::setHorizonDates(
+    const std::vector<Date> &horizonDates) {
+
+    Size n = horizonDates.size();
+    QL_REQUIRE(n > 0, "no horizon dates given");
+
+    boost::shared_ptr<StochasticProcess1D> process = model_->stateProcess();
+    boost::shared_ptr<ForwardMeasureProcess1D> fmp =
+        boost::dynamic_pointer_cast<ForwardMeasureProcess1D>(process);
+
+    // The state process is gaussian with a variance independent of the
+    // state and an expectation affine in the state, so each step reads
+    // x(t_j) = a_j + b_j x(t_{j-1}) + s_j z. We precompute the coefficients
+    // and the moments needed for the standardization (see
+    // Gaussian1dModel::y()) once per horizon date.
+    x0_ = process->x0();
+    horizonTimes_.resize(n);
+    a_ = b_ = s_ = mean_ = stdDev_ = Array(n);
+    Time t0 = 0.0;
+    for (Size j = 0; j < n; ++j) {
+        Time t = dc_.yearFraction(baseDate_, horizonDates[j]);
+        QL_REQUIRE(t >= t0, "horizon date #" << j << " (" << horizonDates[j]
+                                             << ") is before the previous one "
+                                                "or the base date ("
+                                             << baseDate_ << ")");
+        QL_REQUIRE(fmp == NULL || t <= fmp->getForwardMeasureTime(),
+                   "horizon date #" << j << " (" << horizonDates[j]
+                                    << ") is after the forward measure time ("
+                                    << fmp->getForwardMeasureTime() << ")");
+        Time dt = t - t0;
+        a_[j] = process->expectation(t0, 0.0, dt);
+        b_[j] = process->expectation(t0, 1.0, dt) - a_[j];
+        s_[j] = process->stdDeviation(t0, 0.0, dt);
+        mean_[j] = process->expectation(0.0, 0.0, t);
+        stdDev_[j] = process->stdDeviation(0.0, 0.0, t);
+        horizonTimes_[j] = t0 = t;
+    }
+}
+
+void Gaussian1dSingleCurveScenarioGenerator::generateStates(
+    Matrix &states, const Size firstPath, const Size nPaths,
+    const Size firstRow) const {
+
+    Size n = horizonTimes_.size();
+    QL_REQUIRE(n > 0, "no horizon dates set");
+    QL_REQUIRE(states.columns() == n,
+               "states matrix has " << states.columns() << " columns, "
+                                    << n << " required");
+    QL_REQUIRE(firstRow + nPaths <= states.rows(),
+               "states matrix has " << states.rows() << " rows, "
+                                    << firstRow + nPaths << " required");
+
+    std::vector<unsigned long> seeds(2);
+    seeds[0] = seed_;
+    for (Size i = 0; i < nPaths; ++i) {
+        // the substream of the path, as in resetRng()
+        seeds[1] = static_cast<unsigned long>(firstPath + i);
+        InverseCumulativeRng<MersenneTwisterUniformRng,
+                             InverseCumulativeNormal>
+            icrng((MersenneTwisterUniformRng(seeds)));
+        Real x = x0_;
+        Matrix::row_iterator y = states.row_begin(firstRow + i);
+        for (Size j = 0; j < n; ++j) {
+            x = a_[j] + b_[j] * x + s_[j] * icrng.next().value;
+            y[j] = stdDev_[j] > 0.0 ? (x - mean_[j]) / stdDev_[j] : 0.0;
+        }
+    }
+}
+
+void Gaussian1dSingleCurveScenarioGenerator::generatePaths(
+    const std::vector<Date> &horizonDates, const Size nPaths,
+    const Size firstPath) {
+
+    setHorizonDates(horizonDates);
+    Size n = horizonTimes_.size();
+
+    states_ = Matrix(nPaths, n);
+    numeraires_ = Matrix(nPaths, n);
+
+    if (firstPath != Null<Size>()) {
+        generateStates(states_, firstPath, nPaths);
+    } else {
+        // the random numbers are taken from the path-wise sequence
+        for (Size i = 0; i < nPaths; ++i) {
+            Real x = x0_;
+            Matrix::row_iterator y = states_.row_begin(i);
+            for (Size j = 0; j < n; ++j) {
+                x = a_[j] + b_[j] * x + s_[j] * icrng_->next().value;
+                y[j] = stdDev_[j] > 0.0 ? (x - mean_[j]) / stdDev_[j] : 0.0;
+            }
+        }
+    }
+
+    // the numeraires are evaluated date by date on all paths at once
+    for (Size j = 0; j < n; ++j) {
+        Array y(states_.column_begin(j), states_.column_end(j));
+        Array num = model_->numeraire(horizonTimes_[j], y);
+        std::copy(num.begin(), num.end(), numeraires_.column_begin(j));
+    }
+}
+
+const Disposable<Array>
+Gaussian1dSingleCurveScenarioGenerator::zerobond(const Size j,
+                                                 const Time T) const {
+    QL_REQUIRE(j < horizonTimes_.size(),
+               "horizon date index (" << j << ") out of range (0..."
+                                      << horizonTimes_.size() << ")");
+    Time t = horizonTimes_[j];
+    if (T < t) {
+        Array result(states_.rows(), 1.0);
+        return result;
+    }
+    Array y(states_.column_begin(j), states_.column_end(j));
+    return model_->zerobond(T, t, y);
+}
+
+const Disposable<Matrix>
+Gaussian1dSingleCurveScenarioGenerator::discount(
+    const Size j, const std::vector<Time> &T) const {
+    QL_REQUIRE(j < horizonTimes_.size(),
+               "horizon date index (" << j << ") out of range (0..."
+                                      << horizonTimes_.size() << ")");
+    Time t = horizonTimes_[j];
+    Matrix result(states_.rows(), T.size(), 1.0);
+    Array y(states_.column_begin(j), states_.column_end(j));
+    for (Size k = 0; k < T.size(); ++k) {
+        if (T[k] >= t) {
+            Array p = model_->zerobond(T[k], t, y);
+            std::copy(p.begin(), p.end(), result.column_begin(k));
+        }
+    }
+    return result;
+}
+
 } // namespace QuantLib
@@ -19,6 +19,19 @@
 
 /*! \file gaussian1dscenariogenerator.hpp
     \brief single curve scenario generator based on a gaussian1d model
+
+    Besides the path-wise interface inherited from ScenarioGenerator
+    the generator provides a batched mode which simulates a whole set
+    of paths on a given grid of horizon dates in one call, storing the
+    standardized model states and the numeraire in paths x dates
+    matrices. Zerobonds are then evaluated directly on these matrices,
+    so that no term structure object needs to be created per scenario.
+
+    Path number k can be generated directly via resetPath(k) or as part
+    of a batch. In this case the random numbers are drawn from a
+    substream seeded with the generator's seed and the path number,
+    which allows for a reproducible distribution of the paths over
+    several threads.
 */
 
 #ifndef quantlib_xva_gaussian1dscenariogenerator_hpp
@@ -30,6 +43,7 @@
 #include <ql/math/randomnumbers/mt19937uniformrng.hpp>
 #include <ql/math/randomnumbers/inversecumulativerng.hpp>
 #include <ql/math/distributions/normaldistribution.hpp>
+#include <ql/math/matrix.hpp>
 
 namespace QuantLib {
 
@@ -41,12 +55,69 @@ class Gaussian1dSingleCurveScenarioGenerator
         const unsigned long seed = 0);
 
     bool nextPath();
+    void resetPath(const Size path);
     const Date advance(const Period &suggestedStep = 1 * Days);
     const boost::shared_ptr<YieldTermStructure> state() const;
 
+    /*! batched mode, generates nPaths paths on the given (increasing)
+        horizon dates and stores the results in states() and
+        numeraires(). If no first path is given, the random numbers are
+        taken from the same sequence as in the path-wise mode, i.e. the
+        paths coincide with those obtained by advancing to the same
+        horizon dates in the path-wise mode, and the random numbers
+        used are consumed from that sequence. Otherwise the i-th path
+        of the batch is drawn from the substream of path firstPath + i,
+        as it would be after resetPath(firstPath + i), and the
+        path-wise random number sequence is not affected. The
+        numeraires are evaluated with one batch call to the model per
+        horizon date. */
+    void generatePaths(const std::vector<Date> &horizonDates,
+                       const Size nPaths,
+                       const Size firstPath = Null<Size>());
+
+    /*! sets up the batched mode for the given (increasing) horizon
+        dates, this is done by generatePaths() as well */
+    void setHorizonDates(const std::vector<Date> &horizonDates);
+
+    /*! draws the standardized states of the paths firstPath + i,
+        i = 0...nPaths-1, on the horizon dates given to the last call of
+        setHorizonDates() or generatePaths() and stores them in the rows
+        firstRow + i of states. Each path is drawn from its own
+        substream as in generatePaths(). Neither the model nor the
+        state of the generator are accessed, so that the method can be
+        called concurrently for distinct rows. */
+    void generateStates(Matrix &states, const Size firstPath,
+                        const Size nPaths, const Size firstRow = 0) const;
+
+    //! horizon times of the last batch
+    const std::vector<Time> &horizonTimes() const { return horizonTimes_; }
+    //! standardized model states y, paths x dates
+    const Matrix &states() const { return states_; }
+    //! numeraire values, paths x dates
+    const Matrix &numeraires() const { return numeraires_; }
+
+    /*! zerobond prices P(t_j,T) for all paths of the last batch, where
+        t_j is the horizon time with index j, for T < t_j we return 1.0
+        as in the path-wise mode; the prices are computed with one
+        batch call to the model on the states of date j */
+    const Disposable<Array> zerobond(const Size j, const Time T) const;
+
+    /*! discount factors P(t_j,T_k) for all paths of the last batch (rows)
+        and the given maturities T_k (columns) */
+    const Disposable<Matrix> discount(const Size j,
+                                      const std::vector<Time> &T) const;
+
   private:
+    void resetRng(const Size path);
     boost::shared_ptr<Gaussian1dModel> model_;
+    unsigned long seed_;
     Real modelTime_, modelState_;
+    std::vector<Time> horizonTimes_;
+    // state transition x(t_j) = a_j + b_j x(t_{j-1}) + s_j z and
+    // moments of x(t_j) used for the standardization
+    Real x0_;
+    Array a_, b_, s_, mean_, stdDev_;
+    Matrix states_, numeraires_;
     boost::shared_ptr<MersenneTwisterUniformRng> mt_;
     boost::shared_ptr<InverseCumulativeRng<MersenneTwisterUniformRng,
                                            InverseCumulativeNormal> > icrng_;
@@ -29,6 +29,7 @@
 #include <ql/time/calendars/nullcalendar.hpp>
 #include <ql/time/daycounters/actual365fixed.hpp>
 #include <ql/settings.hpp>
+#include <ql/errors.hpp>
 
 namespace QuantLib {
 
@@ -45,6 +46,12 @@ template <class State> class ScenarioGenerator {
     // If no more path can be generated false is returned.
     virtual bool nextPath();
 
+    // Reset the horizon date and start the path with the given
+    // number. Generators supporting this produce the path independently
+    // of the paths generated before, so that the paths can be
+    // distributed over several generator instances (e.g. one per thread).
+    virtual void resetPath(const Size path);
+
     // Return the current horizon date (or null if invalid)
     virtual const Date horizonDate() const;
 
@@ -86,6 +93,11 @@ template <class State> inline bool ScenarioGenerator<State>::nextPath() {
     return true;
 }
 
+template <class State>
+inline void ScenarioGenerator<State>::resetPath(const Size) {
+    QL_FAIL("scenario generator does not support random access to paths");
+}
+
 template <class State>
 inline const Date ScenarioGenerator<State>::advance(const Period &p) {
     if (horizonDate_ >= Date::maxDate())
@@ -5,6 +5,7 @@
  Copyright (C) 2003, 2004, 2005, 2006 StatPro Italia srl
  Copyright (C) 2007, 2008 Ferdinando Ametrano
  Copyright (C) 2007 Chiara Fornarola
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -43,6 +44,7 @@ namespace QuantLib {
     */
     class Index : public Observable {
       public:
+        Index() : fixingsId_(Null<Size>()) {}
         virtual ~Index() {}
         //! Returns the name of the index.
         /*! \warning This method is used for output and comparison
@@ -92,7 +94,7 @@ namespace QuantLib {
                         bool forceOverwrite = false) {
             checkNativeFixingsAllowed();
             std::string tag = name();
-            TimeSeries<Real> h = IndexManager::instance().getHistory(tag);
+            FixingHistory h = IndexManager::instance().getFixingHistory(tag);
             bool missingFixing, validFixing;
             bool noInvalidFixing = true, noDuplicatedFixing = true;
             Date invalidDate, duplicatedDate;
@@ -105,7 +107,7 @@ namespace QuantLib {
                 missingFixing = forceOverwrite || currentValue == nullValue;
                 if (validFixing) {
                     if (missingFixing)
-                        h[*(dBegin++)] = *(vBegin++);
+                        h.set(*(dBegin++), *(vBegin++));
                     else if (close(currentValue,*(vBegin))) {
                         ++dBegin;
                         ++vBegin;
@@ -120,7 +122,7 @@ namespace QuantLib {
                     invalidValue = *(vBegin++);
                 }
             }
-            IndexManager::instance().setHistory(tag, h);
+            IndexManager::instance().setFixingHistory(tag, h);
             QL_REQUIRE(noInvalidFixing,
                        "At least one invalid fixing provided: " <<
                        invalidDate.weekday() << " " << invalidDate <<
@@ -133,9 +135,20 @@ namespace QuantLib {
         }
         //! clears all stored historical fixings
         void clearFixings();
+      protected:
+        //! returns the stored fixing at the given date, or Null<Real>()
+        /*! The name of the index is interned on first use, later
+            lookups go directly to the stored history.
+        */
+        Real storedFixing(const Date& fixingDate) const {
+            if (fixingsId_ == Null<Size>())
+                fixingsId_ = IndexManager::instance().id(name());
+            return IndexManager::instance().fixing(fixingsId_, fixingDate);
+        }
       private:
         //! check if index allows for native fixings
         void checkNativeFixingsAllowed();
+        mutable Size fixingsId_;
     };
 
 }
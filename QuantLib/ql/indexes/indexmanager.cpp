@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2004, 2005, 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -26,46 +27,270 @@
 #if defined(__GNUC__) && (((__GNUC__ == 4) && (__GNUC_MINOR__ >= 8)) || (__GNUC__ > 4))
 #pragma GCC diagnostic pop
 #endif
+#include <boost/cstdint.hpp>
+#include <fstream>
 
 using boost::algorithm::to_upper_copy;
 using std::string;
 
 namespace QuantLib {
 
+    namespace {
+
+        const char historyFileTag[4] = { 'Q', 'L', 'F', 'H' };
+        const boost::uint32_t historyFileVersion = 1;
+
+        template <class T>
+        void write(std::ofstream& out, const T& x) {
+            out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+        }
+
+        template <class T>
+        void read(std::ifstream& in, T& x) {
+            in.read(reinterpret_cast<char*>(&x), sizeof(T));
+        }
+
+    }
+
+    FixingHistory::FixingHistory(const TimeSeries<Real>& history)
+    : firstSerial_(0), size_(0) {
+        if (history.empty())
+            return;
+        firstSerial_ = history.firstDate().serialNumber();
+        values_.resize(history.lastDate().serialNumber() - firstSerial_ + 1,
+                       Null<Real>());
+        for (TimeSeries<Real>::const_iterator i = history.begin();
+             i != history.end(); ++i) {
+            Real& v = values_[i->first.serialNumber() - firstSerial_];
+            if (v == Null<Real>() && i->second != Null<Real>())
+                ++size_;
+            v = i->second;
+        }
+    }
+
+    Date FixingHistory::firstDate() const {
+        QL_REQUIRE(size_ > 0, "empty fixing history");
+        Size i = 0;
+        while (values_[i] == Null<Real>())
+            ++i;
+        return Date(firstSerial_ + static_cast<BigInteger>(i));
+    }
+
+    Date FixingHistory::lastDate() const {
+        QL_REQUIRE(size_ > 0, "empty fixing history");
+        Size i = values_.size() - 1;
+        while (values_[i] == Null<Real>())
+            --i;
+        return Date(firstSerial_ + static_cast<BigInteger>(i));
+    }
+
+    TimeSeries<Real> FixingHistory::timeSeries() const {
+        std::vector<Date> dates;
+        std::vector<Real> values;
+        dates.reserve(size_);
+        values.reserve(size_);
+        for (Size i = 0; i < values_.size(); ++i) {
+            if (values_[i] != Null<Real>()) {
+                dates.push_back(Date(firstSerial_ + static_cast<BigInteger>(i)));
+                values.push_back(values_[i]);
+            }
+        }
+        return TimeSeries<Real>(dates.begin(), dates.end(), values.begin());
+    }
+
+    void FixingHistory::set(const Date& d, Real value) {
+        BigInteger s = d.serialNumber();
+        if (values_.empty()) {
+            if (value == Null<Real>())
+                return;
+            firstSerial_ = s;
+        } else if (s < firstSerial_) {
+            if (value == Null<Real>())
+                return;
+            values_.insert(values_.begin(), firstSerial_ - s, Null<Real>());
+            firstSerial_ = s;
+        }
+        Size i = static_cast<Size>(s - firstSerial_);
+        if (i >= values_.size()) {
+            if (value == Null<Real>())
+                return;
+            values_.resize(i + 1, Null<Real>());
+        }
+        if (values_[i] == Null<Real>() && value != Null<Real>())
+            ++size_;
+        else if (values_[i] != Null<Real>() && value == Null<Real>())
+            --size_;
+        values_[i] = value;
+    }
+
+    void FixingHistory::clear() {
+        firstSerial_ = 0;
+        values_.clear();
+        size_ = 0;
+    }
+
+
+    Size IndexManager::id(const string& name) const {
+        std::pair<std::map<string, Size>::iterator, bool> i =
+            ids_.insert(std::make_pair(to_upper_copy(name), entries_.size()));
+        if (i.second)
+            entries_.push_back(Entry());
+        return i.first->second;
+    }
+
+    IndexManager::Entry& IndexManager::entry(const string& name) const {
+        Entry& e = entries_[id(name)];
+        e.stored = true;
+        return e;
+    }
+
+    const IndexManager::Entry* IndexManager::find(const string& name) const {
+        std::map<string, Size>::const_iterator i =
+            ids_.find(to_upper_copy(name));
+        if (i == ids_.end() || !entries_[i->second].stored)
+            return 0;
+        return &entries_[i->second];
+    }
+
     bool IndexManager::hasHistory(const string& name) const {
-        return data_.find(to_upper_copy(name)) != data_.end();
+        return find(name) != 0;
     }
 
     const TimeSeries<Real>&
     IndexManager::getHistory(const string& name) const {
-        return data_[to_upper_copy(name)].value();
+        const Entry& e = entry(name);
+        if (!e.seriesIsValid) {
+            e.series = e.fixings.timeSeries();
+            e.seriesIsValid = true;
+        }
+        return e.series;
     }
 
     void IndexManager::setHistory(const string& name,
                                   const TimeSeries<Real>& history) {
-        data_[to_upper_copy(name)] = history;
+        Entry& e = entry(name);
+        e.fixings = FixingHistory(history);
+        e.series = history;
+        e.seriesIsValid = true;
+        e.notifier->notifyObservers();
+    }
+
+    const FixingHistory&
+    IndexManager::getFixingHistory(const string& name) const {
+        return entry(name).fixings;
+    }
+
+    void IndexManager::setFixingHistory(const string& name,
+                                        const FixingHistory& history) {
+        Entry& e = entry(name);
+        e.fixings = history;
+        // keep the time series in sync if it was requested before,
+        // since references to it might have been kept
+        if (e.seriesIsValid)
+            e.series = history.timeSeries();
+        e.notifier->notifyObservers();
+    }
+
+    Real IndexManager::fixing(const string& name, const Date& d) const {
+        const Entry* e = find(name);
+        return e == 0 ? Null<Real>() : e->fixings[d];
     }
 
     boost::shared_ptr<Observable>
     IndexManager::notifier(const string& name) const {
-        return data_[to_upper_copy(name)];
+        return entry(name).notifier;
     }
 
     std::vector<string> IndexManager::histories() const {
         std::vector<string> temp;
-        temp.reserve(data_.size());
-        for (history_map::const_iterator i=data_.begin();
-             i!=data_.end(); ++i)
-            temp.push_back(i->first);
+        temp.reserve(ids_.size());
+        for (std::map<string, Size>::const_iterator i=ids_.begin();
+             i!=ids_.end(); ++i)
+            if (entries_[i->second].stored)
+                temp.push_back(i->first);
         return temp;
     }
 
     void IndexManager::clearHistory(const string& name) {
-        data_.erase(to_upper_copy(name));
+        std::map<string, Size>::const_iterator i =
+            ids_.find(to_upper_copy(name));
+        if (i == ids_.end())
+            return;
+        Entry& e = entries_[i->second];
+        e.stored = false;
+        e.fixings.clear();
+        e.series = TimeSeries<Real>();
+        e.seriesIsValid = false;
+        e.notifier->notifyObservers();
     }
 
     void IndexManager::clearHistories() {
-        data_.clear();
+        for (std::map<string, Size>::const_iterator i=ids_.begin();
+             i!=ids_.end(); ++i)
+            clearHistory(i->first);
+    }
+
+    void IndexManager::loadHistories(const string& fileName) {
+        std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+        QL_REQUIRE(in.is_open(), "could not open " << fileName);
+        char tag[4];
+        boost::uint32_t version, realSize, n;
+        in.read(tag, 4);
+        read(in, version);
+        read(in, realSize);
+        read(in, n);
+        QL_REQUIRE(in && std::equal(tag, tag + 4, historyFileTag),
+                   fileName << " is not a fixing history file");
+        QL_REQUIRE(version == historyFileVersion,
+                   "unsupported fixing history file version " << version);
+        QL_REQUIRE(realSize == sizeof(Real),
+                   "fixing history file was written with a Real type of size "
+                       << realSize << ", expected " << sizeof(Real));
+        for (Size i = 0; i < n; ++i) {
+            boost::uint32_t nameSize;
+            boost::int64_t firstSerial;
+            boost::uint64_t size;
+            read(in, nameSize);
+            string name(nameSize, ' ');
+            if (nameSize > 0)
+                in.read(&name[0], nameSize);
+            read(in, firstSerial);
+            read(in, size);
+            QL_REQUIRE(in, "error reading " << fileName);
+            FixingHistory h;
+            h.firstSerial_ = static_cast<BigInteger>(firstSerial);
+            h.values_.resize(static_cast<Size>(size));
+            if (size > 0)
+                in.read(reinterpret_cast<char*>(&h.values_[0]),
+                        size * sizeof(Real));
+            QL_REQUIRE(in, "error reading " << fileName);
+            for (Size j = 0; j < h.values_.size(); ++j)
+                if (h.values_[j] != Null<Real>())
+                    ++h.size_;
+            setFixingHistory(name, h);
+        }
+    }
+
+    void IndexManager::saveHistories(const string& fileName) const {
+        std::ofstream out(fileName.c_str(),
+                          std::ios::out | std::ios::binary | std::ios::trunc);
+        QL_REQUIRE(out.is_open(), "could not open " << fileName);
+        std::vector<string> names = histories();
+        out.write(historyFileTag, 4);
+        write(out, historyFileVersion);
+        write(out, static_cast<boost::uint32_t>(sizeof(Real)));
+        write(out, static_cast<boost::uint32_t>(names.size()));
+        for (Size i = 0; i < names.size(); ++i) {
+            const FixingHistory& h = entries_[ids_[names[i]]].fixings;
+            write(out, static_cast<boost::uint32_t>(names[i].size()));
+            out.write(names[i].data(), names[i].size());
+            write(out, static_cast<boost::int64_t>(h.firstSerial_));
+            write(out, static_cast<boost::uint64_t>(h.values_.size()));
+            if (!h.values_.empty())
+                out.write(reinterpret_cast<const char*>(&h.values_[0]),
+                          h.values_.size() * sizeof(Real));
+        }
+        QL_REQUIRE(out, "error writing " << fileName);
     }
 
 }
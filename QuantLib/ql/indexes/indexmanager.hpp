@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2004, 2005, 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -26,13 +27,62 @@
 
 #include <ql/timeseries.hpp>
 #include <ql/patterns/singleton.hpp>
-#include <ql/utilities/observablevalue.hpp>
+#include <ql/patterns/observable.hpp>
+#include <deque>
 
 
 namespace QuantLib {
 
+    //! contiguous history of index fixings
+    /*! The fixings are stored in an array indexed by the serial
+        number of the fixing date relative to the first stored date,
+        missing fixings being represented by Null<Real>(). The lookup
+        of a fixing is therefore O(1) and the history can be copied,
+        written and read as a single block of memory.
+
+        \note the array covers all calendar days between the first
+              and the last fixing, so that histories with sparse
+              fixings (e.g. monthly inflation fixings) take more
+              memory than their TimeSeries counterpart.
+    */
+    class FixingHistory {
+        friend class IndexManager;
+      public:
+        FixingHistory() : firstSerial_(0), size_(0) {}
+        explicit FixingHistory(const TimeSeries<Real>& history);
+        //! \name Inspectors
+        //@{
+        //! returns the fixing at the given date, or Null<Real>() if none
+        Real operator[](const Date& d) const;
+        //! number of stored fixings
+        Size size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        Date firstDate() const;
+        Date lastDate() const;
+        //! conversion to a time series
+        TimeSeries<Real> timeSeries() const;
+        //@}
+        //! \name Modifiers
+        //@{
+        //! stores the fixing; a null value removes the fixing
+        void set(const Date& d, Real value);
+        void clear();
+        //@}
+      private:
+        BigInteger firstSerial_;
+        std::vector<Real> values_;
+        Size size_;
+    };
+
     //! global repository for past index fixings
-    /*! \note index names are case insensitive */
+    /*! The fixings are stored as FixingHistory instances; the
+        TimeSeries returned by getHistory() is built on demand and
+        cached until the fixings of the index change.
+
+        \note index names are case insensitive; they are interned
+              on first use, so that the storage of an index is not
+              released when its history is cleared.
+    */
     class IndexManager : public Singleton<IndexManager> {
         friend class Singleton<IndexManager>;
       private:
@@ -44,6 +94,20 @@ namespace QuantLib {
         const TimeSeries<Real>& getHistory(const std::string& name) const;
         //! stores the historical fixings of the index
         void setHistory(const std::string& name, const TimeSeries<Real>&);
+        //! returns the (possibly empty) contiguous history of the index fixings
+        const FixingHistory& getFixingHistory(const std::string& name) const;
+        //! stores the historical fixings of the index
+        void setFixingHistory(const std::string& name, const FixingHistory&);
+        //! returns the fixing of the index at the given date, or Null<Real>()
+        Real fixing(const std::string& name, const Date& d) const;
+        //! returns the interned id of the index
+        /*! The id stays valid for the lifetime of the manager, also
+            when the history of the index is cleared.
+        */
+        Size id(const std::string& name) const;
+        //! returns the fixing of the index with the given id, or Null<Real>()
+        /*! This avoids the case-insensitive lookup of the name. */
+        Real fixing(Size id, const Date& d) const;
         //! observer notifying of changes in the index fixings
         boost::shared_ptr<Observable> notifier(const std::string& name) const;
         //! returns all names of the indexes for which fixings were stored
@@ -52,12 +116,51 @@ namespace QuantLib {
         void clearHistory(const std::string& name);
         //! clears all stored fixings
         void clearHistories();
+        //! \name Bulk storage
+        /*! The histories are written as blocks of raw memory in the
+            native byte order, the file can therefore only be read on
+            platforms with the same endianness and the same Real type.
+        */
+        //@{
+        //! stores the histories read from the given file
+        void loadHistories(const std::string& fileName);
+        //! writes all stored histories to the given file
+        void saveHistories(const std::string& fileName) const;
+        //@}
       private:
-        typedef std::map<std::string, ObservableValue<TimeSeries<Real> > >
-                                                                  history_map;
-        mutable history_map data_;
+        struct Entry {
+            Entry() : stored(false), seriesIsValid(false),
+                      notifier(new Observable) {}
+            bool stored;
+            FixingHistory fixings;
+            mutable bool seriesIsValid;
+            mutable TimeSeries<Real> series;
+            boost::shared_ptr<Observable> notifier;
+        };
+        Entry& entry(const std::string& name) const;
+        const Entry* find(const std::string& name) const;
+        // interned (upper case) names, entries are never removed so
+        // that references to them stay valid
+        mutable std::map<std::string, Size> ids_;
+        mutable std::deque<Entry> entries_;
     };
 
+
+    // inline definitions
+
+    inline Real FixingHistory::operator[](const Date& d) const {
+        BigInteger i = d.serialNumber() - firstSerial_;
+        if (i < 0 || i >= static_cast<BigInteger>(values_.size()))
+            return Null<Real>();
+        return values_[i];
+    }
+
+    inline Real IndexManager::fixing(Size id, const Date& d) const {
+        QL_REQUIRE(id < entries_.size(), "unknown index id " << id);
+        // cleared histories are empty, no need to check the flag
+        return entries_[id].fixings[d];
+    }
+
 }
 
 
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2007 Chris Kenyon
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -142,7 +143,7 @@ namespace QuantLib {
             // we're not sure, but the fixing might be there so we
             // check.  Todo: check which fixings are not possible, to
             // avoid using fixings in the future
-            Real f = timeSeries()[latestNeededDate];
+            Real f = storedFixing(latestNeededDate);
             return (f == Null<Real>());
         }
     }
@@ -252,8 +253,7 @@ namespace QuantLib {
                 QL_REQUIRE(limBefFirstFix != Null<Rate>(),
                             "Missing " << name() << " fixing for "
                             << limBef.first );
-                Rate limBefSecondFix =
-                IndexManager::instance().getHistory(name())[limBef.second+1];
+                Rate limBefSecondFix = storedFixing(limBef.second+1);
                 QL_REQUIRE(limBefSecondFix != Null<Rate>(),
                             "Missing " << name() << " fixing for "
                             << limBef.second+1 );
@@ -4,6 +4,7 @@
  Copyright (C) 2002, 2003 Ferdinando Ametrano
  Copyright (C) 2000, 2001, 2002, 2003 RiskMap srl
  Copyright (C) 2003, 2004, 2005, 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -29,6 +30,7 @@
 #include <ql/math/interpolations/extrapolation.hpp>
 #include <ql/math/comparison.hpp>
 #include <ql/errors.hpp>
+#include <algorithm>
 #include <vector>
 
 namespace QuantLib {
@@ -52,6 +54,12 @@ namespace QuantLib {
             virtual std::vector<Real> yValues() const = 0;
             virtual bool isInRange(Real) const = 0;
             virtual Real value(Real) const = 0;
+            /*! value at x, the hint is the interval index returned
+                by a previous call; implementations which do not
+                make use of it fall back to value(x). */
+            virtual Real hintedValue(Real x, Size&) const {
+                return value(x);
+            }
             virtual Real primitive(Real) const = 0;
             virtual Real derivative(Real) const = 0;
             virtual Real secondDerivative(Real) const = 0;
@@ -105,6 +113,25 @@ namespace QuantLib {
                 else
                     return std::upper_bound(xBegin_,xEnd_-1,x)-xBegin_-1;
             }
+            /*! same as locate(x), but starting the search from the
+                interval given by the hint, which is updated. Moving
+                forward by one or two intervals is resolved without a
+                binary search, and the search for larger steps is
+                restricted to the points after the hint. */
+            Size locate(Real x, Size& hint) const {
+                Size n = xEnd_-xBegin_;
+                if (hint > n-2 || (hint > 0 && x < xBegin_[hint])) {
+                    hint = locate(x);
+                    return hint;
+                }
+                for (Size k=0; k<2; ++k) {
+                    if (hint == n-2 || x < xBegin_[hint+1])
+                        return hint;
+                    ++hint;
+                }
+                hint = std::upper_bound(xBegin_+hint+1,xEnd_-1,x)-xBegin_-1;
+                return hint;
+            }
             I1 xBegin_, xEnd_;
             I2 yBegin_;
         };
@@ -116,6 +143,27 @@ namespace QuantLib {
             checkRange(x,allowExtrapolation);
             return impl_->value(x);
         }
+        /*! value at x, where the hint holds the interval found by the
+            previous call (start with 0). Sequences of increasing points
+            are evaluated without a full binary search each time.
+        */
+        Real operator()(Real x, Size& hint,
+                        bool allowExtrapolation = false) const {
+            checkRange(x,allowExtrapolation);
+            return impl_->hintedValue(x, hint);
+        }
+        /*! values at the points in [xBegin, xEnd), written to the
+            output iterator. The points should be sorted to benefit
+            from the hinted evaluation, unsorted points are handled
+            correctly, though.
+        */
+        template <class I, class O>
+        void operator()(I xBegin, I xEnd, O result,
+                        bool allowExtrapolation = false) const {
+            Size hint = 0;
+            for (; xBegin != xEnd; ++xBegin, ++result)
+                *result = (*this)(*xBegin, hint, allowExtrapolation);
+        }
         Real primitive(Real x, bool allowExtrapolation = false) const {
             checkRange(x,allowExtrapolation);
             return impl_->primitive(x);
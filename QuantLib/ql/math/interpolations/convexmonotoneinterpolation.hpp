@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2008 Simon Ibbotson
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -210,6 +211,7 @@ namespace QuantLib {
             void update();
 
             Real value(Real x) const;
+            Real hintedValue(Real x, Size& hint) const;
             Real primitive(Real x) const;
             Real derivative(Real) const {
                 QL_FAIL("Convex-monotone spline derivative not implemented");
@@ -226,8 +228,11 @@ namespace QuantLib {
                 return retArray;
             }
           private:
+            void updateSections();
             helper_map sectionHelpers_;
             helper_map preSectionHelpers_;
+            // section helpers in the order of the intervals
+            std::vector<boost::shared_ptr<SectionHelper> > sections_;
             boost::shared_ptr<SectionHelper> extrapolationHelper_;
             bool forcePositive_, constantLastPeriod_;
             Real quadraticity_;
@@ -608,6 +613,7 @@ namespace QuantLib {
                                                            this->xBegin_[0]));
                 sectionHelpers_[this->xBegin_[1]] = singleHelper;
                 extrapolationHelper_ = singleHelper;
+                updateSections();
                 return;
             }
 
@@ -841,6 +847,19 @@ namespace QuantLib {
                                 primitive,
                                 *(this->xEnd_-1)));
             }
+            updateSections();
+        }
+
+        template <class I1, class I2>
+        void ConvexMonotoneImpl<I1,I2>::updateSections() {
+            // the helper of the i-th interval is stored at x[i+1]
+            sections_.clear();
+            if (sectionHelpers_.size() != length_-1)
+                return;
+            for (typename helper_map::const_iterator i =
+                     sectionHelpers_.begin();
+                 i != sectionHelpers_.end(); ++i)
+                sections_.push_back(i->second);
         }
 
         template <class I1, class I2>
@@ -852,6 +871,20 @@ namespace QuantLib {
             return sectionHelpers_.upper_bound(x)->second->value(x);
         }
 
+        template <class I1, class I2>
+        Real ConvexMonotoneImpl<I1,I2>::hintedValue(Real x,
+                                                    Size& hint) const {
+            if (x >= *(this->xEnd_-1)) {
+                return extrapolationHelper_->value(x);
+            }
+
+            // pre-existing helpers not matching the points
+            if (sections_.empty())
+                return value(x);
+
+            return sections_[this->locate(x, hint)]->value(x);
+        }
+
         template <class I1, class I2>
         Real ConvexMonotoneImpl<I1,I2>::primitive(Real x) const {
             if (x >= *(this->xEnd_-1)) {
@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2002, 2003, 2008, 2009 Ferdinando Ametrano
  Copyright (C) 2004, 2007, 2008 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -227,6 +228,9 @@ namespace QuantLib {
             Real value(Real x) const {
                 return std::exp(interpolation_(x, true));
             }
+            Real hintedValue(Real x, Size& hint) const {
+                return std::exp(interpolation_(x, hint, true));
+            }
             Real primitive(Real) const {
                 QL_FAIL("LogInterpolation primitive not implemented");
             }
@@ -78,6 +78,8 @@ namespace QuantLib {
         const std::vector<std::pair<Size,value_type> >& convergenceTable()
                                                                         const;
       private:
+        // not supported, the convergence table can not be merged
+        void merge(const ConvergenceStatistics&);
         table_type table_;
         U samplingRule_;
         Size nextSampleSize_;
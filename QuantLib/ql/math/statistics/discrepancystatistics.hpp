@@ -93,6 +93,8 @@ namespace QuantLib {
         }
         void reset(Size dimension = 0);
       private:
+        // not supported, the discrepancy can not be merged
+        void merge(const DiscrepancyStatistics&);
         mutable Real adiscr_, cdiscr_;
         Real bdiscr_, ddiscr_;
     };
@@ -168,6 +168,10 @@ namespace QuantLib {
                 add(*begin, *wbegin);
         }
 
+        /*! adds the data collected by another instance, the result
+            is identical to adding its samples one by one */
+        void merge(const GeneralStatistics& other);
+
         //! resets the data to a null set
         void reset();
 
@@ -225,6 +229,14 @@ namespace QuantLib {
         sorted_ = false;
     }
 
+    inline void GeneralStatistics::merge(const GeneralStatistics& other) {
+        if (other.samples_.empty())
+            return;
+        samples_.insert(samples_.end(), other.samples_.begin(),
+                        other.samples_.end());
+        sorted_ = false;
+    }
+
     inline void GeneralStatistics::reset() {
         samples_ = std::vector<std::pair<Real,Real> >();
         sorted_ = true;
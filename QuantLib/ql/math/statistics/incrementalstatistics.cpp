@@ -20,7 +20,8 @@
 */
 
 #include <ql/math/statistics/incrementalstatistics.hpp>
-#include <iomanip>
+#include <algorithm>
+#include <cmath>
 
 namespace QuantLib {
 
@@ -29,28 +30,23 @@ namespace QuantLib {
     }
 
     Size IncrementalStatistics::samples() const {
-        return boost::accumulators::extract_result<
-            boost::accumulators::tag::count>(acc_);
+        return samples_;
     }
 
     Real IncrementalStatistics::weightSum() const {
-        return boost::accumulators::extract_result<
-            boost::accumulators::tag::sum_of_weights>(acc_);
+        return weightSum_;
     }
 
     Real IncrementalStatistics::mean() const {
         QL_REQUIRE(weightSum() > 0.0, "sampleWeight_= 0, unsufficient");
-        return boost::accumulators::extract_result<
-            boost::accumulators::tag::weighted_mean>(acc_);
+        return weightedSum_ / weightSum_;
     }
 
     Real IncrementalStatistics::variance() const {
         QL_REQUIRE(weightSum() > 0.0, "sampleWeight_= 0, unsufficient");
         QL_REQUIRE(samples() > 1, "sample number <= 1, unsufficient");
         Real n = static_cast<Real>(samples());
-        return n / (n - 1.0) *
-               boost::accumulators::extract_result<
-                   boost::accumulators::tag::weighted_variance>(acc_);
+        return n / (n - 1.0) * runningVariance_;
     }
 
     Real IncrementalStatistics::standardDeviation() const {
@@ -66,47 +62,45 @@ namespace QuantLib {
         Real n = static_cast<Real>(samples());
         Real r1 = n / (n - 2.0);
         Real r2 = (n - 1.0) / (n - 2.0);
-        return std::sqrt(r1 * r2) * 
-               boost::accumulators::extract_result<
-                   boost::accumulators::tag::weighted_skewness>(acc_);
+        Real m = weightedSum_ / weightSum_;
+        Real m2 = moment2_ / weightSum_, m3 = moment3_ / weightSum_;
+        Real c2 = m2 - m * m;
+        return std::sqrt(r1 * r2) *
+               ((m3 - 3. * m2 * m + 2. * m * m * m) / (c2 * std::sqrt(c2)));
     }
 
     Real IncrementalStatistics::kurtosis() const {
         QL_REQUIRE(samples() > 3,
                    "sample number <= 3, unsufficient");
-        boost::accumulators::extract_result<
-            boost::accumulators::tag::weighted_kurtosis>(acc_);
         Real n = static_cast<Real>(samples());
         Real r1 = (n - 1.0) / (n - 2.0);
         Real r2 = (n + 1.0) / (n - 3.0);
         Real r3 = (n - 1.0) / (n - 3.0);
-        return ((3.0 + boost::accumulators::extract_result<
-                           boost::accumulators::tag::weighted_kurtosis>(acc_)) *
-                    r2 -
-                3.0 * r3) *
-               r1;
+        Real m = weightedSum_ / weightSum_;
+        Real m2 = moment2_ / weightSum_, m3 = moment3_ / weightSum_,
+             m4 = moment4_ / weightSum_;
+        Real c2 = m2 - m * m;
+        Real excess = (m4 - 4. * m3 * m + 6. * m2 * m * m -
+                       3. * m * m * m * m) / (c2 * c2) - 3.;
+        return ((3.0 + excess) * r2 - 3.0 * r3) * r1;
     }
 
     Real IncrementalStatistics::min() const {
         QL_REQUIRE(samples() > 0, "empty sample set");
-        return boost::accumulators::extract_result<
-            boost::accumulators::tag::min>(acc_);
+        return min_;
     }
 
     Real IncrementalStatistics::max() const {
         QL_REQUIRE(samples() > 0, "empty sample set");
-        return boost::accumulators::extract_result<
-            boost::accumulators::tag::max>(acc_);
+        return max_;
     }
 
     Size IncrementalStatistics::downsideSamples() const {
-        return boost::accumulators::extract_result<
-            boost::accumulators::tag::count>(downsideAcc_);
+        return downsideSamples_;
     }
 
     Real IncrementalStatistics::downsideWeightSum() const {
-        return boost::accumulators::extract_result<
-            boost::accumulators::tag::sum_of_weights>(downsideAcc_);
+        return downsideWeightSum_;
     }
 
     Real IncrementalStatistics::downsideVariance() const {
@@ -114,9 +108,7 @@ namespace QuantLib {
         QL_REQUIRE(downsideSamples() > 1, "sample number <= 1, unsufficient");
         Real n = static_cast<Real>(downsideSamples());
         Real r1 = n / (n - 1.0);
-        return r1 *
-               boost::accumulators::extract_result<
-                   boost::accumulators::tag::moment<2> >(downsideAcc_);
+        return r1 * (downsideMoment2_ / downsideWeightSum_);
     }
 
     Real IncrementalStatistics::downsideDeviation() const {
@@ -126,14 +118,66 @@ namespace QuantLib {
     void IncrementalStatistics::add(Real value, Real valueWeight) {
         QL_REQUIRE(valueWeight >= 0.0, "negative weight (" << valueWeight
                                                            << ") not allowed");
-        acc_(value, boost::accumulators::weight = valueWeight);
-        if(value < 0.0)
-            downsideAcc_(value, boost::accumulators::weight = valueWeight);
+        Real value2 = value * value;
+        ++samples_;
+        weightSum_ += valueWeight;
+        weightedSum_ += value * valueWeight;
+        // running mean and variance (West's algorithm)
+        runningMean_ = (runningMean_ * (weightSum_ - valueWeight) +
+                        value * valueWeight) / weightSum_;
+        if (samples_ > 1) {
+            Real tmp = value - runningMean_;
+            runningVariance_ =
+                runningVariance_ * (weightSum_ - valueWeight) / weightSum_ +
+                tmp * tmp * valueWeight / (weightSum_ - valueWeight);
+        }
+        moment2_ += valueWeight * value2;
+        moment3_ += valueWeight * (value2 * value);
+        moment4_ += valueWeight * (value2 * value2);
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        if (value < 0.0) {
+            ++downsideSamples_;
+            downsideWeightSum_ += valueWeight;
+            downsideMoment2_ += valueWeight * value2;
+        }
+    }
+
+    void IncrementalStatistics::merge(const IncrementalStatistics& other) {
+        if (other.samples_ == 0)
+            return;
+        if (samples_ == 0) {
+            *this = other;
+            return;
+        }
+        Real w = weightSum_ + other.weightSum_;
+        Real delta = other.runningMean_ - runningMean_;
+        runningVariance_ =
+            (runningVariance_ * weightSum_ +
+             other.runningVariance_ * other.weightSum_) / w +
+            delta * delta * (weightSum_ / w) * (other.weightSum_ / w);
+        runningMean_ = (runningMean_ * weightSum_ +
+                        other.runningMean_ * other.weightSum_) / w;
+        samples_ += other.samples_;
+        weightSum_ = w;
+        weightedSum_ += other.weightedSum_;
+        moment2_ += other.moment2_;
+        moment3_ += other.moment3_;
+        moment4_ += other.moment4_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        downsideSamples_ += other.downsideSamples_;
+        downsideWeightSum_ += other.downsideWeightSum_;
+        downsideMoment2_ += other.downsideMoment2_;
     }
 
     void IncrementalStatistics::reset() {
-        acc_ = accumulator_set();
-        downsideAcc_ = downside_accumulator_set();
+        samples_ = downsideSamples_ = 0;
+        weightSum_ = weightedSum_ = runningMean_ = runningVariance_ = 0.0;
+        moment2_ = moment3_ = moment4_ = 0.0;
+        min_ = QL_MAX_REAL;
+        max_ = QL_MIN_REAL;
+        downsideWeightSum_ = downsideMoment2_ = 0.0;
     }
 
 }
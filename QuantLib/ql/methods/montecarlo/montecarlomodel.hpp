@@ -28,7 +28,12 @@
 
 #include <ql/methods/montecarlo/mctraits.hpp>
 #include <ql/math/statistics/statistics.hpp>
+#include <ql/math/statistics/incrementalstatistics.hpp>
+#include <ql/math/statistics/sequencestatistics.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <algorithm>
+#include <vector>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -36,6 +41,34 @@
 
 namespace QuantLib {
 
+    //! flags statistics classes providing a merge() method
+    /*! Statistics classes for which this trait is true can collect
+        samples in separate instances which are merged afterwards.
+        User-defined classes providing a
+        <tt>merge(const S&)</tt> method can opt in by specializing it.
+    */
+    template <class S>
+    struct mergeable_statistics : boost::false_type {};
+
+    template <>
+    struct mergeable_statistics<GeneralStatistics> : boost::true_type {};
+
+    template <>
+    struct mergeable_statistics<IncrementalStatistics> : boost::true_type {};
+
+    template <class S>
+    struct mergeable_statistics<GenericGaussianStatistics<S> >
+    : mergeable_statistics<S> {};
+
+    template <class S>
+    struct mergeable_statistics<GenericRiskStatistics<S> >
+    : mergeable_statistics<S> {};
+
+    template <class S>
+    struct mergeable_statistics<GenericSequenceStatistics<S> >
+    : mergeable_statistics<S> {};
+
+
     //! General-purpose Monte Carlo model for path samples
     /*! The template arguments of this class correspond to available
         policies for the particular model to be instantiated---i.e.,
@@ -53,7 +86,13 @@ namespace QuantLib {
         When using multithreading (by enabling OpenMP *and* using a
         multithreaded RNG) it must be ensured that both the path pricer
         and the process (used for path generation) are implemented in a
-        thread safe way (w.r.t. omp parallelization).
+        thread safe way (w.r.t. omp parallelization). The number of
+        threads is capped at the number of streams provided by the
+        path generator's RNG.
+        If the statistics class is flagged as mergeable (see
+        mergeable_statistics below) each thread accumulates its samples
+        separately and the results are merged at the end; otherwise the
+        samples are added to the accumulator in a critical section.
 
         \ingroup mcarlo
     */
@@ -87,6 +126,13 @@ namespace QuantLib {
         void addSamples(Size samples);
         const stats_type& sampleAccumulator(void) const;
       private:
+        Real nextSample(unsigned int threadId, result_type& price);
+        void addSamples(Size samples, boost::false_type);
+        void addSamples(Size samples, boost::true_type);
+        void addSamples(Size samples, int numberOfThreads,
+                        boost::false_type);
+        void addSamples(Size samples, int numberOfThreads,
+                        boost::true_type);
         const boost::shared_ptr<path_generator_type> pathGenerator_;
         const boost::shared_ptr<path_pricer_type> pathPricer_;
         stats_type sampleAccumulator_;
@@ -99,50 +145,127 @@ namespace QuantLib {
 
     // inline definitions
     template <template <class> class MC, class RNG, class S>
-    inline void MonteCarloModel<MC,RNG,S>::addSamples(Size samples) {
-
-        unsigned int threadId = 0;
+    inline Real MonteCarloModel<MC,RNG,S>::nextSample(unsigned int threadId,
+                                                      result_type& price) {
 
-#pragma omp parallel for firstprivate(threadId) schedule(static) if(RNG::maxNumberOfThreads > 1)
-        for(Size j = 1; j <= samples; j++) {
-
-#ifdef _OPENMP
-            if (RNG::maxNumberOfThreads > 1)
-                threadId = omp_get_thread_num();
-#endif
+        sample_type path = pathGenerator_->next(threadId);
 
-            sample_type path = pathGenerator_->next(threadId);
+        price = (*pathPricer_)(path.value);
 
-            result_type price = (*pathPricer_)(path.value);
+        if (isControlVariate_) {
+            if (!cvPathGenerator_) {
+                price += cvOptionValue_-(*cvPathPricer_)(path.value);
+            }
+            else {
+                sample_type cvPath = cvPathGenerator_->next(threadId);
+                price += cvOptionValue_-(*cvPathPricer_)(cvPath.value);
+            }
+        }
 
+        if (isAntitheticVariate_) {
+            path = pathGenerator_->antithetic(threadId);
+            result_type price2 = (*pathPricer_)(path.value);
             if (isControlVariate_) {
-                if (!cvPathGenerator_) {
-                    price += cvOptionValue_-(*cvPathPricer_)(path.value);
-                }
+                if (!cvPathGenerator_)
+                    price2 += cvOptionValue_-(*cvPathPricer_)(path.value);
                 else {
-                    sample_type cvPath = cvPathGenerator_->next(threadId);
-                    price += cvOptionValue_-(*cvPathPricer_)(cvPath.value);
+                    sample_type cvPath = cvPathGenerator_->antithetic(threadId);
+                    price2 += cvOptionValue_-(*cvPathPricer_)(cvPath.value);
                 }
             }
+            price = (price+price2)/2.0;
+        }
 
-            if (isAntitheticVariate_) {
-                path = pathGenerator_->antithetic(threadId);
-                result_type price2 = (*pathPricer_)(path.value);
-                if (isControlVariate_) {
-                    if (!cvPathGenerator_)
-                        price2 += cvOptionValue_-(*cvPathPricer_)(path.value);
-                    else {
-                        sample_type cvPath = cvPathGenerator_->antithetic(threadId);
-                        price2 += cvOptionValue_-(*cvPathPricer_)(cvPath.value);
-                    }
-                }
-#pragma omp critical
-                sampleAccumulator_.add((price+price2)/2.0, path.weight);
-            } else {
+        return path.weight;
+    }
+
+    template <template <class> class MC, class RNG, class S>
+    inline void MonteCarloModel<MC,RNG,S>::addSamples(Size samples) {
+        addSamples(samples,
+                   boost::integral_constant<bool,
+                                            (RNG::maxNumberOfThreads > 1)>());
+    }
+
+    template <template <class> class MC, class RNG, class S>
+    inline void MonteCarloModel<MC,RNG,S>::addSamples(Size samples,
+                                                      boost::false_type) {
+        for(Size j = 1; j <= samples; j++) {
+            result_type price;
+            Real weight = nextSample(0, price);
+            sampleAccumulator_.add(price, weight);
+        }
+    }
+
+    template <template <class> class MC, class RNG, class S>
+    inline void MonteCarloModel<MC,RNG,S>::addSamples(Size samples,
+                                                      boost::true_type) {
+
+#ifdef _OPENMP
+        // never use more threads than the path generators provide
+        // streams for
+        Size streams = pathGenerator_->numberOfThreads();
+        if (cvPathGenerator_)
+            streams = std::min(streams, cvPathGenerator_->numberOfThreads());
+        const int numberOfThreads =
+            std::min<int>(omp_get_max_threads(), static_cast<int>(streams));
+#else
+        const int numberOfThreads = 1;
+#endif
+
+        addSamples(samples, numberOfThreads,
+                   boost::integral_constant<bool,
+                       mergeable_statistics<stats_type>::value>());
+    }
+
+    template <template <class> class MC, class RNG, class S>
+    inline void MonteCarloModel<MC,RNG,S>::addSamples(Size samples,
+                                                      int numberOfThreads,
+                                                      boost::false_type) {
+
+#pragma omp parallel for num_threads(numberOfThreads)
+        for(Size j = 1; j <= samples; j++) {
+            unsigned int threadId = 0;
+#ifdef _OPENMP
+            threadId = omp_get_thread_num();
+#endif
+            result_type price;
+            Real weight = nextSample(threadId, price);
 #pragma omp critical
-                sampleAccumulator_.add(price, path.weight);
+            sampleAccumulator_.add(price, weight);
+        }
+    }
+
+    template <template <class> class MC, class RNG, class S>
+    inline void MonteCarloModel<MC,RNG,S>::addSamples(Size samples,
+                                                      int numberOfThreads,
+                                                      boost::true_type) {
+
+        // each thread collects its samples in a private accumulator, the
+        // accumulators are merged in thread order afterwards; since the
+        // samples are distributed in contiguous chunks, this gives the
+        // same order of samples as a serial run
+        std::vector<stats_type> accumulators(numberOfThreads);
+
+#pragma omp parallel num_threads(numberOfThreads)
+        {
+            unsigned int threadId = 0;
+#ifdef _OPENMP
+            threadId = omp_get_thread_num();
+#endif
+            stats_type accumulator;
+
+#pragma omp for schedule(static)
+            for(Size j = 1; j <= samples; j++) {
+                result_type price;
+                Real weight = nextSample(threadId, price);
+                accumulator.add(price, weight);
             }
-        } // for samples
+
+            accumulators[threadId] = accumulator;
+        }
+
+        for (int i = 0; i < numberOfThreads; ++i)
+            sampleAccumulator_.merge(accumulators[i]);
     }
 
     template <template <class> class MC, class RNG, class S>
@@ -5,7 +5,7 @@
  Copyright (C) 2003 Ferdinando Ametrano
  Copyright (C) 2003, 2004, 2005 StatPro Italia srl
  Copyright (C) 2005 Klaus Spanderen
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -45,6 +45,13 @@ namespace QuantLib {
 
         \ingroup mcarlo
 
+        Besides single multipaths, blocks of paths can be generated. A
+        block is stored time major, i.e. as a vector with one matrix
+        per time grid point; each matrix has one row per state variable
+        and one column per path. The block is evolved step by step using
+        the process' evolveBlock() method, the paths are identical to
+        the ones obtained by consecutive calls to next().
+
         \test the generated paths are checked against cached results
     */
     template <class GSG>
@@ -57,12 +64,30 @@ namespace QuantLib {
                            bool brownianBridge = false);
         const sample_type& next(unsigned int threadId = 0) const;
         const sample_type& antithetic(unsigned int threadId = 0) const;
+        //! number of threads that can generate paths concurrently
+        Size numberOfThreads() const { return next_.size(); }
+        //! \name block mode
+        //@{
+        //! generates the next n paths
+        const std::vector<Matrix>& nextBlock(Size n,
+                                             unsigned int threadId = 0) const;
+        //! antithetic paths of the last generated block
+        const std::vector<Matrix>& antitheticBlock(
+                                          unsigned int threadId = 0) const;
+        //! weights of the paths of the last generated block
+        const Array& blockWeights(unsigned int threadId = 0) const;
+        //@}
       private:
         const sample_type& next(bool antithetic, unsigned int threadId = 0) const;
+        const std::vector<Matrix>& evolveBlock(bool antithetic,
+                                               unsigned int threadId) const;
         bool brownianBridge_;
         boost::shared_ptr<StochasticProcess> process_;
         GSG generator_;
         mutable std::vector<sample_type> next_;
+        mutable std::vector<std::vector<Matrix> > block_, blockIncrements_;
+        mutable std::vector<Array> blockWeights_;
+        mutable std::vector<Matrix> blockTemp_;
     };
 
 
@@ -76,8 +101,12 @@ namespace QuantLib {
                    bool brownianBridge)
     : brownianBridge_(brownianBridge), process_(process),
       generator_(generator), 
-      next_(std::vector<sample_type>(GSG::maxNumberOfThreads,
-            sample_type(MultiPath(process->size(), times), 1.0))) {
+      next_(std::vector<sample_type>(detail::numberOfThreads(generator_),
+            sample_type(MultiPath(process->size(), times), 1.0))),
+      block_(next_.size()),
+      blockIncrements_(next_.size()),
+      blockWeights_(next_.size()),
+      blockTemp_(next_.size()) {
 
         QL_REQUIRE(generator_.dimension() ==
                    process->factors()*(times.size()-1),
@@ -106,9 +135,9 @@ namespace QuantLib {
     const typename MultiPathGenerator<GSG>::sample_type&
     MultiPathGenerator<GSG>::next(bool antithetic, unsigned int threadId) const {
 
-        QL_REQUIRE(threadId < GSG::maxNumberOfThreads,
+        QL_REQUIRE(threadId < next_.size(),
                    "thread id (" << threadId << ") out of bounds [0..."
-                   << GSG::maxNumberOfThreads - 1 << "]");
+                   << next_.size() - 1 << "]");
 
         if (brownianBridge_) {
 
@@ -157,6 +186,95 @@ namespace QuantLib {
         }
     }
 
+    template <class GSG>
+    const std::vector<Matrix>&
+    MultiPathGenerator<GSG>::nextBlock(Size n, unsigned int threadId) const {
+
+        QL_REQUIRE(threadId < next_.size(),
+                   "thread id (" << threadId << ") out of bounds [0..."
+                   << next_.size() - 1 << "]");
+        QL_REQUIRE(!brownianBridge_, "Brownian bridge not supported");
+        QL_REQUIRE(n > 0, "block size must be positive");
+
+        const Size steps = next_[threadId].value.pathSize() - 1;
+        const Size factors = process_->factors();
+
+        std::vector<Matrix>& dw = blockIncrements_[threadId];
+        Array& weights = blockWeights_[threadId];
+        if (dw.size() != steps || dw.front().columns() != n) {
+            dw = std::vector<Matrix>(steps, Matrix(factors, n));
+            weights = Array(n);
+        }
+
+        typedef typename GSG::sample_type sequence_type;
+        for (Size j=0; j<n; ++j) {
+            const sequence_type& sequence_ = generator_.nextSequence(threadId);
+            for (Size i=0; i<steps; ++i)
+                std::copy(sequence_.value.begin() + i*factors,
+                          sequence_.value.begin() + (i+1)*factors,
+                          dw[i].column_begin(j));
+            weights[j] = sequence_.weight;
+        }
+
+        return evolveBlock(false, threadId);
+    }
+
+    template <class GSG>
+    const std::vector<Matrix>&
+    MultiPathGenerator<GSG>::antitheticBlock(unsigned int threadId) const {
+        QL_REQUIRE(threadId < next_.size(),
+                   "thread id (" << threadId << ") out of bounds [0..."
+                   << next_.size() - 1 << "]");
+        QL_REQUIRE(!blockIncrements_[threadId].empty(), "no block generated");
+        return evolveBlock(true, threadId);
+    }
+
+    template <class GSG>
+    const Array&
+    MultiPathGenerator<GSG>::blockWeights(unsigned int threadId) const {
+        QL_REQUIRE(threadId < next_.size(),
+                   "thread id (" << threadId << ") out of bounds [0..."
+                   << next_.size() - 1 << "]");
+        return blockWeights_[threadId];
+    }
+
+    template <class GSG>
+    const std::vector<Matrix>&
+    MultiPathGenerator<GSG>::evolveBlock(bool antithetic,
+                                         unsigned int threadId) const {
+
+        const std::vector<Matrix>& dw = blockIncrements_[threadId];
+        const Size n = dw.front().columns();
+        const Size m = process_->size();
+        const TimeGrid& timeGrid = next_[threadId].value[0].timeGrid();
+
+        std::vector<Matrix>& paths = block_[threadId];
+        if (paths.size() != timeGrid.size() || paths.front().columns() != n)
+            paths = std::vector<Matrix>(timeGrid.size(), Matrix(m, n));
+
+        Array asset = process_->initialValues();
+        for (Size k=0; k<m; k++)
+            std::fill(paths[0].row_begin(k), paths[0].row_end(k), asset[k]);
+
+        Matrix& negated = blockTemp_[threadId];
+        if (antithetic && (negated.rows() != dw.front().rows() ||
+                           negated.columns() != n))
+            negated = Matrix(dw.front().rows(), n);
+
+        for (Size i=1; i<timeGrid.size(); i++) {
+            if (antithetic) {
+                std::transform(dw[i-1].begin(), dw[i-1].end(),
+                               negated.begin(), std::negate<Real>());
+                process_->evolveBlock(timeGrid[i-1], paths[i-1],
+                                      timeGrid.dt(i-1), negated, paths[i]);
+            } else {
+                process_->evolveBlock(timeGrid[i-1], paths[i-1],
+                                      timeGrid.dt(i-1), dw[i-1], paths[i]);
+            }
+        }
+        return paths;
+    }
+
 }
 
 #endif
@@ -4,7 +4,7 @@
  Copyright (C) 2002, 2003 Ferdinando Ametrano
  Copyright (C) 2000, 2001, 2002, 2003 RiskMap srl
  Copyright (C) 2003, 2004, 2005, 2006 StatPro Italia srl
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -28,6 +28,7 @@
 #define quantlib_montecarlo_path_generator_hpp
 
 #include <ql/methods/montecarlo/brownianbridge.hpp>
+#include <ql/methods/montecarlo/sample.hpp>
 #include <ql/stochasticprocess.hpp>
 
 namespace QuantLib {
@@ -39,6 +40,13 @@ namespace QuantLib {
 
         \ingroup mcarlo
 
+        Besides single paths, blocks of paths can be generated. A
+        block is stored time major, i.e. as a matrix with one row per
+        time grid point and one column per path, and is evolved step by
+        step using the process' evolveBlock() method. The paths in a
+        block are identical to the ones obtained by consecutive calls
+        to next().
+
         \test the generated paths are checked against cached results
     */
     template <class GSG>
@@ -61,9 +69,22 @@ namespace QuantLib {
         const sample_type& antithetic(unsigned int threadId = 0) const;
         Size size() const { return dimension_; }
         const TimeGrid& timeGrid() const { return timeGrid_; }
+        //! number of threads that can generate paths concurrently
+        Size numberOfThreads() const { return next_.size(); }
+        //@}
+        //! \name block mode
+        //@{
+        /*! generates the next n paths, the result is a matrix with
+            timeGrid().size() rows and n columns */
+        const Matrix& nextBlock(Size n, unsigned int threadId = 0) const;
+        //! antithetic paths of the last generated block
+        const Matrix& antitheticBlock(unsigned int threadId = 0) const;
+        //! weights of the paths of the last generated block
+        const Array& blockWeights(unsigned int threadId = 0) const;
         //@}
       private:
         const sample_type& next(bool antithetic, unsigned int threadId = 0) const;
+        const Matrix& evolveBlock(bool antithetic, unsigned int threadId) const;
         bool brownianBridge_;
         GSG generator_;
         Size dimension_;
@@ -72,6 +93,8 @@ namespace QuantLib {
         mutable std::vector<sample_type> next_;
         mutable std::vector<std::vector<Real> > temp_;
         BrownianBridge bb_;
+        mutable std::vector<Matrix> block_, blockIncrements_;
+        mutable std::vector<Array> blockWeights_, blockTemp_;
     };
 
 
@@ -87,9 +110,11 @@ namespace QuantLib {
     : brownianBridge_(brownianBridge), generator_(generator),
       dimension_(generator_.dimension()), timeGrid_(length, timeSteps),
       process_(boost::dynamic_pointer_cast<StochasticProcess1D>(process)),
-      next_(std::vector<sample_type>(GSG::maxNumberOfThreads,
+      next_(std::vector<sample_type>(detail::numberOfThreads(generator_),
                                      sample_type(Path(timeGrid_),1.0))),
-      temp_(GSG::maxNumberOfThreads,std::vector<Real>(dimension_)), bb_(timeGrid_) {
+      temp_(next_.size(),std::vector<Real>(dimension_)), bb_(timeGrid_),
+      block_(next_.size()), blockIncrements_(next_.size()),
+      blockWeights_(next_.size()), blockTemp_(next_.size()) {
         QL_REQUIRE(dimension_==timeSteps,
                    "sequence generator dimensionality (" << dimension_
                    << ") != timeSteps (" << timeSteps << ")");
@@ -104,9 +129,11 @@ namespace QuantLib {
     : brownianBridge_(brownianBridge), generator_(generator),
       dimension_(generator_.dimension()), timeGrid_(timeGrid),
       process_(boost::dynamic_pointer_cast<StochasticProcess1D>(process)),
-      next_(std::vector<sample_type>(GSG::maxNumberOfThreads,
+      next_(std::vector<sample_type>(detail::numberOfThreads(generator_),
                                      sample_type(Path(timeGrid_),1.0))),
-      temp_(GSG::maxNumberOfThreads,std::vector<Real>(dimension_)), bb_(timeGrid_) {
+      temp_(next_.size(),std::vector<Real>(dimension_)), bb_(timeGrid_),
+      block_(next_.size()), blockIncrements_(next_.size()),
+      blockWeights_(next_.size()), blockTemp_(next_.size()) {
         QL_REQUIRE(dimension_==timeGrid_.size()-1,
                    "sequence generator dimensionality (" << dimension_
                    << ") != timeSteps (" << timeGrid_.size()-1 << ")");
@@ -127,9 +154,9 @@ namespace QuantLib {
     template <class GSG>
     const typename PathGenerator<GSG>::sample_type&
     PathGenerator<GSG>::next(bool antithetic, unsigned int threadId) const {
-        QL_REQUIRE(threadId < GSG::maxNumberOfThreads,
+        QL_REQUIRE(threadId < next_.size(),
                    "thread id (" << threadId << ") out of bounds [0..."
-                   << GSG::maxNumberOfThreads - 1 << "]");
+                   << next_.size() - 1 << "]");
 
         typedef typename GSG::sample_type sequence_type;
         const sequence_type& sequence_ =
@@ -161,6 +188,90 @@ namespace QuantLib {
         return next_[threadId];
     }
 
+    template <class GSG>
+    const Matrix& PathGenerator<GSG>::nextBlock(Size n,
+                                                unsigned int threadId) const {
+        QL_REQUIRE(threadId < next_.size(),
+                   "thread id (" << threadId << ") out of bounds [0..."
+                   << next_.size() - 1 << "]");
+        QL_REQUIRE(n > 0, "block size must be positive");
+
+        Matrix& dw = blockIncrements_[threadId];
+        Array& weights = blockWeights_[threadId];
+        if (dw.rows() != dimension_ || dw.columns() != n) {
+            dw = Matrix(dimension_, n);
+            weights = Array(n);
+        }
+
+        typedef typename GSG::sample_type sequence_type;
+        std::vector<Real>& temp = temp_[threadId];
+        for (Size j=0; j<n; ++j) {
+            const sequence_type& sequence_ = generator_.nextSequence(threadId);
+            if (brownianBridge_) {
+                bb_.transform(sequence_.value.begin(),
+                              sequence_.value.end(),
+                              temp.begin());
+            } else {
+                std::copy(sequence_.value.begin(),
+                          sequence_.value.end(),
+                          temp.begin());
+            }
+            std::copy(temp.begin(), temp.end(), dw.column_begin(j));
+            weights[j] = sequence_.weight;
+        }
+
+        return evolveBlock(false, threadId);
+    }
+
+    template <class GSG>
+    const Matrix&
+    PathGenerator<GSG>::antitheticBlock(unsigned int threadId) const {
+        QL_REQUIRE(threadId < next_.size(),
+                   "thread id (" << threadId << ") out of bounds [0..."
+                   << next_.size() - 1 << "]");
+        QL_REQUIRE(blockIncrements_[threadId].columns() > 0,
+                   "no block generated");
+        return evolveBlock(true, threadId);
+    }
+
+    template <class GSG>
+    const Array&
+    PathGenerator<GSG>::blockWeights(unsigned int threadId) const {
+        QL_REQUIRE(threadId < next_.size(),
+                   "thread id (" << threadId << ") out of bounds [0..."
+                   << next_.size() - 1 << "]");
+        return blockWeights_[threadId];
+    }
+
+    template <class GSG>
+    const Matrix& PathGenerator<GSG>::evolveBlock(bool antithetic,
+                                                  unsigned int threadId) const {
+        const Matrix& dw = blockIncrements_[threadId];
+        const Size n = dw.columns();
+
+        Matrix& paths = block_[threadId];
+        if (paths.rows() != timeGrid_.size() || paths.columns() != n)
+            paths = Matrix(timeGrid_.size(), n);
+        Array& negated = blockTemp_[threadId];
+        if (antithetic && negated.size() != n)
+            negated = Array(n);
+
+        std::fill(paths.row_begin(0), paths.row_end(0), process_->x0());
+
+        for (Size i=1; i<timeGrid_.size(); i++) {
+            const Real* w = dw.row_begin(i-1);
+            if (antithetic) {
+                std::transform(dw.row_begin(i-1), dw.row_end(i-1),
+                               negated.begin(), std::negate<Real>());
+                w = negated.begin();
+            }
+            process_->evolveBlock(timeGrid_[i-1], paths.row_begin(i-1),
+                                  timeGrid_.dt(i-1), w, paths.row_begin(i),
+                                  n);
+        }
+        return paths;
+    }
+
 }
 
 
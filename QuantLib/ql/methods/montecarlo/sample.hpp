@@ -25,6 +25,7 @@
 #define quantlib_sample_h
 
 #include <ql/types.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 
 namespace QuantLib {
 
@@ -40,6 +41,31 @@ namespace QuantLib {
         Real weight;
     };
 
+    namespace detail {
+
+        template <class G>
+        Size numberOfThreads(const G&, boost::false_type) {
+            return 1;
+        }
+
+        template <class G>
+        Size numberOfThreads(const G& generator, boost::true_type) {
+            return generator.numberOfThreads();
+        }
+
+        /* number of threads that can draw samples from the given
+           generator concurrently; generators flagged as multithreaded
+           by their maxNumberOfThreads provide it at run time */
+        template <class G>
+        Size numberOfThreads(const G& generator) {
+            return numberOfThreads(
+                generator,
+                boost::integral_constant<bool,
+                                         (G::maxNumberOfThreads > 1)>());
+        }
+
+    }
+
 }
 
 
@@ -49,6 +49,7 @@ namespace QuantLib {
         void multiplePathValues(SequenceStatisticsInc& stats,
                                 Size numberOfPaths);
       private:
+        friend class ParallelAccountingEngine;
         Real singlePathValues(std::vector<Real>& values);
 
         boost::shared_ptr<MarketModelEvolver> evolver_;
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2006 Mark Joshi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -21,6 +22,7 @@
 #ifndef quantlib_brownian_generator_hpp
 #define quantlib_brownian_generator_hpp
 
+#include <ql/errors.hpp>
 #include <ql/types.hpp>
 #include <boost/shared_ptr.hpp>
 #include <vector>
@@ -45,6 +47,17 @@ namespace QuantLib {
 
         virtual boost::shared_ptr<BrownianGenerator> create(Size factors,
                                                             Size steps) const = 0;
+        /*! returns a factory for the generators of the given block
+            of a simulation split into contiguous blocks of
+            pathsPerBlock paths. The blocks can be simulated
+            independently, e.g. on different threads; the first
+            block is generated by this factory itself.
+        */
+        virtual boost::shared_ptr<BrownianGeneratorFactory> blockFactory(
+                                                Size /* block */,
+                                                Size /* pathsPerBlock */) const {
+            QL_FAIL("blocks of paths not supported by this factory");
+        }
     };
 
 }
@@ -0,0 +1,76 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include <ql/models/marketmodels/browniangenerators/brownianblock.hpp>
+#include <algorithm>
+
+namespace QuantLib {
+
+    BrownianBlock::BrownianBlock(Size factors,
+                                 Size steps,
+                                 Size paths)
+    : factors_(factors), steps_(steps), paths_(paths),
+      variates_(factors*steps*paths), pathWeights_(paths),
+      stepWeights_(steps*paths), brownians_(factors) {
+        QL_REQUIRE(paths_ > 0, "at least one path per block required");
+    }
+
+    void BrownianBlock::nextBlock(BrownianGenerator& generator) {
+        QL_REQUIRE(generator.numberOfFactors() == factors_,
+                   "generator has " << generator.numberOfFactors()
+                   << " factors, " << factors_ << " required");
+        QL_REQUIRE(generator.numberOfSteps() == steps_,
+                   "generator has " << generator.numberOfSteps()
+                   << " steps, " << steps_ << " required");
+        for (Size p=0; p<paths_; ++p) {
+            pathWeights_[p] = generator.nextPath();
+            for (Size s=0; s<steps_; ++s) {
+                stepWeights_[s*paths_+p] = generator.nextStep(brownians_);
+                for (Size f=0; f<factors_; ++f)
+                    variates_[(s*factors_+f)*paths_+p] = brownians_[f];
+            }
+        }
+    }
+
+    void BrownianBlock::correlate(Size step,
+                                  const Matrix& pseudoRoot,
+                                  Size firstRow,
+                                  std::vector<Real>& result,
+                                  Size firstPath) const {
+        QL_REQUIRE(pseudoRoot.columns() == factors_,
+                   "pseudo-root has " << pseudoRoot.columns()
+                   << " columns, " << factors_ << " required");
+        QL_REQUIRE(result.size() >= pseudoRoot.rows()*paths_,
+                   "result size (" << result.size() << ") too small");
+        // a small matrix-matrix product; the innermost loop runs
+        // over the contiguous variates of the paths and can be
+        // vectorized by the compiler
+        for (Size i=firstRow; i<pseudoRoot.rows(); ++i) {
+            Real* r = &result[i*paths_];
+            std::fill(r+firstPath, r+paths_, 0.0);
+            for (Size f=0; f<factors_; ++f) {
+                const Real a = pseudoRoot[i][f];
+                const Real* z = variates(step, f);
+                for (Size p=firstPath; p<paths_; ++p)
+                    r[p] = r[p] + a*z[p];
+            }
+        }
+    }
+
+}
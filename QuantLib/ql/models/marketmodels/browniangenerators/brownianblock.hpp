@@ -0,0 +1,84 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file brownianblock.hpp
+    \brief block of Brownian paths for market-model simulations
+*/
+
+#ifndef quantlib_brownian_block_hpp
+#define quantlib_brownian_block_hpp
+
+#include <ql/models/marketmodels/browniangenerator.hpp>
+#include <ql/math/matrix.hpp>
+
+namespace QuantLib {
+
+    //! Block of Brownian paths for market-model simulations
+    /*! The variates of a block of paths are drawn in advance from a
+        Brownian generator, in the same order in which an evolver
+        would draw them path by path. They are stored so that the
+        variates of a given step and factor are contiguous over the
+        paths; this allows evolvers to advance all the paths of the
+        block at once, with inner loops running over the paths.
+    */
+    class BrownianBlock {
+      public:
+        BrownianBlock(Size factors,
+                      Size steps,
+                      Size paths);
+        //! draws the next block of paths from the given generator
+        void nextBlock(BrownianGenerator& generator);
+        //! \name Inspectors
+        //@{
+        Size numberOfFactors() const { return factors_; }
+        Size numberOfSteps() const { return steps_; }
+        Size numberOfPaths() const { return paths_; }
+        //! weight returned by the generator at the start of a path
+        Real pathWeight(Size path) const { return pathWeights_[path]; }
+        //! weight returned by the generator for a step of a path
+        Real stepWeight(Size step, Size path) const {
+            return stepWeights_[step*paths_+path];
+        }
+        //! variates of the given step and factor for all paths
+        const Real* variates(Size step, Size factor) const {
+            return &variates_[(step*factors_+factor)*paths_];
+        }
+        //@}
+        /*! computes the correlated increments A z for the rows i >=
+            firstRow of the pseudo-root A; the increments of the
+            i-th row are stored in result[i*paths] to
+            result[(i+1)*paths-1]. Only the paths from firstPath on
+            are computed. The result coincides with the inner products
+            computed by the evolvers path by path.
+        */
+        void correlate(Size step,
+                       const Matrix& pseudoRoot,
+                       Size firstRow,
+                       std::vector<Real>& result,
+                       Size firstPath = 0) const;
+      private:
+        Size factors_, steps_, paths_;
+        std::vector<Real> variates_, pathWeights_, stepWeights_;
+        // work variable
+        std::vector<Real> brownians_;
+    };
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -66,5 +67,17 @@ namespace QuantLib {
                               new MTBrownianGenerator(factors, steps, seed_));
     }
 
+    boost::shared_ptr<BrownianGeneratorFactory>
+    MTBrownianGeneratorFactory::blockFactory(Size block, Size) const {
+        unsigned long seed = seed_;
+        if (block > 0) {
+            MersenneTwisterUniformRng seeds(seed_);
+            for (Size i=0; i<block; ++i)
+                seed = seeds.nextInt32();
+        }
+        return boost::shared_ptr<BrownianGeneratorFactory>(
+                                     new MTBrownianGeneratorFactory(seed));
+    }
+
 }
 
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -63,6 +64,14 @@ namespace QuantLib {
         MTBrownianGeneratorFactory(unsigned long seed = 0);
         boost::shared_ptr<BrownianGenerator> create(Size factors,
                                                     Size steps) const;
+        /*! each block uses its own seed, derived from the seed of
+            this factory and the index of the block. The paths thus
+            depend on the block size; the same block size gives the
+            same paths, regardless of how the blocks are scheduled.
+        */
+        boost::shared_ptr<BrownianGeneratorFactory> blockFactory(
+                                                Size block,
+                                                Size pathsPerBlock) const;
       private:
         unsigned long seed_;
     };
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -104,6 +105,16 @@ namespace QuantLib {
         }
         */
 
+        SobolRsg skippedSobolRsg(Size dimension,
+                                 unsigned long seed,
+                                 SobolRsg::DirectionIntegers integers,
+                                 unsigned long firstPath) {
+            SobolRsg sobol(dimension, seed, integers);
+            if (firstPath > 0)
+                sobol.skipTo(firstPath);
+            return sobol;
+        }
+
     }
 
 
@@ -112,9 +123,10 @@ namespace QuantLib {
                                         Size steps,
                                         Ordering ordering,
                                         unsigned long seed,
-                                        SobolRsg::DirectionIntegers integers)
+                                        SobolRsg::DirectionIntegers integers,
+                                        unsigned long firstPath)
     : factors_(factors), steps_(steps), ordering_(ordering),
-      generator_(SobolRsg(factors*steps, seed, integers),
+      generator_(skippedSobolRsg(factors*steps, seed, integers, firstPath),
                  InverseCumulativeNormal()),
       bridge_(steps), lastStep_(0),
       orderedIndices_(factors, std::vector<Size>(steps)),
@@ -213,14 +225,26 @@ namespace QuantLib {
     SobolBrownianGeneratorFactory::SobolBrownianGeneratorFactory(
                                     SobolBrownianGenerator::Ordering ordering,
                                     unsigned long seed,
-                                    SobolRsg::DirectionIntegers integers)
-    : ordering_(ordering), seed_(seed), integers_(integers) {}
+                                    SobolRsg::DirectionIntegers integers,
+                                    unsigned long firstPath)
+    : ordering_(ordering), seed_(seed), integers_(integers),
+      firstPath_(firstPath) {}
 
     boost::shared_ptr<BrownianGenerator>
     SobolBrownianGeneratorFactory::create(Size factors, Size steps) const {
         return boost::shared_ptr<BrownianGenerator>(
                          new SobolBrownianGenerator(factors, steps, ordering_,
-                                                    seed_, integers_));
+                                                    seed_, integers_,
+                                                    firstPath_));
+    }
+
+    boost::shared_ptr<BrownianGeneratorFactory>
+    SobolBrownianGeneratorFactory::blockFactory(Size block,
+                                                Size pathsPerBlock) const {
+        return boost::shared_ptr<BrownianGeneratorFactory>(
+                    new SobolBrownianGeneratorFactory(
+                                      ordering_, seed_, integers_,
+                                      firstPath_ + block*pathsPerBlock));
     }
 
 }
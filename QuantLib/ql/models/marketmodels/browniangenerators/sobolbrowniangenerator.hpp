@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -46,13 +47,16 @@ namespace QuantLib {
                            most important factors and the largest
                            steps. */
         };
+        /*! the generator starts at the path with index firstPath
+            of the underlying low-discrepancy sequence */
         SobolBrownianGenerator(
                            Size factors,
                            Size steps,
                            Ordering ordering,
                            unsigned long seed = 0,
                            SobolRsg::DirectionIntegers directionIntegers
-                                                        = SobolRsg::Jaeckel);
+                                                        = SobolRsg::Jaeckel,
+                           unsigned long firstPath = 0);
 
         Real nextPath();
         Real nextStep(std::vector<Real>&);
@@ -82,13 +86,22 @@ namespace QuantLib {
                            SobolBrownianGenerator::Ordering ordering,
                            unsigned long seed = 0,
                            SobolRsg::DirectionIntegers directionIntegers
-                                                         = SobolRsg::Jaeckel);
+                                                         = SobolRsg::Jaeckel,
+                           unsigned long firstPath = 0);
         boost::shared_ptr<BrownianGenerator> create(Size factors,
                                                     Size steps) const;
+        /*! each block skips to its first path in the low-discrepancy
+            sequence, so that the blocks together reproduce the paths
+            of a single generator.
+        */
+        boost::shared_ptr<BrownianGeneratorFactory> blockFactory(
+                                                Size block,
+                                                Size pathsPerBlock) const;
       private:
         SobolBrownianGenerator::Ordering ordering_;
         unsigned long seed_;
         SobolRsg::DirectionIntegers integers_;
+        unsigned long firstPath_;
     };
 
 }
@@ -6,6 +6,7 @@
  Copyright (C) 2006 Silvia Frasson
  Copyright (C) 2006 Mario Pucci
  Copyright (C) 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -181,4 +182,109 @@ namespace QuantLib {
         }
     }
 
+    void LMMDriftCalculator::compute(const std::vector<Rate>& fwds,
+                                     std::vector<Real>& drifts,
+                                     Size paths,
+                                     Size firstPath) const {
+        #if defined(QL_EXTRA_SAFETY_CHECKS)
+            QL_REQUIRE(fwds.size()==numberOfRates_*paths,
+                       "numberOfRates*paths <> block size");
+            QL_REQUIRE(drifts.size()==numberOfRates_*paths,
+                       "drifts.size() <> block size");
+        #endif
+
+        if (isFullFactor_)
+            computePlain(fwds, drifts, paths, firstPath);
+        else
+            computeReduced(fwds, drifts, paths, firstPath);
+    }
+
+    void LMMDriftCalculator::computePlain(const std::vector<Rate>& forwards,
+                                          std::vector<Real>& drifts,
+                                          Size paths,
+                                          Size firstPath) const {
+
+        // same as above, the operations on each path are done
+        // in the same order
+        Size i, j, p;
+        blockTmp_.resize(numberOfRates_*paths);
+        for (i=alive_; i<numberOfRates_; ++i) {
+            const Real* f = &forwards[i*paths];
+            Real* t = &blockTmp_[i*paths];
+            for (p=firstPath; p<paths; ++p)
+                t[p] = (f[p]+displacements_[i]) / (oneOverTaus_[i]+f[p]);
+        }
+
+        for (i=alive_; i<numberOfRates_; ++i) {
+            Real* d = &drifts[i*paths];
+            std::fill(d+firstPath, d+paths, 0.0);
+            for (j=downs_[i]; j<ups_[i]; ++j) {
+                const Real c = C_[i][j];
+                const Real* t = &blockTmp_[j*paths];
+                for (p=firstPath; p<paths; ++p)
+                    d[p] = d[p] + t[p]*c;
+            }
+            if (numeraire_>i+1) {
+                for (p=firstPath; p<paths; ++p)
+                    d[p] = -d[p];
+            }
+        }
+    }
+
+    void LMMDriftCalculator::computeReduced(const std::vector<Rate>& forwards,
+                                            std::vector<Real>& drifts,
+                                            Size paths,
+                                            Size firstPath) const {
+
+        // same as above, with the e_[r][i] of each path kept in a
+        // single row per factor
+        Size p, r;
+        blockTmp_.resize(numberOfRates_*paths);
+        blockE_.resize(numberOfFactors_*paths);
+        for (Size i=alive_; i<numberOfRates_; ++i) {
+            const Real* f = &forwards[i*paths];
+            Real* t = &blockTmp_[i*paths];
+            for (p=firstPath; p<paths; ++p)
+                t[p] = (f[p]+displacements_[i]) / (oneOverTaus_[i]+f[p]);
+        }
+
+        // 1st step
+        if (numeraire_>0)
+            std::fill(drifts.begin()+(numeraire_-1)*paths+firstPath,
+                      drifts.begin()+numeraire_*paths, 0.0);
+
+        // 2nd step
+        std::fill(blockE_.begin(), blockE_.end(), 0.0);
+        for (Integer i=static_cast<Integer>(numeraire_)-2;
+             i>=static_cast<Integer>(alive_); --i) {
+            Real* d = &drifts[i*paths];
+            const Real* t = &blockTmp_[(i+1)*paths];
+            std::fill(d+firstPath, d+paths, 0.0);
+            for (r=0; r<numberOfFactors_; ++r) {
+                const Real a1 = pseudo_[i+1][r], a0 = pseudo_[i][r];
+                Real* e = &blockE_[r*paths];
+                for (p=firstPath; p<paths; ++p) {
+                    e[p] = e[p] + t[p]*a1;
+                    d[p] -= e[p]*a0;
+                }
+            }
+        }
+
+        // 3rd step
+        std::fill(blockE_.begin(), blockE_.end(), 0.0);
+        for (Size i=numeraire_; i<numberOfRates_; ++i) {
+            Real* d = &drifts[i*paths];
+            const Real* t = &blockTmp_[i*paths];
+            std::fill(d+firstPath, d+paths, 0.0);
+            for (r=0; r<numberOfFactors_; ++r) {
+                const Real a = pseudo_[i][r];
+                Real* e = &blockE_[r*paths];
+                for (p=firstPath; p<paths; ++p) {
+                    e[p] = e[p] + t[p]*a;
+                    d[p] += e[p]*a;
+                }
+            }
+        }
+    }
+
 }
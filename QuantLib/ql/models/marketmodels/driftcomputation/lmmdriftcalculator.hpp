@@ -64,6 +64,25 @@ namespace QuantLib {
         void computeReduced(const std::vector<Rate>& fwds,
                             std::vector<Real>& drifts) const;
 
+        /*! Computes the drifts of a block of paths. The forward
+            rate and the drift of the i-th rate on the p-th path are
+            stored at index i*paths+p; only the paths p >= firstPath
+            are computed. The results coincide with the ones
+            computed path by path, but the innermost loops run over
+            the paths and can be vectorized by the compiler. */
+        void compute(const std::vector<Rate>& fwds,
+                     std::vector<Real>& drifts,
+                     Size paths,
+                     Size firstPath = 0) const;
+        void computePlain(const std::vector<Rate>& fwds,
+                          std::vector<Real>& drifts,
+                          Size paths,
+                          Size firstPath = 0) const;
+        void computeReduced(const std::vector<Rate>& fwds,
+                            std::vector<Real>& drifts,
+                            Size paths,
+                            Size firstPath = 0) const;
+
       private:
         Size numberOfRates_, numberOfFactors_;
         bool isFullFactor_;
@@ -74,6 +93,7 @@ namespace QuantLib {
         // temporary variables to be added later
         mutable std::vector<Real> tmp_;
         mutable Matrix e_;
+        mutable std::vector<Real> blockTmp_, blockE_;
         std::vector<Size> downs_, ups_;
     };
 
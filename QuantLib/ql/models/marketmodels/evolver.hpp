@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2006 Mark Joshi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -22,11 +23,14 @@
 #define quantlib_market_model_evolver_hpp
 
 #include <ql/types.hpp>
+#include <boost/shared_ptr.hpp>
 #include <vector>
 
 namespace QuantLib {
 
     class CurveState;
+    class MarketModel;
+    class BrownianGeneratorFactory;
 
     //! Market-model evolver
     /*! Abstract base class. The evolver does the actual gritty work of
@@ -44,6 +48,79 @@ namespace QuantLib {
         virtual void setInitialState(const CurveState&) = 0;
     };
 
+    //! Market-model evolver factory
+    /*! Abstract base class for the creation of evolvers driven by
+        the generators of a given Brownian generator factory; this
+        allows to run several evolvers of the same model on
+        different streams of random numbers.
+    */
+    class MarketModelEvolverFactory {
+      public:
+        virtual ~MarketModelEvolverFactory() {}
+
+        virtual boost::shared_ptr<MarketModelEvolver> create(
+                               const BrownianGeneratorFactory&) const = 0;
+    };
+
+    //! Factory for evolvers with the usual constructor signature
+    /*! The Evolver class must provide a constructor taking the
+        market model, the Brownian generator factory, the numeraires
+        and the initial step, as e.g. LogNormalFwdRatePc does.
+    */
+    template <class Evolver>
+    class EvolverFactory : public MarketModelEvolverFactory {
+      public:
+        EvolverFactory(const boost::shared_ptr<MarketModel>& marketModel,
+                       const std::vector<Size>& numeraires,
+                       Size initialStep = 0)
+        : marketModel_(marketModel), numeraires_(numeraires),
+          initialStep_(initialStep) {}
+
+        boost::shared_ptr<MarketModelEvolver> create(
+                       const BrownianGeneratorFactory& generatorFactory) const {
+            return boost::shared_ptr<MarketModelEvolver>(
+                        new Evolver(marketModel_, generatorFactory,
+                                    numeraires_, initialStep_));
+        }
+      private:
+        boost::shared_ptr<MarketModel> marketModel_;
+        std::vector<Size> numeraires_;
+        Size initialStep_;
+    };
+
+    //! Factory for evolvers evolving blocks of paths
+    /*! The Evolver class must also take the number of paths per
+        block of its evolution, as e.g. LogNormalFwdRatePc and
+        LogNormalFwdRateIpc do. When used with a
+        ParallelAccountingEngine, the number of paths per block of
+        the engine should be a multiple of the one of the evolvers,
+        since each engine block is started on a generator of its
+        own and the paths drawn in excess are not used.
+    */
+    template <class Evolver>
+    class BlockEvolverFactory : public MarketModelEvolverFactory {
+      public:
+        BlockEvolverFactory(
+                       const boost::shared_ptr<MarketModel>& marketModel,
+                       const std::vector<Size>& numeraires,
+                       Size initialStep = 0,
+                       Size pathsPerBlock = 1)
+        : marketModel_(marketModel), numeraires_(numeraires),
+          initialStep_(initialStep), pathsPerBlock_(pathsPerBlock) {}
+
+        boost::shared_ptr<MarketModelEvolver> create(
+                       const BrownianGeneratorFactory& generatorFactory) const {
+            return boost::shared_ptr<MarketModelEvolver>(
+                        new Evolver(marketModel_, generatorFactory,
+                                    numeraires_, initialStep_,
+                                    pathsPerBlock_));
+        }
+      private:
+        boost::shared_ptr<MarketModel> marketModel_;
+        std::vector<Size> numeraires_;
+        Size initialStep_, pathsPerBlock_;
+    };
+
 }
 
 #endif
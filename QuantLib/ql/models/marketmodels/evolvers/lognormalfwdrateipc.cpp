@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2006 Ferdinando Ametrano
  Copyright (C) 2006 Mark Joshi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -22,6 +23,7 @@
 #include <ql/models/marketmodels/marketmodel.hpp>
 #include <ql/models/marketmodels/evolutiondescription.hpp>
 #include <ql/models/marketmodels/browniangenerator.hpp>
+#include <ql/models/marketmodels/browniangenerators/brownianblock.hpp>
 #include <ql/models/marketmodels/driftcomputation/lmmdriftcalculator.hpp>
 
 namespace QuantLib {
@@ -30,7 +32,8 @@ namespace QuantLib {
                            const boost::shared_ptr<MarketModel>& marketModel,
                            const BrownianGeneratorFactory& factory,
                            const std::vector<Size>& numeraires,
-                           Size initialStep)
+                           Size initialStep,
+                           Size pathsPerBlock)
     : marketModel_(marketModel),
       numeraires_(numeraires),
       initialStep_(initialStep),
@@ -44,9 +47,12 @@ namespace QuantLib {
       g_(numberOfRates_), brownians_(numberOfFactors_),
       correlatedBrownians_(numberOfRates_),
       rateTaus_(marketModel->evolution().rateTaus()),
-      alive_(marketModel->evolution().firstAliveRate())
+      alive_(marketModel->evolution().firstAliveRate()),
+      pathsPerBlock_(pathsPerBlock),
+      blockPath_(pathsPerBlock), blockEvolved_(false)
     {
         checkCompatibility(marketModel->evolution(), numeraires);
+        QL_REQUIRE(pathsPerBlock > 0, "at least one path per block required");
         QL_REQUIRE(isInTerminalMeasure(marketModel->evolution(), numeraires),
                    "terminal measure required for ipc ");
 
@@ -74,6 +80,26 @@ namespace QuantLib {
             fixedDrifts_.push_back(fixed);
         }
 
+        if (pathsPerBlock_ > 1) {
+            block_ = boost::shared_ptr<BrownianBlock>(
+                new BrownianBlock(numberOfFactors_, steps-initialStep_,
+                                  pathsPerBlock_));
+            // only the alive rates of each step are stored
+            blockOffsets_.resize(steps-initialStep_+1, 0);
+            for (Size j=initialStep_; j<steps; ++j)
+                blockOffsets_[j-initialStep_+1] =
+                    blockOffsets_[j-initialStep_] +
+                    (numberOfRates_-alive_[j])*pathsPerBlock_;
+            blockForwards_.resize(blockOffsets_.back());
+            Size size = numberOfRates_*pathsPerBlock_;
+            blockLogForwards_.resize(size);
+            blockForwardsWork_.resize(size);
+            blockDrifts1_.resize(size);
+            blockG_.resize(size);
+            blockCorrelatedBrownians_.resize(size);
+            blockDrifts2_.resize(pathsPerBlock_);
+        }
+
         setForwards(marketModel_->initialRates());
     }
 
@@ -85,10 +111,17 @@ namespace QuantLib {
     {
         QL_REQUIRE(forwards.size()==numberOfRates_,
                    "mismatch between forwards and rateTimes");
+        // nothing to do, and the evolved paths are still valid
+        if (forwards == initialForwards_)
+            return;
+        initialForwards_ = forwards;
         for (Size i=0; i<numberOfRates_; ++i)
             initialLogForwards_[i] = std::log(forwards[i] +
                                               displacements_[i]);
         calculators_[initialStep_].compute(forwards, initialDrifts_);
+        // the paths of the current block not yet started must be
+        // evolved again
+        blockEvolved_ = false;
     }
 
     void LogNormalFwdRateIpc::setInitialState(const CurveState& cs) {
@@ -97,6 +130,18 @@ namespace QuantLib {
 
     Real LogNormalFwdRateIpc::startNewPath() {
         currentStep_ = initialStep_;
+        if (pathsPerBlock_ > 1) {
+            if (blockPath_+1 < pathsPerBlock_) {
+                ++blockPath_;
+            } else {
+                block_->nextBlock(*generator_);
+                blockPath_ = 0;
+                blockEvolved_ = false;
+            }
+            if (!blockEvolved_)
+                evolveBlock(blockPath_);
+            return block_->pathWeight(blockPath_);
+        }
         std::copy(initialLogForwards_.begin(), initialLogForwards_.end(),
                   logForwards_.begin());
         return generator_->nextPath();
@@ -104,6 +149,19 @@ namespace QuantLib {
 
     Real LogNormalFwdRateIpc::advanceStep()
     {
+        if (pathsPerBlock_ > 1) {
+            // the path was evolved together with its block; the rates
+            // which are not alive keep their values, as they do below
+            Size step = currentStep_-initialStep_;
+            Size n = pathsPerBlock_, alive = alive_[currentStep_];
+            const Rate* f = &blockForwards_[blockOffsets_[step]] + blockPath_;
+            for (Size i=alive; i<numberOfRates_; ++i)
+                forwards_[i] = f[(i-alive)*n];
+            curveState_.setOnForwardRates(forwards_);
+            ++currentStep_;
+            return block_->stepWeight(step, blockPath_);
+        }
+
         // we're going from T1 to T2:
 
         // a) compute drifts D1 at T1;
@@ -143,6 +201,74 @@ namespace QuantLib {
         return weight;
     }
 
+    void LogNormalFwdRateIpc::evolveBlock(Size firstPath) {
+        // same steps as in advanceStep(), applied to the paths of the
+        // block from the given one on; the forwards are stored rate by
+        // rate, each rate holding the values of all paths
+        const Size n = pathsPerBlock_;
+        Size p;
+        for (Size i=0; i<numberOfRates_; ++i) {
+            std::fill(blockLogForwards_.begin()+i*n+firstPath,
+                      blockLogForwards_.begin()+(i+1)*n,
+                      initialLogForwards_[i]);
+            std::fill(blockForwardsWork_.begin()+i*n+firstPath,
+                      blockForwardsWork_.begin()+(i+1)*n,
+                      initialForwards_[i]);
+        }
+
+        Size steps = marketModel_->evolution().numberOfSteps();
+        for (Size step=initialStep_; step<steps; ++step) {
+            const Matrix& A = marketModel_->pseudoRoot(step);
+            const Matrix& C = marketModel_->covariance(step);
+            const std::vector<Real>& fixedDrift = fixedDrifts_[step];
+            Size alive = alive_[step];
+
+            // a) compute drifts D1 at T1;
+            if (step > initialStep_) {
+                calculators_[step].computePlain(blockForwardsWork_,
+                                                blockDrifts1_, n, firstPath);
+            } else {
+                for (Size i=alive; i<numberOfRates_; ++i)
+                    std::fill(blockDrifts1_.begin()+i*n+firstPath,
+                              blockDrifts1_.begin()+(i+1)*n,
+                              initialDrifts_[i]);
+            }
+
+            // b) evolve the rates backwards, each one for all paths,
+            //    and store them
+            block_->correlate(step-initialStep_, A, alive,
+                              blockCorrelatedBrownians_, firstPath);
+            Rate* stored = &blockForwards_[blockOffsets_[step-initialStep_]];
+            for (Size i=numberOfRates_; i-- > alive; ) {
+                Real* drifts2 = &blockDrifts2_[0];
+                std::fill(drifts2+firstPath, drifts2+n, 0.0);
+                for (Size j=i+1; j<numberOfRates_; ++j) {
+                    const Real c = C[i][j];
+                    const Real* g = &blockG_[j*n];
+                    for (p=firstPath; p<n; ++p)
+                        drifts2[p] -= g[p]*c;
+                }
+                Real* logForwards = &blockLogForwards_[i*n];
+                Real* forwards = &blockForwardsWork_[i*n];
+                Real* g = &blockG_[i*n];
+                const Real* drifts1 = &blockDrifts1_[i*n];
+                const Real* correlatedBrownians =
+                    &blockCorrelatedBrownians_[i*n];
+                Rate* s = stored + (i-alive)*n;
+                for (p=firstPath; p<n; ++p) {
+                    logForwards[p] +=
+                        0.5*(drifts1[p]+drifts2[p]) + fixedDrift[i];
+                    logForwards[p] += correlatedBrownians[p];
+                    s[p] = forwards[p] =
+                        std::exp(logForwards[p]) - displacements_[i];
+                    g[p] = rateTaus_[i]*(forwards[p]+displacements_[i])/
+                        (1.0+rateTaus_[i]*forwards[p]);
+                }
+            }
+        }
+        blockEvolved_ = true;
+    }
+
     Size LogNormalFwdRateIpc::currentStep() const {
         return currentStep_;
     }
@@ -0,0 +1,110 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include <ql/models/marketmodels/parallelaccountingengine.hpp>
+#include <ql/models/marketmodels/accountingengine.hpp>
+#include <ql/models/marketmodels/browniangenerator.hpp>
+#include <ql/models/marketmodels/evolver.hpp>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace QuantLib {
+
+    ParallelAccountingEngine::ParallelAccountingEngine(
+            const boost::shared_ptr<MarketModelEvolverFactory>& evolverFactory,
+            const boost::shared_ptr<BrownianGeneratorFactory>& generatorFactory,
+            const Clone<MarketModelMultiProduct>& product,
+            Real initialNumeraireValue,
+            Size pathsPerBlock,
+            Size nThreads)
+    : evolverFactory_(evolverFactory), generatorFactory_(generatorFactory),
+      product_(product), initialNumeraireValue_(initialNumeraireValue),
+      pathsPerBlock_(pathsPerBlock), nThreads_(nThreads), nextBlock_(0) {
+        QL_REQUIRE(evolverFactory_, "no evolver factory given");
+        QL_REQUIRE(generatorFactory_, "no Brownian generator factory given");
+        QL_REQUIRE(pathsPerBlock_ > 0, "paths per block must be positive");
+        QL_REQUIRE(nThreads_ == Null<Size>() || nThreads_ > 0,
+                   "number of threads (" << nThreads_
+                   << ") must be positive");
+    }
+
+    void ParallelAccountingEngine::multiplePathValues(
+                                                  SequenceStatisticsInc& stats,
+                                                  Size numberOfPaths) {
+        const Size numberProducts = product_->numberOfProducts();
+        const Size blocks =
+            (numberOfPaths + pathsPerBlock_ - 1) / pathsPerBlock_;
+
+        Size threads = 1;
+        #ifdef _OPENMP
+        threads = nThreads_ == Null<Size>() ?
+            static_cast<Size>(omp_get_max_threads()) : nThreads_;
+        #endif
+        threads = std::max<Size>(1, std::min(threads, blocks));
+
+        // path values, followed by the path weight, in path order
+        std::vector<Real> results(numberOfPaths*(numberProducts+1));
+        std::vector<std::string> errors(blocks);
+
+        #pragma omp parallel for schedule(dynamic) num_threads(static_cast<int>(threads)) if(threads > 1)
+        for (Size b=0; b<blocks; ++b) {
+            try {
+                boost::shared_ptr<BrownianGeneratorFactory> generatorFactory =
+                    generatorFactory_->blockFactory(nextBlock_ + b,
+                                                    pathsPerBlock_);
+                AccountingEngine engine(
+                                 evolverFactory_->create(*generatorFactory),
+                                 product_, initialNumeraireValue_);
+                std::vector<Real> values(numberProducts);
+                const Size firstPath = b*pathsPerBlock_;
+                const Size lastPath =
+                    std::min(firstPath + pathsPerBlock_, numberOfPaths);
+                for (Size i=firstPath; i<lastPath; ++i) {
+                    Real weight = engine.singlePathValues(values);
+                    std::vector<Real>::iterator r =
+                        results.begin() + i*(numberProducts+1);
+                    std::copy(values.begin(), values.end(), r);
+                    *(r + numberProducts) = weight;
+                }
+            } catch (std::exception& e) {
+                errors[b] = e.what();
+            } catch (...) {
+                errors[b] = "unknown error";
+            }
+        }
+
+        for (Size b=0; b<blocks; ++b)
+            QL_REQUIRE(errors[b].empty(),
+                       "error in simulation block #" << b << ": "
+                       << errors[b]);
+        nextBlock_ += blocks;
+
+        std::vector<Real> values(numberProducts);
+        for (Size i=0; i<numberOfPaths; ++i) {
+            std::vector<Real>::const_iterator r =
+                results.begin() + i*(numberProducts+1);
+            std::copy(r, r + numberProducts, values.begin());
+            stats.add(values, *(r + numberProducts));
+        }
+    }
+
+}
@@ -0,0 +1,82 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file parallelaccountingengine.hpp
+    \brief accounting engine simulating blocks of paths in parallel
+*/
+
+#ifndef quantlib_parallel_accounting_engine_hpp
+#define quantlib_parallel_accounting_engine_hpp
+
+#include <ql/models/marketmodels/multiproduct.hpp>
+#include <ql/math/statistics/sequencestatistics.hpp>
+#include <ql/utilities/clone.hpp>
+#include <ql/utilities/null.hpp>
+
+namespace QuantLib {
+
+    class MarketModelEvolverFactory;
+    class BrownianGeneratorFactory;
+
+    //! Engine collecting cash flows along a parallel market-model simulation
+    /*! The paths are split into contiguous blocks of pathsPerBlock
+        paths. Each block is simulated by an AccountingEngine of its
+        own, with an evolver created by the given evolver factory
+        from the block factory of the Brownian generator factory
+        (see BrownianGeneratorFactory::blockFactory) and a copy of
+        the product; the blocks are distributed over nThreads
+        threads, Null<Size>() meaning the number of threads
+        available to OpenMP.
+
+        The path values are added to the statistics in the order of
+        the paths once all blocks are done, so that the results do
+        not depend on the number of threads. For Sobol generators
+        they also reproduce the results of a single AccountingEngine
+        on the same generator factory, which is the case for
+        Mersenne-twister generators only for simulations fitting in a
+        single block.
+
+        \warning the market model is shared by the evolvers and must
+                 therefore allow concurrent reads.
+    */
+    class ParallelAccountingEngine {
+      public:
+        ParallelAccountingEngine(
+            const boost::shared_ptr<MarketModelEvolverFactory>& evolverFactory,
+            const boost::shared_ptr<BrownianGeneratorFactory>& generatorFactory,
+            const Clone<MarketModelMultiProduct>& product,
+            Real initialNumeraireValue,
+            Size pathsPerBlock = 4096,
+            Size nThreads = Null<Size>());
+        void multiplePathValues(SequenceStatisticsInc& stats,
+                                Size numberOfPaths);
+      private:
+        boost::shared_ptr<MarketModelEvolverFactory> evolverFactory_;
+        boost::shared_ptr<BrownianGeneratorFactory> generatorFactory_;
+        Clone<MarketModelMultiProduct> product_;
+        Real initialNumeraireValue_;
+        Size pathsPerBlock_, nThreads_;
+        // first block of the next simulation, so that subsequent
+        // calls to multiplePathValues() use fresh paths
+        Size nextBlock_;
+    };
+
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <ql/models/shortrate/onefactormodels/coxingersollross.hpp>
 #include <ql/models/shortrate/onefactormodels/extendedcoxingersollross.hpp>
 #include <ql/models/shortrate/onefactormodels/gaussian1dmodel.hpp>
+#include <ql/models/shortrate/onefactormodels/gaussian1dmodelsnapshot.hpp>
 #include <ql/models/shortrate/onefactormodels/gsr.hpp>
 #include <ql/models/shortrate/onefactormodels/hullwhite.hpp>
 #include <ql/models/shortrate/onefactormodels/markovfunctional.hpp>
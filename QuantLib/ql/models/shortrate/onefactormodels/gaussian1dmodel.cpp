@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -25,17 +25,93 @@ using std::exp;
 
 namespace QuantLib {
 
+// the scalar rates are evaluated as one point batches, so that the
+// schedule and index setup is shared with the batch versions below
+
 const Real Gaussian1dModel::forwardRate(const Date &fixing,
                                         const Date &referenceDate, const Real y,
                                         boost::shared_ptr<IborIndex> iborIdx,
                                         const bool adjusted) const {
+    return forwardRate(fixing, referenceDate, Array(1, y), iborIdx,
+                       adjusted)[0];
+}
+
+const Real Gaussian1dModel::swapRate(const Date &fixing, const Period &tenor,
+                                     const Date &referenceDate, const Real y,
+                                     boost::shared_ptr<SwapIndex> swapIdx,
+                                     const bool adjusted) const {
+    return swapRate(fixing, tenor, referenceDate, Array(1, y), swapIdx,
+                    adjusted)[0];
+}
+
+const Real Gaussian1dModel::swapAnnuity(const Date &fixing, const Period &tenor,
+                                        const Date &referenceDate, const Real y,
+                                        boost::shared_ptr<SwapIndex> swapIdx,
+                                        const bool adjusted) const {
+    return swapAnnuityImpl(fixing, tenor, referenceDate, Array(1, y), swapIdx,
+                           adjusted, false, Handle<YieldTermStructure>())[0];
+}
+
+const Real Gaussian1dModel::deflatedSwapAnnuity(
+    const Date &fixing, const Period &tenor, const Date &referenceDate,
+    const Real y, boost::shared_ptr<SwapIndex> swapIdx, const bool adjusted,
+    const Handle<YieldTermStructure> &ytsNumeraire) const {
+    return swapAnnuityImpl(fixing, tenor, referenceDate, Array(1, y), swapIdx,
+                           adjusted, true, ytsNumeraire)[0];
+}
+
+const Disposable<Array>
+Gaussian1dModel::numeraireImpl(const Time t, const Array &y,
+                               const Handle<YieldTermStructure> &yts) const {
+    Array res(y.size());
+    for (Size i = 0; i < y.size(); ++i)
+        res[i] = numeraireImpl(t, y[i], yts);
+    return res;
+}
+
+const Disposable<Array>
+Gaussian1dModel::zerobondImpl(const Time T, const Time t, const Array &y,
+                              const Handle<YieldTermStructure> &yts,
+                              const bool adjusted) const {
+    Array res(y.size());
+    for (Size i = 0; i < y.size(); ++i)
+        res[i] = zerobondImpl(T, t, y[i], yts, adjusted);
+    return res;
+}
+
+const Disposable<Array> Gaussian1dModel::deflatedZerobondImpl(
+    const Time T, const Time t, const Array &y,
+    const Handle<YieldTermStructure> &yts,
+    const Handle<YieldTermStructure> &ytsNumeraire,
+    const bool adjusted) const {
+    return zerobondImpl(T, t, y, yts, adjusted) /
+           numeraire(t, y, ytsNumeraire);
+}
+
+const Disposable<Array> Gaussian1dModel::rateZerobond(
+    const Date &maturity, const Date &referenceDate, const Array &y,
+    const Handle<YieldTermStructure> &yts, const bool adjusted) const {
+    return preferDeflatedZerobond()
+               ? deflatedZerobond(maturity, referenceDate, y, yts,
+                                  Handle<YieldTermStructure>(), adjusted)
+               : zerobond(maturity, referenceDate, y, yts, adjusted);
+}
+
+const Disposable<Array>
+Gaussian1dModel::forwardRate(const Date &fixing, const Date &referenceDate,
+                             const Array &y,
+                             boost::shared_ptr<IborIndex> iborIdx,
+                             const bool adjusted) const {
 
     QL_REQUIRE(iborIdx != NULL, "no ibor index given");
 
     calculate();
 
-    if (fixing <= (evaluationDate_ + (enforcesTodaysHistoricFixings_ ? 0 : -1)))
-        return iborIdx->fixing(fixing);
+    if (fixing <=
+        (evaluationDate_ + (enforcesTodaysHistoricFixings_ ? 0 : -1))) {
+        Array res(y.size(), iborIdx->fixing(fixing));
+        return res;
+    }
 
     Handle<YieldTermStructure> yts =
         iborIdx->forwardingTermStructure(); // might be empty, then use
@@ -48,30 +124,28 @@ const Real Gaussian1dModel::forwardRate(const Date &fixing,
     // FIXME Here we should use the calculation date calendar ?
     Real dcf = iborIdx->dayCounter().yearFraction(valueDate, endDate);
 
-    return preferDeflatedZerobond()
-               ? (deflatedZerobond(valueDate, referenceDate, y, yts,
-                                   Handle<YieldTermStructure>(), adjusted) -
-                  deflatedZerobond(endDate, referenceDate, y, yts,
-                                   Handle<YieldTermStructure>(), adjusted)) /
-                     (dcf * deflatedZerobond(endDate, referenceDate, y, yts,
-                                             Handle<YieldTermStructure>(),
-                                             adjusted))
-               : (zerobond(valueDate, referenceDate, y, yts, adjusted) -
-                  zerobond(endDate, referenceDate, y, yts, adjusted)) /
-                     (dcf * zerobond(endDate, referenceDate, y, yts, adjusted));
+    Array res = rateZerobond(valueDate, referenceDate, y, yts, adjusted);
+    Array end = rateZerobond(endDate, referenceDate, y, yts, adjusted);
+    for (Size i = 0; i < y.size(); ++i)
+        res[i] = (res[i] - end[i]) / (dcf * end[i]);
+    return res;
 }
 
-const Real Gaussian1dModel::swapRate(const Date &fixing, const Period &tenor,
-                                     const Date &referenceDate, const Real y,
-                                     boost::shared_ptr<SwapIndex> swapIdx,
-                                     const bool adjusted) const {
+const Disposable<Array>
+Gaussian1dModel::swapRate(const Date &fixing, const Period &tenor,
+                          const Date &referenceDate, const Array &y,
+                          boost::shared_ptr<SwapIndex> swapIdx,
+                          const bool adjusted) const {
 
     QL_REQUIRE(swapIdx != NULL, "no swap index given");
 
     calculate();
 
-    if (fixing <= (evaluationDate_ + (enforcesTodaysHistoricFixings_ ? 0 : -1)))
-        return swapIdx->fixing(fixing);
+    if (fixing <=
+        (evaluationDate_ + (enforcesTodaysHistoricFixings_ ? 0 : -1))) {
+        Array res(y.size(), swapIdx->fixing(fixing));
+        return res;
+    }
 
     Handle<YieldTermStructure> ytsf =
         swapIdx->iborIndex()->forwardingTermStructure();
@@ -95,84 +169,61 @@ const Real Gaussian1dModel::swapRate(const Date &fixing, const Period &tenor,
     }
 
     // should be fine for overnightindexed swap indices as well
-    Real annuity =
+    Array annuity =
         preferDeflatedZerobond()
             ? deflatedSwapAnnuity(fixing, tenor, referenceDate, y, swapIdx,
                                   adjusted, Handle<YieldTermStructure>())
             : swapAnnuity(fixing, tenor, referenceDate, y, swapIdx, adjusted);
 
-    Rate floatleg = 0.0;
+    Array floatleg(y.size(), 0.0);
     // simple 100-formula can be used only in one curve setup
     if (ytsf.empty() && ytsd.empty()) {
-        floatleg =
-            preferDeflatedZerobond()
-                ? deflatedZerobond(sched.dates().front(), referenceDate, y,
-                                   Handle<YieldTermStructure>(),
-                                   Handle<YieldTermStructure>(), adjusted) -
-                      deflatedZerobond(sched.calendar().adjust(
-                                           sched.dates().back(),
-                                           underlying->paymentConvention()),
-                                       referenceDate, y,
-                                       Handle<YieldTermStructure>(),
-                                       Handle<YieldTermStructure>(), adjusted)
-                : zerobond(sched.dates().front(), referenceDate, y,
-                           Handle<YieldTermStructure>(), adjusted) -
-                      zerobond(sched.calendar().adjust(
-                                   sched.dates().back(),
-                                   underlying->paymentConvention()),
-                               referenceDate, y, Handle<YieldTermStructure>(),
-                               adjusted);
+        floatleg = rateZerobond(sched.dates().front(), referenceDate, y,
+                                Handle<YieldTermStructure>(), adjusted) -
+                   rateZerobond(sched.calendar().adjust(
+                                    sched.dates().back(),
+                                    underlying->paymentConvention()),
+                                referenceDate, y,
+                                Handle<YieldTermStructure>(), adjusted);
     } else {
         // we do *not* use indexed coupons here, but the accrual schedule
+        Array start = rateZerobond(floatSched[0], referenceDate, y, ytsf,
+                                   adjusted);
         for (Size i = 1; i < floatSched.size(); i++) {
-            floatleg +=
-                preferDeflatedZerobond()
-                    ? (deflatedZerobond(floatSched[i - 1], referenceDate, y,
-                                        ytsf, Handle<YieldTermStructure>(),
-                                        adjusted) /
-                           deflatedZerobond(floatSched[i], referenceDate, y,
-                                            ytsf, Handle<YieldTermStructure>(),
-                                            adjusted) -
-                       1.0) *
-                          deflatedZerobond(floatSched.calendar().adjust(
-                                               floatSched[i],
-                                               underlying->paymentConvention()),
-                                           referenceDate, y, ytsd,
-                                           Handle<YieldTermStructure>(),
-                                           adjusted)
-                    : (zerobond(floatSched[i - 1], referenceDate, y, ytsf,
-                                adjusted) /
-                           zerobond(floatSched[i], referenceDate, y, ytsf,
-                                    adjusted) -
-                       1.0) *
-                          zerobond(floatSched.calendar().adjust(
-                                       floatSched[i],
-                                       underlying->paymentConvention()),
-                                   referenceDate, y, ytsd, adjusted);
+            Array end =
+                rateZerobond(floatSched[i], referenceDate, y, ytsf, adjusted);
+            Array pay = rateZerobond(
+                floatSched.calendar().adjust(floatSched[i],
+                                             underlying->paymentConvention()),
+                referenceDate, y, ytsd, adjusted);
+            for (Size j = 0; j < y.size(); ++j)
+                floatleg[j] += (start[j] / end[j] - 1.0) * pay[j];
+            start.swap(end);
         }
     }
-    return floatleg / annuity;
+    floatleg /= annuity;
+    return floatleg;
 }
 
-const Real Gaussian1dModel::swapAnnuity(const Date &fixing, const Period &tenor,
-                                        const Date &referenceDate, const Real y,
-                                        boost::shared_ptr<SwapIndex> swapIdx,
-                                        const bool adjusted) const {
+const Disposable<Array> Gaussian1dModel::swapAnnuity(
+    const Date &fixing, const Period &tenor, const Date &referenceDate,
+    const Array &y, boost::shared_ptr<SwapIndex> swapIdx,
+    const bool adjusted) const {
     return swapAnnuityImpl(fixing, tenor, referenceDate, y, swapIdx, adjusted,
                            false, Handle<YieldTermStructure>());
 }
 
-const Real Gaussian1dModel::deflatedSwapAnnuity(
+const Disposable<Array> Gaussian1dModel::deflatedSwapAnnuity(
     const Date &fixing, const Period &tenor, const Date &referenceDate,
-    const Real y, boost::shared_ptr<SwapIndex> swapIdx, const bool adjusted,
+    const Array &y, boost::shared_ptr<SwapIndex> swapIdx, const bool adjusted,
     const Handle<YieldTermStructure> &ytsNumeraire) const {
     return swapAnnuityImpl(fixing, tenor, referenceDate, y, swapIdx, adjusted,
-                           true,ytsNumeraire);
+                           true, ytsNumeraire);
 }
 
-const Real Gaussian1dModel::swapAnnuityImpl(
+const Disposable<Array> Gaussian1dModel::swapAnnuityImpl(
     const Date &fixing, const Period &tenor, const Date &referenceDate,
-    const Real y, boost::shared_ptr<SwapIndex> swapIdx, const bool adjusted,
+    const Array &y, boost::shared_ptr<SwapIndex> swapIdx, const bool adjusted,
     const bool deflated, const Handle<YieldTermStructure> &ytsNumeraire) const {
 
     QL_REQUIRE(swapIdx != NULL, "no swap index given");
@@ -188,19 +239,16 @@ const Real Gaussian1dModel::swapAnnuityImpl(
 
     Schedule sched = underlying->fixedSchedule();
 
-    Real annuity = 0.0;
+    Array annuity(y.size(), 0.0);
     for (unsigned int j = 1; j < sched.size(); j++) {
-        annuity +=
-            (deflated
-                 ? deflatedZerobond(
-                       sched.calendar().adjust(sched.date(j),
-                                               underlying->paymentConvention()),
-                       referenceDate, y, ytsd, ytsNumeraire, adjusted)
-                 : zerobond(sched.calendar().adjust(
-                                sched.date(j), underlying->paymentConvention()),
-                            referenceDate, y, ytsd, adjusted)) *
-            swapIdx->dayCounter().yearFraction(sched.date(j - 1),
-                                               sched.date(j));
+        Date payDate = sched.calendar().adjust(
+            sched.date(j), underlying->paymentConvention());
+        Array zb = deflated ? deflatedZerobond(payDate, referenceDate, y, ytsd,
+                                               ytsNumeraire, adjusted)
+                            : zerobond(payDate, referenceDate, y, ytsd,
+                                       adjusted);
+        annuity += zb * swapIdx->dayCounter().yearFraction(sched.date(j - 1),
+                                                            sched.date(j));
     }
     return annuity;
 }
@@ -326,6 +374,10 @@ const Disposable<Array> Gaussian1dModel::yGrid(const Real stdDevs,
     Real stdDev_0_T = stateProcess_->stdDeviation(0.0, 0.0, T);
     Real e_0_T = stateProcess_->expectation(0.0, 0.0, T);
 
+    // the state at T is deterministic (T = 0), so is y
+    if (stdDev_0_T < QL_EPSILON)
+        return result;
+
     if (t < QL_EPSILON) {
         // stdDev_0_t = 0.0;
         stdDev_t_T = stdDev_0_T;
@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -119,6 +119,73 @@ class Gaussian1dModel : public TermStructureConsistentModel, public LazyObject {
             Handle<YieldTermStructure>(),
         const bool adjusted = false) const;
 
+    /*! \name Batch evaluation
+        The following methods evaluate the model quantities on an
+        array of values of the state variable, which is considerably
+        faster than separate calls for each value, since the time
+        dependent parts are computed only once. */
+    //@{
+    const Disposable<Array>
+    numeraire(const Time t, const Array &y,
+              const Handle<YieldTermStructure> &yts =
+                  Handle<YieldTermStructure>()) const;
+
+    const Disposable<Array>
+    zerobond(const Time T, const Time t, const Array &y,
+             const Handle<YieldTermStructure> &yts =
+                 Handle<YieldTermStructure>(),
+             const bool adjusted = false) const;
+
+    const Disposable<Array> deflatedZerobond(
+        const Time T, const Time t, const Array &y,
+        const Handle<YieldTermStructure> &yts = Handle<YieldTermStructure>(),
+        const Handle<YieldTermStructure> &ytsNumeraire =
+            Handle<YieldTermStructure>(),
+        const bool adjusted = false) const;
+
+    const Disposable<Array>
+    numeraire(const Date &referenceDate, const Array &y,
+              const Handle<YieldTermStructure> &yts =
+                  Handle<YieldTermStructure>()) const;
+
+    const Disposable<Array>
+    zerobond(const Date &maturity, const Date &referenceDate, const Array &y,
+             const Handle<YieldTermStructure> &yts =
+                 Handle<YieldTermStructure>(),
+             const bool adjusted = false) const;
+
+    const Disposable<Array> deflatedZerobond(
+        const Date &maturity, const Date &referenceDate, const Array &y,
+        const Handle<YieldTermStructure> &yts = Handle<YieldTermStructure>(),
+        const Handle<YieldTermStructure> &ytsNumeraire =
+            Handle<YieldTermStructure>(),
+        const bool adjusted = false) const;
+
+    const Disposable<Array>
+    forwardRate(const Date &fixing, const Date &referenceDate, const Array &y,
+                boost::shared_ptr<IborIndex> iborIdx,
+                const bool adjusted = false) const;
+
+    const Disposable<Array>
+    swapRate(const Date &fixing, const Period &tenor,
+             const Date &referenceDate, const Array &y,
+             boost::shared_ptr<SwapIndex> swapIdx,
+             const bool adjusted = false) const;
+
+    const Disposable<Array>
+    swapAnnuity(const Date &fixing, const Period &tenor,
+                const Date &referenceDate, const Array &y,
+                boost::shared_ptr<SwapIndex> swapIdx,
+                const bool adjusted = false) const;
+
+    const Disposable<Array> deflatedSwapAnnuity(
+        const Date &fixing, const Period &tenor, const Date &referenceDate,
+        const Array &y, boost::shared_ptr<SwapIndex> swapIdx,
+        const bool adjusted = false,
+        const Handle<YieldTermStructure> &ytsNumeraire =
+            Handle<YieldTermStructure>()) const;
+    //@}
+
     const Real zerobondOption(
         const Option::Type &type, const Date &expiry, const Date &valueDate,
         const Date &maturity, const Rate strike,
@@ -185,6 +252,12 @@ class Gaussian1dModel : public TermStructureConsistentModel, public LazyObject {
                                   const Real T = 1.0, const Real t = 0,
                                   const Real y = 0) const;
 
+    /*! Registers the times an engine evaluates the model on, models
+        may precompute terms for them. The registration is lost when
+        the model parameters change, so engines should register their
+        times on each calculation. */
+    virtual void registerTimes(const std::vector<Time> &) const {}
+
     /*! Computes the standardized model state from the original one
         We use that the standard deviation is independent of $x$ here ! */
     const Real y(const Real x, const Time t) {
@@ -193,13 +266,20 @@ class Gaussian1dModel : public TermStructureConsistentModel, public LazyObject {
     }
 
   private:
-    const Real
+    const Disposable<Array>
     swapAnnuityImpl(const Date &fixing, const Period &tenor,
-                    const Date &referenceDate, const Real y,
+                    const Date &referenceDate, const Array &y,
                     boost::shared_ptr<SwapIndex> swapIdx, const bool adjusted,
                     const bool deflated,
                     const Handle<YieldTermStructure> &ytsNumeraire) const;
 
+    // zerobonds used to compute forward and swap rates, deflated if
+    // this is more efficient (the numeraire cancels out then anyway)
+    const Disposable<Array>
+    rateZerobond(const Date &maturity, const Date &referenceDate,
+                 const Array &y, const Handle<YieldTermStructure> &yts,
+                 const bool adjusted) const;
+
     // It is of great importance for performance reasons to cache underlying
     // swaps generated from indexes. In addition the indexes may only be given
     // as templates for the conventions with the tenor replaced by the actual
@@ -258,12 +338,50 @@ class Gaussian1dModel : public TermStructureConsistentModel, public LazyObject {
                          const Handle<YieldTermStructure> &ytsNumeraire,
                          const bool adjusted) const;
 
+    /* batch versions of the above, the default implementations
+       for the numeraire and zerobond loop over the given state
+       values, models should override them with more efficient
+       implementations */
+    virtual const Disposable<Array>
+    numeraireImpl(const Time t, const Array &y,
+                  const Handle<YieldTermStructure> &yts) const;
+
+    virtual const Disposable<Array>
+    zerobondImpl(const Time T, const Time t, const Array &y,
+                 const Handle<YieldTermStructure> &yts,
+                 const bool adjusted) const;
+
+    virtual const Disposable<Array>
+    deflatedZerobondImpl(const Time T, const Time t, const Array &y,
+                         const Handle<YieldTermStructure> &yts,
+                         const Handle<YieldTermStructure> &ytsNumeraire,
+                         const bool adjusted) const;
+
     /* return true in implementations if deflatedZerobond is computed
        more efficiently than zerobond */
     virtual bool preferDeflatedZerobond() const {
         return false;
     }
 
+    /* implementations may provide tables H, m, s and zeta on the
+       given times such that the zerobond prices (w.r.t. the model
+       curve, not adjusted) are given by
+       P(t,T,y) = P(0,T) / P(0,t) * exp( -(H(T)-H(t)) (m(t)+s(t)y)
+                                         -0.5 (H(T)-H(t))^2 zeta(t) )
+       and the numeraire by the same expression with T replaced by
+       numeraireTime and H(T) by numeraireH. This is used by
+       Gaussian1dModelSnapshot, return false if no such representation
+       exists. */
+    virtual bool affineRepresentation(const std::vector<Time> &,
+                                      std::vector<Real> &,
+                                      std::vector<Real> &,
+                                      std::vector<Real> &,
+                                      std::vector<Real> &, Time &,
+                                      Real &) const {
+        return false;
+    }
+    friend class Gaussian1dModelSnapshot;
+
     void performCalculations() const {
         evaluationDate_ = Settings::instance().evaluationDate();
         enforcesTodaysHistoricFixings_ =
@@ -366,6 +484,60 @@ inline const Real Gaussian1dModel::deflatedZerobond(
             : 0.0,
         y, yts, ytsNumeraire, adjusted);
 }
+
+inline const Disposable<Array>
+Gaussian1dModel::numeraire(const Time t, const Array &y,
+                           const Handle<YieldTermStructure> &yts) const {
+    return numeraireImpl(t, y, yts);
+}
+
+inline const Disposable<Array>
+Gaussian1dModel::zerobond(const Time T, const Time t, const Array &y,
+                          const Handle<YieldTermStructure> &yts,
+                          const bool adjusted) const {
+    return zerobondImpl(T, t, y, yts, adjusted);
+}
+
+inline const Disposable<Array> Gaussian1dModel::deflatedZerobond(
+    const Time T, const Time t, const Array &y,
+    const Handle<YieldTermStructure> &yts,
+    const Handle<YieldTermStructure> &ytsNumeraire,
+    const bool adjusted) const {
+    return deflatedZerobondImpl(T, t, y, yts, ytsNumeraire, adjusted);
+}
+
+inline const Disposable<Array>
+Gaussian1dModel::numeraire(const Date &referenceDate, const Array &y,
+                           const Handle<YieldTermStructure> &yts) const {
+    return numeraire(termStructure()->timeFromReference(referenceDate), y,
+                     yts);
+}
+
+inline const Disposable<Array>
+Gaussian1dModel::zerobond(const Date &maturity, const Date &referenceDate,
+                          const Array &y,
+                          const Handle<YieldTermStructure> &yts,
+                          const bool adjusted) const {
+    return zerobond(termStructure()->timeFromReference(maturity),
+                    referenceDate != Null<Date>()
+                        ? termStructure()->timeFromReference(referenceDate)
+                        : 0.0,
+                    y, yts, adjusted);
+}
+
+inline const Disposable<Array> Gaussian1dModel::deflatedZerobond(
+    const Date &maturity, const Date &referenceDate, const Array &y,
+    const Handle<YieldTermStructure> &yts,
+    const Handle<YieldTermStructure> &ytsNumeraire,
+    const bool adjusted) const {
+    return deflatedZerobond(
+        termStructure()->timeFromReference(maturity),
+        referenceDate != Null<Date>()
+            ? termStructure()->timeFromReference(referenceDate)
+            : 0.0,
+        y, yts, ytsNumeraire, adjusted);
+}
+
 } // namespace QuantLib
 
 #endif
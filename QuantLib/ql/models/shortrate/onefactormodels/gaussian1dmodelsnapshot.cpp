@@ -0,0 +1,290 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include <ql/models/shortrate/onefactormodels/gaussian1dmodelsnapshot.hpp>
+#include <ql/math/interpolations/cubicinterpolation.hpp>
+#include <ql/math/comparison.hpp>
+
+namespace QuantLib {
+
+namespace {
+
+bool closeTimes(const Time t1, const Time t2) { return close_enough(t1, t2); }
+
+void makeGrid(std::vector<Time> &grid) {
+    grid.push_back(0.0);
+    std::sort(grid.begin(), grid.end());
+    grid.erase(std::unique(grid.begin(), grid.end(), closeTimes), grid.end());
+    QL_REQUIRE(grid.front() >= 0.0,
+               "times must be non negative (" << grid.front() << ")");
+}
+
+// appends the values and the cubic coefficients of each interval
+void addSpline(std::vector<Real> &table, const Array &x, const Array &values) {
+    CubicInterpolation f(x.begin(), x.end(), values.begin(),
+                         CubicInterpolation::Spline, false,
+                         CubicInterpolation::Lagrange, 0.0,
+                         CubicInterpolation::Lagrange, 0.0);
+    for (Size k = 0; k < x.size() - 1; ++k) {
+        table.push_back(values[k]);
+        table.push_back(f.aCoefficients()[k]);
+        table.push_back(f.bCoefficients()[k]);
+        table.push_back(f.cCoefficients()[k]);
+    }
+    table.push_back(values[x.size() - 1]);
+}
+
+} // anonymous namespace
+
+Gaussian1dModelSnapshot::Gaussian1dModelSnapshot(
+    const boost::shared_ptr<Gaussian1dModel> &model,
+    const std::vector<Time> &times, const std::vector<Time> &stateTimes,
+    const std::vector<Handle<YieldTermStructure> > &curves,
+    const Real yStdDevs, const int yGridPoints)
+    : affine_(false), numeraireH_(0.0), numeraireDiscount_(1.0),
+      yMin_(-yStdDevs), yMax_(yStdDevs),
+      yStep_(yStdDevs / static_cast<Real>(yGridPoints)),
+      yPoints_(2 * yGridPoints + 1), splineSize_(8 * yGridPoints + 1) {
+
+    QL_REQUIRE(model != NULL, "no model given");
+    QL_REQUIRE(yStdDevs > 0.0,
+               "yStdDevs (" << yStdDevs << ") must be positive");
+    QL_REQUIRE(yGridPoints > 1,
+               "yGridPoints (" << yGridPoints << ") must be at least 2");
+
+    referenceDate_ = model->termStructure()->referenceDate();
+    dayCounter_ = model->termStructure()->dayCounter();
+
+    // both grids contain t = 0, the state times are included in the times
+
+    stateTimes_ = stateTimes.empty() ? times : stateTimes;
+    makeGrid(stateTimes_);
+    times_ = times;
+    times_.insert(times_.end(), stateTimes_.begin(), stateTimes_.end());
+    makeGrid(times_);
+    for (Size i = 0; i < stateTimes_.size(); ++i)
+        stateIndex_.push_back(index(stateTimes_[i]));
+
+    Size n = times_.size(), m = stateTimes_.size();
+
+    // curves
+
+    discount_.resize(curves.size() + 1);
+    numeraireAdjustment_.resize(curves.size() + 1);
+    for (Size c = 0; c <= curves.size(); ++c) {
+        Handle<YieldTermStructure> curve =
+            c == 0 || curves[c - 1].empty() ? model->termStructure()
+                                            : curves[c - 1];
+        for (Size j = 0; j < n; ++j)
+            discount_[c].push_back(curve->discount(times_[j], true));
+        for (Size i = 0; i < m; ++i)
+            numeraireAdjustment_[c].push_back(
+                c == 0 || curves[c - 1].empty()
+                    ? 1.0
+                    : model->numeraire(stateTimes_[i], 0.0, curves[c - 1]) /
+                          model->numeraire(stateTimes_[i], 0.0));
+    }
+
+    // moments of the state variable, we use that the conditional
+    // expectation is linear and the standard deviation independent
+    // of the initial state
+
+    const boost::shared_ptr<StochasticProcess1D> process =
+        model->stateProcess();
+
+    for (Size j = 0; j < n; ++j) {
+        e0_.push_back(process->expectation(0.0, 0.0, times_[j]));
+        sd0_.push_back(process->stdDeviation(0.0, 0.0, times_[j]));
+    }
+
+    condA_.resize(m * n, 0.0);
+    condB_.resize(m * n, 0.0);
+    condSd_.resize(m * n, 0.0);
+    for (Size i = 0; i < m; ++i) {
+        for (Size j = stateIndex_[i]; j < n; ++j) {
+            Size k = i * n + j;
+            if (j == stateIndex_[i]) {
+                condB_[k] = 1.0;
+            } else {
+                Time dt = times_[j] - stateTimes_[i];
+                condA_[k] = process->expectation(stateTimes_[i], 0.0, dt);
+                condB_[k] =
+                    process->expectation(stateTimes_[i], 1.0, dt) - condA_[k];
+                condSd_[k] = process->stdDeviation(stateTimes_[i], 0.0, dt);
+            }
+        }
+    }
+
+    // affine representation, if provided by the model
+
+    Time numeraireTime = 0.0;
+    affine_ = model->affineRepresentation(times_, H_, m_, s_, zeta_,
+                                          numeraireTime, numeraireH_);
+
+    if (affine_) {
+        QL_REQUIRE(H_.size() == n && m_.size() == n && s_.size() == n &&
+                       zeta_.size() == n,
+                   "affine representation has wrong size");
+        numeraireDiscount_ =
+            model->termStructure()->discount(numeraireTime, true);
+        return;
+    }
+
+    // otherwise tabulate numeraire and deflated zerobonds
+
+    Array y(yPoints_), values(yPoints_);
+    for (Size k = 0; k < yPoints_; ++k)
+        y[k] = yMin_ + static_cast<Real>(k) * yStep_;
+
+    for (Size i = 0; i < m; ++i) {
+        for (Size k = 0; k < yPoints_; ++k)
+            values[k] = model->numeraire(stateTimes_[i], y[k]);
+        addSpline(numeraireTable_, y, values);
+    }
+
+    for (Size i = 0; i < m; ++i) {
+        for (Size j = 0; j < n; ++j) {
+            for (Size k = 0; k < yPoints_; ++k)
+                values[k] =
+                    j < stateIndex_[i]
+                        ? 0.0
+                        : model->deflatedZerobond(times_[j], stateTimes_[i],
+                                                  y[k]);
+            addSpline(deflatedZerobondTable_, y, values);
+        }
+    }
+}
+
+Real Gaussian1dModelSnapshot::numeraire(const Time t, const Real y,
+                                        const Size curve) const {
+    Size i = stateIndex(t);
+    return modelNumeraire(i, y) * numeraireAdjustment_[curveIndex(curve)][i];
+}
+
+Real Gaussian1dModelSnapshot::zerobond(const Time T, const Time t,
+                                       const Real y, const Size curve) const {
+    Size i = stateIndex(t), j = index(T), c = curveIndex(curve);
+    Size ti = stateIndex_[i];
+    QL_REQUIRE(j >= ti, "maturity (" << T << ") must not be before time ("
+                                     << t << ")");
+    Real res = modelZerobond(j, i, y);
+    if (c != 0)
+        res *= discount_[c][j] / discount_[c][ti] * discount_[0][ti] /
+               discount_[0][j];
+    return res;
+}
+
+const Disposable<Array>
+Gaussian1dModelSnapshot::yGrid(const Real stdDevs, const int gridPoints,
+                               const Time T, const Time t,
+                               const Real y) const {
+
+    Size j = index(T);
+    Real e_t_T, stdDev_t_T;
+
+    if (t < QL_EPSILON) {
+        e_t_T = e0_[j];
+        stdDev_t_T = sd0_[j];
+    } else {
+        Size i = stateIndex(t), ti = stateIndex_[i], k = i * times_.size() + j;
+        QL_REQUIRE(j >= ti, "time (" << T << ") must not be before time ("
+                                     << t << ")");
+        Real x_t = y * sd0_[ti] + e0_[ti];
+        e_t_T = condA_[k] + condB_[k] * x_t;
+        stdDev_t_T = condSd_[k];
+    }
+
+    Array result(2 * gridPoints + 1, 0.0);
+
+    // the state at T is deterministic (T = 0), so is y
+    if (sd0_[j] < QL_EPSILON)
+        return result;
+
+    Real h = stdDevs / ((Real)gridPoints);
+
+    for (int l = -gridPoints; l <= gridPoints; l++) {
+        result[l + gridPoints] =
+            (e_t_T + stdDev_t_T * ((Real)l) * h - e0_[j]) / sd0_[j];
+    }
+
+    return result;
+}
+
+Size Gaussian1dModelSnapshot::index(const Time t) const {
+    Size i = std::upper_bound(times_.begin(), times_.end(), t) - times_.begin();
+    if (i > 0 && close_enough(times_[i - 1], t))
+        return i - 1;
+    if (i < times_.size() && close_enough(times_[i], t))
+        return i;
+    QL_FAIL("time " << t << " is not on the snapshot grid");
+}
+
+Size Gaussian1dModelSnapshot::stateIndex(const Time t) const {
+    Size i = std::upper_bound(stateTimes_.begin(), stateTimes_.end(), t) -
+             stateTimes_.begin();
+    if (i > 0 && close_enough(stateTimes_[i - 1], t))
+        return i - 1;
+    if (i < stateTimes_.size() && close_enough(stateTimes_[i], t))
+        return i;
+    QL_FAIL("time " << t << " is not a state time of the snapshot");
+}
+
+Size Gaussian1dModelSnapshot::curveIndex(const Size curve) const {
+    QL_REQUIRE(curve < discount_.size(),
+               "curve " << curve << " out of range [0..."
+                        << discount_.size() - 1 << "]");
+    return curve;
+}
+
+Real Gaussian1dModelSnapshot::modelNumeraire(const Size i,
+                                             const Real y) const {
+    if (affine_) {
+        Size ti = stateIndex_[i];
+        Real dH = numeraireH_ - H_[ti];
+        return numeraireDiscount_ / discount_[0][ti] *
+               std::exp(-dH * (m_[ti] + s_[ti] * y) -
+                        0.5 * dH * dH * zeta_[ti]);
+    }
+    return spline(numeraireTable_, i * splineSize_, y);
+}
+
+Real Gaussian1dModelSnapshot::modelZerobond(const Size j, const Size i,
+                                            const Real y) const {
+    if (affine_) {
+        Size ti = stateIndex_[i];
+        Real dH = H_[j] - H_[ti];
+        return discount_[0][j] / discount_[0][ti] *
+               std::exp(-dH * (m_[ti] + s_[ti] * y) -
+                        0.5 * dH * dH * zeta_[ti]);
+    }
+    return spline(deflatedZerobondTable_,
+                  (i * times_.size() + j) * splineSize_, y) *
+           modelNumeraire(i, y);
+}
+
+Real Gaussian1dModelSnapshot::spline(const std::vector<Real> &table,
+                                     const Size offset, const Real y) const {
+    Real yc = std::min(std::max(y, yMin_), yMax_);
+    Size k = std::min(static_cast<Size>((yc - yMin_) / yStep_), yPoints_ - 2);
+    Real d = yc - (yMin_ + static_cast<Real>(k) * yStep_);
+    const Real *p = &table[offset + 4 * k];
+    return p[0] + d * (p[1] + d * (p[2] + d * p[3]));
+}
+
+} // namespace QuantLib
@@ -0,0 +1,153 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file gaussian1dmodelsnapshot.hpp
+    \brief immutable evaluation snapshot of a Gaussian1dModel
+*/
+
+#ifndef quantlib_gaussian1dmodelsnapshot_hpp
+#define quantlib_gaussian1dmodelsnapshot_hpp
+
+#include <ql/models/shortrate/onefactormodels/gaussian1dmodel.hpp>
+
+namespace QuantLib {
+
+/*! Immutable snapshot of a Gaussian1dModel on a fixed time grid. All
+    model quantities are computed in the constructor, the inspectors
+    only read precomputed tables and can therefore be called
+    concurrently from several threads without any synchronization, as
+    opposed to the model itself (which is a lazy object and may cache
+    intermediate results in its state process).
+
+    Models that provide an affine representation of their zerobond
+    prices (Gsr, Lgm) are evaluated in closed form from tables of
+    \f$ H(t) \f$, \f$ \zeta(t) \f$ and the state variable's moments.
+    For all other models (e.g. MarkovFunctional) the numeraire and the
+    deflated zerobond prices are tabulated on a grid for the
+    standardized state variable \f$ y \f$ and interpolated by cubic
+    splines, values outside the grid are extrapolated flat. On the
+    grid points themselves the model values are reproduced exactly.
+
+    Times passed to the inspectors must be on the snapshot grid (up to
+    rounding), the conditioning time \f$ t \f$ must furthermore be a
+    state time. Curves are referred to by their index, 0 denotes the
+    model curve, \f$ i>0 \f$ the i-th of the curves given in the
+    constructor (an empty handle again standing for the model curve).
+
+    The snapshot reflects the unadjusted model. It is not updated when
+    the model changes, a new snapshot has to be created instead.
+
+    \warning for models without an affine representation the memory
+             needed is proportional to the number of state times times
+             the number of times times the number of y grid points.
+*/
+
+class Gaussian1dModelSnapshot {
+  public:
+    Gaussian1dModelSnapshot(
+        const boost::shared_ptr<Gaussian1dModel> &model,
+        const std::vector<Time> &times,
+        const std::vector<Time> &stateTimes = std::vector<Time>(),
+        const std::vector<Handle<YieldTermStructure> > &curves =
+            std::vector<Handle<YieldTermStructure> >(),
+        const Real yStdDevs = 7.0, const int yGridPoints = 64);
+
+    //! \name Inspectors
+    //@{
+    const std::vector<Time> &times() const { return times_; }
+    const std::vector<Time> &stateTimes() const { return stateTimes_; }
+    bool affine() const { return affine_; }
+    //! time from the model curve's reference date
+    Time time(const Date &d) const;
+    //@}
+
+    //! \name Model quantities
+    //@{
+    Real numeraire(const Time t, const Real y = 0.0,
+                   const Size curve = 0) const;
+    Real zerobond(const Time T, const Time t = 0.0, const Real y = 0.0,
+                  const Size curve = 0) const;
+    Real deflatedZerobond(const Time T, const Time t = 0.0, const Real y = 0.0,
+                          const Size curve = 0,
+                          const Size numeraireCurve = 0) const;
+    /*! simple forward rate for the period from \f$ S \f$ to
+        \f$ E \f$ with year fraction dcf */
+    Real forwardRate(const Time S, const Time E, const Real dcf,
+                     const Time t = 0.0, const Real y = 0.0,
+                     const Size curve = 0) const;
+    //! see Gaussian1dModel::yGrid
+    const Disposable<Array> yGrid(const Real yStdDevs, const int gridPoints,
+                                  const Time T = 1.0, const Time t = 0.0,
+                                  const Real y = 0.0) const;
+    //@}
+
+  private:
+    Size index(const Time t) const;
+    Size stateIndex(const Time t) const;
+    Size curveIndex(const Size curve) const;
+    Real modelNumeraire(const Size i, const Real y) const;
+    Real modelZerobond(const Size j, const Size i, const Real y) const;
+    Real spline(const std::vector<Real> &table, const Size offset,
+                const Real y) const;
+
+    Date referenceDate_;
+    DayCounter dayCounter_;
+    std::vector<Time> times_, stateTimes_;
+    std::vector<Size> stateIndex_;
+    // discount factors on times_, one vector per curve, and the ratio
+    // of the numeraire w.r.t. a curve to the model numeraire on the
+    // state times
+    std::vector<std::vector<Real> > discount_, numeraireAdjustment_;
+    // moments of the state variable x(t) given x(0)
+    std::vector<Real> e0_, sd0_;
+    // conditional moments E(x(T)|x(t)) = a + b x(t) and stddev(x(T)|x(t))
+    // for state times t (rows) and times T (columns)
+    std::vector<Real> condA_, condB_, condSd_;
+    // affine representation
+    bool affine_;
+    std::vector<Real> H_, m_, s_, zeta_;
+    Real numeraireH_, numeraireDiscount_;
+    // spline tables for the other models
+    Real yMin_, yMax_, yStep_;
+    Size yPoints_, splineSize_;
+    std::vector<Real> numeraireTable_, deflatedZerobondTable_;
+};
+
+// inline
+
+inline Time Gaussian1dModelSnapshot::time(const Date &d) const {
+    return dayCounter_.yearFraction(referenceDate_, d);
+}
+
+inline Real Gaussian1dModelSnapshot::deflatedZerobond(
+    const Time T, const Time t, const Real y, const Size curve,
+    const Size numeraireCurve) const {
+    return zerobond(T, t, y, curve) / numeraire(t, y, numeraireCurve);
+}
+
+inline Real Gaussian1dModelSnapshot::forwardRate(const Time S, const Time E,
+                                                 const Real dcf, const Time t,
+                                                 const Real y,
+                                                 const Size curve) const {
+    return (zerobond(S, t, y, curve) / zerobond(E, t, y, curve) - 1.0) / dcf;
+}
+
+} // namespace QuantLib
+
+#endif
@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -286,4 +286,127 @@ const Real Gsr::numeraireImpl(const Time t, const Real y,
                    : yts->discount(p->getForwardMeasureTime());
     return zerobond(p->getForwardMeasureTime(), t, y, yts, false);
 }
+
+const Disposable<Array>
+Gsr::zerobondImpl(const Time T, const Time t, const Array &y,
+                  const Handle<YieldTermStructure> &yts,
+                  const bool adjusted) const {
+
+    calculate();
+
+    if (t == 0.0) {
+        Array res(y.size(), yts.empty()
+                                ? this->termStructure()->discount(T, true)
+                                : yts->discount(T, true));
+        return res;
+    }
+
+    boost::shared_ptr<GsrProcess> p =
+        adjusted
+            ? boost::dynamic_pointer_cast<GsrProcess>(adjustedStateProcess_)
+            : boost::dynamic_pointer_cast<GsrProcess>(stateProcess_);
+
+    // the time dependent parts are computed only once, note that G
+    // does not depend on the state
+    Real sd = stateProcess_->stdDeviation(0.0, 0.0, t);
+    Real e = stateProcess_->expectation(0.0, 0.0, t);
+    Real gtT = p->G(t, T, 0.0);
+    Real c = 0.5 * p->y(t) * gtT * gtT;
+
+    Real d = yts.empty()
+                 ? termStructure()->discount(T, true) /
+                       termStructure()->discount(t, true)
+                 : yts->discount(T, true) / yts->discount(t, true);
+
+    Array res(y.size());
+    for (Size i = 0; i < y.size(); ++i) {
+        Real x = y[i] * sd + e;
+        res[i] = d * exp(-x * gtT - c);
+    }
+    return res;
+}
+
+const Disposable<Array>
+Gsr::numeraireImpl(const Time t, const Array &y,
+                   const Handle<YieldTermStructure> &yts) const {
+
+    calculate();
+
+    boost::shared_ptr<GsrProcess> p =
+        boost::dynamic_pointer_cast<GsrProcess>(stateProcess_);
+
+    if (t == 0) {
+        Array res(y.size(),
+                  yts.empty() ? this->termStructure()->discount(
+                                    p->getForwardMeasureTime(), true)
+                              : yts->discount(p->getForwardMeasureTime()));
+        return res;
+    }
+    return zerobondImpl(p->getForwardMeasureTime(), t, y, yts, false);
+}
+
+bool Gsr::affineRepresentation(const std::vector<Time> &times,
+                               std::vector<Real> &H, std::vector<Real> &m,
+                               std::vector<Real> &s, std::vector<Real> &zeta,
+                               Time &numeraireTime, Real &numeraireH) const {
+
+    calculate();
+
+    boost::shared_ptr<GsrProcess> p =
+        boost::static_pointer_cast<GsrProcess>(stateProcess_);
+
+    // the state variable x is the short rate deviation in the forward
+    // measure, scaled by H'(t) it becomes the lgm state variable,
+    // shifted by the drift of the measure change
+
+    H.resize(times.size());
+    m.resize(times.size());
+    s.resize(times.size());
+    zeta.resize(times.size());
+    Real Hprime;
+    for (Size i = 0; i < times.size(); ++i) {
+        reversionIntegrals(times[i], H[i], Hprime);
+        if (times[i] < QL_EPSILON) {
+            m[i] = s[i] = zeta[i] = 0.0;
+        } else {
+            m[i] = stateProcess_->expectation(0.0, 0.0, times[i]) / Hprime;
+            s[i] = stateProcess_->stdDeviation(0.0, 0.0, times[i]) / Hprime;
+            zeta[i] = p->y(times[i]) / (Hprime * Hprime);
+        }
+    }
+
+    numeraireTime = p->getForwardMeasureTime();
+    reversionIntegrals(numeraireTime, numeraireH, Hprime);
+
+    return true;
+}
+
+void Gsr::registerTimes(const std::vector<Time> &times) const {
+
+    calculate();
+
+    boost::shared_ptr<GsrProcess> p =
+        boost::static_pointer_cast<GsrProcess>(stateProcess_);
+
+    std::vector<Time> grid(times);
+    grid.push_back(0.0);
+    grid.push_back(p->getForwardMeasureTime());
+    p->precompute(grid);
+}
+
+void Gsr::reversionIntegrals(const Time t, Real &H, Real &Hprime) const {
+    H = 0.0;
+    Hprime = 1.0;
+    Time t0 = 0.0;
+    for (Size k = 0; t0 < t; ++k) {
+        Time t1 = k < volsteptimes_.size() ? std::min(volsteptimes_[k], t) : t;
+        Real kappa = reversion_.params()[reversion_.size() == 1 ? 0 : k];
+        Real dt = t1 - t0;
+        H += Hprime * (close_enough(kappa, 0.0)
+                           ? dt
+                           : (1.0 - std::exp(-kappa * dt)) / kappa);
+        Hprime *= std::exp(-kappa * dt);
+        t0 = t1;
+    }
+}
 }
@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -195,6 +195,12 @@ class Gsr : public Gaussian1dModel, public CalibratedModel {
         }
     }
 
+    /*! fills the tables of the state process for the given times,
+        the origin and the forward measure time (the adjusted state
+        process, which is only used for adjusted zerobonds, keeps
+        its lazily filled cache) */
+    void registerTimes(const std::vector<Time> &times) const;
+
   protected:
     const Real numeraireImpl(const Time t, const Real y,
                              const Handle<YieldTermStructure> &yts) const;
@@ -203,6 +209,20 @@ class Gsr : public Gaussian1dModel, public CalibratedModel {
                             const Handle<YieldTermStructure> &yts,
                             const bool adjusted) const;
 
+    const Disposable<Array>
+    numeraireImpl(const Time t, const Array &y,
+                  const Handle<YieldTermStructure> &yts) const;
+
+    const Disposable<Array>
+    zerobondImpl(const Time T, const Time t, const Array &y,
+                 const Handle<YieldTermStructure> &yts,
+                 const bool adjusted) const;
+
+    bool affineRepresentation(const std::vector<Time> &times,
+                              std::vector<Real> &H, std::vector<Real> &m,
+                              std::vector<Real> &s, std::vector<Real> &zeta,
+                              Time &numeraireTime, Real &numeraireH) const;
+
     void generateArguments() {
         boost::static_pointer_cast<GsrProcess>(stateProcess_)->flushCache();
         boost::static_pointer_cast<GsrProcess>(adjustedStateProcess_)
@@ -224,6 +244,9 @@ class Gsr : public Gaussian1dModel, public CalibratedModel {
 
     void initialize(Real);
 
+    // H(t) = \int_0^t \exp(-\int_0^u \kappa(s) ds) du and its derivative
+    void reversionIntegrals(const Time t, Real &H, Real &Hprime) const;
+
     Parameter &reversion_, &sigma_, &adjuster_;
     Parameter unitAdjuster_;
 
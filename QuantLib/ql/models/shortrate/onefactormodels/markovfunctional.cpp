@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013 Peter Caspers
+ Copyright (C) 2013, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -837,6 +837,70 @@ namespace QuantLib {
                        termStructure()->discount(numeraireTime())));
     }
 
+    const Disposable<Array> MarkovFunctional::numeraireImpl(
+        const Time t, const Array &y,
+        const Handle<YieldTermStructure> &yts) const {
+
+        if (close(t, 0.0)) {
+            Array res(y.size(),
+                      yts.empty() ? this->termStructure()->discount(
+                                        numeraireTime(), true)
+                                  : yts->discount(numeraireTime()));
+            return res;
+        }
+
+        Array res = numeraireArray(t, y);
+        if (!yts.empty())
+            res *= yts->discount(numeraireTime()) / yts->discount(t) *
+                   termStructure()->discount(t) /
+                   termStructure()->discount(numeraireTime());
+        return res;
+    }
+
+    const Disposable<Array>
+    MarkovFunctional::zerobondImpl(const Time T, const Time t, const Array &y,
+                                   const Handle<YieldTermStructure> &yts,
+                                   const bool) const {
+
+        if (close(t, 0.0)) {
+            Array res(y.size(), yts.empty()
+                                    ? this->termStructure()->discount(T, true)
+                                    : yts->discount(T, true));
+            return res;
+        }
+
+        Array res = zerobondArray(T, t, y);
+        if (!yts.empty())
+            res *= yts->discount(T) / yts->discount(t) *
+                   termStructure()->discount(t) / termStructure()->discount(T);
+        return res;
+    }
+
+    const Disposable<Array> MarkovFunctional::deflatedZerobondImpl(
+        const Time T, const Time t, const Array &y,
+        const Handle<YieldTermStructure> &yts,
+        const Handle<YieldTermStructure> &ytsNumeraire,
+        const bool) const {
+
+        if (close(t, 0.0)) {
+            Array res(y.size(),
+                      (yts.empty() ? this->termStructure()->discount(T, true)
+                                   : yts->discount(T, true)) /
+                          numeraire(0.0, 0.0, ytsNumeraire));
+            return res;
+        }
+
+        Array res = deflatedZerobondArray(T, t, y);
+        if (!yts.empty())
+            res *= yts->discount(T) / yts->discount(t) *
+                   termStructure()->discount(t) / termStructure()->discount(T);
+        if (!ytsNumeraire.empty())
+            res /= ytsNumeraire->discount(numeraireTime()) /
+                   ytsNumeraire->discount(t) * termStructure()->discount(t) /
+                   termStructure()->discount(numeraireTime());
+        return res;
+    }
+
     const Real MarkovFunctional::marketSwapRate(const Date &expiry,
                                                 const CalibrationPoint &p,
                                                 const Real digitalPrice,
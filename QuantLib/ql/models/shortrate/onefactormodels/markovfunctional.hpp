@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013 Peter Caspers
+ Copyright (C) 2013, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -346,6 +346,21 @@ namespace QuantLib {
                                         const Handle<YieldTermStructure> &ytsNumeraire,
                                         const bool adjusted) const;
 
+        const Disposable<Array>
+        numeraireImpl(const Time t, const Array &y,
+                      const Handle<YieldTermStructure> &yts) const;
+
+        const Disposable<Array>
+        zerobondImpl(const Time T, const Time t, const Array &y,
+                     const Handle<YieldTermStructure> &yts,
+                     const bool adjusted) const;
+
+        const Disposable<Array>
+        deflatedZerobondImpl(const Time T, const Time t, const Array &y,
+                             const Handle<YieldTermStructure> &yts,
+                             const Handle<YieldTermStructure> &ytsNumeraire,
+                             const bool adjusted) const;
+
         bool preferDeflatedZerobond() const { return true; }
 
         void generateArguments() {
@@ -6,5 +6,6 @@
 #include <ql/patterns/lazyobject.hpp>
 #include <ql/patterns/observable.hpp>
 #include <ql/patterns/singleton.hpp>
+#include <ql/patterns/threadsession.hpp>
 #include <ql/patterns/visitor.hpp>
 
@@ -3,6 +3,7 @@
 /*
 Copyright (C) 2013 Chris Higgs
 Copyright (C) 2015 Klaus Spanderen
+Copyright (C) 2016 Peter Caspers
 
 This file is part of QuantLib, a free-software/open-source library
 for financial quantitative analysts and developers - http://quantlib.org/
@@ -23,21 +24,78 @@ FOR A PARTICULAR PURPOSE.  See the license for more details.
 
 #ifndef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
 
+#include <ql/patterns/lazyobject.hpp>
+#include <ql/patterns/threadsession.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+
 namespace QuantLib {
 
-    void ObservableSettings::enableUpdates() {
+    void ObservableSettings::enableUpdates(bool recalculate, bool parallel) {
         updatesEnabled_  = true;
         updatesDeferred_ = false;
 
         // if there are outstanding deferred updates, do the notification
-        if (deferredObservers_.size()) {
-            bool successful = true;
-            std::string errMsg;
+        if (deferredObservers_.empty())
+            return;
+
+        // the deferred observers and all observers reachable from them
+        std::vector<Observer*> nodes(deferredObservers_.begin(),
+                                     deferredObservers_.end());
+        deferredObservers_.clear();
+        Size seeds = nodes.size();
+        boost::unordered_map<Observer*, Size> index;
+        for (Size i=0; i<seeds; ++i)
+            index[nodes[i]] = i;
+        std::vector<const Observable*> observables;
+        std::vector<std::vector<Size> > successors;
+        for (Size i=0; i<nodes.size(); ++i) {
+            const Observable* o = dynamic_cast<const Observable*>(nodes[i]);
+            observables.push_back(o);
+            successors.push_back(std::vector<Size>());
+            if (o != 0) {
+                for (boost::unordered_set<Observer*>::const_iterator j =
+                         o->observers_.begin();
+                     j != o->observers_.end(); ++j) {
+                    std::pair<boost::unordered_map<Observer*, Size>::iterator,
+                              bool> k =
+                        index.insert(std::make_pair(*j, nodes.size()));
+                    if (k.second)
+                        nodes.push_back(*j);
+                    successors[i].push_back(k.first->second);
+                }
+            }
+        }
+
+        // topological order and level of each observer
+        Size n = nodes.size();
+        std::vector<Size> inDegree(n, 0), level(n, 0), order;
+        order.reserve(n);
+        for (Size i=0; i<n; ++i)
+            for (Size j=0; j<successors[i].size(); ++j)
+                ++inDegree[successors[i][j]];
+        for (Size i=0; i<n; ++i)
+            if (inDegree[i] == 0)
+                order.push_back(i);
+        for (Size k=0; k<order.size(); ++k) {
+            Size i = order[k];
+            for (Size j=0; j<successors[i].size(); ++j) {
+                Size l = successors[i][j];
+                level[l] = std::max(level[l], level[i]+1);
+                if (--inDegree[l] == 0)
+                    order.push_back(l);
+            }
+        }
+
+        bool successful = true;
+        std::string errMsg;
 
-            for (iterator i=deferredObservers_.begin();
-                i!=deferredObservers_.end(); ++i) {
+        if (order.size() < n) {
+            // the graph has cycles, we notify the deferred observers
+            // and let the notifications propagate as usual
+            for (Size i=0; i<seeds; ++i) {
                 try {
-                    (*i)->update();
+                    nodes[i]->update();
                 } catch (std::exception& e) {
                     successful = false;
                     errMsg = e.what();
@@ -45,21 +103,156 @@ namespace QuantLib {
                     successful = false;
                 }
             }
+            QL_ENSURE(successful,
+                  "could not notify one or more observers: " << errMsg);
+            QL_REQUIRE(!recalculate,
+                       "observer graph has cycles, "
+                       "lazy objects can not be recalculated by level");
+            return;
+        }
 
-            deferredObservers_.clear();
+        // notify each observer once; an observer is notified if it
+        // is a deferred one or if one of its observables forwarded
+        // the notification it received
+        std::vector<bool> pending(n, false);
+        std::fill(pending.begin(), pending.begin()+seeds, true);
+        // the observables which forwarded a notification to each observer
+        std::vector<std::vector<Size> > sources(n);
+        std::vector<Size> notified;
+        flushing_ = true;
+        graphChanged_ = false;
+        flushedObservables_.clear();
+        flushPositions_.assign(n, 0);
+        notifiedObservables_.clear();
+        unregisteredObservers_.clear();
+        for (Size k=0; k<n; ++k) {
+            Size i = order[k];
+            flushPositions_[i] = k;
+            if (observables[i] != 0)
+                flushedObservables_[observables[i]] = i;
+        }
+        for (Size k=0; k<n; ++k) {
+            Size i = order[k];
+            flushPosition_ = k;
+            if (!pending[i] ||
+                !stillObserving(nodes, observables, sources, i))
+                continue;
+            try {
+                nodes[i]->update();
+            } catch (std::exception& e) {
+                successful = false;
+                errMsg = e.what();
+            } catch (...) {
+                successful = false;
+            }
+            notified.push_back(i);
+            // the update may have made this or later observables notify
+            for (Size m=0; m<notifiedObservables_.size(); ++m) {
+                Size j = notifiedObservables_[m];
+                for (Size l=0; l<successors[j].size(); ++l) {
+                    pending[successors[j][l]] = true;
+                    sources[successors[j][l]].push_back(j);
+                }
+            }
+            notifiedObservables_.clear();
+        }
+        flushing_ = false;
+        flushedObservables_.clear();
+        flushPositions_.clear();
 
-            QL_ENSURE(successful,
+        QL_ENSURE(successful,
                   "could not notify one or more observers: " << errMsg);
+
+        if (!recalculate) {
+            unregisteredObservers_.clear();
+            return;
+        }
+
+        // recalculate the notified lazy objects level by level; if the
+        // graph changed, the levels might be outdated and we recalculate
+        // serially in the order of the original graph
+        bool inParallel = parallel && !graphChanged_;
+        std::vector<std::vector<LazyObject*> > levels;
+        for (Size k=0; k<notified.size(); ++k) {
+            Size i = notified[k];
+            if (unregisteredObservers_.count(nodes[i]) != 0)
+                continue;
+            LazyObject* l = dynamic_cast<LazyObject*>(nodes[i]);
+            if (l != 0) {
+                Size lev = graphChanged_ ? 0 : level[i];
+                if (levels.size() <= lev)
+                    levels.resize(lev+1);
+                levels[lev].push_back(l);
+            }
         }
+        unregisteredObservers_.clear();
+#if defined(QL_ENABLE_SESSIONS)
+        Integer session = ThreadSession::id();
+#endif
+        for (Size k=0; k<levels.size(); ++k) {
+            std::vector<std::string> errors(levels[k].size());
+            long m = static_cast<long>(levels[k].size());
+            recalculatingInParallel_ = inParallel;
+            #pragma omp parallel for schedule(dynamic) if(inParallel)
+            for (long j=0; j<m; ++j) {
+#if defined(QL_ENABLE_SESSIONS)
+                // the objects belong to the session of the calling thread
+                ThreadSession threadSession(session);
+#endif
+                try {
+                    levels[k][j]->calculate();
+                } catch (std::exception& e) {
+                    errors[j] = e.what();
+                } catch (...) {
+                    errors[j] = "unknown error";
+                }
+            }
+            recalculatingInParallel_ = false;
+            for (Size j=0; j<errors.size(); ++j) {
+                if (!errors[j].empty()) {
+                    successful = false;
+                    errMsg = errors[j];
+                }
+            }
+        }
+
+        QL_ENSURE(successful,
+                  "could not recalculate one or more objects: " << errMsg);
+    }
+
+    bool ObservableSettings::stillObserving(
+                       const std::vector<Observer*>& nodes,
+                       const std::vector<const Observable*>& observables,
+                       const std::vector<std::vector<Size> >& sources,
+                       Size i) const {
+        // observers which never unregistered during the flush are
+        // alive and still registered with the observables in the graph
+        if (unregisteredObservers_.count(nodes[i]) == 0)
+            return true;
+        // otherwise they might have been destroyed; we only look at the
+        // forwarding observables which did not unregister from anything
+        for (Size k=0; k<sources[i].size(); ++k) {
+            Size j = sources[i][k];
+            if (unregisteredObservers_.count(nodes[j]) == 0 &&
+                observables[j]->observers_.count(nodes[i]) != 0)
+                return true;
+        }
+        return false;
     }
 
 
     void Observable::notifyObservers() {
+        QL_REQUIRE(!settings_.recalculatingInParallel_,
+                   "notification sent during parallel recalculation");
         if (!settings_.updatesEnabled()) {
             // if updates are only deferred, flag this for later notification
             // these are held centrally by the settings singleton
             settings_.registerDeferredObservers(observers_);
         }
+        else if (settings_.recordNotification(this)) {
+            // the observers are notified by the settings singleton,
+            // which is flushing the deferred notifications
+        }
         else if (observers_.size()) {
             bool successful = true;
             std::string errMsg;
@@ -89,54 +282,21 @@ namespace QuantLib {
 
 #else
 
-#include <boost/signals2/signal_type.hpp>
-
 namespace QuantLib {
 
-    namespace detail {
-
-        class Signal {
-          public:
-            typedef boost::signals2::signal_type<
-                void(),
-                boost::signals2::keywords::mutex_type<boost::recursive_mutex> >
-                ::type signal_type;
-
-            void connect(const signal_type::slot_type& slot) {
-                sig_.connect(slot);
-            }
-
-            template <class T>
-            void disconnect(const T& slot) {
-                sig_.disconnect(slot);
-            }
-
-            void operator()() const {
-                sig_.operator()();
-            }
-          private:
-            signal_type sig_;
-        };
-
-    }
-
     void Observable::registerObserver(
         const boost::shared_ptr<Observer::Proxy>& observerProxy) {
-        {
-            boost::lock_guard<boost::recursive_mutex> lock(mutex_);
-            observers_.insert(observerProxy);
-        }
-
-        detail::Signal::signal_type::slot_type slot(&Observer::Proxy::update,
-                                    observerProxy.get());
-        sig_->connect(slot.track(observerProxy));
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        if (observers_.insert(observerProxy).second)
+            snapshot_.reset();
     }
 
     void Observable::unregisterObserver(
         const boost::shared_ptr<Observer::Proxy>& observerProxy) {
         {
-            boost::lock_guard<boost::recursive_mutex> lock(mutex_);
-            observers_.erase(observerProxy);
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            if (observers_.erase(observerProxy) != 0)
+                snapshot_.reset();
         }
 
         if (settings_.updatesDeferred()) {
@@ -145,22 +305,47 @@ namespace QuantLib {
                 settings_.unregisterDeferredObserver(observerProxy);
             }
         }
+    }
+
+    void Observable::sendNotifications() {
+        boost::shared_ptr<const snapshot_type> observers;
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            if (!snapshot_)
+                snapshot_ = boost::shared_ptr<const snapshot_type>(
+                    new snapshot_type(observers_.begin(), observers_.end()));
+            observers = snapshot_;
+        }
 
-        sig_->disconnect(boost::bind(&Observer::Proxy::update,
-                             observerProxy.get()));
+        bool successful = true;
+        std::string errMsg;
+        for (snapshot_type::const_iterator i=observers->begin();
+             i!=observers->end(); ++i) {
+            try {
+                (*i)->update();
+            } catch (std::exception& e) {
+                // see the non thread-safe implementation
+                successful = false;
+                errMsg = e.what();
+            } catch (...) {
+                successful = false;
+            }
+        }
+        QL_ENSURE(successful,
+                  "could not notify one or more observers: " << errMsg);
     }
 
     void Observable::notifyObservers() {
         if (settings_.updatesEnabled()) {
-            return sig_->operator()();
+            return sendNotifications();
         }
 
         boost::lock_guard<boost::mutex> sLock(settings_.mutex_);
         if (settings_.updatesEnabled()) {
-            return sig_->operator()();
+            return sendNotifications();
         }
         else if (settings_.updatesDeferred()) {
-            boost::lock_guard<boost::recursive_mutex> lock(mutex_);
+            boost::lock_guard<boost::mutex> lock(mutex_);
             // if updates are only deferred, flag this for later notification
             // these are held centrally by the settings singleton
             settings_.registerDeferredObservers(observers_);
@@ -168,12 +353,10 @@ namespace QuantLib {
     }
 
     Observable::Observable()
-    : sig_(new detail::Signal()),
-      settings_(ObservableSettings::instance()) { }
+    : settings_(ObservableSettings::instance()) { }
 
     Observable::Observable(const Observable&)
-    : sig_(new detail::Signal()),
-      settings_(ObservableSettings::instance()) {
+    : settings_(ObservableSettings::instance()) {
         // the observer set is not copied; no observer asked to
         // register with this object
     }
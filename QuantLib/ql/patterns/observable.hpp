@@ -6,6 +6,7 @@ Copyright (C) 2003, 2004, 2005, 2006 StatPro Italia srl
 Copyright (C) 2011, 2012 Ferdinando Ametrano
 Copyright (C) 2013 Chris Higgs
 Copyright (C) 2015 Klaus Spanderen
+Copyright (C) 2016 Peter Caspers
 
 
 This file is part of QuantLib, a free-software/open-source library
@@ -35,6 +36,8 @@ FOR A PARTICULAR PURPOSE.  See the license for more details.
 
 #include <boost/shared_ptr.hpp>
 #include <boost/unordered_set.hpp>
+#include <boost/unordered_map.hpp>
+#include <vector>
 
 
 #ifndef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
@@ -52,6 +55,26 @@ namespace QuantLib {
     class Observable;
 
     //! global repository for run-time library settings
+    /*! When updates are disabled and deferred, the observers of the
+        notifying observables are collected. Re-enabling updates
+        sends the outstanding notifications through the observer
+        graph in topological order, so that each observer depending
+        (directly or indirectly) on the changed observables is
+        notified at most once and after all the observers it depends
+        on. Optionally, the lazy objects notified are then
+        recalculated level by level, i.e., each of them after the
+        lazy objects it depends on.
+
+        Observers may register or unregister during the flush (e.g.,
+        when an update() creates or destroys objects). If an
+        observable of the graph gains an observer, the remaining
+        notifications are sent as usual, as they are for observables
+        notifying again after their turn. Observers which unregistered
+        from any observable during the flush are only notified if they
+        are still registered with an observable that forwarded the
+        notification; in particular, this is not checked for the
+        deferred observers themselves, which are then skipped.
+    */
     class ObservableSettings : public Singleton<ObservableSettings> {
         friend class Singleton<ObservableSettings>;
         friend class Observable;
@@ -60,30 +83,60 @@ namespace QuantLib {
             updatesEnabled_  = false;
             updatesDeferred_ = deferred;
         }
-        void enableUpdates();
+        /*! If \p recalculate is true, the lazy objects notified by
+            the deferred updates are recalculated level by level.
+
+            If \p parallel is also true and OpenMP is enabled, the
+            recalculations within a level are run in parallel. This
+            is opt-in since it is only safe if they do not share any
+            state; in particular, they must not trigger the
+            calculation of common lazy objects which were not
+            notified. Notifications sent while recalculating in
+            parallel raise an error.
+        */
+        void enableUpdates(bool recalculate=false, bool parallel=false);
 
         bool updatesEnabled()  {return updatesEnabled_;}
         bool updatesDeferred() {return updatesDeferred_;}
       private:
         ObservableSettings()
         : updatesEnabled_(true),
-          updatesDeferred_(false) {}
+          updatesDeferred_(false),
+          flushing_(false), graphChanged_(false),
+          recalculatingInParallel_(false), flushPosition_(0) {}
 
         void registerDeferredObservers(
             const boost::unordered_set<Observer*>& observers);
         void unregisterDeferredObserver(Observer*);
+        bool recordNotification(const Observable*);
+        void recordRegistration(const Observable*);
+        void recordUnregistration(Observer*);
+        bool stillObserving(const std::vector<Observer*>& nodes,
+                            const std::vector<const Observable*>& observables,
+                            const std::vector<std::vector<Size> >& sources,
+                            Size i) const;
 
         typedef boost::unordered_set<Observer*> set_type;
         typedef set_type::iterator iterator;
         set_type deferredObservers_;
 
         bool updatesEnabled_,  updatesDeferred_;
+
+        // while flushing, the notifications of the observables in
+        // the graph which did not have their turn yet are recorded
+        // instead of being sent, unless the graph changed
+        bool flushing_, graphChanged_, recalculatingInParallel_;
+        Size flushPosition_;
+        boost::unordered_map<const Observable*, Size> flushedObservables_;
+        std::vector<Size> flushPositions_, notifiedObservables_;
+        boost::unordered_set<Observer*> unregisteredObservers_;
     };
 
     //! Object that notifies its changes to a set of observers
     /*! \ingroup patterns */
     class Observable {
         friend class Observer;
+        friend class ObservableSettings;
       public:
         // constructors, assignment, destructor
         Observable() : settings_(ObservableSettings::instance()) {}
@@ -155,6 +208,28 @@ namespace QuantLib {
         deferredObservers_.erase(o);
     }
 
+    inline bool ObservableSettings::recordNotification(const Observable* o) {
+        if (!flushing_ || graphChanged_)
+            return false;
+        boost::unordered_map<const Observable*, Size>::const_iterator i =
+            flushedObservables_.find(o);
+        if (i == flushedObservables_.end() ||
+            flushPositions_[i->second] < flushPosition_)
+            return false;
+        notifiedObservables_.push_back(i->second);
+        return true;
+    }
+
+    inline void ObservableSettings::recordRegistration(const Observable* o) {
+        if (flushing_ && flushedObservables_.count(o) != 0)
+            graphChanged_ = true;
+    }
+
+    inline void ObservableSettings::recordUnregistration(Observer* o) {
+        if (flushing_)
+            unregisteredObservers_.insert(o);
+    }
+
     inline Observable::Observable(const Observable&)
     : settings_(ObservableSettings::instance()) {
         // the observer set is not copied; no observer asked to
@@ -179,12 +254,14 @@ namespace QuantLib {
 
     inline std::pair<boost::unordered_set<Observer*>::iterator, bool>
     Observable::registerObserver(Observer* o) {
+        settings_.recordRegistration(this);
         return observers_.insert(o);
     }
 
     inline Size Observable::unregisterObserver(Observer* o) {
         if (settings_.updatesDeferred())
             settings_.unregisterDeferredObserver(o);
+        settings_.recordUnregistration(o);
 
         return observers_.erase(o);
     }
@@ -253,6 +330,7 @@ namespace QuantLib {
 #include <boost/smart_ptr/owner_less.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <set>
+#include <vector>
 
 namespace QuantLib {
 
@@ -300,10 +378,15 @@ namespace QuantLib {
             void update() const {
                 boost::lock_guard<boost::recursive_mutex> lock(mutex_);
                 if (active_) {
-                    const boost::weak_ptr<Observer> o
-                        = observer_->weak_from_this();
-                    if (!o._empty()) {
-                        const boost::shared_ptr<Observer> obs(o.lock());
+                    // observers owned by a shared pointer are kept alive
+                    // during the update; the weak reference is looked
+                    // up once, since the observer is usually not yet
+                    // owned when the proxy is created
+                    if (observerRef_._empty())
+                        observerRef_ = observer_->weak_from_this();
+                    if (!observerRef_._empty()) {
+                        const boost::shared_ptr<Observer> obs(
+                                                       observerRef_.lock());
                         if (obs)
                             obs->update();
                     }
@@ -322,6 +405,7 @@ namespace QuantLib {
             bool active_;
             mutable boost::recursive_mutex mutex_;
             Observer* const observer_;
+            mutable boost::weak_ptr<Observer> observerRef_;
         };
 
         boost::shared_ptr<Proxy> proxy_;
@@ -330,12 +414,16 @@ namespace QuantLib {
         set_type observables_;
     };
 
-	namespace detail {
-		class Signal;
-	}
-
     //! Object that notifies its changes to a set of observers
-    /*! \ingroup patterns */
+    /*! The observers are notified from an immutable snapshot of the
+        observer set, which is shared by concurrent notifications and
+        rebuilt on the first notification after a registration
+        change. The lock of the observable is therefore held only
+        for the (un)registration of observers and for taking the
+        snapshot, never while observers are updated.
+
+        \ingroup patterns
+    */
     class Observable {
         friend class Observer;
       public:
@@ -355,11 +443,14 @@ namespace QuantLib {
       private:
         void registerObserver(const boost::shared_ptr<Observer::Proxy>&);
         void unregisterObserver(const boost::shared_ptr<Observer::Proxy>&);
+        void sendNotifications();
 
-        boost::shared_ptr<detail::Signal> sig_;
+        typedef std::vector<boost::shared_ptr<Observer::Proxy> >
+            snapshot_type;
 
         set_type observers_;
-        mutable boost::recursive_mutex mutex_;
+        boost::shared_ptr<const snapshot_type> snapshot_;
+        mutable boost::mutex mutex_;
 
         ObservableSettings& settings_;
     };
@@ -374,7 +465,9 @@ namespace QuantLib {
             boost::lock_guard<boost::mutex> lock(mutex_);
             updatesType_ = (deferred) ? UpdatesDeferred : 0;
         }
-        void enableUpdates();
+        /*! the notifications are sent in no particular order, the
+            recalculation of lazy objects is not supported. */
+        void enableUpdates(bool recalculate=false, bool parallel=false);
 
         bool updatesEnabled()  {return (updatesType_ & UpdatesEnabled) != 0; }
         bool updatesDeferred() {return (updatesType_ & UpdatesDeferred) != 0; }
@@ -410,7 +503,10 @@ namespace QuantLib {
         deferredObservers_.erase(o);
     }
 
-    inline void ObservableSettings::enableUpdates() {
+    inline void ObservableSettings::enableUpdates(bool recalculate, bool) {
+        QL_REQUIRE(!recalculate,
+                   "recalculation of lazy objects not supported by the "
+                   "thread-safe observer pattern");
         boost::lock_guard<boost::mutex> lock(mutex_);
 
         // if there are outstanding deferred updates, do the notification
@@ -546,4 +642,22 @@ namespace QuantLib {
     }
 }
 #endif
+
+namespace QuantLib {
+
+    //! %Observer recording whether it was notified
+    /*! The flag is raised by any notification of the observables it
+        is registered with; lowering it is up to its owner.
+
+        \ingroup patterns
+    */
+    class NotificationFlag : public Observer {
+      public:
+        NotificationFlag() : notified(false) {}
+        void update() { notified = true; }
+        bool notified;
+    };
+
+}
+
 #endif
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2004, 2005, 2007 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -35,6 +36,12 @@
 #endif
 #include <map>
 
+#if defined(QL_ENABLE_SESSIONS)
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
 #if (_MANAGED == 1) || (_M_CEE == 1)
 // One of the Visual C++ /clr modes. In this case, the global instance
 // map must be declared as a static data member of the class.
@@ -73,6 +80,15 @@ namespace QuantLib {
         as a single implemementation point should synchronization
         features be added.
 
+        When sessions are enabled, each session gets its own
+        instance; since sessions are usually run in different
+        threads, the access to the instance map is synchronized.
+        Each thread caches the instance it accessed last, so that
+        the lock is only taken when it changes session. Without
+        sessions, no synchronization takes place.
+        See ThreadSession for a ready-made sessionId()
+        implementation based on thread-local session ids.
+
         \ingroup patterns
     */
     template <class T>
@@ -80,6 +96,10 @@ namespace QuantLib {
     #if (QL_MANAGED == 1)
       private:
         static std::map<Integer, boost::shared_ptr<T> > instances_;
+        #if defined(QL_ENABLE_SESSIONS)
+        static boost::mutex mutex_;
+        static boost::thread_specific_ptr<std::pair<Integer, T*> > cache_;
+        #endif
     #endif
       public:
         //! access to the unique instance
@@ -92,6 +112,12 @@ namespace QuantLib {
     // static member definition
     template <class T>
     std::map<Integer, boost::shared_ptr<T> > Singleton<T>::instances_;
+    #if defined(QL_ENABLE_SESSIONS)
+    template <class T>
+    boost::mutex Singleton<T>::mutex_;
+    template <class T>
+    boost::thread_specific_ptr<std::pair<Integer, T*> > Singleton<T>::cache_;
+    #endif
     #endif
 
     // template definitions
@@ -100,15 +126,30 @@ namespace QuantLib {
     T& Singleton<T>::instance() {
         #if (QL_MANAGED == 0)
         static std::map<Integer, boost::shared_ptr<T> > instances_;
+        #if defined(QL_ENABLE_SESSIONS)
+        static boost::mutex mutex_;
+        static boost::thread_specific_ptr<std::pair<Integer, T*> > cache_;
+        #endif
         #endif
         #if defined(QL_ENABLE_SESSIONS)
         Integer id = sessionId();
+        // instances are never removed, the cached one stays valid
+        std::pair<Integer, T*>* cached = cache_.get();
+        if (cached != 0 && cached->first == id)
+            return *cached->second;
+        boost::lock_guard<boost::mutex> lock(mutex_);
         #else
         Integer id = 0;
         #endif
         boost::shared_ptr<T>& instance = instances_[id];
         if (!instance)
             instance = boost::shared_ptr<T>(new T);
+        #if defined(QL_ENABLE_SESSIONS)
+        if (cached == 0)
+            cache_.reset(new std::pair<Integer, T*>(id, instance.get()));
+        else
+            *cached = std::make_pair(id, instance.get());
+        #endif
         return *instance;
     }
 
@@ -0,0 +1,56 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+#include <ql/patterns/threadsession.hpp>
+
+#if defined(QL_ENABLE_SESSIONS)
+
+#include <boost/thread/tss.hpp>
+
+namespace QuantLib {
+
+    namespace {
+
+        boost::thread_specific_ptr<Integer>& currentId() {
+            static boost::thread_specific_ptr<Integer> id;
+            return id;
+        }
+
+    }
+
+    ThreadSession::ThreadSession(Integer id) : previous_(ThreadSession::id()) {
+        boost::thread_specific_ptr<Integer>& current = currentId();
+        if (current.get() == 0)
+            current.reset(new Integer(id));
+        else
+            *current = id;
+    }
+
+    ThreadSession::~ThreadSession() {
+        *currentId() = previous_;
+    }
+
+    Integer ThreadSession::id() {
+        Integer* id = currentId().get();
+        return id == 0 ? 0 : *id;
+    }
+
+}
+
+#endif
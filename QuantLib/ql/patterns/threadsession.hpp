@@ -0,0 +1,90 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file threadsession.hpp
+    \brief thread-local session ids
+*/
+
+#ifndef quantlib_thread_session_hpp
+#define quantlib_thread_session_hpp
+
+#include <ql/types.hpp>
+#include <boost/noncopyable.hpp>
+
+#if defined(QL_ENABLE_SESSIONS)
+
+namespace QuantLib {
+
+    //! thread-local session ids
+    /*! This class provides a session id for each thread which can
+        be used to implement the sessionId() function required when
+        sessions are enabled, i.e.
+        \code
+        namespace QuantLib {
+            Integer sessionId() { return ThreadSession::id(); }
+        }
+        \endcode
+        A worker thread then enters its own session by creating an
+        instance of this class; as long as the instance is alive,
+        all singletons (in particular Settings and ObservableSettings)
+        accessed from that thread are the ones of the given session.
+        Therefore each worker can move its own evaluation date, and
+        the notifications are only sent to the observers that were
+        registered within the same session. The previous session id
+        of the thread is restored on destruction.
+
+        Threads which did not enter a session use the session id 0.
+        This includes the worker threads of OpenMP parallel regions,
+        which do not inherit the session of the thread starting them;
+        code running in a session must enter it again in the region,
+        as in
+        \code
+        Integer session = ThreadSession::id();
+        #pragma omp parallel for
+        for (Size i=0; i<n; ++i) {
+            ThreadSession threadSession(session);
+            ...
+        }
+        \endcode
+        The parallel regions of the library working on objects built
+        by the caller (e.g., bucketJacobian() and the
+        parallel recalculation in ObservableSettings::enableUpdates)
+        do so.
+
+        \warning objects must not be shared across sessions, since
+                 their observers are registered with the singletons
+                 of the session in which they were built.
+
+        \ingroup patterns
+    */
+    class ThreadSession : private boost::noncopyable {
+      public:
+        explicit ThreadSession(Integer id);
+        ~ThreadSession();
+        //! session id of the calling thread
+        static Integer id();
+      private:
+        Integer previous_;
+    };
+
+}
+
+#endif
+
+#endif
@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -226,6 +226,215 @@ namespace QuantLib {
             event0Time = std::max(
                 model_->termStructure()->timeFromReference(event0), 0.0);
 
+            // event date calculations are done for all states at once,
+            // the flows fixing on the event date are stored with the
+            // sign they enter the underlying npv
+
+            std::vector<Array> flows;
+            Array rebateValues, numeraires;
+
+            if (isEventDate) {
+
+                Array zk = event0 > expiry ? z : Array(1, y);
+
+                if (isLeg1Fixing) { // if event is a fixing date and
+                                    // exercise date,
+                    // the coupon is part of the exercise into right (by
+                    // definition)
+                    Size j = std::find(arguments_.leg1FixingDates.begin(),
+                                       arguments_.leg1FixingDates.end(),
+                                       event0) -
+                             arguments_.leg1FixingDates.begin();
+                    Real zSpreadDf =
+                        oas_.empty()
+                            ? 1.0
+                            : std::exp(-oas_->value() *
+                                       (model_->termStructure()
+                                            ->dayCounter()
+                                            .yearFraction(
+                                                 event0,
+                                                 arguments_.leg1PayDates[j])));
+                    bool done = false;
+                    do {
+                        Array df = model_->deflatedZerobond(
+                            arguments_.leg1PayDates[j], event0, zk,
+                            discountCurve_, discountCurve_);
+                        Array flow(zk.size());
+                        if (arguments_.leg1IsRedemptionFlow[j]) {
+                            for (Size k = 0; k < zk.size(); ++k)
+                                flow[k] = -(arguments_.leg1Coupons[j] * df[k] *
+                                            zSpreadDf);
+                        } else {
+                            Array estFixing(zk.size(), 0.0);
+                            if (ibor1 != NULL) {
+                                estFixing = model_->forwardRate(
+                                    arguments_.leg1FixingDates[j], event0, zk,
+                                    ibor1, adjusted_);
+                            }
+                            if (cms1 != NULL) {
+                                estFixing = model_->swapRate(
+                                    arguments_.leg1FixingDates[j],
+                                    cms1->tenor(), event0, zk, cms1,
+                                    adjusted_);
+                            }
+                            if (cmsspread1 != NULL)
+                                estFixing =
+                                    cmsspread1->gearing1() *
+                                        model_->swapRate(
+                                            arguments_.leg1FixingDates[j],
+                                            cmsspread1->swapIndex1()->tenor(),
+                                            event0, zk,
+                                            cmsspread1->swapIndex1(),
+                                            adjusted_) +
+                                    cmsspread1->gearing2() *
+                                        model_->swapRate(
+                                            arguments_.leg1FixingDates[j],
+                                            cmsspread1->swapIndex2()->tenor(),
+                                            event0, zk,
+                                            cmsspread1->swapIndex2(),
+                                            adjusted_);
+                            for (Size k = 0; k < zk.size(); ++k) {
+                                Real rate =
+                                    arguments_.leg1Spreads[j] +
+                                    arguments_.leg1Gearings[j] * estFixing[k];
+                                if (arguments_.leg1CappedRates[j] !=
+                                    Null<Real>())
+                                    rate = std::min(
+                                        arguments_.leg1CappedRates[j], rate);
+                                if (arguments_.leg1FlooredRates[j] !=
+                                    Null<Real>())
+                                    rate = std::max(
+                                        arguments_.leg1FlooredRates[j], rate);
+                                Real amount = rate * arguments_.nominal1[j] *
+                                              arguments_.leg1AccrualTimes[j];
+                                flow[k] = -(amount * df[k] * zSpreadDf);
+                            }
+                        }
+                        flows.push_back(flow);
+
+                        if (j < arguments_.leg1FixingDates.size() - 1) {
+                            j++;
+                            done = (event0 != arguments_.leg1FixingDates[j]);
+                        } else
+                            done = true;
+
+                    } while (!done);
+                }
+
+                if (isLeg2Fixing) { // if event is a fixing date and
+                                    // exercise date,
+                    // the coupon is part of the exercise into right (by
+                    // definition)
+                    Size j = std::find(arguments_.leg2FixingDates.begin(),
+                                       arguments_.leg2FixingDates.end(),
+                                       event0) -
+                             arguments_.leg2FixingDates.begin();
+                    Real zSpreadDf =
+                        oas_.empty()
+                            ? 1.0
+                            : std::exp(-oas_->value() *
+                                       (model_->termStructure()
+                                            ->dayCounter()
+                                            .yearFraction(
+                                                 event0,
+                                                 arguments_.leg2PayDates[j])));
+                    bool done;
+                    do {
+                        Array df = model_->deflatedZerobond(
+                            arguments_.leg2PayDates[j], event0, zk,
+                            discountCurve_, discountCurve_);
+                        Array flow(zk.size());
+                        if (arguments_.leg2IsRedemptionFlow[j]) {
+                            for (Size k = 0; k < zk.size(); ++k)
+                                flow[k] =
+                                    arguments_.leg2Coupons[j] * df[k] * zSpreadDf;
+                        } else {
+                            Array estFixing(zk.size(), 0.0);
+                            if (ibor2 != NULL)
+                                estFixing = model_->forwardRate(
+                                    arguments_.leg2FixingDates[j], event0, zk,
+                                    ibor2);
+                            if (cms2 != NULL)
+                                estFixing = model_->swapRate(
+                                    arguments_.leg2FixingDates[j],
+                                    cms2->tenor(), event0, zk, cms2);
+                            if (cmsspread2 != NULL)
+                                estFixing =
+                                    cmsspread2->gearing1() *
+                                        model_->swapRate(
+                                            arguments_.leg2FixingDates[j],
+                                            cmsspread2->swapIndex1()->tenor(),
+                                            event0, zk,
+                                            cmsspread2->swapIndex1()) +
+                                    cmsspread2->gearing2() *
+                                        model_->swapRate(
+                                            arguments_.leg2FixingDates[j],
+                                            cmsspread2->swapIndex2()->tenor(),
+                                            event0, zk,
+                                            cmsspread2->swapIndex2());
+                            for (Size k = 0; k < zk.size(); ++k) {
+                                Real rate =
+                                    arguments_.leg2Spreads[j] +
+                                    arguments_.leg2Gearings[j] * estFixing[k];
+                                if (arguments_.leg2CappedRates[j] !=
+                                    Null<Real>())
+                                    rate = std::min(
+                                        arguments_.leg2CappedRates[j], rate);
+                                if (arguments_.leg2FlooredRates[j] !=
+                                    Null<Real>())
+                                    rate = std::max(
+                                        arguments_.leg2FlooredRates[j], rate);
+                                Real amount = rate * arguments_.nominal2[j] *
+                                              arguments_.leg2AccrualTimes[j];
+                                flow[k] = amount * df[k] * zSpreadDf;
+                            }
+                        }
+                        flows.push_back(flow);
+
+                        if (j < arguments_.leg2FixingDates.size() - 1) {
+                            j++;
+                            done = (event0 != arguments_.leg2FixingDates[j]);
+                        } else
+                            done = true;
+
+                    } while (!done);
+                }
+
+                if (isExercise) {
+                    Size j = std::find(arguments_.exercise->dates().begin(),
+                                       arguments_.exercise->dates().end(),
+                                       event0) -
+                             arguments_.exercise->dates().begin();
+                    Real rebate = 0.0;
+                    Real zSpreadDf = 1.0;
+                    Date rebateDate = event0;
+                    if (rebatedExercise_ != NULL) {
+                        rebate = rebatedExercise_->rebate(j);
+                        rebateDate = rebatedExercise_->rebatePaymentDate(j);
+                        zSpreadDf =
+                            oas_.empty()
+                                ? 1.0
+                                : std::exp(-oas_->value() *
+                                           (model_->termStructure()
+                                                ->dayCounter()
+                                                .yearFraction(event0,
+                                                              rebateDate)));
+                    }
+                    rebateValues =
+                        rebate *
+                        model_->deflatedZerobond(rebateDate, event0, zk,
+                                                 discountCurve_,
+                                                 discountCurve_) *
+                        zSpreadDf;
+                    if (considerProbabilities && probabilities_ == Digital)
+                        numeraires = model_->numeraire(event0Time,
+                                                       event0 > expiry
+                                                           ? z
+                                                           : Array(1, z[0]),
+                                                       discountCurve_);
+                }
+            }
+
             // todo add openmp support later on (as in gaussian1dswaptionengine)
 
             for (Size k = 0; k < (event0 > expiry ? npv0.size() : 1); k++) {
@@ -437,199 +646,13 @@ namespace QuantLib {
 
                 if (isEventDate) {
 
-                    Real zk = event0 > expiry ? z[k] : y;
-
-                    if (isLeg1Fixing) { // if event is a fixing date and
-                                        // exercise date,
-                        // the coupon is part of the exercise into right (by
-                        // definition)
-                        Size j = std::find(arguments_.leg1FixingDates.begin(),
-                                           arguments_.leg1FixingDates.end(),
-                                           event0) -
-                                 arguments_.leg1FixingDates.begin();
-                        Real zSpreadDf =
-                            oas_.empty()
-                                ? 1.0
-                                : std::exp(
-                                      -oas_->value() *
-                                      (model_->termStructure()
-                                           ->dayCounter()
-                                           .yearFraction(
-                                                event0,
-                                                arguments_.leg1PayDates[j])));
-                        bool done = false;
-                        do {
-                            Real amount;
-                            if (arguments_.leg1IsRedemptionFlow[j]) {
-                                amount = arguments_.leg1Coupons[j];
-                            } else {
-                                Real estFixing = 0.0;
-                                if(ibor1 != NULL) {
-                                    estFixing = model_->forwardRate(
-                                        arguments_.leg1FixingDates[j], event0,
-                                        zk, ibor1, adjusted_);
-                                }
-                                if(cms1 != NULL) {
-                                    estFixing = model_->swapRate(
-                                        arguments_.leg1FixingDates[j],
-                                        cms1->tenor(), event0, zk, cms1,
-                                        adjusted_);
-                                }
-                                if (cmsspread1 != NULL)
-                                    estFixing =
-                                        cmsspread1->gearing1() *
-                                            model_->swapRate(
-                                                arguments_.leg1FixingDates[j],
-                                                cmsspread1->swapIndex1()
-                                                    ->tenor(),
-                                                event0, zk,
-                                                cmsspread1->swapIndex1(),
-                                                adjusted_) +
-                                        cmsspread1->gearing2() *
-                                            model_->swapRate(
-                                                arguments_.leg1FixingDates[j],
-                                                cmsspread1->swapIndex2()
-                                                    ->tenor(),
-                                                event0, zk,
-                                                cmsspread1->swapIndex2(),
-                                                adjusted_);
-                                Real rate =
-                                    arguments_.leg1Spreads[j] +
-                                    arguments_.leg1Gearings[j] * estFixing;
-                                if (arguments_.leg1CappedRates[j] !=
-                                    Null<Real>())
-                                    rate = std::min(
-                                        arguments_.leg1CappedRates[j], rate);
-                                if (arguments_.leg1FlooredRates[j] !=
-                                    Null<Real>())
-                                    rate = std::max(
-                                        arguments_.leg1FlooredRates[j], rate);
-                                amount = rate * arguments_.nominal1[j] *
-                                         arguments_.leg1AccrualTimes[j];
-                            }
-
-                            npv0a[k] -= amount *
-                                        model_->deflatedZerobond(
-                                            arguments_.leg1PayDates[j], event0,
-                                            zk, discountCurve_, discountCurve_) *
-                                        zSpreadDf;
-
-                            if (j < arguments_.leg1FixingDates.size() - 1) {
-                                j++;
-                                done =
-                                    (event0 != arguments_.leg1FixingDates[j]);
-                            } else
-                                done = true;
-
-                        } while (!done);
-                    }
-
-                    if (isLeg2Fixing) { // if event is a fixing date and
-                                        // exercise date,
-                        // the coupon is part of the exercise into right (by
-                        // definition)
-                        Size j = std::find(arguments_.leg2FixingDates.begin(),
-                                           arguments_.leg2FixingDates.end(),
-                                           event0) -
-                                 arguments_.leg2FixingDates.begin();
-                        Real zSpreadDf =
-                            oas_.empty()
-                                ? 1.0
-                                : std::exp(
-                                      -oas_->value() *
-                                      (model_->termStructure()
-                                           ->dayCounter()
-                                           .yearFraction(
-                                                event0,
-                                                arguments_.leg2PayDates[j])));
-                        bool done;
-                        do {
-                            Real amount;
-                            if (arguments_.leg2IsRedemptionFlow[j]) {
-                                amount = arguments_.leg2Coupons[j];
-                            } else {
-                                Real estFixing = 0.0;
-                                if(ibor2 != NULL)
-                                    estFixing = model_->forwardRate(
-                                        arguments_.leg2FixingDates[j], event0,
-                                        zk, ibor2);
-                                if(cms2 != NULL)
-                                    estFixing = model_->swapRate(
-                                        arguments_.leg2FixingDates[j],
-                                        cms2->tenor(), event0, zk, cms2);
-                                if (cmsspread2 != NULL)
-                                    estFixing =
-                                        cmsspread2->gearing1() *
-                                            model_->swapRate(
-                                                arguments_.leg2FixingDates[j],
-                                                cmsspread2->swapIndex1()
-                                                    ->tenor(),
-                                                event0, zk,
-                                                cmsspread2->swapIndex1()) +
-                                        cmsspread2->gearing2() *
-                                            model_->swapRate(
-                                                arguments_.leg2FixingDates[j],
-                                                cmsspread2->swapIndex2()
-                                                    ->tenor(),
-                                                event0, zk,
-                                                cmsspread2->swapIndex2());
-                                Real rate =
-                                    arguments_.leg2Spreads[j] +
-                                    arguments_.leg2Gearings[j] * estFixing;
-                                if (arguments_.leg2CappedRates[j] !=
-                                    Null<Real>())
-                                    rate = std::min(
-                                        arguments_.leg2CappedRates[j], rate);
-                                if (arguments_.leg2FlooredRates[j] !=
-                                    Null<Real>())
-                                    rate = std::max(
-                                        arguments_.leg2FlooredRates[j], rate);
-                                amount = rate * arguments_.nominal2[j] *
-                                         arguments_.leg2AccrualTimes[j];
-                            }
-
-                            npv0a[k] += amount *
-                                        model_->deflatedZerobond(
-                                            arguments_.leg2PayDates[j], event0,
-                                            zk, discountCurve_, discountCurve_) *
-                                        zSpreadDf;
-                            if (j < arguments_.leg2FixingDates.size() - 1) {
-                                j++;
-                                done =
-                                    (event0 != arguments_.leg2FixingDates[j]);
-                            } else
-                                done = true;
-
-                        } while (!done);
-                    }
+                    for (Size f = 0; f < flows.size(); ++f)
+                        npv0a[k] += flows[f][k];
 
                     if (isExercise) {
-                        Size j = std::find(arguments_.exercise->dates().begin(),
-                                           arguments_.exercise->dates().end(),
-                                           event0) -
-                                 arguments_.exercise->dates().begin();
-                        Real rebate = 0.0;
-                        Real zSpreadDf = 1.0;
-                        Date rebateDate = event0;
-                        if (rebatedExercise_ != NULL) {
-                            rebate = rebatedExercise_->rebate(j);
-                            rebateDate = rebatedExercise_->rebatePaymentDate(j);
-                            zSpreadDf =
-                                oas_.empty()
-                                    ? 1.0
-                                    : std::exp(-oas_->value() *
-                                               (model_->termStructure()
-                                                    ->dayCounter()
-                                                    .yearFraction(event0,
-                                                                  rebateDate)));
-                        }
                         Real exerciseValue =
                             (type == Option::Call ? 1.0 : -1.0) * npv0a[k] +
-                            rebate *
-                                model_->deflatedZerobond(rebateDate, event0, zk,
-                                                         discountCurve_,
-                                                         discountCurve_) *
-                                zSpreadDf;
+                            rebateValues[k];
 
                         if (considerProbabilities && probabilities_ != None) {
                             if (exIdx == noEx) {
@@ -642,9 +665,7 @@ namespace QuantLib {
                                         : 1.0 / (model_->zerobond(
                                                      event0Time, 0.0, 0.0,
                                                      discountCurve_) *
-                                                 model_->numeraire(
-                                                     event0, z[k],
-                                                     discountCurve_));
+                                                 numeraires[k]);
                             }
                             if (exerciseValue >= npv0[k]) {
                                 npvp0[exIdx-1][k] =
@@ -653,9 +674,7 @@ namespace QuantLib {
                                         : 1.0 / (model_->zerobond(
                                                      event0Time, 0.0, 0.0,
                                                      discountCurve_) *
-                                                 model_->numeraire(
-                                                     event0Time, z[k],
-                                                     discountCurve_));
+                                                 numeraires[k]);
                                 for (Size ii = exIdx; ii < noEx+1; ++ii)
                                     npvp0[ii][k] = 0.0;
                             }
@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -155,6 +155,41 @@ namespace QuantLib {
                              arguments_.exercise->dates().end(), settlement) -
             arguments_.exercise->dates().begin());
 
+        // register the times the model is evaluated on, i.e. the
+        // exercise times, the payment times and the forward rate
+        // periods, this has to be done on each calculation, since
+        // the registration is lost when the model parameters change
+
+        std::vector<Time> times;
+        std::vector<Date> dates(arguments_.exercise->dates().begin() +
+                                    minIdxAlive,
+                                arguments_.exercise->dates().end());
+        dates.insert(dates.end(), arguments_.fixedPayDates.begin(),
+                     arguments_.fixedPayDates.end());
+        dates.insert(dates.end(), arguments_.floatingPayDates.begin(),
+                     arguments_.floatingPayDates.end());
+        boost::shared_ptr<IborIndex> iborIdx = arguments_.swap->iborIndex();
+        for (Size l = 0; l < arguments_.floatingFixingDates.size(); ++l) {
+            if (arguments_.floatingIsRedemptionFlow[l])
+                continue;
+            Date valueDate =
+                iborIdx->valueDate(arguments_.floatingFixingDates[l]);
+            dates.push_back(valueDate);
+            dates.push_back(iborIdx->fixingCalendar().advance(
+                valueDate, iborIdx->tenor(), iborIdx->businessDayConvention(),
+                iborIdx->endOfMonth()));
+        }
+        if (rebatedExercise != NULL) {
+            for (Size i = minIdxAlive; i <= static_cast<Size>(idx); ++i)
+                dates.push_back(rebatedExercise->rebatePaymentDate(i));
+        }
+        for (Size i = 0; i < dates.size(); ++i) {
+            if (dates[i] > settlement)
+                times.push_back(
+                    model_->termStructure()->timeFromReference(dates[i]));
+        }
+        model_->registerTimes(times);
+
         NonstandardSwap swap = *arguments_.swap;
         Option::Type type =
             arguments_.type == VanillaSwap::Payer ? Option::Call : Option::Put;
@@ -199,6 +234,89 @@ namespace QuantLib {
                                  floatSchedule.dates().end(), expiry0 - 1) -
                 floatSchedule.dates().begin();
 
+            // the exercise values (and the numeraire needed for the
+            // probabilities) are computed for the whole grid at once
+
+            Array exerciseValues, numeraires;
+            if (expiry0 > settlement) {
+                Array floatingLegNpv(z.size(), 0.0);
+                for (Size l = k1; l < arguments_.floatingCoupons.size(); l++) {
+                    Real zSpreadDf =
+                        oas_.empty()
+                            ? 1.0
+                            : std::exp(-oas_->value() *
+                                       (model_->termStructure()
+                                            ->dayCounter()
+                                            .yearFraction(
+                                                 expiry0,
+                                                 arguments_
+                                                     .floatingPayDates[l])));
+                    Array df = model_->deflatedZerobond(
+                        arguments_.floatingPayDates[l], expiry0, z,
+                        discountCurve_, discountCurve_);
+                    if (arguments_.floatingIsRedemptionFlow[l]) {
+                        for (Size k = 0; k < z.size(); k++)
+                            floatingLegNpv[k] += arguments_.floatingCoupons[l] *
+                                                 df[k] * zSpreadDf;
+                    } else {
+                        Array fwd = model_->forwardRate(
+                            arguments_.floatingFixingDates[l], expiry0, z,
+                            arguments_.swap->iborIndex());
+                        for (Size k = 0; k < z.size(); k++)
+                            floatingLegNpv[k] +=
+                                arguments_.floatingNominal[l] *
+                                arguments_.floatingAccrualTimes[l] *
+                                (arguments_.floatingGearings[l] * fwd[k] +
+                                 arguments_.floatingSpreads[l]) *
+                                df[k] * zSpreadDf;
+                    }
+                }
+                Array fixedLegNpv(z.size(), 0.0);
+                for (Size l = j1; l < arguments_.fixedCoupons.size(); l++) {
+                    Real zSpreadDf =
+                        oas_.empty()
+                            ? 1.0
+                            : std::exp(-oas_->value() *
+                                       (model_->termStructure()
+                                            ->dayCounter()
+                                            .yearFraction(
+                                                 expiry0,
+                                                 arguments_.fixedPayDates[l])));
+                    Array df = model_->deflatedZerobond(
+                        arguments_.fixedPayDates[l], expiry0, z,
+                        discountCurve_, discountCurve_);
+                    for (Size k = 0; k < z.size(); k++)
+                        fixedLegNpv[k] +=
+                            arguments_.fixedCoupons[l] * df[k] * zSpreadDf;
+                }
+                Real rebate = 0.0;
+                Real zSpreadDf = 1.0;
+                Date rebateDate = expiry0;
+                if (rebatedExercise != NULL) {
+                    rebate = rebatedExercise->rebate(idx);
+                    rebateDate = rebatedExercise->rebatePaymentDate(idx);
+                    zSpreadDf =
+                        oas_.empty()
+                            ? 1.0
+                            : std::exp(-oas_->value() *
+                                       (model_->termStructure()
+                                            ->dayCounter()
+                                            .yearFraction(expiry0,
+                                                          rebateDate)));
+                }
+                Array rebateDf = model_->deflatedZerobond(
+                    rebateDate, expiry0, z, discountCurve_, discountCurve_);
+                exerciseValues = Array(z.size());
+                for (Size k = 0; k < z.size(); k++)
+                    exerciseValues[k] =
+                        (type == Option::Call ? 1.0 : -1.0) *
+                            (floatingLegNpv[k] - fixedLegNpv[k]) +
+                        rebate * rebateDf[k] * zSpreadDf;
+                if (probabilities_ == Digital)
+                    numeraires =
+                        model_->numeraire(expiry0Time, z, discountCurve_);
+            }
+
             // todo add openmp support later on (as in gaussian1dswaptionengine)
 
             for (Size k = 0; k < (expiry0 > settlement ? npv0.size() : 1);
@@ -361,81 +479,7 @@ namespace QuantLib {
                 // end probability computation
 
                 if (expiry0 > settlement) {
-                    Real floatingLegNpv = 0.0;
-                    for (Size l = k1; l < arguments_.floatingCoupons.size();
-                         l++) {
-                        Real zSpreadDf =
-                            oas_.empty()
-                                ? 1.0
-                                : std::exp(
-                                      -oas_->value() *
-                                      (model_->termStructure()
-                                           ->dayCounter()
-                                           .yearFraction(
-                                                expiry0,
-                                                arguments_
-                                                    .floatingPayDates[l])));
-                        Real amount;
-                        if (arguments_.floatingIsRedemptionFlow[l])
-                            amount = arguments_.floatingCoupons[l];
-                        else
-                            amount = arguments_.floatingNominal[l] *
-                                     arguments_.floatingAccrualTimes[l] *
-                                     (arguments_.floatingGearings[l] *
-                                          model_->forwardRate(
-                                              arguments_.floatingFixingDates[l],
-                                              expiry0, z[k],
-                                              arguments_.swap->iborIndex()) +
-                                      arguments_.floatingSpreads[l]);
-                        floatingLegNpv +=
-                            amount *
-                            model_->deflatedZerobond(
-                                arguments_.floatingPayDates[l], expiry0, z[k],
-                                discountCurve_, discountCurve_) *
-                            zSpreadDf;
-                    }
-                    Real fixedLegNpv = 0.0;
-                    for (Size l = j1; l < arguments_.fixedCoupons.size(); l++) {
-                        Real zSpreadDf =
-                            oas_.empty()
-                                ? 1.0
-                                : std::exp(
-                                      -oas_->value() *
-                                      (model_->termStructure()
-                                           ->dayCounter()
-                                           .yearFraction(
-                                                expiry0,
-                                                arguments_.fixedPayDates[l])));
-                        fixedLegNpv +=
-                            arguments_.fixedCoupons[l] *
-                            model_->deflatedZerobond(
-                                arguments_.fixedPayDates[l], expiry0, z[k],
-                                discountCurve_, discountCurve_) *
-                            zSpreadDf;
-                    }
-                    Real rebate = 0.0;
-                    Real zSpreadDf = 1.0;
-                    Date rebateDate = expiry0;
-                    if (rebatedExercise != NULL) {
-                        rebate = rebatedExercise->rebate(idx);
-                        rebateDate = rebatedExercise->rebatePaymentDate(idx);
-                        zSpreadDf =
-                            oas_.empty()
-                                ? 1.0
-                                : std::exp(
-                                      -oas_->value() *
-                                      (model_->termStructure()
-                                           ->dayCounter()
-                                           .yearFraction(expiry0, rebateDate)));
-                    }
-                    Real exerciseValue =
-                        ((type == Option::Call ? 1.0 : -1.0) *
-                             (floatingLegNpv - fixedLegNpv) +
-                         rebate *
-                             model_->deflatedZerobond(rebateDate, expiry0, z[k],
-                                                      discountCurve_,
-                                                      discountCurve_) *
-                             zSpreadDf);
+                    Real exerciseValue = exerciseValues[k];
                     // for probability computation
                     if (probabilities_ != None) {
                         if (idx == static_cast<int>(
@@ -449,8 +493,7 @@ namespace QuantLib {
                                     : 1.0 / (model_->zerobond(expiry0Time, 0.0,
                                                               0.0,
                                                               discountCurve_) *
-                                             model_->numeraire(expiry0, z[k],
-                                                               discountCurve_));
+                                             numeraires[k]);
                         if (exerciseValue >= npv0[k]) {
                             npvp0[idx - minIdxAlive][k] =
                                 probabilities_ == Naive
@@ -459,8 +502,7 @@ namespace QuantLib {
                                           (model_->zerobond(expiry0Time, 0.0,
                                                             0.0,
                                                             discountCurve_) *
-                                           model_->numeraire(expiry0Time, z[k],
-                                                             discountCurve_));
+                                           numeraires[k]);
                             for (Size ii = idx - minIdxAlive + 1;
                                  ii < npvp0.size(); ii++)
                                 npvp0[ii][k] = 0.0;
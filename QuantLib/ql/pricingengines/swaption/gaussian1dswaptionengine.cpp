@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -18,11 +18,19 @@
 */
 
 #include <ql/pricingengines/swaption/gaussian1dswaptionengine.hpp>
+#include <ql/models/shortrate/onefactormodels/gaussian1dmodelsnapshot.hpp>
 #include <ql/math/interpolations/cubicinterpolation.hpp>
 #include <ql/payoff.hpp>
+#include <boost/make_shared.hpp>
 
 namespace QuantLib {
 
+    void Gaussian1dSwaptionEngine::update() {
+        snapshot_.reset();
+        GenericModelEngine<Gaussian1dModel, Swaption::arguments,
+                           Swaption::results>::update();
+    }
+
     void Gaussian1dSwaptionEngine::calculate() const {
 
         QL_REQUIRE(arguments_.settlementType == Settlement::Physical,
@@ -66,6 +74,98 @@ namespace QuantLib {
         }
         // end probabkility computation
 
+        // the model is evaluated on a snapshot, which can be queried
+        // concurrently in the parallelized loop below (the lazy object
+        // recalculation and the caching in gsrprocess are not thread
+        // safe). Curve 1 is the discount curve; the forwarding curve
+        // enters through deterministic adjustments of the model curve's
+        // forwards, so that the snapshot does not depend on it and can
+        // be reused as long as the model and discount curve do not
+        // change.
+
+        boost::shared_ptr<IborIndex> iborIndex = arguments_.swap->iborIndex();
+        Date evaluationDate = Settings::instance().evaluationDate();
+        bool enforcesTodaysHistoricFixings =
+            Settings::instance().enforcesTodaysHistoricFixings();
+
+        std::vector<Time> times, stateTimes;
+        for (Size i = minIdxAlive; i < arguments_.exercise->dates().size();
+             i++) {
+            stateTimes.push_back(model_->termStructure()->timeFromReference(
+                arguments_.exercise->dates()[i]));
+        }
+
+        Date firstExercise = arguments_.exercise->dates()[minIdxAlive];
+        Size jMin = std::upper_bound(fixedSchedule.dates().begin(),
+                                     fixedSchedule.dates().end(),
+                                     firstExercise - 1) -
+                    fixedSchedule.dates().begin();
+        Size kMin = std::upper_bound(floatSchedule.dates().begin(),
+                                     floatSchedule.dates().end(),
+                                     firstExercise - 1) -
+                    floatSchedule.dates().begin();
+
+        std::vector<Time> fixedPayTimes(arguments_.fixedCoupons.size());
+        for (Size l = jMin; l < arguments_.fixedCoupons.size(); l++) {
+            fixedPayTimes[l] = model_->termStructure()->timeFromReference(
+                arguments_.fixedPayDates[l]);
+            times.push_back(fixedPayTimes[l]);
+        }
+
+        Size nFloating = arguments_.floatingCoupons.size();
+        std::vector<Time> floatingPayTimes(nFloating),
+            floatingValueTimes(nFloating), floatingEndTimes(nFloating);
+        std::vector<Real> floatingDcf(nFloating),
+            floatingFixings(nFloating, Null<Real>()),
+            floatingAdjustments(nFloating, 1.0);
+        Handle<YieldTermStructure> forwardingCurve =
+            iborIndex->forwardingTermStructure();
+        for (Size l = kMin; l < nFloating; l++) {
+            floatingPayTimes[l] = model_->termStructure()->timeFromReference(
+                arguments_.floatingPayDates[l]);
+            times.push_back(floatingPayTimes[l]);
+            Date fixing = arguments_.floatingFixingDates[l];
+            if (fixing <=
+                (evaluationDate + (enforcesTodaysHistoricFixings ? 0 : -1))) {
+                floatingFixings[l] = iborIndex->fixing(fixing);
+            } else {
+                Date valueDate = iborIndex->valueDate(fixing);
+                Date endDate = iborIndex->fixingCalendar().advance(
+                    valueDate, iborIndex->tenor(),
+                    iborIndex->businessDayConvention(),
+                    iborIndex->endOfMonth());
+                floatingDcf[l] =
+                    iborIndex->dayCounter().yearFraction(valueDate, endDate);
+                floatingValueTimes[l] =
+                    model_->termStructure()->timeFromReference(valueDate);
+                floatingEndTimes[l] =
+                    model_->termStructure()->timeFromReference(endDate);
+                times.push_back(floatingValueTimes[l]);
+                times.push_back(floatingEndTimes[l]);
+                if (!forwardingCurve.empty())
+                    floatingAdjustments[l] =
+                        forwardingCurve->discount(floatingValueTimes[l],
+                                                  true) /
+                        forwardingCurve->discount(floatingEndTimes[l], true) *
+                        model_->termStructure()->discount(
+                            floatingEndTimes[l], true) /
+                        model_->termStructure()->discount(
+                            floatingValueTimes[l], true);
+            }
+        }
+
+        if (!snapshot_ || times != snapshotTimes_ ||
+            stateTimes != snapshotStateTimes_) {
+            std::vector<Handle<YieldTermStructure> > curves(1,
+                                                            discountCurve_);
+            snapshot_ = boost::make_shared<Gaussian1dModelSnapshot>(
+                model_.currentLink(), times, stateTimes, curves, stddevs_,
+                integrationPoints_);
+            snapshotTimes_ = times;
+            snapshotStateTimes_ = stateTimes;
+        }
+        const Gaussian1dModelSnapshot& snapshot = *snapshot_;
+
         Date expiry1 = Null<Date>(), expiry0;
         Time expiry1Time = Null<Real>(), expiry0Time;
 
@@ -88,41 +188,15 @@ namespace QuantLib {
                                  floatSchedule.dates().end(), expiry0 - 1) -
                 floatSchedule.dates().begin();
 
-            // a lazy object is not thread safe, neither is the caching
-            // in gsrprocess. therefore we trigger computations here such
-            // that neither lazy object recalculation nor write access
-            // during caching occurs in the parallized loop below.
-            // this is known to work for the gsr and markov functional
-            // model implementations of Gaussian1dModel
-#ifdef _OPENMP
-            if (expiry1Time != Null<Real>())
-                model_->yGrid(stddevs_, integrationPoints_, expiry1Time,
-                              expiry0Time, 0.0);
-            if (expiry0 > settlement) {
-                for (Size l = k1; l < arguments_.floatingCoupons.size(); l++) {
-                    model_->forwardRate(arguments_.floatingFixingDates[l],
-                                        expiry0, 0.0,
-                                        arguments_.swap->iborIndex());
-                    model_->zerobond(arguments_.floatingPayDates[l], expiry0,
-                                     0.0, discountCurve_);
-                }
-                for (Size l = j1; l < arguments_.fixedCoupons.size(); l++) {
-                    model_->zerobond(arguments_.fixedPayDates[l], expiry0, 0.0,
-                                     discountCurve_);
-                }
-                model_->numeraire(expiry0Time, 0.0, discountCurve_);
-            }
-#endif
-
 #pragma omp parallel for default(shared) firstprivate(p) if(expiry0>settlement)
             for (Size k = 0; k < (expiry0 > settlement ? npv0.size() : 1);
                  k++) {
 
                 Real price = 0.0;
                 if (expiry1Time != Null<Real>()) {
-                    Array yg = model_->yGrid(stddevs_, integrationPoints_,
-                                             expiry1Time, expiry0Time,
-                                             expiry0 > settlement ? z[k] : 0.0);
+                    Array yg = snapshot.yGrid(
+                        stddevs_, integrationPoints_, expiry1Time, expiry0Time,
+                        expiry0 > settlement ? z[k] : 0.0);
                     CubicInterpolation payoff0(
                         z.begin(), z.end(), npv1.begin(),
                         CubicInterpolation::Spline, true,
@@ -178,7 +252,7 @@ namespace QuantLib {
                     for (Size m = 0; m < npvp0.size(); m++) {
                         Real price = 0.0;
                         if (expiry1Time != Null<Real>()) {
-                            Array yg = model_->yGrid(
+                            Array yg = snapshot.yGrid(
                                 stddevs_, integrationPoints_, expiry1Time,
                                 expiry0Time, expiry0 > settlement ? z[k] : 0.0);
                             CubicInterpolation payoff0(
@@ -256,24 +330,27 @@ namespace QuantLib {
                     Real floatingLegNpv = 0.0;
                     for (Size l = k1; l < arguments_.floatingCoupons.size();
                          l++) {
+                        Real forward = floatingFixings[l];
+                        if (forward == Null<Real>())
+                            forward = (snapshot.zerobond(floatingValueTimes[l],
+                                                         expiry0Time, z[k]) /
+                                       snapshot.zerobond(floatingEndTimes[l],
+                                                         expiry0Time, z[k]) *
+                                       floatingAdjustments[l] - 1.0) /
+                                      floatingDcf[l];
                         floatingLegNpv +=
                             arguments_.nominal *
                             arguments_.floatingAccrualTimes[l] *
-                            (arguments_.floatingSpreads[l] +
-                             model_->forwardRate(
-                                 arguments_.floatingFixingDates[l], expiry0,
-                                 z[k], arguments_.swap->iborIndex())) *
-                            model_->deflatedZerobond(
-                                arguments_.floatingPayDates[l], expiry0, z[k],
-                                discountCurve_, discountCurve_);
+                            (arguments_.floatingSpreads[l] + forward) *
+                            snapshot.deflatedZerobond(floatingPayTimes[l],
+                                                      expiry0Time, z[k], 1, 1);
                     }
                     Real fixedLegNpv = 0.0;
                     for (Size l = j1; l < arguments_.fixedCoupons.size(); l++) {
                         fixedLegNpv +=
                             arguments_.fixedCoupons[l] *
-                            model_->deflatedZerobond(
-                                arguments_.fixedPayDates[l], expiry0, z[k],
-                                discountCurve_, discountCurve_);
+                            snapshot.deflatedZerobond(fixedPayTimes[l],
+                                                      expiry0Time, z[k], 1, 1);
                     }
                     Real exerciseValue =
                         (type == Option::Call ? 1.0 : -1.0) *
@@ -289,21 +366,19 @@ namespace QuantLib {
                             npvp0.back()[k] =
                                 probabilities_ == Naive
                                     ? 1.0
-                                    : 1.0 / (model_->zerobond(expiry0Time, 0.0,
-                                                              0.0,
-                                                              discountCurve_) *
-                                             model_->numeraire(expiry0, z[k],
-                                                               discountCurve_));
+                                    : 1.0 / (snapshot.zerobond(expiry0Time,
+                                                               0.0, 0.0, 1) *
+                                             snapshot.numeraire(expiry0Time,
+                                                                z[k], 1));
                         if (exerciseValue >= npv0[k]) {
                             npvp0[idx - minIdxAlive][k] =
                                 probabilities_ == Naive
                                     ? 1.0
                                     : 1.0 /
-                                          (model_->zerobond(expiry0Time, 0.0,
-                                                            0.0,
-                                                            discountCurve_) *
-                                           model_->numeraire(expiry0Time, z[k],
-                                                             discountCurve_));
+                                          (snapshot.zerobond(expiry0Time, 0.0,
+                                                             0.0, 1) *
+                                           snapshot.numeraire(expiry0Time,
+                                                              z[k], 1));
                             for (Size ii = idx - minIdxAlive + 1;
                                  ii < npvp0.size(); ii++)
                                 npvp0[ii][k] = 0.0;
@@ -329,7 +404,7 @@ namespace QuantLib {
 
         } while (--idx >= minIdxAlive - 1);
 
-        results_.value = npv1[0] * model_->numeraire(0.0, 0.0, discountCurve_);
+        results_.value = npv1[0] * snapshot.numeraire(0.0, 0.0, 1);
 
         // for probability computation
         if (probabilities_ != None) {
@@ -338,7 +413,7 @@ namespace QuantLib {
                 prob[i] = npvp1[i][0] *
                           (probabilities_ == Naive
                                ? 1.0
-                               : model_->numeraire(0.0, 0.0, discountCurve_));
+                               : snapshot.numeraire(0.0, 0.0, 1));
             }
             results_.additionalResults["probabilities"] = prob;
         }
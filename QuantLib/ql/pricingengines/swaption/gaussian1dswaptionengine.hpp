@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -26,7 +26,7 @@
 
 #include <ql/instruments/swaption.hpp>
 #include <ql/pricingengines/genericmodelengine.hpp>
-#include <ql/models/shortrate/onefactormodels/gaussian1dmodel.hpp>
+#include <ql/models/shortrate/onefactormodels/gaussian1dmodelsnapshot.hpp>
 
 namespace QuantLib {
 
@@ -37,6 +37,11 @@ namespace QuantLib {
         option expiry are considered to be
         part of the exercise into right.
 
+        The model is evaluated on a Gaussian1dModelSnapshot, which is
+        kept between calculations and only rebuilt when the model or
+        the discount curve notify a change or when a swaption needs
+        other times.
+
         \warning Cash settled swaptions are not supported
     */
 
@@ -70,6 +75,7 @@ namespace QuantLib {
         }
 
         void calculate() const;
+        void update();
 
       private:
         const int integrationPoints_;
@@ -77,6 +83,8 @@ namespace QuantLib {
         const bool extrapolatePayoff_, flatPayoffExtrapolation_;
         const Handle<YieldTermStructure> discountCurve_;
         const Probabilities probabilities_;
+        mutable boost::shared_ptr<Gaussian1dModelSnapshot> snapshot_;
+        mutable std::vector<Time> snapshotTimes_, snapshotStateTimes_;
     };
 }
 
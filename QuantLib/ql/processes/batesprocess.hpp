@@ -61,6 +61,11 @@ namespace QuantLib {
         Disposable<Array> drift(Time t, const Array& x) const;
         Disposable<Array> evolve(Time t0, const Array& x0,
                                  Time dt, const Array& dw) const;
+        //! evolves the paths one by one, including the jumps
+        void evolveBlock(Time t0, const Matrix& x0, Time dt,
+                         const Matrix& dw, Matrix& x) const {
+            StochasticProcess::evolveBlock(t0, x0, dt, dw, x);
+        }
 
         Real lambda() const;
         Real nu()     const;
@@ -76,6 +76,10 @@ namespace QuantLib {
         Real stdDeviation(Time t0, Real x0, Time dt) const;
         Real variance(Time t0, Real x0, Time dt) const;
         Real evolve(Time t0, Real x0, Time dt, Real dw) const;
+        /*! for strike independent volatilities the drift and variance
+            are computed once for the whole block */
+        void evolveBlock(Time t0, const Real* x0, Time dt,
+                         const Real* dw, Real* x, Size n) const;
         //@}
         Time time(const Date&) const;
         //! \name Observer interface
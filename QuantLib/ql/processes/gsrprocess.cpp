@@ -75,6 +75,20 @@ namespace QuantLib {
         return core_.variance(w,dt);
     }
 
+    void GsrProcess::evolveBlock(Time t0, const Real* x0, Time dt,
+                                 const Real* dw, Real* x, Size n) const {
+        checkT(t0 + dt);
+        // the conditional expectation is affine in the initial state and
+        // the variance does not depend on it, so that all cache lookups
+        // can be done once for the whole block
+        Real a = core_.expectation_x0dep_part(t0, 1.0, dt);
+        Real b = core_.expectation_rn_part(t0, dt);
+        Real c = core_.expectation_tf_part(t0, dt);
+        Real s = std::sqrt(core_.variance(t0, dt));
+        for (Size j = 0; j < n; ++j)
+            x[j] = x0[j] * a + b + c + s * dw[j];
+    }
+
     Real GsrProcess::sigma(Time t) const { return core_.sigma(t); }
 
     Real GsrProcess::reversion(Time t) const { return core_.reversion(t); }
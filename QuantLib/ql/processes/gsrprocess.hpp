@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2013, 2015 Peter Caspers
+ Copyright (C) 2013, 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -50,6 +50,8 @@ namespace QuantLib {
         Real expectation(Time t0, Real x0, Time dt) const;
         Real stdDeviation(Time t0, Real x0, Time dt) const;
         Real variance(Time t0, Real, Time dt) const;
+        void evolveBlock(Time t0, const Real* x0, Time dt,
+                         const Real* dw, Real* x, Size n) const;
         Real time(const Date& d) const;
         //@}
         //! \name ForwardMeasureProcess1D interface
@@ -68,6 +70,13 @@ namespace QuantLib {
         Real G(Time t, Time T, Real x) const;
         //! reset cache
         void flushCache() const;
+        /*! fill the cache for all pairs of the given times, after
+            that the process does not modify its cache any more and
+            can be evaluated from several threads concurrently (results
+            for other times are computed without caching) */
+        void precompute(const std::vector<Time>& times) const;
+        //! the times registered by precompute(), sorted
+        const std::vector<Time>& precomputedTimes() const;
 
       private:
         void checkT(const Time t) const;
@@ -87,6 +96,14 @@ namespace QuantLib {
         core_.flushCache();
     }
 
+    inline void GsrProcess::precompute(const std::vector<Time>& times) const {
+        core_.precompute(times);
+    }
+
+    inline const std::vector<Time>& GsrProcess::precomputedTimes() const {
+        return core_.precomputedTimes();
+    }
+
 } // namesapce QuantLib
 
 #endif
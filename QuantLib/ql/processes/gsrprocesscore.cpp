@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -18,16 +18,30 @@
 */
 
 #include <ql/processes/gsrprocesscore.hpp>
+#include <ql/utilities/null.hpp>
+#include <algorithm>
 
 namespace QuantLib {
 
 namespace detail {
 
+namespace {
+
+// position of (i,j), i <= j, in an n x n upper triangular table
+Size triangularIndex(const Size i, const Size j, const Size n) {
+    return i * n - i * (i + 1) / 2 + j;
+}
+
+bool closeTimes(const Time a, const Time b) { return close_enough(a, b); }
+
+} // anonymous namespace
+
 GsrProcessCore::GsrProcessCore(const Array &times, const Array &vols,
                                const Array &reversions, const Array &adjusters,
                                const Real T)
     : times_(times), vols_(vols), reversions_(reversions),
-      adjusters_(adjusters), T_(T), revZero_(reversions.size(), false) {
+      adjusters_(adjusters), T_(T),
+      revZero_(reversions.size(), false) {
 
     QL_REQUIRE(times.size() == vols.size() - 1,
                "number of volatilities ("
@@ -58,6 +72,13 @@ void GsrProcessCore::flushCache() const {
             revZero_[i] = true;
         else
             revZero_[i] = false;
+    grid_.clear();
+    std::vector<Real>().swap(grid1_);
+    std::vector<Real>().swap(grid2a_);
+    std::vector<Real>().swap(grid2b_);
+    std::vector<Real>().swap(grid3_);
+    std::vector<Real>().swap(grid4_);
+    std::vector<Real>().swap(grid5_);
     cache1_.clear();
     cache2a_.clear();
     cache2b_.clear();
@@ -66,34 +87,119 @@ void GsrProcessCore::flushCache() const {
     cache5_.clear();
 }
 
+void GsrProcessCore::precompute(const std::vector<Time> &times) const {
+    std::vector<Time> grid(times);
+    std::sort(grid.begin(), grid.end());
+    grid.erase(std::unique(grid.begin(), grid.end(), closeTimes), grid.end());
+    // the tables are still valid if the same grid is registered again,
+    // flushCache() clears the grid when the parameters change
+    if (!grid_.empty() && grid == grid_)
+        return;
+    grid_.swap(grid);
+    Size n = grid_.size(), m = n * (n + 1) / 2;
+    grid1_.resize(m);
+    grid2a_.resize(m);
+    grid2b_.resize(m);
+    grid3_.resize(m);
+    grid4_.resize(n);
+    grid5_.resize(m);
+    for (Size i = 0; i < n; ++i) {
+        Time w = grid_[i];
+        grid4_[i] = computeY(w);
+        for (Size j = i; j < n; ++j) {
+            // same arithmetic as in a lookup with dt = t_j - t_i
+            Time t = w + (grid_[j] - w);
+            Size k = triangularIndex(i, j, n);
+            grid1_[k] = computeExpectation_x0dep(w, t);
+            grid2a_[k] = computeExpectation_rn(w, t);
+            grid2b_[k] = computeExpectation_tf(w, t);
+            grid3_[k] = computeVariance(w, t);
+            grid5_[k] = computeG(w, grid_[j]);
+        }
+    }
+}
+
+const Size GsrProcessCore::gridIndex(const Time t) const {
+    std::vector<Time>::const_iterator k =
+        std::lower_bound(grid_.begin(), grid_.end(), t);
+    if (k != grid_.end() && close_enough(*k, t))
+        return k - grid_.begin();
+    if (k != grid_.begin() && close_enough(*(k - 1), t))
+        return k - 1 - grid_.begin();
+    return Null<Size>();
+}
+
+const Real
+GsrProcessCore::cached(const Term term, const std::vector<Real> &table,
+                       std::map<std::pair<Real, Real>, Real> &map,
+                       const Time w, const Time t) const {
+    if (!grid_.empty()) {
+        Size i = gridIndex(w), j = gridIndex(t);
+        if (i != Null<Size>() && j != Null<Size>() && i <= j)
+            return table[triangularIndex(i, j, grid_.size())];
+        return (this->*term)(w, t);
+    }
+    std::pair<Real, Real> key = std::make_pair(w, t);
+    std::map<std::pair<Real, Real>, Real>::const_iterator k = map.find(key);
+    if (k != map.end())
+        return k->second;
+    Real res = (this->*term)(w, t);
+    map.insert(std::make_pair(key, res));
+    return res;
+}
+
 const Real GsrProcessCore::expectation_x0dep_part(const Time w, const Real xw,
                                                   const Time dt) const {
-    Real t = w + dt;
-    std::pair<Real, Real> key;
-    key = std::make_pair(w, t);
-    std::map<std::pair<Real, Real>, Real>::const_iterator k = cache1_.find(key);
-    if (k != cache1_.end())
-        return xw * (k->second);
-    // A(w,t)x(w)
-    Real res2 = 1.0;
-    for (int i = lowerIndex(w); i <= upperIndex(t) - 1; i++) {
-        res2 *= exp(-rev(i) * (cappedTime(i + 1, t) - flooredTime(i, w)));
-    }
-    cache1_.insert(std::make_pair(key, res2));
-    return res2 * xw;
+    return xw * cached(&GsrProcessCore::computeExpectation_x0dep, grid1_,
+                       cache1_, w, w + dt);
 }
 
 const Real GsrProcessCore::expectation_rn_part(const Time w,
                                                const Time dt) const {
+    return cached(&GsrProcessCore::computeExpectation_rn, grid2a_, cache2a_,
+                  w, w + dt);
+}
+
+const Real GsrProcessCore::expectation_tf_part(const Time w,
+                                               const Time dt) const {
+    return cached(&GsrProcessCore::computeExpectation_tf, grid2b_, cache2b_,
+                  w, w + dt);
+}
 
-    Real t = w + dt;
+const Real GsrProcessCore::variance(const Time w, const Time dt) const {
+    return cached(&GsrProcessCore::computeVariance, grid3_, cache3_, w,
+                  w + dt);
+}
 
-    std::pair<Real, Real> key;
-    key = std::make_pair(w, t);
-    std::map<std::pair<Real, Real>, Real>::const_iterator k =
-        cache2a_.find(key);
-    if (k != cache2a_.end())
+const Real GsrProcessCore::y(const Time t) const {
+    if (!grid_.empty()) {
+        Size i = gridIndex(t);
+        return i != Null<Size>() ? grid4_[i] : computeY(t);
+    }
+    std::map<Real, Real>::const_iterator k = cache4_.find(t);
+    if (k != cache4_.end())
         return k->second;
+    Real res = computeY(t);
+    cache4_.insert(std::make_pair(t, res));
+    return res;
+}
+
+const Real GsrProcessCore::G(const Time t, const Time w) const {
+    return cached(&GsrProcessCore::computeG, grid5_, cache5_, t, w);
+}
+
+const Real GsrProcessCore::computeExpectation_x0dep(const Time w,
+                                                    const Time t) const {
+    // A(w,t)
+    Real res2 = 1.0;
+    for (int i = lowerIndex(w); i <= upperIndex(t) - 1; i++) {
+        res2 *= exp(-rev(i) * (cappedTime(i + 1, t) - flooredTime(i, w)));
+    }
+    return res2;
+}
+
+const Real GsrProcessCore::computeExpectation_rn(const Time w,
+                                                 const Time t) const {
 
     Real res = 0.0;
 
@@ -151,22 +257,11 @@ const Real GsrProcessCore::expectation_rn_part(const Time w,
         res += res2;
     }
 
-    cache2a_.insert(std::make_pair(key, res));
-
     return res;
 } // expectation_rn_part
 
-const Real GsrProcessCore::expectation_tf_part(const Time w,
-                                               const Time dt) const {
-
-    Real t = w + dt;
-
-    std::pair<Real, Real> key;
-    key = std::make_pair(w, t);
-    std::map<std::pair<Real, Real>, Real>::const_iterator k =
-        cache2b_.find(key);
-    if (k != cache2b_.end())
-        return k->second;
+const Real GsrProcessCore::computeExpectation_tf(const Time w,
+                                                 const Time t) const {
 
     Real res = 0.0;
     // int -A(s,t) \sigma^2 G(s,T)
@@ -229,20 +324,11 @@ const Real GsrProcessCore::expectation_tf_part(const Time w,
         res += -vol(k) * vol(k) * res2;
     }
 
-    cache2b_.insert(std::make_pair(key, res));
-
     return res;
 } // expectation_tf_part
 
-const Real GsrProcessCore::variance(const Time w, const Time dt) const {
-
-    Real t = w + dt;
-
-    std::pair<Real, Real> key;
-    key = std::make_pair(w, t);
-    std::map<std::pair<Real, Real>, Real>::const_iterator k = cache3_.find(key);
-    if (k != cache3_.end())
-        return k->second;
+const Real GsrProcessCore::computeVariance(const Time w,
+                                           const Time t) const {
 
     Real res = 0.0;
     for (int k = lowerIndex(w); k <= upperIndex(t) - 1; k++) {
@@ -260,16 +346,10 @@ const Real GsrProcessCore::variance(const Time w, const Time dt) const {
         res += res2;
     }
 
-    cache3_.insert(std::make_pair(key, res));
     return res;
 }
 
-const Real GsrProcessCore::y(const Time t) const {
-    Real key;
-    key = t;
-    std::map<Real, Real>::const_iterator k = cache4_.find(key);
-    if (k != cache4_.end())
-        return k->second;
+const Real GsrProcessCore::computeY(const Time t) const {
 
     Real res = 0.0;
     for (int i = 0; i <= upperIndex(t) - 1; i++) {
@@ -284,16 +364,10 @@ const Real GsrProcessCore::y(const Time t) const {
         res += res2;
     }
 
-    cache4_.insert(std::make_pair(key, res));
     return res;
 }
 
-const Real GsrProcessCore::G(const Time t, const Time w) const {
-    std::pair<Real, Real> key;
-    key = std::make_pair(w, t);
-    std::map<std::pair<Real, Real>, Real>::const_iterator k = cache5_.find(key);
-    if (k != cache5_.end())
-        return k->second;
+const Real GsrProcessCore::computeG(const Time t, const Time w) const {
 
     Real res = 0.0;
     for (int i = lowerIndex(t); i <= upperIndex(w) - 1; i++) {
@@ -308,7 +382,6 @@ const Real GsrProcessCore::G(const Time t, const Time w) const {
         res += res2;
     }
 
-    cache5_.insert(std::make_pair(key, res));
     return res;
 }
 
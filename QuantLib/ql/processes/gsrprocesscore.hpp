@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -23,6 +23,15 @@
     \warning Results are cached for performance reasons, so if
              parameters change, you need to call flushCache() to
              avoid inconsistent results.
+
+    Times registered by precompute() have their own tables, which
+    hold the results for all pairs of registered times and are filled
+    completely by precompute(). Lookups on this grid only read these
+    tables. Once a grid is registered, results for other times are
+    computed without being cached, so that all lookups are read only
+    and can be done concurrently. Without a registered grid all
+    results are cached in maps keyed by the requested times, which is
+    only suitable for serial use.
 */
 
 #ifndef quantlib_gsr_process_core_hpp
@@ -31,6 +40,7 @@
 #include <ql/math/array.hpp>
 #include <ql/math/comparison.hpp>
 #include <map>
+#include <vector>
 
 namespace QuantLib {
 
@@ -72,6 +82,12 @@ class GsrProcessCore {
     // reset cache
     void flushCache() const;
 
+    // register the given times (replacing a previously registered
+    // grid) and fill the cache for them, nothing is done if the
+    // same grid is registered already
+    void precompute(const std::vector<Time> &times) const;
+    const std::vector<Time> &precomputedTimes() const { return grid_; }
+
     // some more inspectors
     const Array& times() const { return times_; }
     const Array& vols() const { return vols_; }
@@ -88,8 +104,30 @@ class GsrProcessCore {
     const Real rev(Size index) const;
     const bool revZero(Size index) const;
 
+    // uncached computations, t = w + dt
+    const Real computeExpectation_x0dep(const Time w, const Time t) const;
+    const Real computeExpectation_rn(const Time w, const Time t) const;
+    const Real computeExpectation_tf(const Time w, const Time t) const;
+    const Real computeVariance(const Time w, const Time t) const;
+    const Real computeY(const Time t) const;
+    const Real computeG(const Time t, const Time w) const;
+
+    typedef const Real (GsrProcessCore::*Term)(const Time, const Time) const;
+    // looks up a term in the grid table or the map, see above
+    const Real cached(const Term term, const std::vector<Real> &table,
+                      std::map<std::pair<Real, Real>, Real> &map,
+                      const Time w, const Time t) const;
+    // position of a registered time in the grid or Null<Size>()
+    const Size gridIndex(const Time t) const;
+
     const Array &times_, &vols_, &reversions_, &adjusters_;
 
+    // registered times (sorted) and tables for all pairs (t_i, t_j),
+    // i <= j, in row major upper triangular storage resp. for all t_i
+    mutable std::vector<Time> grid_;
+    mutable std::vector<Real> grid1_, grid2a_, grid2b_, grid3_, grid4_,
+        grid5_;
+    // lazily filled caches if no grid is registered
     mutable std::map<std::pair<Real, Real>, Real> cache1_, cache2a_, cache2b_,
         cache3_, cache5_;
     mutable std::map<Real, Real> cache4_;
@@ -346,13 +346,26 @@ namespace QuantLib {
         }
     }
 
-    Disposable<Array> HestonProcess::evolve(Time t0, const Array& x0,
-                                            Time dt, const Array& dw) const {
-        Array retVal(2);
-        Real vol, vol2, mu, nu, dy;
+    HestonProcess::StepConstants HestonProcess::stepConstants(Time t0,
+                                                             Time dt) const {
+        StepConstants c;
+        c.r =   riskFreeRate_->forwardRate(t0, t0+dt, Continuous)
+              - dividendYield_->forwardRate(t0, t0+dt, Continuous);
+        c.dt = dt;
+        c.sdt = std::sqrt(dt);
+        c.sqrhov = std::sqrt(1.0 - rho_*rho_);
+        c.ex = (discretization_ == QuadraticExponential ||
+                discretization_ == QuadraticExponentialMartingale)
+            ? std::exp(-kappa_*dt) : 0.0;
+        return c;
+    }
 
-        const Real sdt = std::sqrt(dt);
-        const Real sqrhov = std::sqrt(1.0 - rho_*rho_);
+    inline void HestonProcess::evolvePath(const StepConstants& c,
+                                          Real s0, Real v0,
+                                          Real dw0, Real dw1,
+                                          Real& s1, Real& v1) const {
+        Real vol, vol2, mu, nu;
+        const Real dt = c.dt, sdt = c.sdt, sqrhov = c.sqrhov;
 
         switch (discretization_) {
           // For the definition of PartialTruncation, FullTruncation
@@ -361,55 +374,31 @@ namespace QuantLib {
           //  stochastic volatility models",
           // Working Paper, Tinbergen Institute
           case PartialTruncation:
-            vol = (x0[1] > 0.0) ? std::sqrt(x0[1]) : 0.0;
+            vol = (v0 > 0.0) ? std::sqrt(v0) : 0.0;
             vol2 = sigma_ * vol;
-            mu =    riskFreeRate_->forwardRate(t0, t0+dt, Continuous)
-                  - dividendYield_->forwardRate(t0, t0+dt, Continuous)
-                    - 0.5 * vol * vol;
-            nu = kappa_*(theta_ - x0[1]);
+            mu = c.r - 0.5 * vol * vol;
+            nu = kappa_*(theta_ - v0);
 
-            retVal[0] = x0[0] * std::exp(mu*dt+vol*dw[0]*sdt);
-            retVal[1] = x0[1] + nu*dt + vol2*sdt*(rho_*dw[0] + sqrhov*dw[1]);
+            s1 = s0 * std::exp(mu*dt+vol*dw0*sdt);
+            v1 = v0 + nu*dt + vol2*sdt*(rho_*dw0 + sqrhov*dw1);
             break;
           case FullTruncation:
-            vol = (x0[1] > 0.0) ? std::sqrt(x0[1]) : 0.0;
+            vol = (v0 > 0.0) ? std::sqrt(v0) : 0.0;
             vol2 = sigma_ * vol;
-            mu =    riskFreeRate_->forwardRate(t0, t0+dt, Continuous)
-                  - dividendYield_->forwardRate(t0, t0+dt, Continuous)
-                    - 0.5 * vol * vol;
+            mu = c.r - 0.5 * vol * vol;
             nu = kappa_*(theta_ - vol*vol);
 
-            retVal[0] = x0[0] * std::exp(mu*dt+vol*dw[0]*sdt);
-            retVal[1] = x0[1] + nu*dt + vol2*sdt*(rho_*dw[0] + sqrhov*dw[1]);
+            s1 = s0 * std::exp(mu*dt+vol*dw0*sdt);
+            v1 = v0 + nu*dt + vol2*sdt*(rho_*dw0 + sqrhov*dw1);
             break;
           case Reflection:
-            vol = std::sqrt(std::fabs(x0[1]));
+            vol = std::sqrt(std::fabs(v0));
             vol2 = sigma_ * vol;
-            mu =    riskFreeRate_->forwardRate(t0, t0+dt, Continuous)
-                  - dividendYield_->forwardRate(t0, t0+dt, Continuous)
-                    - 0.5 * vol*vol;
+            mu = c.r - 0.5 * vol*vol;
             nu = kappa_*(theta_ - vol*vol);
 
-            retVal[0] = x0[0]*std::exp(mu*dt+vol*dw[0]*sdt);
-            retVal[1] = vol*vol
-                        +nu*dt + vol2*sdt*(rho_*dw[0] + sqrhov*dw[1]);
-            break;
-          case NonCentralChiSquareVariance:
-            // use Alan Lewis trick to decorrelate the equity and the variance
-            // process by using y(t)=x(t)-\frac{rho}{sigma}\nu(t)
-            // and Ito's Lemma. Then use exact sampling for the variance
-            // process. For further details please read the Wilmott thread
-            // "QuantLib code is very high quality"
-            vol = (x0[1] > 0.0) ? std::sqrt(x0[1]) : 0.0;
-            mu =   riskFreeRate_->forwardRate(t0, t0+dt, Continuous)
-                 - dividendYield_->forwardRate(t0, t0+dt, Continuous)
-                   - 0.5 * vol*vol;
-
-            retVal[1] = varianceDistribution(x0[1], dw[1], dt);
-            dy = (mu - rho_/sigma_*kappa_
-                          *(theta_-vol*vol)) * dt + vol*sqrhov*dw[0]*sdt;
-
-            retVal[0] = x0[0]*std::exp(dy + rho_/sigma_*(retVal[1]-x0[1]));
+            s1 = s0*std::exp(mu*dt+vol*dw0*sdt);
+            v1 = vol*vol + nu*dt + vol2*sdt*(rho_*dw0 + sqrhov*dw1);
             break;
           case QuadraticExponential:
           case QuadraticExponentialMartingale:
@@ -417,10 +406,10 @@ namespace QuantLib {
             // for details of the quadratic exponential discretization scheme
             // see Leif Andersen,
             // Efficient Simulation of the Heston Stochastic Volatility Model
-            const Real ex = std::exp(-kappa_*dt);
+            const Real ex = c.ex;
 
-            const Real m  =  theta_+(x0[1]-theta_)*ex;
-            const Real s2 =  x0[1]*sigma_*sigma_*ex/kappa_*(1-ex)
+            const Real m  =  theta_+(v0-theta_)*ex;
+            const Real s2 =  v0*sigma_*sigma_*ex/kappa_*(1-ex)
                            + theta_*sigma_*sigma_/(2*kappa_)*(1-ex)*(1-ex);
             const Real psi = s2/(m*m);
 
@@ -442,31 +431,67 @@ namespace QuantLib {
                     // martingale correction
                     QL_REQUIRE(A < 1/(2*a), "illegal value");
                     k0 = -A*b2*a/(1-2*A*a)+0.5*std::log(1-2*A*a)
-                         -(k1+0.5*k3)*x0[1];
+                         -(k1+0.5*k3)*v0;
                 }
-                retVal[1] = a*(b+dw[1])*(b+dw[1]);
+                v1 = a*(b+dw1)*(b+dw1);
             }
             else {
                 const Real p = (psi-1)/(psi+1);
                 const Real beta = (1-p)/m;
 
-                const Real u = CumulativeNormalDistribution()(dw[1]);
+                const Real u = CumulativeNormalDistribution()(dw1);
 
                 if (discretization_ == QuadraticExponentialMartingale) {
                     // martingale correction
                     QL_REQUIRE(A < beta, "illegal value");
-                    k0 = -std::log(p+beta*(1-p)/(beta-A))-(k1+0.5*k3)*x0[1];
+                    k0 = -std::log(p+beta*(1-p)/(beta-A))-(k1+0.5*k3)*v0;
                 }
-                retVal[1] = ((u <= p) ? 0.0 : std::log((1-p)/(1-u))/beta);
+                v1 = ((u <= p) ? 0.0 : std::log((1-p)/(1-u))/beta);
             }
 
-            mu =   riskFreeRate_->forwardRate(t0, t0+dt, Continuous)
-                 - dividendYield_->forwardRate(t0, t0+dt, Continuous);
-
-            retVal[0] = x0[0]*std::exp(mu*dt + k0 + k1*x0[1] + k2*retVal[1]
-                                       +std::sqrt(k3*x0[1]+k4*retVal[1])*dw[0]);
+            s1 = s0*std::exp(c.r*dt + k0 + k1*v0 + k2*v1
+                             +std::sqrt(k3*v0+k4*v1)*dw0);
           }
           break;
+          default:
+            QL_FAIL("discretization schema not supported by path kernel");
+        }
+    }
+
+    Disposable<Array> HestonProcess::evolve(Time t0, const Array& x0,
+                                            Time dt, const Array& dw) const {
+        Array retVal(2);
+        Real vol, mu, dy;
+
+        const Real sdt = std::sqrt(dt);
+        const Real sqrhov = std::sqrt(1.0 - rho_*rho_);
+
+        switch (discretization_) {
+          case PartialTruncation:
+          case FullTruncation:
+          case Reflection:
+          case QuadraticExponential:
+          case QuadraticExponentialMartingale:
+            evolvePath(stepConstants(t0, dt), x0[0], x0[1], dw[0], dw[1],
+                       retVal[0], retVal[1]);
+            break;
+          case NonCentralChiSquareVariance:
+            // use Alan Lewis trick to decorrelate the equity and the variance
+            // process by using y(t)=x(t)-\frac{rho}{sigma}\nu(t)
+            // and Ito's Lemma. Then use exact sampling for the variance
+            // process. For further details please read the Wilmott thread
+            // "QuantLib code is very high quality"
+            vol = (x0[1] > 0.0) ? std::sqrt(x0[1]) : 0.0;
+            mu =   riskFreeRate_->forwardRate(t0, t0+dt, Continuous)
+                 - dividendYield_->forwardRate(t0, t0+dt, Continuous)
+                   - 0.5 * vol*vol;
+
+            retVal[1] = varianceDistribution(x0[1], dw[1], dt);
+            dy = (mu - rho_/sigma_*kappa_
+                          *(theta_-vol*vol)) * dt + vol*sqrhov*dw[0]*sdt;
+
+            retVal[0] = x0[0]*std::exp(dy + rho_/sigma_*(retVal[1]-x0[1]));
+            break;
           case BroadieKayaExactSchemeLobatto:
           case BroadieKayaExactSchemeLaguerre:
           case BroadieKayaExactSchemeTrapezoidal:
@@ -503,6 +528,35 @@ namespace QuantLib {
         return retVal;
     }
 
+    void HestonProcess::evolveBlock(Time t0, const Matrix& x0, Time dt,
+                                    const Matrix& dw, Matrix& x) const {
+        QL_REQUIRE(x0.rows() == 2 && x.rows() == 2 &&
+                   x0.columns() == x.columns() && dw.rows() >= 2 &&
+                   dw.columns() == x0.columns(),
+                   "state or increment matrix dimensions do not match");
+
+        switch (discretization_) {
+          case PartialTruncation:
+          case FullTruncation:
+          case Reflection:
+          case QuadraticExponential:
+          case QuadraticExponentialMartingale:
+          {
+            // the rates and step constants are computed once for all paths
+            const StepConstants c = stepConstants(t0, dt);
+            const Size n = x0.columns();
+            const Real *s0 = x0.row_begin(0), *v0 = x0.row_begin(1);
+            const Real *dw0 = dw.row_begin(0), *dw1 = dw.row_begin(1);
+            Real *s1 = x.row_begin(0), *v1 = x.row_begin(1);
+            for (Size j=0; j<n; ++j)
+                evolvePath(c, s0[j], v0[j], dw0[j], dw1[j], s1[j], v1[j]);
+          }
+          break;
+          default:
+            StochasticProcess::evolveBlock(t0, x0, dt, dw, x);
+        }
+    }
+
     const Handle<Quote>& HestonProcess::s0() const {
         return s0_;
     }
@@ -71,6 +71,12 @@ namespace QuantLib {
         Disposable<Array> apply(const Array& x0, const Array& dx) const;
         Disposable<Array> evolve(Time t0, const Array& x0,
                                  Time dt, const Array& dw) const;
+        /*! for the truncation, reflection and quadratic exponential
+            schemes the rates and step constants are computed once for
+            the whole block, the other schemes evolve the paths one by
+            one */
+        void evolveBlock(Time t0, const Matrix& x0, Time dt,
+                         const Matrix& dw, Matrix& x) const;
 
         Real v0()    const { return v0_; }
         Real rho()   const { return rho_; }
@@ -85,6 +91,15 @@ namespace QuantLib {
         Time time(const Date&) const;
 
       private:
+        // step constants shared by the paths evolved over the same step
+        struct StepConstants {
+            Real r, dt, sdt, sqrhov, ex;
+        };
+        StepConstants stepConstants(Time t0, Time dt) const;
+        // single path kernel of the truncation, reflection and quadratic
+        // exponential schemes, used by evolve() and evolveBlock()
+        void evolvePath(const StepConstants& c, Real s0, Real v0,
+                        Real dw0, Real dw1, Real& s1, Real& v1) const;
         Real varianceDistribution(Real v, Real dw, Time dt) const;
 
         Handle<YieldTermStructure> riskFreeRate_, dividendYield_;
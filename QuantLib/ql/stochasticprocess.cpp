@@ -59,6 +59,27 @@ namespace QuantLib {
         return apply(expectation(t0,x0,dt), stdDeviation(t0,x0,dt)*dw);
     }
 
+    void StochasticProcess::evolveBlock(Time t0, const Matrix& x0, Time dt,
+                                        const Matrix& dw, Matrix& x) const {
+        QL_REQUIRE(x0.rows() == size() && x.rows() == size() &&
+                   x0.columns() == x.columns(),
+                   "state matrices (" << x0.rows() << "x" << x0.columns()
+                   << ", " << x.rows() << "x" << x.columns()
+                   << ") do not match process size " << size());
+        QL_REQUIRE(dw.rows() == factors() && dw.columns() == x0.columns(),
+                   "increment matrix (" << dw.rows() << "x" << dw.columns()
+                   << ") does not match number of factors " << factors()
+                   << " and paths " << x0.columns());
+        Array state(x0.rows()), increment(dw.rows());
+        for (Size j=0; j<x0.columns(); ++j) {
+            std::copy(x0.column_begin(j), x0.column_end(j), state.begin());
+            std::copy(dw.column_begin(j), dw.column_end(j),
+                      increment.begin());
+            Array result = evolve(t0, state, dt, increment);
+            std::copy(result.begin(), result.end(), x.column_begin(j));
+        }
+    }
+
     Disposable<Array> StochasticProcess::apply(const Array& x0,
                                                const Array& dx) const {
         return x0 + dx;
@@ -98,6 +119,13 @@ namespace QuantLib {
         return apply(expectation(t0,x0,dt), stdDeviation(t0,x0,dt)*dw);
     }
 
+    void StochasticProcess1D::evolveBlock(Time t0, const Real* x0, Time dt,
+                                          const Real* dw, Real* x,
+                                          Size n) const {
+        for (Size j=0; j<n; ++j)
+            x[j] = evolve(t0, x0[j], dt, dw[j]);
+    }
+
     Real StochasticProcess1D::apply(Real x0, Real dx) const {
         return x0 + dx;
     }
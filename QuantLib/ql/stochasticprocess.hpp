@@ -123,6 +123,21 @@ namespace QuantLib {
                                          const Array& x0,
                                          Time dt,
                                          const Array& dw) const;
+        /*! evolves a block of paths at once. The i-th column of
+            \f$ \mathrm{x}_0 \f$ (a size() x n matrix) and of
+            \f$ \Delta \mathrm{w} \f$ (a factors() x n matrix) contain
+            the state and the random increments of the i-th path; the
+            evolved states are written to the columns of \f$ \mathrm{x}
+            \f$, which must have the same dimensions as \f$ \mathrm{x}_0
+            \f$. By default, the paths are evolved one by one; derived
+            classes can override this to compute the time dependent
+            quantities only once for the whole block.
+        */
+        virtual void evolveBlock(Time t0,
+                                 const Matrix& x0,
+                                 Time dt,
+                                 const Matrix& dw,
+                                 Matrix& x) const;
         /*! applies a change to the asset value. By default, it
             returns \f$ \mathrm{x} + \Delta \mathrm{x} \f$.
         */
@@ -216,6 +231,15 @@ namespace QuantLib {
             standard deviation.
         */
         virtual Real evolve(Time t0, Real x0, Time dt, Real dw) const;
+        /*! evolves n paths at once, x0, dw and x point to arrays of
+            size n holding the initial states, random increments and
+            evolved states of the paths. By default, the paths are
+            evolved one by one; derived classes can override this to
+            compute the time dependent quantities only once for the
+            whole block.
+        */
+        virtual void evolveBlock(Time t0, const Real* x0, Time dt,
+                                 const Real* dw, Real* x, Size n) const;
         /*! applies a change to the asset value. By default, it
             returns \f$ x + \Delta x \f$.
         */
@@ -239,6 +263,8 @@ namespace QuantLib {
                                       Time dt) const;
         Disposable<Array> evolve(Time t0, const Array& x0,
                                  Time dt, const Array& dw) const;
+        void evolveBlock(Time t0, const Matrix& x0, Time dt,
+                         const Matrix& dw, Matrix& x) const;
         Disposable<Array> apply(const Array& x0, const Array& dx) const;
     };
 
@@ -310,6 +336,17 @@ namespace QuantLib {
         return a;
     }
 
+    inline void StochasticProcess1D::evolveBlock(Time t0, const Matrix& x0,
+                                                 Time dt, const Matrix& dw,
+                                                 Matrix& x) const {
+        #if defined(QL_EXTRA_SAFETY_CHECKS)
+        QL_REQUIRE(x0.rows() == 1, "1-D state matrix required");
+        QL_REQUIRE(dw.rows() == 1, "1-D increment matrix required");
+        #endif
+        evolveBlock(t0, x0.row_begin(0), dt, dw.row_begin(0), x.row_begin(0),
+                    x0.columns());
+    }
+
     inline Disposable<Array> StochasticProcess1D::apply(
                                                       const Array& x0,
                                                       const Array& dx) const {
@@ -0,0 +1,311 @@
+/* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+
+/*
+ Copyright (C) 2016 Peter Caspers
+
+ This file is part of QuantLib, a free-software/open-source library
+ for financial quantitative analysts and developers - http://quantlib.org/
+
+ QuantLib is free software: you can redistribute it and/or modify it
+ under the terms of the QuantLib license.  You should have received a
+ copy of the license along with this program; if not, please email
+ <quantlib-dev@lists.sf.net>. The license is also available online at
+ <http://quantlib.org/license.shtml>.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the license for more details.
+*/
+
+/*! \file globalbootstrap.hpp
+    \brief bootstrapper solving for all pillars simultaneously
+*/
+
+#ifndef quantlib_global_bootstrap_hpp
+#define quantlib_global_bootstrap_hpp
+
+#include <ql/termstructures/iterativebootstrap.hpp>
+#include <ql/math/matrixutilities/qrdecomposition.hpp>
+#include <ql/utilities/dataformatters.hpp>
+
+namespace QuantLib {
+
+    //! Global piecewise-term-structure bootstrapper
+    /*! The curve data on all pillars are solved for simultaneously by
+        a damped quasi-Newton iteration on the vector of the helpers'
+        quote errors, instead of bootstrapping pillar by pillar and
+        repeating the sweep until convergence as IterativeBootstrap
+        does for global interpolations and overlapping helpers.
+
+        The jacobian of the quote errors w.r.t. the curve data is
+        computed by forward differences. It is kept between
+        calculations and updated by Broyden's method, so that a
+        recalculation after small quote changes usually costs only a
+        few evaluations of the helpers. It is recomputed whenever a
+        step does not decrease the quote errors.
+
+        Without a valid previous curve state the initial guess is
+        obtained by a single pillar by pillar sweep, sharing its steps
+        with the first iteration of IterativeBootstrap.
+
+        The sensitivities of the curve data w.r.t. the helpers' quotes
+        are available via jacobian().
+    */
+    template <class Curve>
+    class GlobalBootstrap {
+        typedef typename Curve::traits_type Traits;
+        typedef typename Curve::interpolator_type Interpolator;
+      public:
+        GlobalBootstrap();
+        void setup(Curve* ts);
+        void calculate() const;
+        /*! sensitivities of the curve data on the pillars (rows, the
+            value on the initial date is not included) w.r.t. the quotes
+            of the alive helpers (columns, sorted by pillar date). The
+            curve is calculated if needed.
+        */
+        const Matrix& jacobian() const;
+      private:
+        void initialize() const;
+        void initialGuess() const;
+        Disposable<Array> curveData() const;
+        void setCurveData(const Array& x) const;
+        Disposable<Array> quoteErrors() const;
+        void computeJacobian(const Array& errors) const;
+        Curve* ts_;
+        Size n_;
+        Brent firstSolver_;
+        mutable bool initialized_, validCurve_, validQuoteJacobian_;
+        mutable Size firstAliveHelper_, alive_;
+        mutable std::vector<boost::shared_ptr<BootstrapError<Curve> > > errors_;
+        mutable Matrix errorJacobian_, quoteJacobian_;
+    };
+
+
+    // template definitions
+
+    template <class Curve>
+    GlobalBootstrap<Curve>::GlobalBootstrap()
+    : ts_(0), initialized_(false), validCurve_(false),
+      validQuoteJacobian_(false) {}
+
+    template <class Curve>
+    void GlobalBootstrap<Curve>::setup(Curve* ts) {
+
+        ts_ = ts;
+        n_ = ts_->instruments_.size();
+        QL_REQUIRE(n_ > 0, "no bootstrap helpers given")
+        for (Size j=0; j<n_; ++j)
+            ts_->registerWith(ts_->instruments_[j]);
+
+        // do not initialize yet: instruments could be invalid here
+        // but valid later when bootstrapping is actually required
+    }
+
+    template <class Curve>
+    void GlobalBootstrap<Curve>::initialize() const {
+        detail::initializePillars(ts_, ts_->instruments_, ts_->dates_,
+                                  ts_->times_, ts_->maxDate_,
+                                  firstAliveHelper_, alive_, errors_);
+
+        // the current curve can only be used as guess if the number of
+        // pillars did not change
+        if (!validCurve_ || ts_->data_.size()!=alive_+1) {
+            ts_->data_ = std::vector<Real>(alive_+1, Traits::initialValue(ts_));
+            validCurve_ = false;
+        }
+        if (errorJacobian_.rows() != alive_)
+            errorJacobian_ = Matrix();
+        initialized_ = true;
+    }
+
+    template <class Curve>
+    void GlobalBootstrap<Curve>::initialGuess() const {
+
+        const std::vector<Time>& times = ts_->times_;
+        const std::vector<Real>& data = ts_->data_;
+        Real accuracy = ts_->accuracy_;
+
+        for (Size i=1; i<=alive_; ++i) {
+            Real min, max;
+            Real guess = detail::pillarGuess(ts_, i, false,
+                                             firstAliveHelper_, min, max);
+            detail::extendInterpolation(ts_->interpolation_,
+                                        ts_->interpolator_, times, data, i);
+            try {
+                firstSolver_.solve(*errors_[i], accuracy, guess, min, max);
+            } catch (std::exception &e) {
+                QL_FAIL("initial guess: failed at " << io::ordinal(i) <<
+                        " alive instrument, pillar " <<
+                        errors_[i]->helper()->pillarDate() <<
+                        ", maturity " <<
+                        errors_[i]->helper()->maturityDate() <<
+                        ", reference date " << ts_->dates_[0] <<
+                        ": " << e.what());
+            }
+        }
+    }
+
+    template <class Curve>
+    Disposable<Array> GlobalBootstrap<Curve>::curveData() const {
+        Array x(alive_);
+        for (Size i=0; i<alive_; ++i)
+            x[i] = ts_->data_[i+1];
+        return x;
+    }
+
+    template <class Curve>
+    void GlobalBootstrap<Curve>::setCurveData(const Array& x) const {
+        for (Size i=0; i<alive_; ++i)
+            Traits::updateGuess(ts_->data_, x[i], i+1);
+        ts_->interpolation_.update();
+    }
+
+    template <class Curve>
+    Disposable<Array> GlobalBootstrap<Curve>::quoteErrors() const {
+        Array errors(alive_);
+        for (Size i=0; i<alive_; ++i)
+            errors[i] = errors_[i+1]->helper()->quoteError();
+        return errors;
+    }
+
+    template <class Curve>
+    void GlobalBootstrap<Curve>::computeJacobian(const Array& errors) const {
+        const Real h = 1.0E-7;
+        errorJacobian_ = Matrix(alive_, alive_);
+        for (Size j=0; j<alive_; ++j) {
+            Real x = ts_->data_[j+1];
+            Traits::updateGuess(ts_->data_, x+h, j+1);
+            ts_->interpolation_.update();
+            for (Size i=0; i<alive_; ++i)
+                errorJacobian_[i][j] =
+                    (errors_[i+1]->helper()->quoteError() - errors[i]) / h;
+            Traits::updateGuess(ts_->data_, x, j+1);
+        }
+        ts_->interpolation_.update();
+    }
+
+    template <class Curve>
+    void GlobalBootstrap<Curve>::calculate() const {
+
+        // we might have to call initialize even if the curve is initialized
+        // and not moving, just because helpers might be date relative and change
+        // with evaluation date change.
+        if (!initialized_ || ts_->moving_)
+            initialize();
+
+        detail::setupHelpers(ts_, ts_->instruments_, firstAliveHelper_);
+
+        validQuoteJacobian_ = false;
+        if (!validCurve_)
+            initialGuess();
+        // from here on a failure requires a fresh start
+        validCurve_ = false;
+
+        ts_->interpolation_ = ts_->interpolator_.interpolate(
+            ts_->times_.begin(), ts_->times_.end(), ts_->data_.begin());
+        ts_->interpolation_.update();
+
+        Real accuracy = ts_->accuracy_;
+        Size maxIterations = Traits::maxIterations();
+
+        Array x = curveData(), errors = quoteErrors();
+        bool freshJacobian = false;
+        if (errorJacobian_.rows() != alive_) {
+            computeJacobian(errors);
+            freshJacobian = true;
+        }
+
+        for (Size iteration=0; ; ++iteration) {
+
+            Array step = -qrSolve(errorJacobian_, errors);
+            Real change = 0.0, error = 0.0;
+            for (Size i=0; i<alive_; ++i) {
+                change = std::max(change, std::fabs(step[i]));
+                error = std::max(error, std::fabs(errors[i]));
+            }
+
+            // exit condition
+            if (change <= accuracy) {
+                setCurveData(x + step);
+                break;
+            }
+
+            QL_REQUIRE(iteration < maxIterations,
+                       "convergence not reached after " << iteration <<
+                       " iterations; last change " << change <<
+                       ", last quote error " << error <<
+                       ", required accuracy " << accuracy);
+
+            // the step is accepted if it does not increase the quote
+            // errors, otherwise we recompute the jacobian or, if it
+            // is fresh already, try smaller steps
+            Real norm = DotProduct(errors, errors), lambda = 1.0;
+            Array newErrors;
+            bool accepted = false;
+            for (Size k=0; k<10 && !accepted; ++k) {
+                setCurveData(x + lambda*step);
+                newErrors = quoteErrors();
+                if (DotProduct(newErrors, newErrors) <= norm)
+                    accepted = true;
+                else if (!freshJacobian)
+                    break;
+                else
+                    lambda /= 2.0;
+            }
+
+            if (!accepted) {
+                setCurveData(x);
+                // within the accuracy we can't expect any improvement
+                if (error <= accuracy)
+                    break;
+                QL_REQUIRE(!freshJacobian,
+                           io::ordinal(iteration+1) << " iteration: quote "
+                           "errors can not be reduced, last change " <<
+                           change << ", last quote error " << error <<
+                           ", reference date " << ts_->dates_[0]);
+                computeJacobian(errors);
+                freshJacobian = true;
+                continue;
+            }
+
+            // Broyden update of the jacobian
+            step *= lambda;
+            Array r = newErrors - errors - errorJacobian_ * step;
+            Real s2 = DotProduct(step, step);
+            for (Size i=0; i<alive_; ++i)
+                for (Size j=0; j<alive_; ++j)
+                    errorJacobian_[i][j] += r[i] * step[j] / s2;
+            freshJacobian = false;
+
+            x += step;
+            errors = newErrors;
+        }
+        validCurve_ = true;
+    }
+
+    template <class Curve>
+    const Matrix& GlobalBootstrap<Curve>::jacobian() const {
+        ts_->calculate();
+        if (!validQuoteJacobian_) {
+            // the helpers might have been used by another curve since
+            detail::setupHelpers(ts_, ts_->instruments_, firstAliveHelper_);
+            // errors are quote minus implied quote, so that the
+            // sensitivities are minus the inverse of their jacobian
+            computeJacobian(quoteErrors());
+            quoteJacobian_ = Matrix(alive_, alive_);
+            for (Size k=0; k<alive_; ++k) {
+                Array e(alive_, 0.0);
+                e[k] = -1.0;
+                Array c = qrSolve(errorJacobian_, e);
+                for (Size i=0; i<alive_; ++i)
+                    quoteJacobian_[i][k] = c[i];
+            }
+            validQuoteJacobian_ = true;
+        }
+        return quoteJacobian_;
+    }
+
+}
+
+#endif
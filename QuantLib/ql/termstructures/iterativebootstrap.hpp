@@ -5,6 +5,7 @@
  Copyright (C) 2007 Chris Kenyon
  Copyright (C) 2007 StatPro Italia srl
  Copyright (C) 2015 Paolo Mazzocchi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -36,7 +37,162 @@
 
 namespace QuantLib {
 
+    namespace detail {
+
+        inline void no_deletion(Observer*) {}
+
+        /* The steps below are shared by the bootstrappers. Since only
+           the bootstrapper of a curve is its friend, they are given
+           the curve members they modify. */
+
+        /* sorts the helpers, sets the pillar dates and times, the
+           curve's max date and the errors of the alive helpers.
+           Returns true if any pillar date differs from the latest
+           relevant date of its helper. */
+        template <class Curve>
+        bool initializePillars(
+            const Curve* ts,
+            std::vector<boost::shared_ptr<
+                typename Curve::traits_type::helper> >& instruments,
+            std::vector<Date>& dates, std::vector<Time>& times,
+            Date& curveMaxDate, Size& firstAliveHelper, Size& alive,
+            std::vector<boost::shared_ptr<BootstrapError<Curve> > >& errors) {
+            typedef typename Curve::traits_type Traits;
+            typedef typename Curve::interpolator_type Interpolator;
+            Size n = instruments.size();
+            // ensure helpers are sorted
+            std::sort(instruments.begin(), instruments.end(),
+                      BootstrapHelperSorter());
+            // skip expired helpers
+            Date firstDate = Traits::initialDate(ts);
+            QL_REQUIRE(instruments[n-1]->pillarDate()>firstDate,
+                       "all instruments expired");
+            firstAliveHelper = 0;
+            while (instruments[firstAliveHelper]->pillarDate() <= firstDate)
+                ++firstAliveHelper;
+            alive = n-firstAliveHelper;
+            QL_REQUIRE(alive>=Interpolator::requiredPoints-1,
+                       "not enough alive instruments: " << alive <<
+                       " provided, " << Interpolator::requiredPoints-1 <<
+                       " required");
+
+            // calculate dates and times, create errors
+            dates.resize(alive+1);
+            times.resize(alive+1);
+            errors.resize(alive+1);
+            dates[0] = firstDate;
+            times[0] = ts->timeFromReference(dates[0]);
+
+            bool pillarsDiffer = false;
+            Date latestRelevantDate, maxDate = firstDate;
+            // pillar counter: i
+            // helper counter: j
+            for (Size i=1, j=firstAliveHelper; j<n; ++i, ++j) {
+                const boost::shared_ptr<typename Traits::helper>& helper =
+                                                            instruments[j];
+                dates[i] = helper->pillarDate();
+                times[i] = ts->timeFromReference(dates[i]);
+                // check for duplicated pillars
+                QL_REQUIRE(dates[i-1]!=dates[i],
+                           "more than one instrument with pillar " <<
+                           dates[i]);
+
+                latestRelevantDate = helper->latestRelevantDate();
+                // check that the helper is really extending the curve,
+                // i.e. that pillar-sorted helpers are also sorted by
+                // latestRelevantDate
+                QL_REQUIRE(latestRelevantDate > maxDate,
+                           io::ordinal(j+1) << " instrument (pillar: " <<
+                           dates[i] << ") has latestRelevantDate (" <<
+                           latestRelevantDate << ") before or equal to "
+                           "previous instrument's latestRelevantDate (" <<
+                           maxDate << ")");
+                maxDate = latestRelevantDate;
+
+                if (dates[i] != latestRelevantDate)
+                    pillarsDiffer = true;
+
+                errors[i] = boost::shared_ptr<BootstrapError<Curve> >(new
+                    BootstrapError<Curve>(ts, helper, i));
+            }
+            curveMaxDate = maxDate;
+            return pillarsDiffer;
+        }
+
+        // checks the quotes of the alive helpers and links them to
+        // the curve
+        template <class Curve>
+        void setupHelpers(
+            Curve* ts,
+            const std::vector<boost::shared_ptr<
+                typename Curve::traits_type::helper> >& instruments,
+            Size firstAliveHelper) {
+            for (Size j=firstAliveHelper; j<instruments.size(); ++j) {
+                const boost::shared_ptr<
+                    typename Curve::traits_type::helper>& helper =
+                                                            instruments[j];
+                // check for valid quote
+                QL_REQUIRE(helper->quote()->isValid(),
+                           io::ordinal(j + 1) << " instrument (maturity: " <<
+                           helper->maturityDate() << ", pillar: " <<
+                           helper->pillarDate() << ") has an invalid quote");
+                // don't try this at home!
+                // This call creates helpers, and removes "const".
+                // There is a significant interaction with observability.
+                helper->setTermStructure(ts);
+            }
+        }
+
+        // brackets the root for the i-th pillar and returns the guess
+        template <class Curve>
+        Real pillarGuess(const Curve* ts, Size i, bool validData,
+                         Size firstAliveHelper, Real& min, Real& max) {
+            typedef typename Curve::traits_type Traits;
+            min = Traits::minValueAfter(i, ts, validData, firstAliveHelper);
+            max = Traits::maxValueAfter(i, ts, validData, firstAliveHelper);
+            Real guess = Traits::guess(i, ts, validData, firstAliveHelper);
+            // adjust guess if needed
+            if (guess>=max)
+                guess = max - (max-min)/5.0;
+            else if (guess<=min)
+                guess = min + (max-min)/5.0;
+            return guess;
+        }
+
+        // extends the interpolation a point at a time including the
+        // i-th pillar, which is to be bootstrapped
+        template <class Interpolator>
+        void extendInterpolation(Interpolation& interpolation,
+                                 const Interpolator& interpolator,
+                                 const std::vector<Time>& times,
+                                 const std::vector<Real>& data, Size i) {
+            try {
+                interpolation = interpolator.interpolate(
+                    times.begin(), times.begin()+i+1, data.begin());
+            } catch (...) {
+                if (!Interpolator::global)
+                    throw; // no chance to fix it in a later iteration
+
+                // otherwise use Linear while the target
+                // interpolation is not usable yet
+                interpolation = Linear().interpolate(
+                    times.begin(), times.begin()+i+1, data.begin());
+            }
+            interpolation.update();
+        }
+
+    }
+
     //! Universal piecewise-term-structure boostrapper.
+    /*! For local interpolations, where each helper only depends on
+        the curve up to its pillar, a non-moving curve is only
+        rebootstrapped from the first pillar whose helper sent a
+        notification since the last calculation; the pillars before
+        are kept. This makes recalculations after single quote
+        changes, e.g. under a market data feed, much cheaper. Any
+        other notification received by the curve (e.g. from jumps)
+        triggers a full rebootstrap.
+    */
     template <class Curve>
     class IterativeBootstrap {
         typedef typename Curve::traits_type Traits;
@@ -47,6 +203,7 @@ namespace QuantLib {
         void calculate() const;
       private:
         void initialize() const;
+        Size firstAffectedPillar() const;
         Curve* ts_;
         Size n_;
         Brent firstSolver_;
@@ -55,6 +212,12 @@ namespace QuantLib {
         mutable Size firstAliveHelper_, alive_;
         mutable std::vector<Real> previousData_;
         mutable std::vector<boost::shared_ptr<BootstrapError<Curve> > > errors_;
+        // notifications received since the last calculation, from each
+        // (sorted) helper and from all other observables of the curve
+        mutable std::vector<boost::shared_ptr<NotificationFlag> > helperFlags_;
+        mutable std::vector<boost::shared_ptr<typename Traits::helper> >
+                                                            flaggedHelpers_;
+        boost::shared_ptr<NotificationFlag> otherFlag_;
     };
 
 
@@ -74,69 +237,45 @@ namespace QuantLib {
         for (Size j=0; j<n_; ++j)
             ts_->registerWith(ts_->instruments_[j]);
 
+        otherFlag_ = boost::shared_ptr<NotificationFlag>(
+                                                        new NotificationFlag);
+        otherFlag_->registerWithObservables(
+                     boost::shared_ptr<Observer>(ts_, detail::no_deletion));
+        for (Size j=0; j<n_; ++j)
+            otherFlag_->unregisterWith(ts_->instruments_[j]);
+
         // do not initialize yet: instruments could be invalid here
         // but valid later when bootstrapping is actually required
     }
 
     template <class Curve>
     void IterativeBootstrap<Curve>::initialize() const {
-        // ensure helpers are sorted
-        std::sort(ts_->instruments_.begin(), ts_->instruments_.end(),
-                  detail::BootstrapHelperSorter());
-        // skip expired helpers
-        Date firstDate = Traits::initialDate(ts_);
-        QL_REQUIRE(ts_->instruments_[n_-1]->pillarDate()>firstDate,
-                   "all instruments expired");
-        firstAliveHelper_ = 0;
-        while (ts_->instruments_[firstAliveHelper_]->pillarDate() <= firstDate)
-            ++firstAliveHelper_;
-        alive_ = n_-firstAliveHelper_;
-        QL_REQUIRE(alive_>=Interpolator::requiredPoints-1,
-                   "not enough alive instruments: " << alive_ <<
-                   " provided, " << Interpolator::requiredPoints-1 <<
-                   " required");
-
-        // calculate dates and times, create errors_
-        std::vector<Date>& dates = ts_->dates_;
-        std::vector<Time>& times = ts_->times_;
-        dates.resize(alive_+1);
-        times.resize(alive_+1);
-        errors_.resize(alive_+1);
-        dates[0] = firstDate;
-        times[0] = ts_->timeFromReference(dates[0]);
-
-        Date latestRelevantDate, maxDate = firstDate;
-        // pillar counter: i
-        // helper counter: j
-        for (Size i=1, j=firstAliveHelper_; j<n_; ++i, ++j) {
-            const boost::shared_ptr<typename Traits::helper>& helper =
-                                                        ts_->instruments_[j];
-            dates[i] = helper->pillarDate();
-            times[i] = ts_->timeFromReference(dates[i]);
-            // check for duplicated pillars
-            QL_REQUIRE(dates[i-1]!=dates[i],
-                       "more than one instrument with pillar " << dates[i]);
-
-            latestRelevantDate = helper->latestRelevantDate();
-            // check that the helper is really extending the curve, i.e. that
-            // pillar-sorted helpers are also sorted by latestRelevantDate
-            QL_REQUIRE(latestRelevantDate > maxDate,
-                       io::ordinal(j+1) << " instrument (pillar: " <<
-                       dates[i] << ") has latestRelevantDate (" <<
-                       latestRelevantDate << ") before or equal to "
-                       "previous instrument's latestRelevantDate (" <<
-                       maxDate << ")");
-            maxDate = latestRelevantDate;
-
-            // when a pillar date is different from the last relevant date the
-            // convergence loop is required even if the Interpolator is local
-            if (dates[i] != latestRelevantDate)
-                loopRequired_ = true;
-
-            errors_[i] = boost::shared_ptr<BootstrapError<Curve> >(new
-                BootstrapError<Curve>(ts_, helper, i));
+        // when a pillar date is different from the last relevant date the
+        // convergence loop is required even if the Interpolator is local
+        if (detail::initializePillars(ts_, ts_->instruments_, ts_->dates_,
+                                      ts_->times_, ts_->maxDate_,
+                                      firstAliveHelper_, alive_, errors_))
+            loopRequired_ = true;
+
+        // track the notifications of the helpers in their sorted order;
+        // the flags are kept and only registered again with the helpers
+        // which changed their position, those count as notified
+        if (helperFlags_.size() != n_) {
+            helperFlags_.resize(n_);
+            for (Size j=0; j<n_; ++j)
+                helperFlags_[j] = boost::shared_ptr<NotificationFlag>(
+                                                        new NotificationFlag);
+            flaggedHelpers_.clear();
+        }
+        flaggedHelpers_.resize(n_);
+        for (Size j=0; j<n_; ++j) {
+            if (flaggedHelpers_[j] != ts_->instruments_[j]) {
+                helperFlags_[j]->unregisterWithAll();
+                helperFlags_[j]->registerWith(ts_->instruments_[j]);
+                helperFlags_[j]->notified = true;
+                flaggedHelpers_[j] = ts_->instruments_[j];
+            }
         }
-        ts_->maxDate_ = maxDate;
 
         // set initial guess only if the current curve cannot be used as guess
         if (!validCurve_ || ts_->data_.size()!=alive_+1) {
@@ -149,6 +288,21 @@ namespace QuantLib {
         initialized_ = true;
     }
 
+    template <class Curve>
+    Size IterativeBootstrap<Curve>::firstAffectedPillar() const {
+        // without a valid curve, or if the curve might depend on
+        // anything but the helpers, we have to start from scratch
+        if (!validCurve_ || loopRequired_ || ts_->moving_ ||
+            otherFlag_->notified)
+            return 1;
+        for (Size j=firstAliveHelper_; j<n_; ++j) {
+            if (helperFlags_[j]->notified)
+                return j-firstAliveHelper_+1;
+        }
+        // no notification at all, e.g. on an explicit recalculate()
+        return 1;
+    }
+
     template <class Curve>
     void IterativeBootstrap<Curve>::calculate() const {
 
@@ -160,20 +314,7 @@ namespace QuantLib {
         if (!initialized_ || ts_->moving_)
             initialize();
 
-        // setup helpers
-        for (Size j=firstAliveHelper_; j<n_; ++j) {
-            const boost::shared_ptr<typename Traits::helper>& helper =
-                                                        ts_->instruments_[j];
-            // check for valid quote
-            QL_REQUIRE(helper->quote()->isValid(),
-                       io::ordinal(j + 1) << " instrument (maturity: " <<
-                       helper->maturityDate() << ", pillar: " <<
-                       helper->pillarDate() << ") has an invalid quote");
-            // don't try this at home!
-            // This call creates helpers, and removes "const".
-            // There is a significant interaction with observability.
-            helper->setTermStructure(const_cast<Curve*>(ts_));
-        }
+        detail::setupHelpers(ts_, ts_->instruments_, firstAliveHelper_);
 
         const std::vector<Time>& times = ts_->times_;
         const std::vector<Real>& data = ts_->data_;
@@ -184,41 +325,25 @@ namespace QuantLib {
         // there might be a valid curve state to use as guess
         bool validData = validCurve_;
 
+        // pillars before this one are unaffected by the notifications
+        // received since the last calculation
+        Size firstPillar = firstAffectedPillar();
+
         for (Size iteration=0; ; ++iteration) {
             previousData_ = ts_->data_;
 
-            for (Size i=1; i<=alive_; ++i) { // pillar loop
+            for (Size i=firstPillar; i<=alive_; ++i) { // pillar loop
 
                 // bracket root and calculate guess
-                Real min = Traits::minValueAfter(i, ts_, validData,
-                                                            firstAliveHelper_);
-                Real max = Traits::maxValueAfter(i, ts_, validData,
-                                                            firstAliveHelper_);
-                Real guess = Traits::guess(i, ts_, validData,
-                                                            firstAliveHelper_);
-                // adjust guess if needed
-                if (guess>=max)
-                    guess = max - (max-min)/5.0;
-                else if (guess<=min)
-                    guess = min + (max-min)/5.0;
+                Real min, max;
+                Real guess = detail::pillarGuess(ts_, i, validData,
+                                                 firstAliveHelper_, min, max);
 
                 // extend interpolation if needed
-                if (!validData) {
-                    try { // extend interpolation a point at a time
-                          // including the pillar to be boostrapped
-                        ts_->interpolation_ = ts_->interpolator_.interpolate(
-                            times.begin(), times.begin()+i+1, data.begin());
-                    } catch (...) {
-                        if (!Interpolator::global)
-                            throw; // no chance to fix it in a later iteration
-
-                        // otherwise use Linear while the target
-                        // interpolation is not usable yet
-                        ts_->interpolation_ = Linear().interpolate(
-                            times.begin(), times.begin()+i+1, data.begin());
-                    }
-                    ts_->interpolation_.update();
-                }
+                if (!validData)
+                    detail::extendInterpolation(ts_->interpolation_,
+                                                ts_->interpolator_,
+                                                times, data, i);
 
                 try {
                     if (validData)
@@ -259,6 +384,12 @@ namespace QuantLib {
             validData = true;
         }
         validCurve_ = true;
+
+        // notifications sent during the calculation (e.g. when the
+        // helpers are linked to the curve) do not invalidate it
+        otherFlag_->notified = false;
+        for (Size j=0; j<n_; ++j)
+            helperFlags_[j]->notified = false;
     }
 
 }
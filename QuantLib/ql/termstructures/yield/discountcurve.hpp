@@ -5,6 +5,7 @@
  Copyright (C) 2005, 2006, 2008, 2009 StatPro Italia srl
  Copyright (C) 2009, 2015 Ferdinando Ametrano
  Copyright (C) 2015 Paolo Mazzocchi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -32,6 +33,7 @@
 #include <ql/math/interpolations/loginterpolation.hpp>
 #include <ql/math/comparison.hpp>
 #include <utility>
+#include <algorithm>
 
 namespace QuantLib {
 
@@ -95,6 +97,8 @@ namespace QuantLib {
         //! \name YieldTermStructure implementation
         //@{
         DiscountFactor discountImpl(Time) const;
+        void discountsImpl(const std::vector<Time>& t,
+                           std::vector<DiscountFactor>& d) const;
         //@}
         mutable std::vector<Date> dates_;
       private:
@@ -168,6 +172,25 @@ namespace QuantLib {
         return dMax * std::exp(- instFwdMax * (t-tMax));
     }
 
+    template <class T>
+    void InterpolatedDiscountCurve<T>::discountsImpl(
+                                     const std::vector<Time>& t,
+                                     std::vector<DiscountFactor>& d) const {
+        // the times are sorted, so that the extrapolated ones follow
+        // the interpolated ones
+        Time tMax = this->times_.back();
+        Size n = std::upper_bound(t.begin(), t.end(), tMax) - t.begin();
+        this->interpolation_(t.begin(), t.begin()+n, d.begin(), true);
+        if (n == t.size())
+            return;
+
+        // flat fwd extrapolation
+        DiscountFactor dMax = this->data_.back();
+        Rate instFwdMax = - this->interpolation_.derivative(tMax) / dMax;
+        for (Size i=n; i<t.size(); ++i)
+            d[i] = dMax * std::exp(- instFwdMax * (t[i]-tMax));
+    }
+
     template <class T>
     InterpolatedDiscountCurve<T>::InterpolatedDiscountCurve(
                                     const DayCounter& dayCounter,
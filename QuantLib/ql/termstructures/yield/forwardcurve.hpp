@@ -4,6 +4,7 @@
  Copyright (C) 2005, 2006, 2007, 2008, 2009 StatPro Italia srl
  Copyright (C) 2009, 2015 Ferdinando Ametrano
  Copyright (C) 2015 Paolo Mazzocchi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -31,6 +32,7 @@
 #include <ql/math/interpolations/backwardflatinterpolation.hpp>
 #include <ql/math/comparison.hpp>
 #include <utility>
+#include <algorithm>
 
 namespace QuantLib {
 
@@ -97,6 +99,11 @@ namespace QuantLib {
         Rate forwardImpl(Time t) const;
         Rate zeroYieldImpl(Time t) const;
         //@}
+        //! \name YieldTermStructure implementation
+        //@{
+        void discountsImpl(const std::vector<Time>& t,
+                           std::vector<DiscountFactor>& d) const;
+        //@}
         mutable std::vector<Date> dates_;
       private:
         void initialize();
@@ -179,6 +186,29 @@ namespace QuantLib {
         return integral/t;
     }
 
+    template <class T>
+    void InterpolatedForwardCurve<T>::discountsImpl(
+                                     const std::vector<Time>& t,
+                                     std::vector<DiscountFactor>& d) const {
+        // the times are sorted, so that the extrapolated ones follow
+        // the interpolated ones
+        Time tMax = this->times_.back();
+        Size n = std::upper_bound(t.begin(), t.end(), tMax) - t.begin();
+        for (Size i=0; i<n; ++i) {
+            // see ForwardRateStructure::discountImpl()
+            d[i] = t[i] == 0.0 ? 1.0 :
+                std::exp(-this->interpolation_.primitive(t[i], true));
+        }
+        if (n == t.size())
+            return;
+
+        // flat fwd extrapolation
+        Real integralMax = this->interpolation_.primitive(tMax, true);
+        Rate fMax = this->data_.back();
+        for (Size i=n; i<t.size(); ++i)
+            d[i] = std::exp(-(integralMax + fMax * (t[i]-tMax)));
+    }
+
     template <class T>
     InterpolatedForwardCurve<T>::InterpolatedForwardCurve(
                                     const DayCounter& dayCounter,
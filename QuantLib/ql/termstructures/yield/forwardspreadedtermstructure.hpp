@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2000, 2001, 2002, 2003 RiskMap srl
  Copyright (C) 2003, 2004, 2008 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -67,6 +68,12 @@ namespace QuantLib {
         /* This method must disappear should the spread become a curve */
         Rate zeroYieldImpl(Time t) const;
         //@}
+        //! \name YieldTermStructure implementation
+        //@{
+        //! forwards the batch to the original curve
+        void discountsImpl(const std::vector<Time>& t,
+                           std::vector<DiscountFactor>& d) const;
+        //@}
       private:
         Handle<YieldTermStructure> originalCurve_;
         Handle<Quote> spread_;
@@ -126,6 +133,20 @@ namespace QuantLib {
             + spread_->value();
     }
 
+    inline void ForwardSpreadedTermStructure::discountsImpl(
+                                     const std::vector<Time>& t,
+                                     std::vector<DiscountFactor>& d) const {
+        originalCurve_->discount(t, d, true);
+        Spread spread = spread_->value();
+        for (Size i=0; i<t.size(); ++i) {
+            // see ForwardRateStructure::discountImpl() and zeroYieldImpl()
+            if (t[i] == 0.0)
+                d[i] = 1.0;
+            else
+                d[i] *= std::exp(-spread*t[i]);
+        }
+    }
+
 }
 
 #endif
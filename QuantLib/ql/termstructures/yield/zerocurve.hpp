@@ -4,6 +4,7 @@
  Copyright (C) 2003, 2004, 2005, 2006, 2007, 2008 StatPro Italia srl
  Copyright (C) 2009, 2015 Ferdinando Ametrano
  Copyright (C) 2015 Paolo Mazzocchi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -33,6 +34,7 @@
 #include <ql/math/comparison.hpp>
 #include <ql/utilities/dataformatters.hpp>
 #include <utility>
+#include <algorithm>
 
 namespace QuantLib {
 
@@ -104,6 +106,11 @@ namespace QuantLib {
         //@{
         Rate zeroYieldImpl(Time t) const;
         //@}
+        //! \name YieldTermStructure implementation
+        //@{
+        void discountsImpl(const std::vector<Time>& t,
+                           std::vector<DiscountFactor>& d) const;
+        //@}
         mutable std::vector<Date> dates_;
       private:
         void initialize(const Compounding& compounding, const Frequency& frequency);
@@ -170,6 +177,30 @@ namespace QuantLib {
         return (zMax * tMax + instFwdMax * (t-tMax)) / t;
     }
 
+    template <class T>
+    void InterpolatedZeroCurve<T>::discountsImpl(
+                                     const std::vector<Time>& t,
+                                     std::vector<DiscountFactor>& d) const {
+        // the times are sorted, so that the extrapolated ones follow
+        // the interpolated ones
+        Time tMax = this->times_.back();
+        Size n = std::upper_bound(t.begin(), t.end(), tMax) - t.begin();
+        Size hint = 0;
+        for (Size i=0; i<n; ++i) {
+            // see ZeroYieldStructure::discountImpl()
+            d[i] = t[i] == 0.0 ? 1.0 :
+                std::exp(-this->interpolation_(t[i], hint, true) * t[i]);
+        }
+        if (n == t.size())
+            return;
+
+        // flat fwd extrapolation
+        Rate zMax = this->data_.back();
+        Rate instFwdMax = zMax + tMax * this->interpolation_.derivative(tMax);
+        for (Size i=n; i<t.size(); ++i)
+            d[i] = std::exp(-(zMax * tMax + instFwdMax * (t[i]-tMax)));
+    }
+
     template <class T>
     InterpolatedZeroCurve<T>::InterpolatedZeroCurve(
                                     const DayCounter& dayCounter,
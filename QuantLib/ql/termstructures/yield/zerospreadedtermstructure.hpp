@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2000, 2001, 2002, 2003 RiskMap srl
  Copyright (C) 2007, 2008 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -69,6 +70,9 @@ namespace QuantLib {
         //! returns the spreaded forward rate
         /* This method must disappear should the spread become a curve */
         Rate forwardImpl(Time) const;
+        //! forwards the batch to the original curve
+        void discountsImpl(const std::vector<Time>& t,
+                           std::vector<DiscountFactor>& d) const;
       private:
         Handle<YieldTermStructure> originalCurve_;
         Handle<Quote> spread_;
@@ -138,6 +142,29 @@ namespace QuantLib {
         return spreadedRate.equivalentRate(Continuous, NoFrequency, t);
     }
 
+    inline void ZeroSpreadedTermStructure::discountsImpl(
+                                     const std::vector<Time>& t,
+                                     std::vector<DiscountFactor>& d) const {
+        originalCurve_->discount(t, d, true);
+        Spread spread = spread_->value();
+        DayCounter dc = originalCurve_->dayCounter();
+        for (Size i=0; i<t.size(); ++i) {
+            // see ZeroYieldStructure::discountImpl() and zeroYieldImpl()
+            if (t[i] == 0.0) {
+                d[i] = 1.0;
+            } else {
+                InterestRate zeroRate =
+                    InterestRate::impliedRate(1.0/d[i], dc, comp_, freq_,
+                                              t[i]);
+                InterestRate spreadedRate(zeroRate + spread, dc,
+                                          comp_, freq_);
+                Rate r = spreadedRate.equivalentRate(Continuous, NoFrequency,
+                                                     t[i]);
+                d[i] = std::exp(-r*t[i]);
+            }
+        }
+    }
+
     inline Rate ZeroSpreadedTermStructure::forwardImpl(Time t) const {
         return originalCurve_->forwardRate(t, t, comp_, freq_, true)
             + spread_->value();
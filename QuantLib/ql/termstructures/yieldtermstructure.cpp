@@ -4,6 +4,7 @@
  Copyright (C) 2004, 2009 Ferdinando Ametrano
  Copyright (C) 2000, 2001, 2002, 2003 RiskMap srl
  Copyright (C) 2003, 2004, 2005, 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -21,6 +22,7 @@
 
 #include <ql/termstructures/yieldtermstructure.hpp>
 #include <ql/utilities/dataformatters.hpp>
+#include <algorithm>
 
 namespace QuantLib {
 
@@ -109,6 +111,48 @@ namespace QuantLib {
 
     }
 
+    void YieldTermStructure::discount(const std::vector<Time>& t,
+                                      std::vector<DiscountFactor>& discounts,
+                                      bool extrapolate) const {
+        discounts.resize(t.size());
+        if (t.empty())
+            return;
+
+        for (Size i=1; i<t.size(); ++i)
+            QL_REQUIRE(t[i-1]<=t[i], "times must be non-decreasing, " <<
+                       io::ordinal(i) << " time is " << t[i-1] << ", " <<
+                       io::ordinal(i+1) << " time is " << t[i]);
+        checkRange(t.front(), extrapolate);
+        checkRange(t.back(), extrapolate);
+
+        discountsImpl(t, discounts);
+
+        // each jump applies to all times after it
+        for (Size i=0; i<nJumps_; ++i) {
+            if (jumpTimes_[i]>0) {
+                Size first = std::upper_bound(t.begin(), t.end(),
+                                              jumpTimes_[i]) - t.begin();
+                if (first==t.size())
+                    continue;
+                QL_REQUIRE(jumps_[i]->isValid(),
+                           "invalid " << io::ordinal(i+1) << " jump quote");
+                DiscountFactor thisJump = jumps_[i]->value();
+                QL_REQUIRE(thisJump>0.0 && thisJump<=1.0,
+                           "invalid " << io::ordinal(i+1) << " jump value: " <<
+                           thisJump);
+                for (Size j=first; j<t.size(); ++j)
+                    discounts[j] *= thisJump;
+            }
+        }
+    }
+
+    void YieldTermStructure::discountsImpl(
+                                     const std::vector<Time>& t,
+                                     std::vector<DiscountFactor>& d) const {
+        for (Size i=0; i<t.size(); ++i)
+            d[i] = discountImpl(t[i]);
+    }
+
     InterestRate YieldTermStructure::zeroRate(const Date& d,
                                               const DayCounter& dayCounter,
                                               Compounding comp,
@@ -4,6 +4,7 @@
  Copyright (C) 2004, 2009 Ferdinando Ametrano
  Copyright (C) 2000, 2001, 2002, 2003 RiskMap srl
  Copyright (C) 2003, 2004, 2005, 2006 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -77,6 +78,13 @@ namespace QuantLib {
         */
         DiscountFactor discount(Time t,
                                 bool extrapolate = false) const;
+        /*! Discount factors for a sequence of non-decreasing times,
+            which are written to the given vector. This is usually
+            faster than retrieving them one at a time.
+        */
+        void discount(const std::vector<Time>& t,
+                      std::vector<DiscountFactor>& discounts,
+                      bool extrapolate = false) const;
         //@}
 
         /*! \name Zero-yield rates
@@ -168,6 +176,12 @@ namespace QuantLib {
         //@{
         //! discount factor calculation
         virtual DiscountFactor discountImpl(Time) const = 0;
+        /*! discount factor calculation for non-decreasing times; the
+            default implementation calls discountImpl(Time) for each
+            of them, derived classes can provide a faster one.
+        */
+        virtual void discountsImpl(const std::vector<Time>& t,
+                                   std::vector<DiscountFactor>& d) const;
         //@}
       private:
         // methods
@@ -5,6 +5,7 @@
  Copyright (C) 2003, 2004, 2005, 2006, 2007 StatPro Italia srl
  Copyright (C) 2004 Jeff Yu
  Copyright (C) 2014 Paolo Mazzocchi
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -21,11 +22,152 @@
 */
 
 #include <ql/time/calendar.hpp>
+#include <ql/utilities/null.hpp>
 #include <ql/errors.hpp>
+#include <algorithm>
 
 namespace QuantLib {
 
+    // business day table
+
+    Calendar::BusinessDayTable::BusinessDayTable(std::vector<Word>& bits,
+                                                 BigInteger firstCovered,
+                                                 BigInteger lastCovered,
+                                                 Size revision)
+    : firstCovered_(firstCovered), lastCovered_(lastCovered),
+      revision_(revision) {
+        QL_REQUIRE(bits.size() == words(),
+                   "bitmap has " << bits.size() << " words, " <<
+                   words() << " required");
+        bits_.swap(bits);
+        // only the covered range is tabulated
+        for (Size w=0; w<bits_.size(); ++w) {
+            BigInteger lo = static_cast<BigInteger>(w*64), hi = lo + 63;
+            if (hi < firstCovered_ || lo > lastCovered_) {
+                bits_[w] = 0;
+            } else {
+                if (lo < firstCovered_)
+                    bits_[w] &= ~Word(0) << (firstCovered_ - lo);
+                if (hi > lastCovered_)
+                    bits_[w] &= ~Word(0) >> (hi - lastCovered_);
+            }
+        }
+        counts_.resize(bits_.size() + 1, 0);
+        for (Size w=0; w<bits_.size(); ++w)
+            counts_[w+1] = counts_[w] + bitCount(bits_[w]);
+    }
+
+    Size Calendar::BusinessDayTable::words() {
+        // leaves room for one serial number past the maximum date
+        return static_cast<Size>(Date::maxDate().serialNumber()) / 64 + 1;
+    }
+
+    BigInteger Calendar::BusinessDayTable::select(BigInteger r) const {
+        if (r < 0 || r >= counts_.back())
+            return Null<BigInteger>();
+        // the last word with less than or r business days before it
+        Size w = std::upper_bound(counts_.begin(), counts_.end(), r)
+            - counts_.begin() - 1;
+        Word b = bits_[w];
+        // clear the lowest bits and return the position of the next one
+        for (BigInteger k = r - counts_[w]; k > 0; --k)
+            b &= b - 1;
+        Size i = 0;
+        while (((b >> i) & 1) == 0)
+            ++i;
+        return static_cast<BigInteger>(w*64 + i);
+    }
+
+    const Calendar::BusinessDayTable*
+    Calendar::Impl::updateBusinessDays() const {
+        // one thread builds the table, the others wait until it is done
+        // (building takes place once per calendar and holiday change)
+        while (building_.exchange(true, boost::memory_order_acquire)) {}
+        const BusinessDayTable* table;
+        try {
+            // read the revision first, building the bitmap of a joint
+            // calendar may update the tables of the underlying calendars
+            Size rev = revision();
+            table = table_.load(boost::memory_order_relaxed);
+            if (table == 0 || table->revision() != rev) {
+                std::vector<BusinessDayTable::Word> bits(
+                                             BusinessDayTable::words(), 0);
+                BigInteger first = 1, last = 0;
+                businessDayBitmap(bits, first, last);
+                std::set<Date>::const_iterator i;
+                for (i=addedHolidays.begin(); i!=addedHolidays.end(); ++i) {
+                    BigInteger s = i->serialNumber();
+                    bits[s >> 6] &= ~(BusinessDayTable::Word(1) << (s & 63));
+                }
+                for (i=removedHolidays.begin(); i!=removedHolidays.end();
+                     ++i) {
+                    BigInteger s = i->serialNumber();
+                    bits[s >> 6] |= BusinessDayTable::Word(1) << (s & 63);
+                }
+                businessDays_ = boost::shared_ptr<BusinessDayTable>(
+                                   new BusinessDayTable(bits, first, last,
+                                                        rev));
+                table = businessDays_.get();
+                table_.store(table, boost::memory_order_release);
+            }
+        } catch (...) {
+            building_.store(false, boost::memory_order_release);
+            throw;
+        }
+        building_.store(false, boost::memory_order_release);
+        return table;
+    }
+
+    void Calendar::Impl::businessDayBitmap(
+                                std::vector<BusinessDayTable::Word>& bits,
+                                BigInteger& firstCovered,
+                                BigInteger& lastCovered) const {
+        Year minYear = Date::minDate().year(), maxYear = Date::maxDate().year();
+        // longest run of years for which the implementation works
+        Year first = 0, last = -1, runStart = minYear;
+        for (Year y = minYear; y <= maxYear + 1; ++y) {
+            bool valid = false;
+            if (y <= maxYear) {
+                BigInteger s0 = Date(1, January, y).serialNumber(),
+                           s1 = Date(31, December, y).serialNumber();
+                try {
+                    for (BigInteger s = s0; s <= s1; ++s) {
+                        if (isBusinessDay(Date(s)))
+                            bits[s >> 6] |=
+                                BusinessDayTable::Word(1) << (s & 63);
+                    }
+                    valid = true;
+                } catch (std::exception&) {
+                    // clear the bits set before the failure
+                    for (BigInteger s = s0; s <= s1; ++s)
+                        bits[s >> 6] &=
+                            ~(BusinessDayTable::Word(1) << (s & 63));
+                }
+            }
+            if (!valid) {
+                if (y - runStart > last - first + 1) {
+                    first = runStart;
+                    last = y - 1;
+                }
+                runStart = y + 1;
+            }
+        }
+        if (first <= last) {
+            firstCovered = Date(1, January, first).serialNumber();
+            lastCovered = Date(31, December, last).serialNumber();
+        }
+        // clear the valid years outside the longest run
+        for (BigInteger s = Date::minDate().serialNumber();
+             s <= Date::maxDate().serialNumber(); ++s) {
+            if (s < firstCovered || s > lastCovered)
+                bits[s >> 6] &= ~(BusinessDayTable::Word(1) << (s & 63));
+        }
+    }
+
+    // calendar interface
+
     void Calendar::addHoliday(const Date& d) {
+        impl_->invalidateBusinessDays();
         // if d was a genuine holiday previously removed, revert the change
         impl_->removedHolidays.erase(d);
         // if it's already a holiday, leave the calendar alone.
@@ -35,6 +177,7 @@ namespace QuantLib {
     }
 
     void Calendar::removeHoliday(const Date& d) {
+        impl_->invalidateBusinessDays();
         // if d was an artificially-added holiday, revert the change
         impl_->addedHolidays.erase(d);
         // if it's already a business day, leave the calendar alone.
@@ -97,6 +240,17 @@ namespace QuantLib {
         if (n == 0) {
             return adjust(d,c);
         } else if (unit == Days) {
+            const BusinessDayTable& table = impl_->businessDays();
+            BigInteger s = d.serialNumber();
+            if (table.covers(s)) {
+                // the business day with the appropriate rank, if it is
+                // not tabulated we fall back to walking day by day
+                BigInteger r = n > 0 ? table.rank(s+1) + n - 1
+                                     : table.rank(s) + n;
+                BigInteger result = table.select(r);
+                if (result != Null<BigInteger>())
+                    return Date(result);
+            }
             Date d1 = d;
             if (n > 0) {
                 while (n > 0) {
@@ -141,7 +295,12 @@ namespace QuantLib {
                                              bool includeLast) const {
         BigInteger wd = 0;
         if (from != to) {
-            if (from < to) {
+            const BusinessDayTable& table = impl_->businessDays();
+            BigInteger s0 = std::min(from, to).serialNumber(),
+                       s1 = std::max(from, to).serialNumber();
+            if (table.covers(s0) && table.covers(s1)) {
+                wd = table.rank(s1+1) - table.rank(s0);
+            } else if (from < to) {
                 // the last one is treated separately to avoid
                 // incrementing Date::maxDate()
                 for (Date d = from; d < to; ++d) {
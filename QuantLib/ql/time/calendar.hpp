@@ -4,6 +4,7 @@
  Copyright (C) 2000, 2001, 2002, 2003 RiskMap srl
  Copyright (C) 2003, 2004, 2005, 2006, 2007 StatPro Italia srl
  Copyright (C) 2006 Piter Dias
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -29,6 +30,8 @@
 #include <ql/time/date.hpp>
 #include <ql/time/businessdayconvention.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
 #include <set>
 #include <vector>
 #include <string>
@@ -45,6 +48,22 @@ namespace QuantLib {
         The Bridge pattern is used to provide the base behavior of the
         calendar, namely, to determine whether a date is a business day.
 
+        On first use, the business days of the whole date range are
+        tabulated as a bitmap together with cumulated counts, so that
+        checking a date, advancing by a number of business days and
+        counting business days between two dates take constant time
+        (up to a binary search in the latter two). The table is
+        shared by all instances linked to the same implementation and
+        rebuilt after holidays were added or removed. Dates for which
+        the implementation fails (e.g. years for which no data are
+        available) are not tabulated and evaluated by the
+        implementation as before.
+
+        The table is built on first use by a single thread, other
+        threads using the calendar at the same time wait for it. Adding
+        or removing holidays is not thread-safe though and must not
+        happen while the calendar is used by other threads.
+
         A calendar should be defined for specific exchange holiday schedule
         or for general country holiday schedule. Legacy city holiday schedule
         calendars will be moved to the exchange/country convention.
@@ -57,16 +76,91 @@ namespace QuantLib {
     */
     class Calendar {
       protected:
+        //! business days of a calendar as a bitmap
+        /*! Bit \f$ i \f$ stands for the date with serial number
+            \f$ i \f$. Only dates in the covered range are tabulated,
+            all other bits are zero.
+        */
+        class BusinessDayTable {
+          public:
+            typedef boost::uint64_t Word;
+            //! takes ownership of the bitmap by swapping its contents
+            BusinessDayTable(std::vector<Word>& bits,
+                             BigInteger firstCovered,
+                             BigInteger lastCovered,
+                             Size revision);
+            bool covers(BigInteger serialNumber) const;
+            bool isBusinessDay(BigInteger serialNumber) const;
+            //! number of business days before the given serial number
+            /*! the serial number may be one past the covered range */
+            BigInteger rank(BigInteger serialNumber) const;
+            /*! serial number of the business day with the given rank,
+                or null if there is no such business day in the table */
+            BigInteger select(BigInteger rank) const;
+            const std::vector<Word>& bits() const { return bits_; }
+            BigInteger firstCovered() const { return firstCovered_; }
+            BigInteger lastCovered() const { return lastCovered_; }
+            Size revision() const { return revision_; }
+            //! number of words in a bitmap
+            static Size words();
+          private:
+            static Size bitCount(Word);
+            std::vector<Word> bits_;
+            // number of business days in the words before each word
+            std::vector<BigInteger> counts_;
+            BigInteger firstCovered_, lastCovered_;
+            Size revision_;
+        };
         //! abstract base class for calendar implementations
         class Impl {
           public:
+            Impl();
             virtual ~Impl() {}
             virtual std::string name() const = 0;
             virtual bool isBusinessDay(const Date&) const = 0;
             virtual bool isWeekend(Weekday) const = 0;
             std::set<Date> addedHolidays, removedHolidays;
+            //! business day table, including added and removed holidays
+            const BusinessDayTable& businessDays() const;
+            /*! revision of the business days, the table is rebuilt
+                when it changes. Implementations depending on other
+                calendars must include their revisions.
+            */
+            virtual Size revision() const;
+            //! to be called whenever the business days change
+            void invalidateBusinessDays();
+          protected:
+            /*! sets the bits of the business days (disregarding added
+                and removed holidays) in the given bitmap, which is
+                initialized to zero, and returns the range of serial
+                numbers covered. By default the range is the longest
+                run of full years for which isBusinessDay() does not
+                throw.
+            */
+            virtual void businessDayBitmap(
+                                std::vector<BusinessDayTable::Word>& bits,
+                                BigInteger& firstCovered,
+                                BigInteger& lastCovered) const;
+          private:
+            Impl(const Impl&);
+            Impl& operator=(const Impl&);
+            const BusinessDayTable* updateBusinessDays() const;
+            // the table is owned by businessDays_ and published in
+            // table_, both are only written while building_ is set
+            mutable boost::shared_ptr<BusinessDayTable> businessDays_;
+            mutable boost::atomic<const BusinessDayTable*> table_;
+            mutable boost::atomic<bool> building_;
+            boost::atomic<Size> revision_;
         };
         boost::shared_ptr<Impl> impl_;
+        //! business day table of the given calendar
+        static const BusinessDayTable& businessDays(const Calendar& c) {
+            return c.impl_->businessDays();
+        }
+        //! business day revision of the given calendar
+        static Size revision(const Calendar& c) {
+            return c.impl_->revision();
+        }
       public:
         /*! The default constructor returns a calendar with a null
             implementation, which is therefore unusable except as a
@@ -192,7 +286,55 @@ namespace QuantLib {
         return impl_->name();
     }
 
+    inline bool Calendar::BusinessDayTable::covers(BigInteger s) const {
+        return s >= firstCovered_ && s <= lastCovered_;
+    }
+
+    inline bool Calendar::BusinessDayTable::isBusinessDay(
+                                                       BigInteger s) const {
+        Size i = static_cast<Size>(s);
+        return ((bits_[i >> 6] >> (i & 63)) & 1) != 0;
+    }
+
+    inline BigInteger Calendar::BusinessDayTable::rank(BigInteger s) const {
+        Size i = static_cast<Size>(s), b = i & 63;
+        BigInteger r = counts_[i >> 6];
+        if (b != 0)
+            r += bitCount(bits_[i >> 6] & ((Word(1) << b) - 1));
+        return r;
+    }
+
+    inline Size Calendar::BusinessDayTable::bitCount(Word w) {
+        w = w - ((w >> 1) & 0x5555555555555555ULL);
+        w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+        w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return static_cast<Size>((w * 0x0101010101010101ULL) >> 56);
+    }
+
+    inline Calendar::Impl::Impl()
+    : table_(0), building_(false), revision_(0) {}
+
+    inline const Calendar::BusinessDayTable&
+    Calendar::Impl::businessDays() const {
+        const BusinessDayTable* table =
+            table_.load(boost::memory_order_acquire);
+        if (table == 0 || table->revision() != revision())
+            table = updateBusinessDays();
+        return *table;
+    }
+
+    inline Size Calendar::Impl::revision() const {
+        return revision_.load(boost::memory_order_acquire);
+    }
+
+    inline void Calendar::Impl::invalidateBusinessDays() {
+        revision_.fetch_add(1, boost::memory_order_acq_rel);
+    }
+
     inline bool Calendar::isBusinessDay(const Date& d) const {
+        const BusinessDayTable& table = impl_->businessDays();
+        if (table.covers(d.serialNumber()))
+            return table.isBusinessDay(d.serialNumber());
         if (impl_->addedHolidays.find(d) != impl_->addedHolidays.end())
             return false;
         if (impl_->removedHolidays.find(d) != impl_->removedHolidays.end())
@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2003 RiskMap srl
  Copyright (C) 2007 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -20,6 +21,7 @@
 
 #include <ql/time/calendars/jointcalendar.hpp>
 #include <ql/errors.hpp>
+#include <algorithm>
 #include <sstream>
 
 namespace QuantLib {
@@ -114,6 +116,52 @@ namespace QuantLib {
         }
     }
 
+    Size JointCalendar::Impl::revision() const {
+        Size result = Calendar::Impl::revision();
+        for (Size j=0; j<calendars_.size(); ++j)
+            result += Calendar::revision(calendars_[j]);
+        return result;
+    }
+
+    void JointCalendar::Impl::businessDayBitmap(
+                                std::vector<BusinessDayTable::Word>& bits,
+                                BigInteger& firstCovered,
+                                BigInteger& lastCovered) const {
+        // combine the tables of the joint calendars, the result
+        // covers the dates covered by all of them
+        firstCovered = Date::minDate().serialNumber();
+        lastCovered = Date::maxDate().serialNumber();
+        for (Size j=0; j<calendars_.size(); ++j) {
+            const BusinessDayTable& table =
+                Calendar::businessDays(calendars_[j]);
+            const std::vector<BusinessDayTable::Word>& b = table.bits();
+            firstCovered = std::max(firstCovered, table.firstCovered());
+            lastCovered = std::min(lastCovered, table.lastCovered());
+            if (j == 0) {
+                bits = b;
+                continue;
+            }
+            switch (rule_) {
+              case JoinHolidays:
+                for (Size i=0; i<bits.size(); ++i)
+                    bits[i] &= b[i];
+                break;
+              case JoinBusinessDays:
+                for (Size i=0; i<bits.size(); ++i)
+                    bits[i] |= b[i];
+                break;
+              default:
+                QL_FAIL("unknown joint calendar rule");
+            }
+        }
+        // days outside the common range may be set by some calendars
+        for (BigInteger s = Date::minDate().serialNumber();
+             s <= Date::maxDate().serialNumber(); ++s) {
+            if (s < firstCovered || s > lastCovered)
+                bits[s >> 6] &= ~(BusinessDayTable::Word(1) << (s & 63));
+        }
+    }
+
 
     JointCalendar::JointCalendar(const Calendar& c1,
                                  const Calendar& c2,
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2003 RiskMap srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -65,6 +66,11 @@ namespace QuantLib {
             std::string name() const;
             bool isWeekend(Weekday) const;
             bool isBusinessDay(const Date&) const;
+            Size revision() const;
+          protected:
+            void businessDayBitmap(std::vector<BusinessDayTable::Word>&,
+                                   BigInteger& firstCovered,
+                                   BigInteger& lastCovered) const;
           private:
             JointCalendarRule rule_;
             std::vector<Calendar> calendars_;
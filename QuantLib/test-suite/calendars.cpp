@@ -5,6 +5,7 @@
  Copyright (C) 2005 Ferdinando Ametrano
  Copyright (C) 2006 Piter Dias
  Copyright (C) 2008 Charles Chongseok Hyun
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -31,6 +32,7 @@
 #include <ql/time/calendars/unitedstates.hpp>
 #include <ql/time/calendars/japan.hpp>
 #include <ql/time/calendars/southkorea.hpp>
+#include <ql/time/calendars/russia.hpp>
 #include <ql/time/calendars/jointcalendar.hpp>
 #include <ql/time/calendars/bespokecalendar.hpp>
 #include <ql/errors.hpp>
@@ -1003,6 +1005,170 @@ void CalendarTest::testBusinessDaysBetween() {
     }
 }
 
+namespace {
+
+    // gives access to the implementation, bypassing the table
+    class RuleBasedCalendar : public Calendar {
+      public:
+        explicit RuleBasedCalendar(const Calendar& c) : Calendar(c) {}
+        bool isRuleBasedBusinessDay(const Date& d) const {
+            if (impl_->addedHolidays.find(d) != impl_->addedHolidays.end())
+                return false;
+            if (impl_->removedHolidays.find(d) !=
+                impl_->removedHolidays.end())
+                return true;
+            return impl_->isBusinessDay(d);
+        }
+        // true if no bits are set outside the covered range
+        bool tableClearOutsideRange() const {
+            const BusinessDayTable& table = businessDays(*this);
+            for (BigInteger s = Date::minDate().serialNumber();
+                 s <= Date::maxDate().serialNumber(); ++s) {
+                if (!table.covers(s) && table.isBusinessDay(s))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    // swaps a holiday and a business day of a calendar and restores
+    // them on restore() or at the latest on destruction, so that other
+    // tests are not affected if this one is aborted
+    class SwappedHolidays {
+      public:
+        SwappedHolidays(const Calendar& c, const Date& holiday,
+                        const Date& businessDay)
+        : calendar_(c), holiday_(holiday), businessDay_(businessDay),
+          swapped_(true) {
+            calendar_.removeHoliday(holiday_);
+            calendar_.addHoliday(businessDay_);
+        }
+        ~SwappedHolidays() { restore(); }
+        void restore() {
+            if (swapped_) {
+                calendar_.addHoliday(holiday_);
+                calendar_.removeHoliday(businessDay_);
+                swapped_ = false;
+            }
+        }
+      private:
+        Calendar calendar_;
+        Date holiday_, businessDay_;
+        bool swapped_;
+    };
+
+}
+
+void CalendarTest::testBusinessDayTable() {
+
+    BOOST_TEST_MESSAGE("Testing tabulated business days against "
+                       "day-by-day calculation...");
+
+    // the MOEX calendar is defined from 2012 on only
+    Calendar moex = Russia(Russia::MOEX);
+    std::vector<Calendar> calendars;
+    calendars.push_back(UnitedStates(UnitedStates::NYSE));
+    calendars.push_back(moex);
+    calendars.push_back(JointCalendar(TARGET(), UnitedKingdom(),
+                                      JoinHolidays));
+    calendars.push_back(JointCalendar(TARGET(), Japan(), moex,
+                                      JoinBusinessDays));
+
+    // modifications of an underlying calendar must be reflected
+    // in a joint calendar whose table was already built
+    Calendar target = TARGET();
+    Date d1(1,May,2009), d2(27,April,2009);
+    QL_REQUIRE(calendars[2].isHoliday(d1) && calendars[2].isBusinessDay(d2),
+               "wrong assumption---correct the test");
+    SwappedHolidays swapped(target, d1, d2);
+    if (calendars[2].isBusinessDay(d2))
+        BOOST_ERROR(d2 << " still a business day for " << calendars[2]);
+
+    Date from(3,January,1990), to(31,December,2030);
+    for (Size i=0; i<calendars.size(); ++i) {
+        const Calendar& c = calendars[i];
+        RuleBasedCalendar r(c);
+        if (!r.tableClearOutsideRange())
+            BOOST_ERROR(c << ": business days set outside the tabulated "
+                        "range");
+        for (Date d = from; d <= to; d += 17) {
+            for (Integer n = -25; n <= 25; n += 5) {
+                if (n == 0)
+                    continue;
+                // reference calculation, stepping day by day
+                Date expected = d;
+                bool throws = false;
+                try {
+                    for (Integer k = 0; k < std::abs(n); ++k) {
+                        expected += n > 0 ? 1 : -1;
+                        while (!r.isRuleBasedBusinessDay(expected))
+                            expected += n > 0 ? 1 : -1;
+                    }
+                } catch (Error&) {
+                    throws = true;
+                }
+                Date calculated;
+                try {
+                    calculated = c.advance(d, n, Days);
+                } catch (Error&) {
+                    if (!throws)
+                        BOOST_FAIL(c << ": advancing " << d << " by " << n
+                                   << " business days throws, expected "
+                                   << expected);
+                    continue;
+                }
+                if (throws)
+                    BOOST_FAIL(c << ": advancing " << d << " by " << n
+                               << " business days gives " << calculated
+                               << ", expected an exception");
+                if (calculated != expected)
+                    BOOST_FAIL(c << ": advancing " << d << " by " << n
+                               << " business days gives " << calculated
+                               << ", expected " << expected);
+            }
+            Date e = d + 200;
+            BigInteger expected = 0;
+            bool throws = false;
+            try {
+                for (Date x = d; x <= e; ++x)
+                    if (r.isRuleBasedBusinessDay(x))
+                        ++expected;
+            } catch (Error&) {
+                throws = true;
+            }
+            if (!throws) {
+                BigInteger calculated = c.businessDaysBetween(d, e, true, true);
+                if (calculated != expected)
+                    BOOST_FAIL(c << ": " << calculated
+                               << " business days between " << d << " and "
+                               << e << ", expected " << expected);
+                if (c.businessDaysBetween(e, d, true, true) != -expected)
+                    BOOST_FAIL(c << ": business days between " << e
+                               << " and " << d << " do not match");
+            }
+        }
+    }
+
+    swapped.restore();
+    if (calendars[2].isHoliday(d2))
+        BOOST_ERROR(d2 << " still a holiday for " << calendars[2]);
+
+    // the table of a fresh calendar used by several threads at once
+    Calendar fresh = JointCalendar(UnitedStates(UnitedStates::Settlement),
+                                   Japan(), JoinBusinessDays);
+    RuleBasedCalendar r(fresh);
+    std::vector<int> calculated(256), expected(256);
+    #pragma omp parallel for
+    for (int k=0; k<256; ++k)
+        calculated[k] = fresh.isBusinessDay(from + 53*k) ? 1 : 0;
+    for (int k=0; k<256; ++k) {
+        expected[k] = r.isRuleBasedBusinessDay(from + 53*k) ? 1 : 0;
+        if (calculated[k] != expected[k])
+            BOOST_ERROR(fresh << ": wrong result for " << from + 53*k
+                        << " when building the table concurrently");
+    }
+}
+
 
 void CalendarTest::testBespokeCalendars() {
 
@@ -1150,6 +1316,7 @@ test_suite* CalendarTest::suite() {
 
     suite->add(QUANTLIB_TEST_CASE(&CalendarTest::testEndOfMonth));
     suite->add(QUANTLIB_TEST_CASE(&CalendarTest::testBusinessDaysBetween));
+    suite->add(QUANTLIB_TEST_CASE(&CalendarTest::testBusinessDayTable));
 
     return suite;
 }
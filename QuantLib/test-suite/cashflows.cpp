@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2009, 2012 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -20,14 +21,18 @@
 #include "cashflows.hpp"
 #include "utilities.hpp"
 #include <ql/cashflows/cashflows.hpp>
+#include <ql/cashflows/legsnapshot.hpp>
 #include <ql/cashflows/simplecashflow.hpp>
 #include <ql/cashflows/fixedratecoupon.hpp>
 #include <ql/cashflows/floatingratecoupon.hpp>
 #include <ql/cashflows/iborcoupon.hpp>
 #include <ql/cashflows/couponpricer.hpp>
 #include <ql/termstructures/volatility/optionlet/constantoptionletvol.hpp>
+#include <ql/termstructures/yield/zerocurve.hpp>
 #include <ql/quotes/simplequote.hpp>
 #include <ql/time/calendars/target.hpp>
+#include <ql/time/daycounters/actual365fixed.hpp>
+#include <ql/time/daycounters/actualactual.hpp>
 #include <ql/time/schedule.hpp>
 #include <ql/indexes/ibor/usdlibor.hpp>
 #include <ql/settings.hpp>
@@ -264,11 +269,112 @@ void CashFlowsTest::testNullFixingDays() {
         .withFixingDays(Null<Natural>());
 }
 
+void CashFlowsTest::testLegSnapshot() {
+    BOOST_TEST_MESSAGE("Testing compiled leg snapshot against cashflows "
+                       "methods...");
+
+    SavedSettings backup;
+
+    Date today = Settings::instance().evaluationDate();
+
+    // a book of fixed-rate bonds, partly in their lifetime
+    std::vector<Leg> legs;
+    for (Size i=0; i<20; ++i) {
+        Date start = today - Period(3*static_cast<Integer>(i % 4), Months);
+        Date maturity = start + Period(1+static_cast<Integer>(i), Years);
+        Schedule schedule = MakeSchedule()
+                            .from(start).to(maturity)
+                            .withFrequency(i % 2 == 0 ? Annual : Semiannual)
+                            .withCalendar(TARGET())
+                            .withConvention(Following)
+                            .backwards();
+        Leg leg = FixedRateLeg(schedule)
+                  .withNotionals(100.0)
+                  .withCouponRates(0.01 + 0.002*i,
+                                   ActualActual(ActualActual::ISMA));
+        leg.push_back(boost::shared_ptr<CashFlow>(
+                     new SimpleCashFlow(100.0, leg.back()->date())));
+        legs.push_back(leg);
+    }
+
+    std::vector<Date> dates;
+    std::vector<Rate> rates;
+    for (Size i=0; i<5; ++i) {
+        dates.push_back(today + Period(5*static_cast<Integer>(i), Years));
+        rates.push_back(0.01 + 0.005*i);
+    }
+    boost::shared_ptr<YieldTermStructure> curvePtr(
+                              new ZeroCurve(dates, rates, Actual365Fixed()));
+    curvePtr->enableExtrapolation();
+    const YieldTermStructure& curve = *curvePtr;
+
+    LegSnapshot snapshot(legs, curve.referenceDate(), curve.dayCounter(),
+                         false, today);
+
+    Array npv, bps;
+    snapshot.npvbps(curve, npv, bps);
+    Array yield = snapshot.yield(npv, ActualActual(ActualActual::ISMA),
+                                 Compounded, Annual);
+    Array zSpreadNpv = npv - 1.0;
+    Array zSpread = snapshot.zSpread(zSpreadNpv, curve, Compounded, Annual);
+
+    Real tolerance = 1.0e-10, solverTolerance = 1.0e-8;
+    for (Size i=0; i<legs.size(); ++i) {
+        Real expectedNpv = CashFlows::npv(legs[i], curve, false, today);
+        Real expectedBps = CashFlows::bps(legs[i], curve, false, today);
+        Rate expectedYield = CashFlows::yield(
+                                   legs[i], expectedNpv,
+                                   ActualActual(ActualActual::ISMA),
+                                   Compounded, Annual, false, today);
+        Spread expectedZSpread = CashFlows::zSpread(
+                                   legs[i], expectedNpv-1.0, curvePtr,
+                                   Actual365Fixed(), Compounded, Annual,
+                                   false, today);
+        if (std::fabs(npv[i]-expectedNpv) > tolerance ||
+            std::fabs(bps[i]-expectedBps) > tolerance ||
+            std::fabs(yield[i]-expectedYield) > solverTolerance ||
+            std::fabs(zSpread[i]-expectedZSpread) > solverTolerance)
+            BOOST_ERROR("leg snapshot results differ for " <<
+                        io::ordinal(i+1) << " leg:" <<
+                        std::setprecision(12) <<
+                        "\n    npv:      " << npv[i] <<
+                        ", expected " << expectedNpv <<
+                        "\n    bps:      " << bps[i] <<
+                        ", expected " << expectedBps <<
+                        "\n    yield:    " << yield[i] <<
+                        ", expected " << expectedYield <<
+                        "\n    z-spread: " << zSpread[i] <<
+                        ", expected " << expectedZSpread);
+    }
+    // the yield solver uses analytic derivatives for each convention
+    Compounding conventions[] = { Simple, SimpleThenCompounded, Continuous };
+    for (Size j=0; j<LENGTH(conventions); ++j) {
+        Array yields = snapshot.yield(npv, ActualActual(ActualActual::ISMA),
+                                      conventions[j], Semiannual,
+                                      1.0e-12, 20);
+        for (Size i=0; i<legs.size(); ++i) {
+            Rate expectedYield = CashFlows::yield(
+                                   legs[i], npv[i],
+                                   ActualActual(ActualActual::ISMA),
+                                   conventions[j], Semiannual, false, today,
+                                   Date(), 1.0e-12);
+            if (std::fabs(yields[i]-expectedYield) > solverTolerance)
+                BOOST_ERROR("leg snapshot yield differs for " <<
+                            io::ordinal(i+1) << " leg:" <<
+                            std::setprecision(12) <<
+                            "\n    compounding: " << Integer(conventions[j]) <<
+                            "\n    yield:       " << yields[i] <<
+                            ", expected " << expectedYield);
+        }
+    }
+}
+
 test_suite* CashFlowsTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("Cash flows tests");
     suite->add(QUANTLIB_TEST_CASE(&CashFlowsTest::testSettings));
     suite->add(QUANTLIB_TEST_CASE(&CashFlowsTest::testAccessViolation));
     suite->add(QUANTLIB_TEST_CASE(&CashFlowsTest::testDefaultSettlementDate));
+    suite->add(QUANTLIB_TEST_CASE(&CashFlowsTest::testLegSnapshot));
     #ifndef QL_USE_INDEXED_COUPON
     suite->add(QUANTLIB_TEST_CASE(&CashFlowsTest::testNullFixingDays));
     #endif
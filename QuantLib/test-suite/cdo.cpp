@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2008 Roland Lichters
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -24,10 +25,14 @@
 #include <ql/experimental/credit/integralcdoengine.hpp>
 #include <ql/experimental/credit/midpointcdoengine.hpp>
 #include <ql/experimental/credit/randomdefaultlatentmodel.hpp>
+#include <ql/experimental/credit/randomlosslatentmodel.hpp>
+#include <ql/experimental/credit/spotlosslatentmodel.hpp>
 #include <ql/experimental/credit/inhomogeneouspooldef.hpp>
 #include <ql/experimental/credit/homogeneouspooldef.hpp>
+#include <ql/experimental/credit/recursivelossmodel.hpp>
 
 #include <ql/experimental/credit/gaussianlhplossmodel.hpp>
+#include <ql/math/randomnumbers/randomsequencegenerator.hpp>
 #include <ql/termstructures/yield/flatforward.hpp>
 #include <ql/termstructures/credit/flathazardrate.hpp>
 #include <ql/time/calendars/target.hpp>
@@ -212,7 +217,13 @@ void CdoTest::testHW() {
             relativeTolerancePeriod.push_back(0.5);
             // Binomial...
             // Saddle point...
-            // Recursive ...
+            // recursive gaussian
+            modelNames.push_back("Recursive gaussian");
+            basketModels.push_back(boost::shared_ptr<DefaultLossModel>(new 
+                RecursiveGaussLossModel(gaussKtLossLM)));
+            absoluteTolerance.push_back(1.);
+            relativeToleranceMidp.push_back(0.04);
+            relativeTolerancePeriod.push_back(0.04);
         }
         else if (hwData7[i].nm > 0 && hwData7[i].nz > 0) {
             TCopulaPolicy::initTraits initTG;
@@ -360,8 +371,133 @@ void CdoTest::testHW() {
 }
 
 
+void CdoTest::testMultithreadedSimulation() {
+
+    BOOST_TEST_MESSAGE("Testing multithreaded random default simulation...");
+
+    SavedSettings backup;
+
+    Size poolSize = 50;
+    Size numSims = 20000;
+    Real recovery = 0.4;
+
+    Date asofDate = Date(31, August, 2006);
+    Settings::instance().evaluationDate() = asofDate;
+    Date horizon = asofDate + 5*Years;
+
+    Handle<Quote> hazardRate(boost::shared_ptr<Quote>(new SimpleQuote(0.01)));
+    boost::shared_ptr<DefaultProbabilityTermStructure> ptr(
+                  new FlatHazardRate(asofDate, hazardRate, ActualActual()));
+    vector<pair<DefaultProbKey,
+           Handle<DefaultProbabilityTermStructure> > > probabilities;
+    probabilities.push_back(std::make_pair(
+        NorthAmericaCorpDefaultKey(EURCurrency(), SeniorSec,
+                                   Period(0,Weeks), 10.),
+        Handle<DefaultProbabilityTermStructure>(ptr)));
+
+    boost::shared_ptr<Pool> pool(new Pool());
+    vector<string> names;
+    for (Size i=0; i<poolSize; ++i) {
+        ostringstream o;
+        o << "issuer-" << i;
+        names.push_back(o.str());
+        pool->add(names.back(), Issuer(probabilities),
+            NorthAmericaCorpDefaultKey(EURCurrency(), QuantLib::SeniorSec,
+                                       Period(), 1.));
+    }
+
+    Handle<Quote> hCorrelation(
+                         boost::shared_ptr<Quote>(new SimpleQuote(0.3)));
+    boost::shared_ptr<GaussianConstantLossLM> lm(new GaussianConstantLossLM(
+        hCorrelation, std::vector<Real>(poolSize, recovery),
+        LatentModelIntegrationType::GaussianQuadrature, poolSize,
+        GaussianCopulaPolicy::initTraits()));
+
+    typedef RandomDefaultLM<GaussianCopulaPolicy,
+        RandomSequenceGenerator<MersenneTwisterUniformRng> > MTRandomDefaultLM;
+
+    Size threads[] = { 1, 4, 4 };
+    vector<Real> el, prob, perc, esf;
+    for (Size i=0; i<LENGTH(threads); ++i) {
+        boost::shared_ptr<Basket> basket(new Basket(asofDate, names,
+            vector<Real>(poolSize, 100.0), pool, 0.0, 0.1));
+        basket->setLossModel(boost::shared_ptr<DefaultLossModel>(
+            new MTRandomDefaultLM(lm, numSims, 1.e-6, 42, threads[i])));
+        el.push_back(basket->expectedTrancheLoss(horizon));
+        prob.push_back(basket->probAtLeastNEvents(5, horizon));
+        perc.push_back(basket->percentile(horizon, 0.95));
+        esf.push_back(basket->expectedShortfall(horizon, 0.95));
+    }
+
+    // same seed and number of threads: identical results
+    BOOST_CHECK_EQUAL(el[1], el[2]);
+    BOOST_CHECK_EQUAL(prob[1], prob[2]);
+    BOOST_CHECK_EQUAL(perc[1], perc[2]);
+    BOOST_CHECK_EQUAL(esf[1], esf[2]);
+
+    // different substreams: same results up to the simulation error
+    Real tolerance = 0.05*el[0];
+    if (std::fabs(el[0] - el[1]) > tolerance)
+        BOOST_ERROR("expected tranche loss with 1 and 4 threads differ:"
+                    << "\n    1 thread:  " << el[0]
+                    << "\n    4 threads: " << el[1]
+                    << "\n    tolerance: " << tolerance);
+    if (std::fabs(prob[0] - prob[1]) > 0.02)
+        BOOST_ERROR("probability of at least 5 defaults with 1 and 4 "
+                    "threads differ:"
+                    << "\n    1 thread:  " << prob[0]
+                    << "\n    4 threads: " << prob[1]);
+
+    // Sobol sequences are skipped to the first simulation of each block:
+    // same samples, hence same results up to the summation order
+    boost::shared_ptr<GaussianSpotLossLM> spotLM(new GaussianSpotLossLM(
+        vector<vector<Real> >(2*poolSize, vector<Real>(1, std::sqrt(0.3))),
+        vector<Real>(poolSize, recovery), 2.2,
+        LatentModelIntegrationType::GaussianQuadrature,
+        GaussianCopulaPolicy::initTraits()));
+    string modelNames[] = { "random default", "random loss" };
+    string statistics[] = { "expected tranche loss",
+                            "probability of at least 5 defaults",
+                            "95% percentile", "95% expected shortfall" };
+    for (Size k=0; k<LENGTH(modelNames); ++k) {
+        vector<Real> results[2];
+        for (Size i=0; i<2; ++i) {
+            Size nThreads = (i == 0 ? 1 : 4);
+            boost::shared_ptr<DefaultLossModel> model;
+            if (k == 0)
+                model = boost::shared_ptr<DefaultLossModel>(
+                    new RandomDefaultLM<GaussianCopulaPolicy>(
+                        lm, numSims, 1.e-6, 42, nThreads));
+            else
+                model = boost::shared_ptr<DefaultLossModel>(
+                    new RandomLossLM<GaussianCopulaPolicy>(
+                        spotLM, numSims, 1.e-6, 42, nThreads));
+            boost::shared_ptr<Basket> basket(new Basket(asofDate, names,
+                vector<Real>(poolSize, 100.0), pool, 0.0, 0.1));
+            basket->setLossModel(model);
+            results[i].push_back(basket->expectedTrancheLoss(horizon));
+            results[i].push_back(basket->probAtLeastNEvents(5, horizon));
+            results[i].push_back(basket->percentile(horizon, 0.95));
+            results[i].push_back(basket->expectedShortfall(horizon, 0.95));
+        }
+        for (Size j=0; j<LENGTH(statistics); ++j) {
+            Real tolerance =
+                1.0e-12 * std::max<Real>(1.0, std::fabs(results[0][j]));
+            if (std::fabs(results[0][j] - results[1][j]) > tolerance)
+                BOOST_ERROR("Sobol " << modelNames[k] << " model: "
+                            << statistics[j]
+                            << " with 1 and 4 threads differ:"
+                            << "\n    1 thread:  " << results[0][j]
+                            << "\n    4 threads: " << results[1][j]
+                            << "\n    tolerance: " << tolerance);
+        }
+    }
+}
+
+
 test_suite* CdoTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("CDO tests");
     suite->add(QUANTLIB_TEST_CASE(&CdoTest::testHW));
+    suite->add(QUANTLIB_TEST_CASE(&CdoTest::testMultithreadedSimulation));
     return suite;
 }
@@ -28,6 +28,7 @@
 class CdoTest {
   public:
     static void testHW();
+    static void testMultithreadedSimulation();
     static boost::unit_test_framework::test_suite* suite();
 };
 
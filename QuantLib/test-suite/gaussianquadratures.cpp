@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2005 Klaus Spanderen
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -23,6 +24,7 @@
 #include <ql/math/functional.hpp>
 #include <ql/math/distributions/normaldistribution.hpp>
 #include <ql/math/integrals/gaussianquadratures.hpp>
+#include <ql/experimental/math/multidimquadrature.hpp>
 
 using namespace QuantLib;
 using namespace boost::unit_test_framework;
@@ -56,6 +58,24 @@ namespace {
         return x*NormalDistribution()(x);
     }
 
+    // product of standard normal densities times (1 + x0*x1 + x2^2),
+    // integrates to 2 over R^3
+    Real gaussian3d(const std::vector<Real>& x) {
+        NormalDistribution phi;
+        return phi(x[0])*phi(x[1])*phi(x[2])*(1.0 + x[0]*x[1] + x[2]*x[2]);
+    }
+
+    // moments of the 3-dimensional normal density, (1, 1, 0)
+    void gaussian3dMoments(const std::vector<Real>& x,
+                           std::vector<Real>& value) {
+        NormalDistribution phi;
+        Real density = phi(x[0])*phi(x[1])*phi(x[2]);
+        value.resize(3);
+        value[0] = density;
+        value[1] = x[0]*x[0]*density;
+        value[2] = x[1]*x[2]*density;
+    }
+
     Real x_x_normaldistribution(Real x) {
         return x*x*NormalDistribution()(x);
     }
@@ -174,6 +194,52 @@ void GaussianQuadraturesTest::testTabulated() {
 }
 
 
+void GaussianQuadraturesTest::testMultidimensionalGrid() {
+     BOOST_TEST_MESSAGE("Testing multi-dimensional Gauss-Hermite "
+                        "integration on the tensor grid...");
+
+     GaussianQuadMultidimIntegrator integrator(3, 20);
+
+     Real recursive = integrator.integrate<Real>(
+                         boost::function<Real (const std::vector<Real>&)>(
+                                                               gaussian3d));
+     Real grid = integrator.integrateGrid(gaussian3d, 1);
+     Real parallel = integrator.integrateGrid(gaussian3d, 4);
+
+     if (std::fabs(recursive-2.0) > 1.0e-7
+         || std::fabs(grid-recursive) > 1.0e-12)
+         BOOST_ERROR("failed to reproduce the recursive integration:"
+                     << std::setprecision(16)
+                     << "\n    recursive: " << recursive
+                     << "\n    grid:      " << grid
+                     << "\n    expected:  " << 2.0);
+     // the partial sums are added in a fixed order
+     if (parallel != grid)
+         BOOST_ERROR("results depend on the number of threads:"
+                     << std::setprecision(16)
+                     << "\n    1 thread:  " << grid
+                     << "\n    4 threads: " << parallel);
+
+     std::vector<Real> moments =
+         integrator.integrateGridV(gaussian3dMoments, 1);
+     std::vector<Real> parallelMoments =
+         integrator.integrateGridV(gaussian3dMoments, 4);
+     Real expected[] = { 1.0, 1.0, 0.0 };
+     for (Size i=0; i<3; ++i) {
+         if (std::fabs(moments[i]-expected[i]) > 1.0e-7)
+             BOOST_ERROR("failed to integrate moment #" << i << ":"
+                         << std::setprecision(16)
+                         << "\n    calculated: " << moments[i]
+                         << "\n    expected:   " << expected[i]);
+         if (parallelMoments[i] != moments[i])
+             BOOST_ERROR("moment #" << i << " depends on the number "
+                         "of threads:" << std::setprecision(16)
+                         << "\n    1 thread:  " << moments[i]
+                         << "\n    4 threads: " << parallelMoments[i]);
+     }
+}
+
+
 test_suite* GaussianQuadraturesTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("Gaussian quadratures tests");
     suite->add(QUANTLIB_TEST_CASE(&GaussianQuadraturesTest::testJacobi));
@@ -181,6 +247,8 @@ test_suite* GaussianQuadraturesTest::suite() {
     suite->add(QUANTLIB_TEST_CASE(&GaussianQuadraturesTest::testHermite));
     suite->add(QUANTLIB_TEST_CASE(&GaussianQuadraturesTest::testHyperbolic));
     suite->add(QUANTLIB_TEST_CASE(&GaussianQuadraturesTest::testTabulated));
+    suite->add(QUANTLIB_TEST_CASE(
+                       &GaussianQuadraturesTest::testMultidimensionalGrid));
     return suite;
 }
 
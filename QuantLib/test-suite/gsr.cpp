@@ -40,6 +40,18 @@
 #include <ql/termstructures/volatility/swaption/swaptionconstantvol.hpp>
 #include <ql/instruments/makevanillaswap.hpp>
 #include <ql/math/optimization/levenbergmarquardt.hpp>
+#include <ql/experimental/xva/gaussian1dscenariogenerator.hpp>
+#include <ql/experimental/xva/gaussian1dexposureengine.hpp>
+#include <ql/models/shortrate/onefactormodels/gaussian1dmodelsnapshot.hpp>
+#include <ql/models/shortrate/onefactormodels/markovfunctional.hpp>
+#include <ql/experimental/models/lgm1.hpp>
+#include <ql/termstructures/volatility/optionlet/constantoptionletvol.hpp>
+#include <ql/cashflows/coupon.hpp>
+#include <boost/timer.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace QuantLib;
 using boost::unit_test_framework::test_suite;
@@ -284,11 +296,735 @@ void GsrTest::testGsrModel() {
                     << HwJamNpv
                     << ") deviates from Gaussian1dJamshidianEngine NPV ("
                     << GsrJamNpv << ")");
+
+    // the swaption engine keeps its model snapshot between calculations,
+    // it has to be rebuilt when the model parameters change
+
+    stdswaption->setPricingEngine(boost::shared_ptr<PricingEngine>(
+        new Gaussian1dSwaptionEngine(model, 64, 7.0, true, false)));
+    stdswaption->recalculate();
+    Real GsrStdNpv2 = stdswaption->NPV();
+    if (GsrStdNpv2 != GsrStdNpv)
+        BOOST_ERROR("Gaussian1dSwaptionEngine NPV with reused snapshot ("
+                    << GsrStdNpv2 << ") differs from initial one ("
+                    << GsrStdNpv << ")");
+
+    Array params = model->params();
+    model->setParams(params * 1.2);
+    Real GsrStdNpv3 = stdswaption->NPV();
+    stdswaption->setPricingEngine(boost::shared_ptr<PricingEngine>(
+        new Gaussian1dSwaptionEngine(model, 64, 7.0, true, false)));
+    Real GsrStdNpv4 = stdswaption->NPV();
+    model->setParams(params);
+    if (GsrStdNpv3 == GsrStdNpv || GsrStdNpv3 != GsrStdNpv4)
+        BOOST_ERROR("Gaussian1dSwaptionEngine NPV after model change ("
+                    << GsrStdNpv3 << ") differs from the one of a new engine ("
+                    << GsrStdNpv4 << ") or equals the one before the change ("
+                    << GsrStdNpv << ")");
+}
+
+void GsrTest::testScenarioGeneratorBatchMode() {
+
+    BOOST_TEST_MESSAGE(
+        "Testing batched mode of the GSR based scenario generator...");
+
+    Handle<YieldTermStructure> yts(boost::shared_ptr<YieldTermStructure>(
+        new FlatForward(0, TARGET(), 0.03, Actual365Fixed())));
+    std::vector<Date> stepDates;
+    std::vector<Real> vols(1, 0.01);
+    std::vector<Real> reversions(1, 0.01);
+    boost::shared_ptr<Gsr> model(
+        new Gsr(yts, stepDates, vols, reversions, 50.0));
+
+    Gaussian1dSingleCurveScenarioGenerator pathwise(model, 42);
+    Gaussian1dSingleCurveScenarioGenerator batched(model, 42);
+
+    Size nDates = 20, nPaths = 5000;
+    std::vector<Time> maturities;
+    maturities.push_back(1.0);
+    maturities.push_back(5.0);
+    maturities.push_back(10.0);
+
+    // the path-wise generator defines the horizon dates
+    std::vector<Date> horizonDates;
+    std::vector<std::vector<Real> > pathwiseZerobonds;
+    for (Size i = 0; i < 10; ++i) {
+        for (Size j = 0; j < nDates; ++j) {
+            Date d = pathwise.advance(3 * Months);
+            if (i == 0)
+                horizonDates.push_back(d);
+            for (Size k = 0; k < maturities.size(); ++k) {
+                if (k == 0)
+                    pathwiseZerobonds.push_back(std::vector<Real>());
+                pathwiseZerobonds.back().push_back(
+                    pathwise.state()->discount(maturities[k]));
+            }
+        }
+        pathwise.nextPath();
+    }
+
+    batched.generatePaths(horizonDates, nPaths);
+
+    if (batched.states().rows() != nPaths ||
+        batched.states().columns() != nDates ||
+        batched.numeraires().rows() != nPaths ||
+        batched.numeraires().columns() != nDates)
+        BOOST_FAIL("state matrix has wrong dimensions");
+
+    Real tol = 1E-12;
+
+    // the batch must reproduce the path-wise scenarios
+    for (Size j = 0; j < nDates; ++j) {
+        Matrix p = batched.discount(j, maturities);
+        for (Size i = 0; i < 10; ++i) {
+            for (Size k = 0; k < maturities.size(); ++k) {
+                Real expected = pathwiseZerobonds[i * nDates + j][k];
+                if (fabs(p[i][k] - expected) > tol)
+                    BOOST_ERROR("batched zerobond P(t="
+                                << batched.horizonTimes()[j]
+                                << ",T=" << maturities[k] << ") on path " << i
+                                << " (" << p[i][k]
+                                << ") differs from path-wise value ("
+                                << expected << ")");
+            }
+        }
+    }
+
+    // deflated zerobonds must be martingales (up to four standard
+    // errors), as long as they are not expired
+    Real n0 = model->numeraire(0.0, 0.0);
+    for (Size j = 0; j < nDates; ++j) {
+        for (Size k = 0; k < maturities.size(); ++k) {
+            if (maturities[k] < batched.horizonTimes()[j])
+                continue;
+            Array p = batched.zerobond(j, maturities[k]);
+            Real sum = 0.0, sum2 = 0.0;
+            for (Size i = 0; i < nPaths; ++i) {
+                Real d = p[i] / batched.numeraires()[i][j];
+                sum += d;
+                sum2 += d * d;
+            }
+            Real expected = yts->discount(maturities[k]) / n0;
+            Real mean = sum / static_cast<Real>(nPaths);
+            Real error = std::sqrt(
+                (sum2 / static_cast<Real>(nPaths) - mean * mean) /
+                static_cast<Real>(nPaths - 1));
+            if (fabs(mean - expected) > 4.0 * error + 1E-12)
+                BOOST_ERROR("expectation of deflated zerobond P(t="
+                            << batched.horizonTimes()[j]
+                            << ",T=" << maturities[k] << ") (" << mean
+                            << ") differs from expected value (" << expected
+                            << "), standard error is " << error);
+        }
+    }
+}
+
+void GsrTest::testExposureEngine() {
+
+    BOOST_TEST_MESSAGE("Testing GSR based exposure engine...");
+
+    SavedSettings backup;
+
+    // the engine requires the curve to start at the evaluation date
+    Date refDate = TARGET().adjust(Settings::instance().evaluationDate());
+    Settings::instance().evaluationDate() = refDate;
+
+    Handle<YieldTermStructure> yts(boost::shared_ptr<YieldTermStructure>(
+        new FlatForward(0, TARGET(), 0.03, Actual365Fixed())));
+    std::vector<Date> stepDates;
+    std::vector<Real> vols(1, 0.01);
+    std::vector<Real> reversions(1, 0.01);
+    boost::shared_ptr<Gsr> model(
+        new Gsr(yts, stepDates, vols, reversions, 50.0));
+
+    boost::shared_ptr<SwapIndex> swpIdx(
+        new EuriborSwapIsdaFixA(10 * Years, yts));
+    Date expiry = TARGET().advance(refDate, 5 * Years);
+
+    std::vector<boost::shared_ptr<VanillaSwap> > swaps;
+    swaps.push_back(MakeVanillaSwap(10 * Years, swpIdx->iborIndex(), 0.03)
+                        .withFixedLegDayCount(swpIdx->dayCounter())
+                        .withFixedLegTenor(swpIdx->fixedLegTenor()));
+    std::vector<boost::shared_ptr<Swaption> > swaptions;
+    boost::shared_ptr<Exercise> exercise(new EuropeanExercise(expiry));
+    swaptions.push_back(boost::shared_ptr<Swaption>(
+        new Swaption(swpIdx->underlyingSwap(expiry), exercise)));
+    swaptions.back()->setPricingEngine(boost::shared_ptr<PricingEngine>(
+        new Gaussian1dSwaptionEngine(model, 64, 7.0, true, false)));
+
+    std::vector<Date> horizonDates;
+    horizonDates.push_back(refDate + 1 * Months);
+    horizonDates.push_back(refDate + 1 * Years);
+    horizonDates.push_back(refDate + 3 * Years);
+    horizonDates.push_back(refDate + 7 * Years);
+
+    Size paths = 2000;
+    Gaussian1dExposureEngine engine(model, swaps, swaptions, horizonDates,
+                                    paths, 42, 0.95, 100, 16);
+
+    // expected deflated npvs at the first horizon date against the
+    // analytical prices
+    Real n0 = model->numeraire(0.0, 0.0);
+    Real npv[] = {swaps[0]->NPV(), swaptions[0]->NPV()};
+    for (Size k = 0; k < 2; ++k) {
+        Real sum = 0.0;
+        for (Size i = 0; i < paths; ++i)
+            sum += engine.cube()[k][i][0] / engine.numeraires()[i][0];
+        Real mean = sum / static_cast<Real>(paths) * n0;
+        if (fabs(mean - npv[k]) > 0.003)
+            BOOST_ERROR("expected deflated npv of trade #"
+                        << k << " at first horizon date (" << mean
+                        << ") differs from npv (" << npv[k] << ")");
+    }
+
+    // a swaption is never a liability before its expiry and the pfe
+    // should exceed the (undiscounted) average exposure
+    for (Size h = 0; h < horizonDates.size(); ++h) {
+        Real exposure = 0.0;
+        for (Size i = 0; i < paths; ++i) {
+            if (horizonDates[h] < expiry && engine.cube()[1][i][h] < 0.0)
+                BOOST_FAIL("negative swaption npv ("
+                           << engine.cube()[1][i][h] << ") on path " << i
+                           << " at horizon date " << horizonDates[h]);
+            exposure += std::max(engine.npv()[i][h], 0.0);
+        }
+        exposure /= static_cast<Real>(paths);
+        if (engine.potentialFutureExposure()[h] < exposure)
+            BOOST_ERROR("pfe (" << engine.potentialFutureExposure()[h]
+                                << ") implausible compared to average "
+                                   "exposure ("
+                                << exposure << ")");
+    }
+
+    // results must not depend on the block size and number of threads
+#ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+#endif
+    Gaussian1dExposureEngine engine2(model, swaps, swaptions, horizonDates,
+                                     paths, 42, 0.95, 37, 16);
+    const Matrix &npv1 = engine.npv(), &npv2 = engine2.npv();
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    for (Size i = 0; i < paths; ++i) {
+        for (Size h = 0; h < horizonDates.size(); ++h) {
+            if (npv1[i][h] != npv2[i][h])
+                BOOST_FAIL("portfolio npv on path "
+                           << i << " at horizon date " << horizonDates[h]
+                           << " is not reproduced (" << npv1[i][h] << ", "
+                           << npv2[i][h] << ")");
+        }
+    }
+    for (Size h = 0; h < horizonDates.size(); ++h) {
+        if (engine.expectedExposure()[h] != engine2.expectedExposure()[h] ||
+            engine.potentialFutureExposure()[h] !=
+                engine2.potentialFutureExposure()[h])
+            BOOST_FAIL("exposure aggregates at horizon date "
+                       << horizonDates[h] << " are not reproduced");
+    }
+}
+
+namespace {
+
+    void checkSnapshot(const boost::shared_ptr<Gaussian1dModel> &model,
+                       const Handle<YieldTermStructure> &curve,
+                       const std::string &tag, const Real offGridTol) {
+
+        std::vector<Time> times, stateTimes;
+        for (Size i = 1; i <= 20; ++i)
+            times.push_back(0.5 * static_cast<Real>(i));
+        stateTimes.push_back(1.0);
+        stateTimes.push_back(2.5);
+        stateTimes.push_back(5.0);
+
+        std::vector<Handle<YieldTermStructure> > curves(1, curve);
+        Gaussian1dModelSnapshot snapshot(model, times, stateTimes, curves,
+                                         7.0, 64);
+
+        // grid points of the snapshot and a point in between
+        Real ys[] = {-3.5, -0.875, 0.0, 1.75, 7.0, 0.3};
+        const Real tol = 1.0E-10;
+
+        for (Size i = 0; i < snapshot.stateTimes().size(); ++i) {
+            Time t = snapshot.stateTimes()[i];
+            for (Size l = 0; l < LENGTH(ys); ++l) {
+                Real y = ys[l];
+                Real tol0 = l == LENGTH(ys) - 1 ? offGridTol : tol;
+                Real n0 = model->numeraire(t, y), n1 = snapshot.numeraire(t, y);
+                Real n2 = model->numeraire(t, y, curve),
+                     n3 = snapshot.numeraire(t, y, 1);
+                if (std::fabs(n0 - n1) > tol0 * n0 ||
+                    std::fabs(n2 - n3) > tol0 * n2)
+                    BOOST_ERROR(tag << " snapshot numeraire at t=" << t
+                                    << ", y=" << y << " ("
+                                    << std::setprecision(12) << n1 << ", "
+                                    << n3 << ") differs from model ("
+                                    << n0 << ", " << n2 << ")");
+                for (Size j = 0; j < snapshot.times().size(); ++j) {
+                    Time T = snapshot.times()[j];
+                    if (T < t)
+                        continue;
+                    Real z0 = model->zerobond(T, t, y),
+                         z1 = snapshot.zerobond(T, t, y);
+                    Real z2 = model->zerobond(T, t, y, curve),
+                         z3 = snapshot.zerobond(T, t, y, 1);
+                    Real d0 = model->deflatedZerobond(T, t, y, curve),
+                         d1 = snapshot.deflatedZerobond(T, t, y, 1);
+                    if (std::fabs(z0 - z1) > tol0 * z0 ||
+                        std::fabs(z2 - z3) > tol0 * z2 ||
+                        std::fabs(d0 - d1) > tol0 * d0)
+                        BOOST_ERROR(tag << " snapshot zerobond at t=" << t
+                                        << ", T=" << T << ", y=" << y << " ("
+                                        << std::setprecision(12) << z1
+                                        << ", " << z3 << ", " << d1
+                                        << ") differs from model (" << z0
+                                        << ", " << z2 << ", " << d0 << ")");
+                    if (T > t) {
+                        Array g0 = model->yGrid(7.0, 8, T, t, y);
+                        Array g1 = snapshot.yGrid(7.0, 8, T, t, y);
+                        for (Size k = 0; k < g0.size(); ++k) {
+                            if (std::fabs(g0[k] - g1[k]) > tol)
+                                BOOST_ERROR(tag << " snapshot y grid at t="
+                                                << t << ", T=" << T
+                                                << ", y=" << y << " ("
+                                                << g1[k]
+                                                << ") differs from model ("
+                                                << g0[k] << ")");
+                        }
+                    }
+                }
+            }
+        }
+
+        // the state is deterministic at T = 0, so the y grid collapses to 0
+        Array g0 = model->yGrid(7.0, 8, 0.0), g1 = snapshot.yGrid(7.0, 8, 0.0);
+        for (Size k = 0; k < g0.size(); ++k) {
+            if (g0[k] != 0.0 || g1[k] != 0.0)
+                BOOST_ERROR(tag << " y grid at T=0 (" << g0[k] << ", "
+                                << g1[k] << ") is not zero");
+        }
+
+        // concurrent evaluation must give the same result as the serial one
+        Size n = snapshot.times().size();
+        std::vector<Real> serial(n), parallel(n);
+        for (Size j = 0; j < n; ++j)
+            serial[j] = snapshot.deflatedZerobond(snapshot.times()[j], 0.0,
+                                                  0.0, 1, 1);
+#pragma omp parallel for
+        for (long j = 0; j < static_cast<long>(n); ++j)
+            parallel[j] = snapshot.deflatedZerobond(snapshot.times()[j], 0.0,
+                                                    0.0, 1, 1);
+        for (Size j = 0; j < n; ++j) {
+            if (serial[j] != parallel[j])
+                BOOST_ERROR(tag << " concurrent snapshot evaluation ("
+                                << parallel[j] << ") differs from serial one ("
+                                << serial[j] << ")");
+        }
+    }
+
+}
+
+void GsrTest::testModelSnapshot() {
+
+    BOOST_TEST_MESSAGE("Testing gaussian 1d model snapshots...");
+
+    SavedSettings backup;
+
+    Date refDate = Settings::instance().evaluationDate();
+
+    Handle<YieldTermStructure> yts(boost::shared_ptr<YieldTermStructure>(
+        new FlatForward(0, TARGET(), 0.03, Actual365Fixed())));
+    Handle<YieldTermStructure> yts2(boost::shared_ptr<YieldTermStructure>(
+        new FlatForward(0, TARGET(), 0.035, Actual365Fixed())));
+
+    std::vector<Date> stepDates;
+    stepDates.push_back(TARGET().advance(refDate, 2 * Years));
+    stepDates.push_back(TARGET().advance(refDate, 4 * Years));
+    std::vector<Real> vols, reversions;
+    vols.push_back(0.0070);
+    vols.push_back(0.0085);
+    vols.push_back(0.0065);
+    reversions.push_back(0.02);
+    reversions.push_back(-0.01);
+    reversions.push_back(0.03);
+
+    checkSnapshot(boost::shared_ptr<Gaussian1dModel>(
+                      new Gsr(yts, stepDates, vols, reversions, 50.0)),
+                  yts2, "gsr (piecewise reversion)", 1.0E-10);
+    checkSnapshot(boost::shared_ptr<Gaussian1dModel>(
+                      new Gsr(yts, stepDates, vols, 0.0, 50.0)),
+                  yts2, "gsr (zero reversion)", 1.0E-10);
+    checkSnapshot(boost::shared_ptr<Gaussian1dModel>(
+                      new Lgm1(yts, stepDates, vols, 0.02)),
+                  yts2, "lgm", 1.0E-10);
+
+    std::vector<Date> expiries;
+    for (Size i = 1; i <= 9; ++i)
+        expiries.push_back(TARGET().advance(refDate, i * Years));
+    Handle<OptionletVolatilityStructure> capletVol(
+        boost::shared_ptr<OptionletVolatilityStructure>(
+            new ConstantOptionletVolatility(0, TARGET(), Following, 0.20,
+                                            Actual365Fixed())));
+    boost::shared_ptr<IborIndex> iborIndex(new Euribor(6 * Months, yts));
+    checkSnapshot(boost::shared_ptr<Gaussian1dModel>(new MarkovFunctional(
+                      yts, 0.01, std::vector<Date>(), std::vector<Real>(1, 1.0),
+                      capletVol, expiries, iborIndex)),
+                  yts2, "markov functional", 1.0E-5);
+}
+
+void GsrTest::testProcessCache() {
+
+    BOOST_TEST_MESSAGE("Testing gsr process cache...");
+
+    SavedSettings backup;
+
+    Date refDate = Settings::instance().evaluationDate();
+
+    Handle<YieldTermStructure> yts(boost::shared_ptr<YieldTermStructure>(
+        new FlatForward(0, TARGET(), 0.03, Actual365Fixed())));
+
+    std::vector<Date> stepDates;
+    for (Size i = 1; i < 10; ++i)
+        stepDates.push_back(TARGET().advance(refDate, i * Years));
+    std::vector<Real> vols(stepDates.size() + 1, 0.0075);
+    std::vector<Real> reversions(stepDates.size() + 1, 0.01);
+    for (Size i = 0; i < reversions.size(); ++i)
+        reversions[i] += 0.001 * static_cast<Real>(i);
+
+    boost::shared_ptr<Gsr> model(
+        new Gsr(yts, stepDates, vols, reversions, 60.0));
+    boost::shared_ptr<GsrProcess> process =
+        boost::static_pointer_cast<GsrProcess>(model->stateProcess());
+
+    // 10y bermudan swaption, callable yearly
+
+    boost::shared_ptr<SwapIndex> swpIdx(
+        new EuriborSwapIsdaFixA(10 * Years, yts));
+    boost::shared_ptr<VanillaSwap> underlying =
+        MakeVanillaSwap(10 * Years, swpIdx->iborIndex(), 0.03)
+            .withEffectiveDate(TARGET().advance(refDate, 2 * Days))
+            .withFixedLegCalendar(swpIdx->fixingCalendar())
+            .withFixedLegDayCount(swpIdx->dayCounter())
+            .withFixedLegTenor(swpIdx->fixedLegTenor())
+            .withFixedLegConvention(swpIdx->fixedLegConvention())
+            .withFixedLegTerminationDateConvention(
+                swpIdx->fixedLegConvention());
+    std::vector<Date> exerciseDates;
+    for (Size i = 1; i < underlying->fixedLeg().size(); ++i)
+        exerciseDates.push_back(
+            boost::dynamic_pointer_cast<Coupon>(underlying->fixedLeg()[i])
+                ->accrualStartDate() -
+            2);
+    boost::shared_ptr<NonstandardSwaption> swaption(
+        new NonstandardSwaption(Swaption(
+            underlying, boost::shared_ptr<Exercise>(
+                            new BermudanExercise(exerciseDates)))));
+    boost::shared_ptr<PricingEngine> engine(
+        new Gaussian1dNonstandardSwaptionEngine(model, 64, 7.0, true, false));
+    swaption->setPricingEngine(engine);
+
+    // the grid the engine evaluates the model on
+
+    std::vector<Time> grid(1, 0.0);
+    for (Size i = 0; i < exerciseDates.size(); ++i)
+        grid.push_back(yts->timeFromReference(exerciseDates[i]));
+    for (Size l = 0; l < 2; ++l) {
+        const Leg &leg = l == 0 ? underlying->fixedLeg()
+                                : underlying->floatingLeg();
+        for (Size i = 0; i < leg.size(); ++i) {
+            boost::shared_ptr<Coupon> c =
+                boost::dynamic_pointer_cast<Coupon>(leg[i]);
+            grid.push_back(yts->timeFromReference(c->accrualStartDate()));
+            grid.push_back(yts->timeFromReference(c->accrualEndDate()));
+            grid.push_back(yts->timeFromReference(c->date()));
+        }
+    }
+    std::sort(grid.begin(), grid.end());
+    grid.erase(std::unique(grid.begin(), grid.end()), grid.end());
+
+    // the engine registers its grid with the model, so that the
+    // process tables are used in the default setup, too
+
+    boost::timer timer;
+
+    process->flushCache();
+    timer.restart();
+    swaption->recalculate();
+    Real npvCold = swaption->NPV();
+    Real timeCold = timer.elapsed();
+
+    const std::vector<Time> &registered = process->precomputedTimes();
+    for (Size i = 0; i < grid.size(); ++i) {
+        bool found = false;
+        for (Size j = 0; j < registered.size() && !found; ++j)
+            found = close_enough(registered[j], grid[i]);
+        if (!found)
+            BOOST_ERROR("time " << grid[i]
+                                << " is not registered by the engine");
+    }
+
+    timer.restart();
+    swaption->recalculate();
+    Real npvWarm = swaption->NPV();
+    Real timeWarm = timer.elapsed();
+
+    // a change in the model parameters flushes the cache, the next
+    // calculation registers the grid again
+
+    model->setParams(model->params());
+    if (!process->precomputedTimes().empty())
+        BOOST_ERROR("registered grid is not cleared by a model update");
+    Real npvUpdated = swaption->NPV();
+    if (process->precomputedTimes().empty())
+        BOOST_ERROR("grid is not registered again after a model update");
+
+    // lookups in the tables vs. lookups in the lazily filled maps
+
+    Size lookups = 0;
+    Real sumTables = 0.0, sumMaps = 0.0;
+    timer.restart();
+    for (Size r = 0; r < 20; ++r) {
+        for (Size i = 0; i < grid.size(); ++i) {
+            for (Size j = i; j < grid.size(); ++j) {
+                sumTables += process->variance(grid[i], 0.0,
+                                               grid[j] - grid[i]);
+                ++lookups;
+            }
+        }
+    }
+    Real timeTables = timer.elapsed();
+    process->flushCache();
+    for (Size i = 0; i < grid.size(); ++i)
+        for (Size j = i; j < grid.size(); ++j)
+            process->variance(grid[i], 0.0, grid[j] - grid[i]);
+    timer.restart();
+    for (Size r = 0; r < 20; ++r) {
+        for (Size i = 0; i < grid.size(); ++i) {
+            for (Size j = i; j < grid.size(); ++j)
+                sumMaps += process->variance(grid[i], 0.0,
+                                             grid[j] - grid[i]);
+        }
+    }
+    Real timeMaps = timer.elapsed();
+
+    BOOST_TEST_MESSAGE("    bermudan swaption pricing, grid of "
+                       << grid.size() << " times\n"
+                       << "    pricing incl. grid registration: " << timeCold
+                       << " s\n"
+                       << "    pricing on registered grid:      " << timeWarm
+                       << " s\n"
+                       << "    " << lookups << " lookups in tables: "
+                       << timeTables << " s\n"
+                       << "    " << lookups << " lookups in maps:   "
+                       << timeMaps << " s");
+
+    if (npvWarm != npvCold)
+        BOOST_ERROR("npv on registered grid ("
+                    << npvWarm << ") differs from first one (" << npvCold
+                    << ")");
+    if (npvUpdated != npvCold)
+        BOOST_ERROR("npv after model update ("
+                    << npvUpdated << ") differs from first one (" << npvCold
+                    << ")");
+    if (sumTables != sumMaps)
+        BOOST_ERROR("lookups in tables (" << sumTables
+                                          << ") differ from lookups in maps ("
+                                          << sumMaps << ")");
+
+    process->precompute(grid);
+
+    // the precomputed values must coincide with the lazily computed
+    // ones, which we compute in reverse order
+
+    std::vector<Real> e, v;
+    for (Size i = 0; i < grid.size(); ++i) {
+        for (Size j = i; j < grid.size(); ++j) {
+            e.push_back(process->expectation(grid[i], 0.01, grid[j] - grid[i]));
+            v.push_back(process->variance(grid[i], 0.0, grid[j] - grid[i]));
+        }
+    }
+    process->flushCache();
+    Size k = e.size();
+    for (Size i = grid.size(); i > 0; --i) {
+        for (Size j = grid.size(); j >= i; --j) {
+            --k;
+            Time dt = grid[j - 1] - grid[i - 1];
+            Real e2 = process->expectation(grid[i - 1], 0.01, dt);
+            Real v2 = process->variance(grid[i - 1], 0.0, dt);
+            if (e[k] != e2 || v[k] != v2)
+                BOOST_ERROR("precomputed expectation ("
+                            << e[k] << ") or variance (" << v[k]
+                            << ") differs from lazily computed one (" << e2
+                            << ", " << v2 << ") for t=" << grid[i - 1]
+                            << ", dt=" << dt);
+        }
+    }
+
+    // with a registered grid, lookups off the grid are not cached and
+    // can be done concurrently with lookups on the grid
+    process->precompute(grid);
+    Size n = grid.size();
+    std::vector<Real> serial(2 * n), parallel(2 * n);
+    for (Size i = 0; i < 2 * n; ++i) {
+        Time t = i < n ? grid[i] : grid[i - n] + 0.1;
+        serial[i] = process->expectation(t, 0.01, 0.75) +
+                    process->variance(t, 0.0, 0.75);
+    }
+#pragma omp parallel for
+    for (long i = 0; i < static_cast<long>(2 * n); ++i) {
+        Time t = i < static_cast<long>(n) ? grid[i] : grid[i - n] + 0.1;
+        parallel[i] = process->expectation(t, 0.01, 0.75) +
+                      process->variance(t, 0.0, 0.75);
+    }
+    for (Size i = 0; i < 2 * n; ++i) {
+        if (serial[i] != parallel[i])
+            BOOST_ERROR("concurrent lookup (" << parallel[i]
+                                              << ") differs from serial one ("
+                                              << serial[i] << ")");
+    }
+}
+
+namespace {
+
+    void checkBatch(const boost::shared_ptr<Gaussian1dModel> &model,
+                    const Handle<YieldTermStructure> &curve,
+                    const std::string &tag) {
+
+        Real tol = 1.0E-12;
+
+        Date refDate = model->termStructure()->referenceDate();
+        Date reference = TARGET().advance(refDate, 2 * Years);
+        Date fixing = TARGET().advance(refDate, 3 * Years);
+        Time t = model->termStructure()->timeFromReference(reference);
+        Time T = 7.0;
+
+        Array y(21);
+        for (Size i = 0; i < y.size(); ++i)
+            y[i] = -3.0 + 0.3 * static_cast<Real>(i);
+
+        std::vector<Handle<YieldTermStructure> > curves;
+        curves.push_back(Handle<YieldTermStructure>());
+        curves.push_back(curve);
+
+        for (Size c = 0; c < curves.size(); ++c) {
+            Array n = model->numeraire(t, y, curves[c]);
+            Array zb = model->zerobond(T, t, y, curves[c]);
+            Array dzb = model->deflatedZerobond(T, t, y, curves[c], curves[c]);
+            Array zb0 = model->zerobond(T, 0.0, y, curves[c]);
+            for (Size i = 0; i < y.size(); ++i) {
+                Real n2 = model->numeraire(t, y[i], curves[c]);
+                Real zb2 = model->zerobond(T, t, y[i], curves[c]);
+                Real dzb2 =
+                    model->deflatedZerobond(T, t, y[i], curves[c], curves[c]);
+                Real zb02 = model->zerobond(T, 0.0, y[i], curves[c]);
+                if (std::fabs(n[i] - n2) > tol ||
+                    std::fabs(zb[i] - zb2) > tol ||
+                    std::fabs(dzb[i] - dzb2) > tol ||
+                    std::fabs(zb0[i] - zb02) > tol)
+                    BOOST_ERROR(tag << " batch evaluation differs from single "
+                                       "one for curve #"
+                                    << c << ", y=" << y[i]
+                                    << "\n    numeraire:         " << n[i]
+                                    << " vs " << n2
+                                    << "\n    zerobond:          " << zb[i]
+                                    << " vs " << zb2
+                                    << "\n    deflated zerobond: " << dzb[i]
+                                    << " vs " << dzb2
+                                    << "\n    zerobond (t=0):    " << zb0[i]
+                                    << " vs " << zb02);
+            }
+        }
+
+        // forward and swap rates, in a single and a multi curve setup
+
+        boost::shared_ptr<IborIndex> ibor(new Euribor(6 * Months));
+        boost::shared_ptr<IborIndex> ibor2(new Euribor(6 * Months, curve));
+        boost::shared_ptr<SwapIndex> swap(new EuriborSwapIsdaFixA(5 * Years));
+        boost::shared_ptr<SwapIndex> swap2(
+            new EuriborSwapIsdaFixA(5 * Years, curve, curve));
+
+        Array fwd = model->forwardRate(fixing, reference, y, ibor);
+        Array fwd2 = model->forwardRate(fixing, reference, y, ibor2);
+        Array swp = model->swapRate(fixing, 5 * Years, reference, y, swap);
+        Array swp2 = model->swapRate(fixing, 5 * Years, reference, y, swap2);
+        for (Size i = 0; i < y.size(); ++i) {
+            Real fwdb = model->forwardRate(fixing, reference, y[i], ibor);
+            Real fwd2b = model->forwardRate(fixing, reference, y[i], ibor2);
+            Real swpb =
+                model->swapRate(fixing, 5 * Years, reference, y[i], swap);
+            Real swp2b =
+                model->swapRate(fixing, 5 * Years, reference, y[i], swap2);
+            if (std::fabs(fwd[i] - fwdb) > tol ||
+                std::fabs(fwd2[i] - fwd2b) > tol ||
+                std::fabs(swp[i] - swpb) > tol ||
+                std::fabs(swp2[i] - swp2b) > tol)
+                BOOST_ERROR(tag << " batch rates differ from single ones for y="
+                                << y[i] << "\n    forward rate:            "
+                                << fwd[i] << " vs " << fwdb
+                                << "\n    forward rate (2 curves): " << fwd2[i]
+                                << " vs " << fwd2b
+                                << "\n    swap rate:               " << swp[i]
+                                << " vs " << swpb
+                                << "\n    swap rate (2 curves):    " << swp2[i]
+                                << " vs " << swp2b);
+        }
+    }
+}
+
+void GsrTest::testBatchEvaluation() {
+
+    BOOST_TEST_MESSAGE("Testing batch evaluation of gaussian 1d models...");
+
+    SavedSettings backup;
+
+    Date refDate = Settings::instance().evaluationDate();
+
+    Handle<YieldTermStructure> yts(boost::shared_ptr<YieldTermStructure>(
+        new FlatForward(0, TARGET(), 0.03, Actual365Fixed())));
+    Handle<YieldTermStructure> yts2(boost::shared_ptr<YieldTermStructure>(
+        new FlatForward(0, TARGET(), 0.035, Actual365Fixed())));
+
+    std::vector<Date> stepDates;
+    stepDates.push_back(TARGET().advance(refDate, 2 * Years));
+    stepDates.push_back(TARGET().advance(refDate, 4 * Years));
+    std::vector<Real> vols, reversions;
+    vols.push_back(0.0070);
+    vols.push_back(0.0085);
+    vols.push_back(0.0065);
+    reversions.push_back(0.02);
+    reversions.push_back(-0.01);
+    reversions.push_back(0.03);
+
+    checkBatch(boost::shared_ptr<Gaussian1dModel>(
+                   new Gsr(yts, stepDates, vols, reversions, 50.0)),
+               yts2, "gsr");
+    checkBatch(boost::shared_ptr<Gaussian1dModel>(
+                   new Lgm1(yts, stepDates, vols, 0.02)),
+               yts2, "lgm");
+
+    std::vector<Date> expiries;
+    for (Size i = 1; i <= 9; ++i)
+        expiries.push_back(TARGET().advance(refDate, i * Years));
+    Handle<OptionletVolatilityStructure> capletVol(
+        boost::shared_ptr<OptionletVolatilityStructure>(
+            new ConstantOptionletVolatility(0, TARGET(), Following, 0.20,
+                                            Actual365Fixed())));
+    boost::shared_ptr<IborIndex> iborIndex(new Euribor(6 * Months, yts));
+    checkBatch(boost::shared_ptr<Gaussian1dModel>(new MarkovFunctional(
+                   yts, 0.01, std::vector<Date>(), std::vector<Real>(1, 1.0),
+                   capletVol, expiries, iborIndex)),
+               yts2, "markov functional");
 }
 
 test_suite *GsrTest::suite() {
     test_suite *suite = BOOST_TEST_SUITE("GSR model tests");
     suite->add(QUANTLIB_TEST_CASE(&GsrTest::testGsrProcess));
     suite->add(QUANTLIB_TEST_CASE(&GsrTest::testGsrModel));
+    suite->add(QUANTLIB_TEST_CASE(&GsrTest::testScenarioGeneratorBatchMode));
+    suite->add(QUANTLIB_TEST_CASE(&GsrTest::testExposureEngine));
+    suite->add(QUANTLIB_TEST_CASE(&GsrTest::testModelSnapshot));
+    suite->add(QUANTLIB_TEST_CASE(&GsrTest::testProcessCache));
+    suite->add(QUANTLIB_TEST_CASE(&GsrTest::testBatchEvaluation));
     return suite;
 }
@@ -31,6 +31,11 @@ class GsrTest {
     static void testGsrModel();
     static void testNonstandardSwaption();
     static void testDummy();
+    static void testScenarioGeneratorBatchMode();
+    static void testExposureEngine();
+    static void testModelSnapshot();
+    static void testProcessCache();
+    static void testBatchEvaluation();
     static boost::unit_test_framework::test_suite *suite();
 };
 
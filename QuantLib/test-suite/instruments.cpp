@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2003 RiskMap srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -20,7 +21,15 @@
 #include "instruments.hpp"
 #include "utilities.hpp"
 #include <ql/instruments/stock.hpp>
+#include <ql/instruments/bonds/zerocouponbond.hpp>
+#include <ql/pricingengines/bond/discountingbondengine.hpp>
+#include <ql/termstructures/yield/flatforward.hpp>
+#include <ql/experimental/risk/sensitivityanalysis.hpp>
 #include <ql/quotes/simplequote.hpp>
+#include <ql/quotes/compositequote.hpp>
+#include <ql/time/calendars/target.hpp>
+#include <ql/time/daycounters/actual365fixed.hpp>
+#include <functional>
 
 using namespace QuantLib;
 using namespace boost::unit_test_framework;
@@ -60,10 +69,119 @@ void InstrumentTest::testObservable() {
         BOOST_FAIL("Observer was not notified of instrument change");
 }
 
+namespace {
+
+    // two curves and a stock price, the first curve is used by two
+    // bonds, the second one by one bond; a third curve, depending on
+    // both rates, is used by another bond
+    class TestMarket : public SensitivityMarket {
+      public:
+        void build(std::vector<Handle<SimpleQuote> >& quotes,
+                   std::vector<boost::shared_ptr<Instrument> >& instruments)
+                                                                      const {
+            Date today = Settings::instance().evaluationDate();
+            quotes.clear();
+            instruments.clear();
+            quotes.push_back(Handle<SimpleQuote>(
+                boost::shared_ptr<SimpleQuote>(new SimpleQuote(0.02))));
+            quotes.push_back(Handle<SimpleQuote>(
+                boost::shared_ptr<SimpleQuote>(new SimpleQuote(0.03))));
+            quotes.push_back(Handle<SimpleQuote>(
+                boost::shared_ptr<SimpleQuote>(new SimpleQuote(100.0))));
+            std::vector<boost::shared_ptr<PricingEngine> > engines;
+            for (Size i=0; i<2; ++i) {
+                Handle<YieldTermStructure> curve(
+                    boost::shared_ptr<YieldTermStructure>(
+                        new FlatForward(today, Handle<Quote>(*quotes[i]),
+                                        Actual365Fixed())));
+                engines.push_back(boost::shared_ptr<PricingEngine>(
+                                          new DiscountingBondEngine(curve)));
+            }
+            Size curve[] = { 0, 0, 1 };
+            Integer years[] = { 5, 10, 7 };
+            for (Size k=0; k<3; ++k) {
+                boost::shared_ptr<Instrument> bond(new ZeroCouponBond(
+                    0, TARGET(), 100.0, today + years[k]*Years));
+                bond->setPricingEngine(engines[curve[k]]);
+                instruments.push_back(bond);
+            }
+            instruments.push_back(boost::shared_ptr<Instrument>(
+                                     new Stock(Handle<Quote>(*quotes[2]))));
+            Handle<Quote> rate(boost::shared_ptr<Quote>(
+                new CompositeQuote<std::plus<Real> >(
+                    Handle<Quote>(*quotes[0]), Handle<Quote>(*quotes[1]),
+                    std::plus<Real>())));
+            Handle<YieldTermStructure> sumCurve(
+                boost::shared_ptr<YieldTermStructure>(
+                    new FlatForward(today, rate, Actual365Fixed())));
+            boost::shared_ptr<Instrument> bond(new ZeroCouponBond(
+                0, TARGET(), 100.0, today + 3*Years));
+            bond->setPricingEngine(boost::shared_ptr<PricingEngine>(
+                                       new DiscountingBondEngine(sumCurve)));
+            instruments.push_back(bond);
+        }
+    };
+
+}
+
+void InstrumentTest::testBucketJacobian() {
+
+    BOOST_TEST_MESSAGE("Testing sparse bucket sensitivities of instruments...");
+
+    SavedSettings backup;
+    Settings::instance().evaluationDate() = Date(15, March, 2016);
+
+    TestMarket market;
+    std::vector<Handle<SimpleQuote> > quotes;
+    std::vector<boost::shared_ptr<Instrument> > instruments;
+    market.build(quotes, instruments);
+
+    // dependencies of the instruments on the quotes
+    Size expected[][2] = { { 0, 0 }, { 1, 0 }, { 4, 0 },
+                           { 2, 1 }, { 4, 1 }, { 3, 2 } };
+
+    SensitivityAnalysis types[] = { OneSide, Centered };
+    Size threads[] = { 1, 2, 3 };
+
+    for (Size i=0; i<LENGTH(types); ++i) {
+        for (Size t=0; t<LENGTH(threads); ++t) {
+            std::vector<BucketSensitivity> jacobian =
+                bucketJacobian(market, 1.0E-4, types[i], threads[t]);
+            if (jacobian.size() != LENGTH(expected))
+                BOOST_FAIL("jacobian has " << jacobian.size() <<
+                           " entries, expected " << LENGTH(expected) <<
+                           " (" << types[i] << ", " << threads[t] <<
+                           " threads)");
+            for (Size j=0; j<jacobian.size(); ++j) {
+                Size k = jacobian[j].instrument, q = jacobian[j].quote;
+                if (k != expected[j][0] || q != expected[j][1])
+                    BOOST_ERROR("unexpected jacobian entry (" << k << "," <<
+                                q << "), expected (" << expected[j][0] <<
+                                "," << expected[j][1] << ")");
+                std::pair<Real, Real> ref = bucketAnalysis(
+                    quotes[q], std::vector<boost::shared_ptr<Instrument> >(
+                                                          1, instruments[k]),
+                    std::vector<Real>(), 1.0E-4, types[i]);
+                if (std::fabs(jacobian[j].delta - ref.first) > 1.0E-10 ||
+                    (types[i] == Centered &&
+                     std::fabs(jacobian[j].gamma - ref.second) > 1.0E-4))
+                    BOOST_ERROR("sensitivity of instrument #" << k <<
+                                " w.r.t. quote #" << q << " (" <<
+                                types[i] << ", " << threads[t] <<
+                                " threads)\n    delta:     " <<
+                                jacobian[j].delta << "\n    expected:  " <<
+                                ref.first << "\n    gamma:     " <<
+                                jacobian[j].gamma << "\n    expected:  " <<
+                                ref.second);
+            }
+        }
+    }
+}
 
 test_suite* InstrumentTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("Instrument tests");
     suite->add(QUANTLIB_TEST_CASE(&InstrumentTest::testObservable));
+    suite->add(QUANTLIB_TEST_CASE(&InstrumentTest::testBucketJacobian));
     return suite;
 }
 
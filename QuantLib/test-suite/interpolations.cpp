@@ -5,7 +5,7 @@
  Copyright (C) 2005, 2006 StatPro Italia srl
  Copyright (C) 2007 Giorgio Facchinetti
  Copyright (C) 2009 Dimitri Reiswich
- Copyright (C) 2014 Peter Caspers
+ Copyright (C) 2014, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -29,6 +29,8 @@
 #include <ql/math/interpolations/backwardflatinterpolation.hpp>
 #include <ql/math/interpolations/forwardflatinterpolation.hpp>
 #include <ql/math/interpolations/cubicinterpolation.hpp>
+#include <ql/math/interpolations/loginterpolation.hpp>
+#include <ql/math/interpolations/convexmonotoneinterpolation.hpp>
 #include <ql/math/interpolations/multicubicspline.hpp>
 #include <ql/math/interpolations/sabrinterpolation.hpp>
 #include <ql/math/interpolations/kernelinterpolation.hpp>
@@ -42,6 +44,7 @@
 #include <ql/math/optimization/levenbergmarquardt.hpp>
 #include <ql/experimental/volatility/noarbsabrinterpolation.hpp>
 #include <boost/foreach.hpp>
+#include <boost/timer.hpp>
 #include <boost/assign/std/vector.hpp>
 
 
@@ -1981,6 +1984,97 @@ void InterpolationTest::testTransformations() {
 
 }
 
+namespace {
+
+    // evaluates f pointwise and in batch on x and compares the results
+    void checkSortedEvaluation(const Interpolation& f,
+                               const std::vector<Real>& x,
+                               const std::string& name,
+                               Size repetitions,
+                               Real& pointwiseTime,
+                               Real& batchTime) {
+        std::vector<Real> expected(x.size()), calculated(x.size());
+        boost::timer timer;
+        for (Size k = 0; k < repetitions; ++k)
+            for (Size i = 0; i < x.size(); ++i)
+                expected[i] = f(x[i], true);
+        pointwiseTime += timer.elapsed();
+        timer.restart();
+        for (Size k = 0; k < repetitions; ++k)
+            f(x.begin(), x.end(), calculated.begin(), true);
+        batchTime += timer.elapsed();
+        Size errors = 0;
+        for (Size i = 0; i < x.size(); ++i) {
+            if (calculated[i] != expected[i]) {
+                BOOST_ERROR(name << ": batch value differs from "
+                            "pointwise value at x = " << x[i]
+                            << std::setprecision(16)
+                            << "\n    batch:     " << calculated[i]
+                            << "\n    pointwise: " << expected[i]);
+                if (++errors > 5)
+                    break;
+            }
+        }
+    }
+
+}
+
+void InterpolationTest::testSortedEvaluation() {
+
+    BOOST_TEST_MESSAGE("Testing hinted and batch evaluation "
+                       "of interpolations...");
+
+    const Size n = 40, m = 5000, repetitions = 50;
+
+    std::vector<Real> x(n), y(n);
+    for (Size i = 0; i < n; ++i) {
+        x[i] = 0.25 * i + 0.01 * i * i;
+        y[i] = 0.02 + 0.01 * std::sin(x[i]) + 0.001 * x[i];
+    }
+
+    // sorted points from before the first to after the last node,
+    // hitting the nodes, with dense and sparse regions
+    std::vector<Real> sorted;
+    for (Size i = 0; i < m; ++i) {
+        Real u = static_cast<Real>(i) / (m - 1);
+        sorted.push_back(-1.0 + (x.back() + 2.0) * u * u);
+    }
+    sorted.insert(sorted.end(), x.begin(), x.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    // the same points in a scrambled order
+    std::vector<Real> scrambled(sorted);
+    for (Size i = 0; i < scrambled.size(); ++i)
+        std::swap(scrambled[i], scrambled[(i * 7919) % scrambled.size()]);
+
+    std::vector<std::pair<std::string, Interpolation> > f;
+    f.push_back(std::make_pair(std::string("Linear"),
+        Interpolation(LinearInterpolation(x.begin(), x.end(),
+                                          y.begin()))));
+    f.push_back(std::make_pair(std::string("LogLinear"),
+        Interpolation(LogLinearInterpolation(x.begin(), x.end(),
+                                             y.begin()))));
+    f.push_back(std::make_pair(std::string("Cubic"),
+        Interpolation(CubicNaturalSpline(x.begin(), x.end(),
+                                         y.begin()))));
+    f.push_back(std::make_pair(std::string("ConvexMonotone"),
+        ConvexMonotone().interpolate(x.begin(), x.end(), y.begin())));
+
+    for (Size j = 0; j < f.size(); ++j) {
+        Real pointwiseTime = 0.0, batchTime = 0.0, dummy = 0.0;
+        checkSortedEvaluation(f[j].second, sorted, f[j].first,
+                              repetitions, pointwiseTime, batchTime);
+        checkSortedEvaluation(f[j].second, scrambled,
+                              f[j].first + " (unsorted points)",
+                              1, dummy, dummy);
+        BOOST_TEST_MESSAGE("    " << std::setw(14) << std::left
+                           << f[j].first << ": pointwise "
+                           << std::fixed << std::setprecision(3)
+                           << pointwiseTime << "s, batch "
+                           << batchTime << "s");
+    }
+}
+
 test_suite* InterpolationTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("Interpolation tests");
 
@@ -2013,5 +2107,6 @@ test_suite* InterpolationTest::suite() {
     suite->add(QUANTLIB_TEST_CASE(&InterpolationTest::testNoArbSabrInterpolation));
     suite->add(QUANTLIB_TEST_CASE(&InterpolationTest::testSabrSingleCases));
     suite->add(QUANTLIB_TEST_CASE(&InterpolationTest::testTransformations));
+    suite->add(QUANTLIB_TEST_CASE(&InterpolationTest::testSortedEvaluation));
     return suite;
 }
@@ -4,7 +4,7 @@
  Copyright (C) 2004 Ferdinando Ametrano
  Copyright (C) 2005, 2006 StatPro Italia srl
  Copyright (C) 2009 Dimitri Reiswich
- Copyright (C) 2014 Peter Caspers
+ Copyright (C) 2014, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -52,6 +52,7 @@ class InterpolationTest {
     static void testNoArbSabrInterpolation();
     static void testSabrSingleCases();
     static void testTransformations();
+    static void testSortedEvaluation();
 
     static boost::unit_test_framework::test_suite* suite();
 };
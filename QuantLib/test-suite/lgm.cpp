@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -38,12 +38,14 @@
 #include <ql/experimental/models/cclgm1.hpp>
 #include <ql/experimental/models/cclgmanalyticfxoptionengine.hpp>
 #include <ql/experimental/models/fxoptionhelper.hpp>
+#include <ql/experimental/models/lgmswaptionengine_ad.hpp>
 
 #include <boost/make_shared.hpp>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/mean.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
 #include <boost/accumulators/statistics/error_of_mean.hpp>
+#include <boost/timer.hpp>
 
 using namespace QuantLib;
 using boost::unit_test_framework::test_suite;
@@ -695,11 +697,152 @@ void LgmTest::testLgm4fAndFxCalibration() {
 
 } // testLgm4fAndFxCalibration
 
+void LgmTest::testSwaptionEngineAD() {
+
+    BOOST_TEST_MESSAGE("Testing adjoint sensitivities of the LGM swaption "
+                       "engine against bump and revalue...");
+
+    SavedSettings backup;
+
+    Date evalDate(12, January, 2015);
+    Settings::instance().evaluationDate() = evalDate;
+    boost::shared_ptr<SimpleQuote> rate = boost::make_shared<SimpleQuote>(0.02);
+    Handle<YieldTermStructure> yts(boost::make_shared<FlatForward>(
+        evalDate, Handle<Quote>(rate), Actual365Fixed()));
+    boost::shared_ptr<IborIndex> euribor6m =
+        boost::make_shared<Euribor>(6 * Months, yts);
+
+    Date effectiveDate = TARGET().advance(evalDate, 2 * Days);
+    Date startDate = TARGET().advance(effectiveDate, 1 * Years);
+    Date maturityDate = TARGET().advance(startDate, 9 * Years);
+
+    Schedule fixedSchedule(startDate, maturityDate, 1 * Years, TARGET(),
+                           ModifiedFollowing, ModifiedFollowing,
+                           DateGeneration::Forward, false);
+    Schedule floatingSchedule(startDate, maturityDate, 6 * Months, TARGET(),
+                              ModifiedFollowing, ModifiedFollowing,
+                              DateGeneration::Forward, false);
+    boost::shared_ptr<VanillaSwap> underlying = boost::make_shared<VanillaSwap>(
+        VanillaSwap(VanillaSwap::Payer, 1.0, fixedSchedule, 0.02, Thirty360(),
+                    floatingSchedule, euribor6m, 0.0, Actual360()));
+
+    std::vector<Date> exerciseDates;
+    for (Size i = 0; i < 9; ++i) {
+        exerciseDates.push_back(TARGET().advance(fixedSchedule[i], -2 * Days));
+    }
+    boost::shared_ptr<Exercise> exercise =
+        boost::make_shared<BermudanExercise>(exerciseDates, false);
+
+    boost::shared_ptr<Swaption> swaption =
+        boost::make_shared<Swaption>(underlying, exercise);
+
+    std::vector<Date> stepDates(exerciseDates.begin(), exerciseDates.end() - 1);
+    std::vector<boost::shared_ptr<SimpleQuote> > alphas;
+    std::vector<Handle<Quote> > alphaHandles;
+    for (Size i = 0; i < stepDates.size() + 1; ++i) {
+        alphas.push_back(boost::make_shared<SimpleQuote>(
+            0.0050 +
+            (0.0080 - 0.0050) * std::exp(-0.2 * static_cast<double>(i))));
+        alphaHandles.push_back(Handle<Quote>(alphas.back()));
+    }
+    boost::shared_ptr<SimpleQuote> kappa =
+        boost::make_shared<SimpleQuote>(0.01);
+
+    boost::shared_ptr<Lgm1> lgm = boost::make_shared<Lgm1>(
+        yts, stepDates, alphaHandles, Handle<Quote>(kappa));
+
+    // the price should be close to the one of the standard engine
+
+    swaption->setPricingEngine(
+        boost::make_shared<Gaussian1dSwaptionEngine>(lgm, 64, 7.0, true, false));
+    Real npvRef = swaption->NPV();
+
+    swaption->setPricingEngine(
+        boost::make_shared<LgmSwaptionEngineAD>(lgm, 64, 7.0));
+
+    boost::timer timer;
+    Real npv = swaption->NPV();
+    std::vector<Real> times =
+        swaption->result<std::vector<Real> >("sensitivityTimes");
+    std::vector<Real> discountSensitivity =
+        swaption->result<std::vector<Real> >("sensitivityDiscount");
+    std::vector<Real> alphaSensitivity =
+        swaption->result<std::vector<Real> >("sensitivityAlpha");
+    Real kappaSensitivity = swaption->result<Real>("sensitivityKappa");
+    Real timeAD = timer.elapsed();
+
+    Real tol0 = 0.5E-4;
+    if (std::fabs(npv - npvRef) > tol0)
+        BOOST_ERROR("LgmSwaptionEngineAD npv ("
+                    << npv << ") differs from Gaussian1dSwaptionEngine npv ("
+                    << npvRef << "), tolerance is " << tol0);
+
+    // bump and revalue
+
+    Real h = 1.0E-6, tol = 1.0E-4;
+    timer.restart();
+
+    for (Size i = 0; i < alphas.size(); ++i) {
+        Real a = alphas[i]->value();
+        alphas[i]->setValue(a + h);
+        Real npvUp = swaption->NPV();
+        alphas[i]->setValue(a - h);
+        Real npvDown = swaption->NPV();
+        alphas[i]->setValue(a);
+        Real fd = (npvUp - npvDown) / (2.0 * h);
+        if (std::fabs(fd - alphaSensitivity[i]) >
+            tol * std::max(1.0, std::fabs(fd)))
+            BOOST_ERROR("adjoint sensitivity w.r.t. alpha #"
+                        << i << " (" << alphaSensitivity[i]
+                        << ") differs from bump and revalue (" << fd << ")");
+    }
+
+    Real k = kappa->value();
+    kappa->setValue(k + h);
+    Real npvUp = swaption->NPV();
+    kappa->setValue(k - h);
+    Real npvDown = swaption->NPV();
+    kappa->setValue(k);
+    Real fdKappa = (npvUp - npvDown) / (2.0 * h);
+    if (std::fabs(fdKappa - kappaSensitivity) >
+        tol * std::max(1.0, std::fabs(fdKappa)))
+        BOOST_ERROR("adjoint sensitivity w.r.t. kappa ("
+                    << kappaSensitivity << ") differs from bump and revalue ("
+                    << fdKappa << ")");
+
+    // a parallel shift of the curve tests the discount sensitivities
+
+    Real r = rate->value();
+    rate->setValue(r + h);
+    npvUp = swaption->NPV();
+    rate->setValue(r - h);
+    npvDown = swaption->NPV();
+    rate->setValue(r);
+    Real fdRate = (npvUp - npvDown) / (2.0 * h);
+    Real adRate = 0.0;
+    for (Size i = 0; i < times.size(); ++i)
+        adRate -= discountSensitivity[i] * times[i] * yts->discount(times[i]);
+    if (std::fabs(fdRate - adRate) > tol * std::max(1.0, std::fabs(fdRate)))
+        BOOST_ERROR("adjoint sensitivity w.r.t. parallel rate shift ("
+                    << adRate << ") differs from bump and revalue (" << fdRate
+                    << ")");
+
+    Real timeBump = timer.elapsed();
+
+    BOOST_TEST_MESSAGE("    price and " << alphas.size() + 2
+                                        << " sensitivities\n"
+                                        << "    adjoint:          " << timeAD
+                                        << " s\n"
+                                        << "    bump and revalue: " << timeBump
+                                        << " s");
+}
+
 test_suite *LgmTest::suite() {
     test_suite *suite = BOOST_TEST_SUITE("LGM model tests");
     suite->add(QUANTLIB_TEST_CASE(&LgmTest::testBermudanLgm1fGsr));
     suite->add(QUANTLIB_TEST_CASE(&LgmTest::testLgm1fCalibration));
     suite->add(QUANTLIB_TEST_CASE(&LgmTest::testLgm3fForeignPayouts));
     suite->add(QUANTLIB_TEST_CASE(&LgmTest::testLgm4fAndFxCalibration));
+    suite->add(QUANTLIB_TEST_CASE(&LgmTest::testSwaptionEngineAD));
     return suite;
 }
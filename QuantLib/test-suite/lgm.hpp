@@ -1,7 +1,7 @@
 /* -*- mode: c++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
 
 /*
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -35,6 +35,7 @@ class LgmTest {
     static void testLgm1fCalibration();
     static void testLgm3fForeignPayouts();
     static void testLgm4fAndFxCalibration();
+    static void testSwaptionEngineAD();
     static boost::unit_test_framework::test_suite *suite();
 };
 
@@ -6,7 +6,7 @@ Copyright (C) 2006 Marco Bianchetti
 Copyright (C) 2006 Cristina Duminuco
 Copyright (C) 2006 StatPro Italia srl
 Copyright (C) 2008 Mark Joshi
-Copyright (C) 2012 Peter Caspers
+Copyright (C) 2012, 2016 Peter Caspers
 
 This file is part of QuantLib, a free-software/open-source library
 for financial quantitative analysts and developers - http://quantlib.org/
@@ -25,6 +25,7 @@ FOR A PARTICULAR PURPOSE.  See the license for more details.
 #include "marketmodel.hpp"
 #include "utilities.hpp"
 #include <ql/models/marketmodels/accountingengine.hpp>
+#include <ql/models/marketmodels/parallelaccountingengine.hpp>
 #include <ql/models/marketmodels/browniangenerators/mtbrowniangenerator.hpp>
 #include <ql/models/marketmodels/browniangenerators/sobolbrowniangenerator.hpp>
 #include <ql/models/marketmodels/callability/collectnodedata.hpp>
@@ -807,6 +808,254 @@ void MarketModelTest::testOneStepForwardsAndOptionlets() {
         }
 }
 
+void MarketModelTest::testParallelAccountingEngine() {
+
+    BOOST_TEST_MESSAGE("Testing parallel accounting engine "
+                       "in a lognormal forward rate market model...");
+
+    setup();
+
+    std::vector<Rate> forwardStrikes(todaysForwards.size());
+    std::vector<boost::shared_ptr<Payoff> > optionletPayoffs(todaysForwards.size());
+    for (Size i=0; i<todaysForwards.size(); ++i) {
+        forwardStrikes[i] = todaysForwards[i] + 0.01;
+        optionletPayoffs[i] = boost::shared_ptr<Payoff>(new
+            PlainVanillaPayoff(Option::Call, todaysForwards[i]));
+    }
+
+    OneStepForwards forwards(rateTimes, accruals,
+        paymentTimes, forwardStrikes);
+    OneStepOptionlets optionlets(rateTimes, accruals,
+        paymentTimes, optionletPayoffs);
+
+    MultiProductComposite product;
+    product.add(forwards);
+    product.add(optionlets);
+    product.finalize();
+
+    EvolutionDescription evolution = product.evolution();
+    std::vector<Size> numeraires = makeMeasure(product, Terminal);
+    boost::shared_ptr<MarketModel> marketModel =
+        makeMarketModel(true, evolution, todaysForwards.size(),
+                        ExponentialCorrelationFlatVolatility);
+    boost::shared_ptr<MarketModelEvolverFactory> evolverFactory(
+        new EvolverFactory<LogNormalFwdRatePc>(marketModel, numeraires));
+    Real initialNumeraireValue = todaysDiscounts[numeraires.front()];
+
+    boost::shared_ptr<BrownianGeneratorFactory> generatorFactories[] = {
+        boost::shared_ptr<BrownianGeneratorFactory>(
+                                     new MTBrownianGeneratorFactory(seed_)),
+        boost::shared_ptr<BrownianGeneratorFactory>(
+                                     new SobolBrownianGeneratorFactory(
+                                         SobolBrownianGenerator::Diagonal,
+                                         seed_)) };
+    std::string generatorNames[] = { "MT BGF", "Sobol BGF" };
+
+    for (Size k=0; k<LENGTH(generatorFactories); ++k) {
+
+        // a single block reproduces the serial engine for all
+        // generators, Sobol generators for any number of blocks
+        Size pathsPerBlock[] = { paths_, 1000 };
+        Size nThreads[] = { 1, 4 };
+
+        boost::shared_ptr<SequenceStatisticsInc> reference =
+            simulate(evolverFactory->create(*generatorFactories[k]),
+                     product);
+        std::vector<Real> referenceMeans = reference->mean();
+        std::vector<Real> referenceErrors = reference->errorEstimate();
+
+        for (Size i=0; i<LENGTH(pathsPerBlock); ++i) {
+            std::vector<Real> firstMeans;
+            for (Size j=0; j<LENGTH(nThreads); ++j) {
+                ParallelAccountingEngine engine(evolverFactory,
+                                                generatorFactories[k],
+                                                product,
+                                                initialNumeraireValue,
+                                                pathsPerBlock[i],
+                                                nThreads[j]);
+                SequenceStatisticsInc stats(product.numberOfProducts());
+                engine.multiplePathValues(stats, paths_);
+                std::vector<Real> means = stats.mean();
+                std::vector<Real> errors = stats.errorEstimate();
+                if (j == 0)
+                    firstMeans = means;
+
+                bool sameAsSerial = i == 0 || k == 1;
+                for (Size l=0; l<means.size(); ++l) {
+                    // the results must not depend on the number of threads
+                    if (means[l] != firstMeans[l])
+                        BOOST_ERROR(generatorNames[k] << ", "
+                                    << pathsPerBlock[i] << " paths per block, "
+                                    << nThreads[j] << " threads:"
+                                    << "\n    product:   " << l
+                                    << "\n    mean:      " << means[l]
+                                    << "\n    1 thread:  " << firstMeans[l]);
+                    Real tolerance = sameAsSerial ? 1.0e-12 :
+                        4.0*std::sqrt(errors[l]*errors[l] +
+                                      referenceErrors[l]*referenceErrors[l]);
+                    if (std::fabs(means[l] - referenceMeans[l]) > tolerance)
+                        BOOST_ERROR(generatorNames[k] << ", "
+                                    << pathsPerBlock[i] << " paths per block, "
+                                    << nThreads[j] << " threads:"
+                                    << "\n    product:   " << l
+                                    << "\n    mean:      " << means[l]
+                                    << "\n    serial:    " << referenceMeans[l]
+                                    << "\n    tolerance: " << tolerance);
+                }
+            }
+        }
+    }
+
+    // evolvers evolving blocks of paths give the same results if
+    // their block size divides the one of the engine
+    boost::shared_ptr<MarketModelEvolverFactory> blockEvolverFactory(
+        new BlockEvolverFactory<LogNormalFwdRatePc>(marketModel, numeraires,
+                                                    0, 100));
+    for (Size k=0; k<LENGTH(generatorFactories); ++k) {
+        ParallelAccountingEngine engine(evolverFactory,
+                                        generatorFactories[k], product,
+                                        initialNumeraireValue, 1000, 4);
+        ParallelAccountingEngine blockEngine(blockEvolverFactory,
+                                             generatorFactories[k], product,
+                                             initialNumeraireValue, 1000, 4);
+        SequenceStatisticsInc stats(product.numberOfProducts()),
+                              blockStats(product.numberOfProducts());
+        engine.multiplePathValues(stats, paths_);
+        blockEngine.multiplePathValues(blockStats, paths_);
+        std::vector<Real> means = stats.mean();
+        std::vector<Real> blockMeans = blockStats.mean();
+        for (Size l=0; l<means.size(); ++l) {
+            Real tolerance = 1.0e-12;
+            if (std::fabs(blockMeans[l] - means[l]) > tolerance)
+                BOOST_ERROR(generatorNames[k] << ", block evolvers:"
+                            << "\n    product:    " << l
+                            << "\n    block:      " << blockMeans[l]
+                            << "\n    path-wise:  " << means[l]
+                            << "\n    tolerance:  " << tolerance);
+        }
+    }
+}
+
+void MarketModelTest::testBlockEvolvers() {
+
+    BOOST_TEST_MESSAGE("Testing evolution of blocks of paths "
+                       "in a lognormal forward rate market model...");
+
+    setup();
+
+    std::vector<Rate> forwardStrikes(todaysForwards.size());
+    std::vector<boost::shared_ptr<Payoff> > optionletPayoffs(todaysForwards.size());
+    for (Size i=0; i<todaysForwards.size(); ++i) {
+        forwardStrikes[i] = todaysForwards[i] + 0.01;
+        optionletPayoffs[i] = boost::shared_ptr<Payoff>(new
+            PlainVanillaPayoff(Option::Call, todaysForwards[i]));
+    }
+
+    MultiStepForwards forwards(rateTimes, accruals,
+        paymentTimes, forwardStrikes);
+    MultiStepOptionlets optionlets(rateTimes, accruals,
+        paymentTimes, optionletPayoffs);
+
+    MultiProductComposite product;
+    product.add(forwards);
+    product.add(optionlets);
+    product.finalize();
+
+    EvolutionDescription evolution = product.evolution();
+    std::vector<Size> numeraires = makeMeasure(product, Terminal);
+    MTBrownianGeneratorFactory generatorFactory(seed_);
+
+    // the number of paths is not a multiple of the block size
+    Size pathsPerBlock = 100;
+    Size testedFactors[] = { 3, todaysForwards.size() };
+
+    for (Size m=0; m<LENGTH(testedFactors); ++m) {
+        boost::shared_ptr<MarketModel> marketModel =
+            makeMarketModel(true, evolution, testedFactors[m],
+                            ExponentialCorrelationAbcdVolatility);
+
+        EvolverType evolvers[] = { Pc, Ipc };
+        for (Size i=0; i<LENGTH(evolvers); ++i) {
+            boost::shared_ptr<MarketModelEvolver> evolver, blockEvolver;
+            switch (evolvers[i]) {
+              case Pc:
+                evolver = boost::shared_ptr<MarketModelEvolver>(
+                    new LogNormalFwdRatePc(marketModel, generatorFactory,
+                                           numeraires));
+                blockEvolver = boost::shared_ptr<MarketModelEvolver>(
+                    new LogNormalFwdRatePc(marketModel, generatorFactory,
+                                           numeraires, 0, pathsPerBlock));
+                break;
+              case Ipc:
+                evolver = boost::shared_ptr<MarketModelEvolver>(
+                    new LogNormalFwdRateIpc(marketModel, generatorFactory,
+                                            numeraires));
+                blockEvolver = boost::shared_ptr<MarketModelEvolver>(
+                    new LogNormalFwdRateIpc(marketModel, generatorFactory,
+                                            numeraires, 0, pathsPerBlock));
+                break;
+              default:
+                QL_FAIL("unexpected evolver type");
+            }
+
+            std::vector<Real> means = simulate(evolver, product)->mean();
+            std::vector<Real> blockMeans =
+                simulate(blockEvolver, product)->mean();
+
+            for (Size l=0; l<means.size(); ++l) {
+                Real tolerance = 1.0e-12;
+                if (std::fabs(blockMeans[l] - means[l]) > tolerance)
+                    BOOST_ERROR(evolverTypeToString(evolvers[i]) << ", "
+                                << testedFactors[m] << " factors, "
+                                << pathsPerBlock << " paths per block:"
+                                << "\n    product:    " << l
+                                << "\n    block:      " << blockMeans[l]
+                                << "\n    path-wise:  " << means[l]
+                                << "\n    tolerance:  " << tolerance);
+            }
+
+            // the initial state is changed within a block
+            std::vector<Rate> shiftedForwards(todaysForwards.size());
+            for (Size l=0; l<todaysForwards.size(); ++l)
+                shiftedForwards[l] = todaysForwards[l] + 0.005;
+            LMMCurveState shiftedState(rateTimes);
+            shiftedState.setOnForwardRates(shiftedForwards);
+            Size changedPath = 3*pathsPerBlock/2;
+            Real maxError = 0.0;
+            for (Size k=0; k<2*pathsPerBlock; ++k) {
+                if (k == changedPath) {
+                    evolver->setInitialState(shiftedState);
+                    blockEvolver->setInitialState(shiftedState);
+                }
+                Real weight = evolver->startNewPath();
+                Real blockWeight = blockEvolver->startNewPath();
+                maxError = std::max(maxError,
+                                    std::fabs(blockWeight - weight));
+                for (Size s=0; s<evolution.numberOfSteps(); ++s) {
+                    weight = evolver->advanceStep();
+                    blockWeight = blockEvolver->advanceStep();
+                    maxError = std::max(maxError,
+                                        std::fabs(blockWeight - weight));
+                    const std::vector<Rate>& f =
+                        evolver->currentState().forwardRates();
+                    const std::vector<Rate>& blockF =
+                        blockEvolver->currentState().forwardRates();
+                    for (Size l=evolution.firstAliveRate()[s];
+                         l<f.size(); ++l)
+                        maxError = std::max(maxError,
+                                            std::fabs(blockF[l] - f[l]));
+                }
+            }
+            if (maxError > 1.0e-12)
+                BOOST_ERROR(evolverTypeToString(evolvers[i]) << ", "
+                            << testedFactors[m] << " factors, "
+                            << pathsPerBlock << " paths per block:"
+                            << "\n    initial state changed within a block"
+                            << "\n    maximum error: " << maxError);
+        }
+    }
+}
+
 void MarketModelTest::testOneStepNormalForwardsAndOptionlets() {
 
     BOOST_TEST_MESSAGE("Testing exact repricing of "
@@ -4894,6 +5143,8 @@ test_suite* MarketModelTest::suite() {
 
     suite->add(QUANTLIB_TEST_CASE(&MarketModelTest::testOneStepForwardsAndOptionlets));
     suite->add(QUANTLIB_TEST_CASE(&MarketModelTest::testOneStepNormalForwardsAndOptionlets));
+    suite->add(QUANTLIB_TEST_CASE(&MarketModelTest::testParallelAccountingEngine));
+    suite->add(QUANTLIB_TEST_CASE(&MarketModelTest::testBlockEvolvers));
 
     suite->add(QUANTLIB_TEST_CASE(&MarketModelTest::testCallableSwapNaif));
     suite->add(QUANTLIB_TEST_CASE(&MarketModelTest::testCallableSwapAnderson));
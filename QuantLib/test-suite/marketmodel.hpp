@@ -3,7 +3,7 @@
 /*
  Copyright (C) 2006 Ferdinando Ametrano
  Copyright (C) 2006 StatPro Italia srl
- Copyright (C) 2012 Peter Caspers
+ Copyright (C) 2012, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -35,6 +35,8 @@ class MarketModelTest {
     static void testAllMultiStepProducts();
     static void testOneStepForwardsAndOptionlets();
     static void testOneStepNormalForwardsAndOptionlets();
+    static void testParallelAccountingEngine();
+    static void testBlockEvolvers();
     static void testCallableSwapNaif();
     static void testCallableSwapLS();
     static void testCallableSwapAnderson();
@@ -46,6 +46,10 @@
 #include <ql/time/period.hpp>
 #include <ql/quotes/simplequote.hpp>
 #include <ql/experimental/math/rngtraits_multithreaded.hpp>
+#include <ql/methods/montecarlo/montecarlomodel.hpp>
+#include <ql/methods/montecarlo/pathpricer.hpp>
+#include <ql/math/statistics/convergencestatistics.hpp>
+#include <ql/processes/geometricbrownianprocess.hpp>
 
 #include <boost/make_shared.hpp>
 
@@ -469,17 +473,271 @@ void MonteCarloMultiThreadedTest::testDynamicCreatorWrapper() {
     }
 }
 
+void MonteCarloMultiThreadedTest::testPhiloxRng() {
+
+    BOOST_TEST_MESSAGE("Testing philox generator ...");
+
+    // known answer tests from the Random123 reference implementation
+    uint32_t counters[3][4] = {
+        {0x00000000, 0x00000000, 0x00000000, 0x00000000},
+        {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+        {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+    uint32_t keys[3][2] = {{0x00000000, 0x00000000},
+                           {0xffffffff, 0xffffffff},
+                           {0xa4093822, 0x299f31d0}};
+    uint32_t expected[3][4] = {
+        {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+        {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+        {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+
+    for (Size i = 0; i < 3; ++i) {
+        uint32_t result[4];
+        PhiloxRng::block(counters[i], keys[i], result);
+        for (Size k = 0; k < 4; ++k) {
+            if (result[k] != expected[i][k])
+                BOOST_ERROR("Failed to verify known answer test #"
+                            << i << ", word " << k << ": " << result[k]
+                            << ", expected " << expected[i][k]);
+        }
+    }
+
+    // discard must be equivalent to drawing the numbers
+    PhiloxRng rng1(42, 3), rng2(42, 3);
+    for (Size skip = 0; skip < 11; ++skip) {
+        for (Size i = 0; i < skip; ++i)
+            rng1.nextInt32();
+        rng2.discard(skip);
+        unsigned long x1 = rng1.nextInt32(), x2 = rng2.nextInt32();
+        if (x1 != x2)
+            BOOST_ERROR("discard(" << skip << ") yields " << x2
+                                   << ", expected " << x1);
+    }
+
+    // the upper 32 bits of the seed must not be ignored
+    PhiloxRng rng3(42, 3), rng4(UINT64_C(42) + (UINT64_C(1) << 32), 3);
+    bool differ = false;
+    for (Size i = 0; i < 8; ++i)
+        differ = differ || rng3.nextInt32() != rng4.nextInt32();
+    if (!differ)
+        BOOST_ERROR("seeds differing in the upper 32 bits only yield the "
+                    "same sequence");
+
+    // a stream of the multithreaded generator must not depend on how
+    // many threads draw from the other streams
+    PhiloxMultiThreaded mt1(42, 64), mt2(42, 64);
+    const Size n = 1000;
+    std::vector<Real> reference(n);
+    std::vector<Real> reference2(n);
+    for (Size i = 0; i < n; ++i) {
+        reference[i] = mt1.nextReal(63);
+        reference2[i] = mt1.nextReal(2);
+    }
+
+#pragma omp parallel for
+    for (int t = 0; t < 64; ++t) {
+        for (Size i = 0; i < n; ++i)
+            mt2.nextReal(t);
+    }
+    PhiloxMultiThreaded mt3(42, 64);
+    for (Size i = 0; i < n; ++i) {
+        Real x = mt3.nextReal(63);
+        if (x != reference[i])
+            BOOST_ERROR("stream 63 number #" << i << " is " << x
+                                             << ", expected " << reference[i]);
+        if (x <= 0.0 || x >= 1.0)
+            BOOST_ERROR("number #" << i << " (" << x
+                                   << ") is not in (0,1)");
+    }
+
+    // the number of streams is chosen at run time, a stream does not
+    // depend on it
+    PhiloxMultiThreaded mt5(42, 3), mt6(42, 1000);
+    if (mt5.numberOfThreads() != 3 || mt6.numberOfThreads() != 1000)
+        BOOST_ERROR("number of streams (" << mt5.numberOfThreads() << ", "
+                                          << mt6.numberOfThreads()
+                                          << ") differs from the requested "
+                                             "one (3, 1000)");
+    for (Size i = 0; i < n; ++i) {
+        Real x5 = mt5.nextReal(2), x6 = mt6.nextReal(2);
+        if (x5 != x6 || x5 != reference2[i])
+            BOOST_ERROR("stream 2 number #" << i << " is " << x5 << " (3 "
+                                            << "streams) and " << x6
+                                            << " (1000 streams), expected "
+                                            << reference2[i]);
+    }
+    bool thrown = false;
+    try {
+        mt5.nextReal(3);
+    } catch (Error &) {
+        thrown = true;
+    }
+    if (!thrown)
+        BOOST_ERROR("drawing from stream 3 of 3 streams did not fail");
+
+    // different streams are uncorrelated
+    PhiloxMultiThreaded mt4(42, 2);
+    Real sum = 0.0;
+    for (Size i = 0; i < 100000; ++i)
+        sum += (mt4.nextReal(0) - 0.5) * (mt4.nextReal(1) - 0.5);
+    Real correlation = 12.0 * sum / 100000.0;
+    // standard deviation of the estimator is 1/sqrt(100000)
+    if (std::fabs(correlation) > 0.013)
+        BOOST_ERROR("correlation of streams 0 and 1 ("
+                    << correlation << ") too high");
+}
+
+void MonteCarloMultiThreadedTest::testPhiloxScaling() {
+
+#if !defined(_OPENMP)
+
+    BOOST_TEST_MESSAGE("Skipping philox multithreaded scaling test, "
+                       "because OpenMP is not enabled");
+
+#else
+
+    BOOST_TEST_MESSAGE("Testing multithreaded Monte Carlo Heston engine "
+                       "with philox generator for 1 to 64 threads...");
+
+    SavedSettings backup;
+
+    Date settlementDate(27, December, 2004);
+    Settings::instance().evaluationDate() = settlementDate;
+
+    DayCounter dayCounter = ActualActual();
+    Date exerciseDate(28, March, 2005);
+
+    boost::shared_ptr<StrikedTypePayoff> payoff(
+        new PlainVanillaPayoff(Option::Put, 1.05));
+    boost::shared_ptr<Exercise> exercise(new EuropeanExercise(exerciseDate));
+
+    Handle<YieldTermStructure> riskFreeTS(flatRate(0.7, dayCounter));
+    Handle<YieldTermStructure> dividendTS(flatRate(0.4, dayCounter));
+
+    Handle<Quote> s0(boost::shared_ptr<Quote>(new SimpleQuote(1.05)));
+
+    boost::shared_ptr<HestonProcess> process(
+        new HestonProcess(riskFreeTS, dividendTS, s0, 0.3, 1.16, 0.2, 0.8, 0.8,
+                          HestonProcess::QuadraticExponentialMartingale));
+
+    VanillaOption option(payoff, exercise);
+
+    Real expected = 0.0632851308977151;
+    int maxThreads = omp_get_max_threads();
+
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        omp_set_num_threads(threads);
+        option.setPricingEngine(
+            MakeMCEuropeanHestonEngine<PseudoRandomPhiloxMultiThreaded>(
+                process)
+                .withStepsPerYear(11)
+                .withAntitheticVariate()
+                .withSamples(50000)
+                .withSeed(1234));
+        double start = omp_get_wtime();
+        Real calculated = option.NPV();
+        double elapsed = omp_get_wtime() - start;
+        Real errorEstimate = option.errorEstimate();
+        BOOST_TEST_MESSAGE("    threads: " << threads << ", npv: " << calculated
+                                           << " +/- " << errorEstimate
+                                           << ", time: " << elapsed << "s");
+        if (std::fabs(calculated - expected) > 3.0 * errorEstimate) {
+            BOOST_ERROR("Failed to reproduce cached price with "
+                        << threads << " threads"
+                        << "\n    calculated: " << calculated
+                        << "\n    expected:   " << expected << " +/- "
+                        << errorEstimate);
+        }
+    }
+
+    omp_set_num_threads(maxThreads);
+
+#endif
+}
+
+namespace {
+
+    class TerminalValuePricer : public PathPricer<Path> {
+      public:
+        Real operator()(const Path& path) const { return path.back(); }
+    };
+
+    template <class S>
+    S terminalValueStatistics(Size samples) {
+        typedef MonteCarloModel<SingleVariate,
+                                PseudoRandomPhiloxMultiThreaded, S> model;
+        boost::shared_ptr<StochasticProcess1D> process(
+                          new GeometricBrownianMotionProcess(100.0, 0.03, 0.2));
+        PseudoRandomPhiloxMultiThreaded::rsg_type rsg =
+            PseudoRandomPhiloxMultiThreaded::make_sequence_generator(4, 42);
+        boost::shared_ptr<typename model::path_generator_type> generator(
+            new typename model::path_generator_type(process, 1.0, 4, rsg,
+                                                    false));
+        boost::shared_ptr<typename model::path_pricer_type> pricer(
+                                                     new TerminalValuePricer);
+        model mc(generator, pricer, S(), false);
+        mc.addSamples(samples);
+        return mc.sampleAccumulator();
+    }
+
+}
+
+void MonteCarloMultiThreadedTest::testNonMergeableStatistics() {
+
+#if !defined(_OPENMP)
+
+    BOOST_TEST_MESSAGE("Skipping multithreaded Monte Carlo model test with "
+                       "non-mergeable statistics, "
+                       "because OpenMP is not enabled");
+
+#else
+
+    BOOST_TEST_MESSAGE("Testing multithreaded Monte Carlo model "
+                       "with non-mergeable statistics...");
+
+    int maxThreads = omp_get_max_threads();
+    omp_set_num_threads(4);
+
+    // the convergence statistics can not be merged, so the samples are
+    // added in a critical section; the mean must agree with the one
+    // accumulated from merged per-thread statistics
+    Size samples = 10000;
+    Statistics merged = terminalValueStatistics<Statistics>(samples);
+    ConvergenceStatistics<Statistics> convergence =
+        terminalValueStatistics<ConvergenceStatistics<Statistics> >(samples);
+
+    omp_set_num_threads(maxThreads);
+
+    if (convergence.samples() != samples)
+        BOOST_ERROR("failed to collect all samples:"
+                    << "\n    calculated: " << convergence.samples()
+                    << "\n    expected:   " << samples);
+    if (convergence.convergenceTable().empty())
+        BOOST_ERROR("empty convergence table");
+    if (std::fabs(convergence.mean() - merged.mean()) > 1.0e-10)
+        BOOST_ERROR("mean of convergence statistics differs from the one "
+                    "of merged statistics:"
+                    << "\n    convergence: " << convergence.mean()
+                    << "\n    merged:      " << merged.mean());
+
+#endif
+}
+
 test_suite *MonteCarloMultiThreadedTest::suite() {
     test_suite *suite = BOOST_TEST_SUITE("Monte carlo multithreaded tests");
 
     suite->add(QUANTLIB_TEST_CASE(
         &MonteCarloMultiThreadedTest::testDynamicCreatorWrapper));
+    suite->add(QUANTLIB_TEST_CASE(&MonteCarloMultiThreadedTest::testPhiloxRng));
     suite->add(
         QUANTLIB_TEST_CASE(&MonteCarloMultiThreadedTest::testHestonEngine));
     suite->add(
         QUANTLIB_TEST_CASE(&MonteCarloMultiThreadedTest::testAmericanOption));
     suite->add(
         QUANTLIB_TEST_CASE(&MonteCarloMultiThreadedTest::testBermudanSwaption));
+    suite->add(
+        QUANTLIB_TEST_CASE(&MonteCarloMultiThreadedTest::testPhiloxScaling));
+    suite->add(QUANTLIB_TEST_CASE(
+        &MonteCarloMultiThreadedTest::testNonMergeableStatistics));
 
     return suite;
 }
@@ -31,6 +31,9 @@ class MonteCarloMultiThreadedTest {
     static void testAmericanOption();
     static void testBermudanSwaption();
     static void testDynamicCreatorWrapper();
+    static void testPhiloxRng();
+    static void testPhiloxScaling();
+    static void testNonMergeableStatistics();
     static boost::unit_test_framework::test_suite *suite();
 };
 
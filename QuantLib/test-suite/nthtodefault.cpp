@@ -166,12 +166,12 @@ void NthToDefaultTest::testGauss() {
     //    // g++ requires this when using make_shared
     //    GaussianCopulaPolicy::initTraits()));
     //Size numSimulations = 1000000;
-    //// Size numCoresUsed = 4; use your are in the multithread branch
+    //Size numCoresUsed = 4;
     //// Sobol, many cores
     //boost::shared_ptr<RandomDefaultLM<GaussianCopulaPolicy> > copula( 
     //    new RandomDefaultLM<GaussianCopulaPolicy>(gLM, 
     //        std::vector<Real>(names, recovery), numSimulations, 1.e-6, 
-    //        2863311530));
+    //        2863311530, numCoresUsed));
 
 
     vector<Handle<DefaultProbabilityTermStructure> > singleProbability;
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2015 Klaus Spanderen
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -20,7 +21,10 @@
 #include "observable.hpp"
 #include "utilities.hpp"
 #include <ql/patterns/observable.hpp>
+#include <ql/patterns/lazyobject.hpp>
 #include <ql/quotes/simplequote.hpp>
+#include <ql/math/comparison.hpp>
+#include <boost/make_shared.hpp>
 
 using namespace QuantLib;
 using namespace boost::unit_test_framework;
@@ -91,6 +95,265 @@ void ObservableTest::testObservableSettings() {
 }
 
 
+#ifndef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
+
+#include <boost/atomic.hpp>
+#include <set>
+
+namespace {
+
+    // sums might be recalculated in parallel
+    boost::atomic<Size> sequence(0);
+
+    // sums up the values of its quotes and of other sums
+    class Sum : public LazyObject {
+      public:
+        Sum() : updates_(0), lastUpdate_(0), lastCalculation_(0),
+                value_(0.0) {}
+        void add(const boost::shared_ptr<Quote>& q) {
+            quotes_.push_back(q);
+            registerWith(q);
+        }
+        void add(const boost::shared_ptr<Sum>& s) {
+            sums_.push_back(s);
+            registerWith(s);
+        }
+        void update() {
+            ++updates_;
+            lastUpdate_ = ++sequence;
+            LazyObject::update();
+        }
+        Real value() const {
+            calculate();
+            return value_;
+        }
+        Size updates() const { return updates_; }
+        Size lastUpdate() const { return lastUpdate_; }
+        Size lastCalculation() const { return lastCalculation_; }
+        bool calculated() const { return calculated_; }
+      private:
+        void performCalculations() const {
+            value_ = 0.0;
+            for (Size i = 0; i < quotes_.size(); ++i)
+                value_ += quotes_[i]->value();
+            for (Size i = 0; i < sums_.size(); ++i)
+                value_ += sums_[i]->value();
+            lastCalculation_ = ++sequence;
+        }
+        std::vector<boost::shared_ptr<Quote> > quotes_;
+        std::vector<boost::shared_ptr<Sum> > sums_;
+        Size updates_, lastUpdate_;
+        mutable Size lastCalculation_;
+        mutable Real value_;
+    };
+
+}
+
+void ObservableTest::testDeferredUpdatesInTopologicalOrder() {
+
+    BOOST_TEST_MESSAGE("Testing deferred updates in topological order...");
+
+    const Size nQuotes = 100, nSums = 10;
+
+    std::vector<boost::shared_ptr<SimpleQuote> > quotes;
+    for (Size i = 0; i < nQuotes; ++i)
+        quotes.push_back(boost::make_shared<SimpleQuote>(1.0));
+
+    // each sum depends on a tenth of the quotes and on the first one,
+    // the total depends on all sums and on all quotes
+    std::vector<boost::shared_ptr<Sum> > sums;
+    boost::shared_ptr<Sum> total = boost::make_shared<Sum>();
+    for (Size j = 0; j < nSums; ++j) {
+        sums.push_back(boost::make_shared<Sum>());
+        if (j != 0)
+            sums.back()->add(quotes[0]);
+        for (Size i = j; i < nQuotes; i += nSums)
+            sums.back()->add(quotes[i]);
+        total->add(sums.back());
+    }
+    for (Size i = 0; i < nQuotes; ++i)
+        total->add(quotes[i]);
+    UpdateCounter counter;
+    counter.registerWith(total);
+
+    Real expected = 2.0 * nQuotes + (nSums - 1);
+    if (!close_enough(total->value(), expected))
+        BOOST_FAIL("unexpected total " << total->value()
+                   << ", expected " << expected);
+
+    ObservableSettings::instance().disableUpdates(true);
+    for (Size i = 0; i < nQuotes; ++i)
+        quotes[i]->setValue(2.0);
+    ObservableSettings::instance().enableUpdates();
+
+    Size lastSumUpdate = 0;
+    for (Size j = 0; j < nSums; ++j) {
+        if (sums[j]->updates() != 1)
+            BOOST_ERROR("sum #" << j << " was updated " << sums[j]->updates()
+                        << " times, expected once");
+        lastSumUpdate = std::max(lastSumUpdate, sums[j]->lastUpdate());
+    }
+    if (total->updates() != 1)
+        BOOST_ERROR("total was updated " << total->updates()
+                    << " times, expected once");
+    if (total->lastUpdate() < lastSumUpdate)
+        BOOST_ERROR("total was updated before the sums");
+    if (counter.counter() != 1)
+        BOOST_ERROR("observer of total was notified " << counter.counter()
+                    << " times, expected once");
+
+    expected *= 2.0;
+    if (!close_enough(total->value(), expected))
+        BOOST_FAIL("unexpected total " << total->value()
+                   << ", expected " << expected);
+
+    // recalculation level by level
+    for (Size k = 0; k < 2; ++k) {
+        bool parallel = k == 1;
+        ObservableSettings::instance().disableUpdates(true);
+        for (Size i = 0; i < nQuotes; ++i)
+            quotes[i]->setValue(3.0 + k);
+        ObservableSettings::instance().enableUpdates(true, parallel);
+
+        Size lastSumCalculation = 0;
+        for (Size j = 0; j < nSums; ++j) {
+            if (!sums[j]->calculated())
+                BOOST_ERROR("sum #" << j << " was not recalculated");
+            lastSumCalculation = std::max(lastSumCalculation,
+                                          sums[j]->lastCalculation());
+        }
+        if (!total->calculated())
+            BOOST_ERROR("total was not recalculated");
+        if (!parallel && total->lastCalculation() < lastSumCalculation)
+            BOOST_ERROR("total was recalculated before the sums");
+        expected = (3.0 + k) * (2.0 * nQuotes + (nSums - 1));
+        if (!close_enough(total->value(), expected))
+            BOOST_ERROR("unexpected total " << total->value()
+                        << ", expected " << expected
+                        << (parallel ? " (parallel)" : ""));
+    }
+}
+
+namespace {
+
+    std::set<const Observer*> destroyed;
+
+    // forwards its notifications, and can be made to notify again
+    class Relay : public Observer, public Observable {
+      public:
+        ~Relay() { destroyed.insert(this); }
+        void update() {
+            if (destroyed.count(this) != 0)
+                BOOST_ERROR("destroyed relay was updated");
+            notifyObservers();
+        }
+        void poke() { notifyObservers(); }
+    };
+
+    // changes the observer graph when notified
+    class GraphChanger : public Observer {
+      public:
+        GraphChanger(const boost::shared_ptr<Observable>& observable,
+                     const boost::shared_ptr<Observer>& newObserver,
+                     boost::shared_ptr<Relay>& doomed,
+                     const boost::shared_ptr<Relay>& poked)
+        : observable_(observable), newObserver_(newObserver),
+          doomed_(doomed), poked_(poked) {}
+        void update() {
+            if (observable_)
+                newObserver_->registerWith(observable_);
+            doomed_.reset();
+            // pokes only once, as the relay might notify this again
+            if (poked_) {
+                boost::shared_ptr<Relay> poked = poked_;
+                poked_.reset();
+                poked->poke();
+            }
+        }
+      private:
+        boost::shared_ptr<Observable> observable_;
+        boost::shared_ptr<Observer> newObserver_;
+        boost::shared_ptr<Relay>& doomed_;
+        boost::shared_ptr<Relay> poked_;
+    };
+
+}
+
+void ObservableTest::testDeferredUpdatesWithChangingGraph() {
+
+    BOOST_TEST_MESSAGE("Testing deferred updates changing the "
+                       "observer graph...");
+
+    boost::shared_ptr<SimpleQuote> quote =
+        boost::make_shared<SimpleQuote>(1.0);
+
+    // quote -> first -> second -> counter; the changers are notified
+    // by the quote or by the first relay, before the second relay
+    boost::shared_ptr<Relay> first = boost::make_shared<Relay>(),
+                             second = boost::make_shared<Relay>();
+    first->registerWith(quote);
+    second->registerWith(first);
+    boost::shared_ptr<UpdateCounter> counter =
+        boost::make_shared<UpdateCounter>();
+    counter->registerWith(second);
+
+    // an observer destroyed before its turn is not updated
+    boost::shared_ptr<Relay> doomed = boost::make_shared<Relay>();
+    doomed->registerWith(first);
+    doomed->registerWith(second);
+    GraphChanger destroyer((boost::shared_ptr<Observable>()),
+                           boost::shared_ptr<Observer>(),
+                           doomed, boost::shared_ptr<Relay>());
+    destroyer.registerWith(quote);
+
+    ObservableSettings::instance().disableUpdates(true);
+    quote->setValue(2.0);
+    ObservableSettings::instance().enableUpdates();
+
+    if (doomed)
+        BOOST_ERROR("relay was not destroyed");
+    if (counter->counter() != 1)
+        BOOST_ERROR("observer was notified " << counter->counter()
+                    << " times, expected once");
+
+    // an observer registering during the flush is notified by
+    // the observables notifying after its registration
+    boost::shared_ptr<UpdateCounter> late =
+        boost::make_shared<UpdateCounter>();
+    boost::shared_ptr<Relay> none;
+    GraphChanger registrar(second, late, none, boost::shared_ptr<Relay>());
+    registrar.registerWith(quote);
+
+    ObservableSettings::instance().disableUpdates(true);
+    quote->setValue(3.0);
+    ObservableSettings::instance().enableUpdates();
+
+    if (late->counter() != 1)
+        BOOST_ERROR("observer registered during the flush was notified "
+                    << late->counter() << " times, expected once");
+    if (counter->counter() != 2)
+        BOOST_ERROR("observer was notified " << counter->counter()
+                    << " times, expected twice");
+    registrar.unregisterWithAll();
+
+    // a repeated notification from an observable which already
+    // had its turn is sent as usual
+    GraphChanger poker((boost::shared_ptr<Observable>()),
+                       boost::shared_ptr<Observer>(), none, first);
+    poker.registerWith(second);
+
+    ObservableSettings::instance().disableUpdates(true);
+    quote->setValue(4.0);
+    ObservableSettings::instance().enableUpdates();
+
+    if (counter->counter() != 4)
+        BOOST_ERROR("observer was notified " << counter->counter() - 2
+                    << " times, expected twice");
+}
+
+#endif
+
+
 #ifdef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
 
 #include <boost/atomic.hpp>
@@ -98,6 +361,7 @@ void ObservableTest::testObservableSettings() {
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/bind.hpp>
 
 #include <list>
 
@@ -247,6 +511,206 @@ void ObservableTest::testMultiThreadingGlobalSettings() {
         }
     }
 }
+
+
+namespace {
+
+    // builds observers of a shared and of a private observable,
+    // notifies them through the latter and destroys them again
+    class ContentionWorker {
+      public:
+        ContentionWorker(const boost::shared_ptr<SimpleQuote>& shared,
+                         Size iterations)
+        : shared_(shared), iterations_(iterations), errors_(0) {}
+
+        void run() {
+            for (Size i=0; i < iterations_; ++i) {
+                const boost::shared_ptr<SimpleQuote> own(new SimpleQuote);
+                const boost::shared_ptr<MTUpdateCounter> observer(
+                                                       new MTUpdateCounter);
+                observer->registerWith(shared_);
+                observer->registerWith(own);
+                for (Size j=0; j < 10; ++j)
+                    own->setValue(Real(j));
+                // notifications of the shared quote may come on top
+                if (observer->counter() < 10)
+                    ++errors_;
+            }
+        }
+
+        Size errors() const { return errors_; }
+      private:
+        const boost::shared_ptr<SimpleQuote> shared_;
+        const Size iterations_;
+        Size errors_;
+    };
+}
+
+void ObservableTest::testMultiThreadingContention() {
+    BOOST_TEST_MESSAGE("Testing observer pattern under contention "
+                       "of several threads...");
+
+    const boost::shared_ptr<SimpleQuote> shared(new SimpleQuote(-1.0));
+    const Size nThreads = 4, iterations = 20000;
+
+    std::vector<boost::shared_ptr<ContentionWorker> > workers;
+    for (Size i=0; i < nThreads; ++i)
+        workers.push_back(boost::shared_ptr<ContentionWorker>(
+                               new ContentionWorker(shared, iterations)));
+
+    const boost::posix_time::ptime start =
+        boost::posix_time::microsec_clock::universal_time();
+
+    boost::thread_group threads;
+    for (Size i=0; i < nThreads; ++i)
+        threads.create_thread(
+                       boost::bind(&ContentionWorker::run, workers[i].get()));
+
+    // notify the shared quote while the workers (un)register with it
+    for (Size j=0; j < 1000; ++j) {
+        shared->setValue(Real(j));
+        boost::this_thread::yield();
+    }
+    threads.join_all();
+
+    const boost::posix_time::time_duration elapsed =
+        boost::posix_time::microsec_clock::universal_time() - start;
+
+    BOOST_TEST_MESSAGE("    " << nThreads << " threads, " << iterations
+                       << " observers each: "
+                       << elapsed.total_milliseconds() << " ms");
+
+    for (Size i=0; i < nThreads; ++i) {
+        if (workers[i]->errors() != 0)
+            BOOST_ERROR(workers[i]->errors() << " observers in thread #"
+                        << i << " missed notifications");
+    }
+
+    if (MTUpdateCounter::instanceCounter() != 0) {
+        BOOST_FAIL(MTUpdateCounter::instanceCounter()
+                   << " observers were not destroyed");
+    }
+}
+#endif
+
+
+#ifdef QL_ENABLE_SESSIONS
+
+#include <ql/patterns/threadsession.hpp>
+#include <ql/settings.hpp>
+#include <ql/termstructures/yield/flatforward.hpp>
+#include <ql/time/calendars/target.hpp>
+#include <ql/time/daycounters/actual365fixed.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace {
+
+    class SessionWorker {
+      public:
+        SessionWorker(Integer session, const Date& today, Size days)
+        : session_(session), today_(today), days_(days),
+          updates_(0), wrongDates_(0) {}
+
+        void operator()() {
+            ThreadSession session(session_);
+
+            Settings::instance().evaluationDate() = today_;
+            const boost::shared_ptr<YieldTermStructure> curve =
+                boost::make_shared<FlatForward>(0, TARGET(), 0.02,
+                                                Actual365Fixed());
+            const boost::shared_ptr<UpdateCounter> counter =
+                boost::make_shared<UpdateCounter>();
+            counter->registerWith(Settings::instance().evaluationDate());
+
+            for (Size i = 1; i <= days_; ++i) {
+                Date d = today_ + static_cast<Integer>(i);
+                Settings::instance().evaluationDate() = d;
+                if (curve->referenceDate() != TARGET().adjust(d))
+                    ++wrongDates_;
+                boost::this_thread::yield();
+            }
+            updates_ = counter->counter();
+        }
+
+        Size updates() const { return updates_; }
+        Size wrongDates() const { return wrongDates_; }
+
+      private:
+        Integer session_;
+        Date today_;
+        Size days_, updates_, wrongDates_;
+    };
+}
+
+void ObservableTest::testSessionScopedSettings() {
+    BOOST_TEST_MESSAGE("Testing session scoped evaluation dates...");
+
+    SavedSettings backup;
+
+    const Date today(15, March, 2016);
+    Settings::instance().evaluationDate() = today;
+
+    const boost::shared_ptr<YieldTermStructure> curve =
+        boost::make_shared<FlatForward>(0, TARGET(), 0.02, Actual365Fixed());
+    const boost::shared_ptr<UpdateCounter> counter =
+        boost::make_shared<UpdateCounter>();
+    counter->registerWith(curve);
+    counter->registerWith(Settings::instance().evaluationDate());
+
+    const Size nThreads = 4, days = 500;
+
+    std::vector<SessionWorker> workers;
+    for (Size i = 0; i < nThreads; ++i)
+        workers.push_back(SessionWorker(static_cast<Integer>(i + 1),
+                                        today + 7 * static_cast<Integer>(i),
+                                        days));
+
+    boost::thread_group threads;
+    for (Size i = 0; i < nThreads; ++i)
+        threads.create_thread(boost::ref(workers[i]));
+    threads.join_all();
+
+    for (Size i = 0; i < nThreads; ++i) {
+        if (workers[i].wrongDates() != 0)
+            BOOST_ERROR("session " << i + 1 << ": "
+                        << workers[i].wrongDates()
+                        << " wrong curve reference dates");
+        if (workers[i].updates() != days)
+            BOOST_ERROR("session " << i + 1 << ": "
+                        << workers[i].updates()
+                        << " notifications received, expected " << days);
+    }
+
+    // a thread switching sessions sees the instances of the new
+    // session, and parallel regions can enter the caller's session
+    {
+        ThreadSession session(static_cast<Integer>(nThreads + 1));
+        const Date sessionToday = today + 100;
+        Settings::instance().evaluationDate() = sessionToday;
+        std::vector<Date> dates(16);
+        Integer id = ThreadSession::id();
+        #pragma omp parallel for
+        for (int i = 0; i < 16; ++i) {
+            ThreadSession threadSession(id);
+            dates[i] = Settings::instance().evaluationDate();
+        }
+        for (Size i = 0; i < dates.size(); ++i) {
+            if (dates[i] != sessionToday)
+                BOOST_ERROR("evaluation date " << dates[i]
+                            << " in parallel region, expected "
+                            << sessionToday);
+        }
+    }
+
+    if (Settings::instance().evaluationDate() != today)
+        BOOST_ERROR("evaluation date of the main session changed to "
+                    << Settings::instance().evaluationDate()
+                    << ", expected " << today);
+    if (counter->counter() != 0)
+        BOOST_ERROR(counter->counter() << " notifications received "
+                    "in the main session, expected none");
+}
+
 #endif
 
 
@@ -256,10 +720,23 @@ test_suite* ObservableTest::suite() {
 
     suite->add(QUANTLIB_TEST_CASE(&ObservableTest::testObservableSettings));
 
+#ifndef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
+    suite->add(QUANTLIB_TEST_CASE(
+        &ObservableTest::testDeferredUpdatesInTopologicalOrder));
+    suite->add(QUANTLIB_TEST_CASE(
+        &ObservableTest::testDeferredUpdatesWithChangingGraph));
+#endif
+
 #ifdef QL_ENABLE_THREAD_SAFE_OBSERVER_PATTERN
     suite->add(QUANTLIB_TEST_CASE(&ObservableTest::testAsyncGarbagCollector));
     suite->add(QUANTLIB_TEST_CASE(
         &ObservableTest::testMultiThreadingGlobalSettings));
+    suite->add(QUANTLIB_TEST_CASE(
+        &ObservableTest::testMultiThreadingContention));
+#endif
+
+#ifdef QL_ENABLE_SESSIONS
+    suite->add(QUANTLIB_TEST_CASE(&ObservableTest::testSessionScopedSettings));
 #endif
 
     return suite;
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2015 Klaus Spanderen
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -28,8 +29,12 @@
 class ObservableTest {
   public:
     static void testObservableSettings();
+    static void testDeferredUpdatesInTopologicalOrder();
+    static void testDeferredUpdatesWithChangingGraph();
     static void testAsyncGarbagCollector();
     static void testMultiThreadingGlobalSettings();
+    static void testMultiThreadingContention();
+    static void testSessionScopedSettings();
 
     static boost::unit_test_framework::test_suite* suite();
 };
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2005 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -22,12 +23,15 @@
 #include <ql/methods/montecarlo/mctraits.hpp>
 #include <ql/processes/blackscholesprocess.hpp>
 #include <ql/processes/geometricbrownianprocess.hpp>
+#include <ql/processes/gsrprocess.hpp>
+#include <ql/processes/hestonprocess.hpp>
 #include <ql/processes/ornsteinuhlenbeckprocess.hpp>
 #include <ql/processes/squarerootprocess.hpp>
 #include <ql/processes/stochasticprocessarray.hpp>
 #include <ql/time/daycounters/actual360.hpp>
 #include <ql/quotes/simplequote.hpp>
 #include <ql/utilities/dataformatters.hpp>
+#include <boost/lexical_cast.hpp>
 
 using namespace QuantLib;
 using namespace boost::unit_test_framework;
@@ -290,11 +294,182 @@ void PathGeneratorTest::testMultiPathGenerator() {
 }
 
 
+namespace {
+
+    bool closeTo(Real x, Real y) {
+        return std::fabs(x - y) <= 1.0E-12 * std::max(1.0, std::fabs(y));
+    }
+
+    void testSingleBlock(
+                    const boost::shared_ptr<StochasticProcess1D>& process,
+                    const std::string& tag, bool brownianBridge) {
+        typedef PseudoRandom::rsg_type rsg_type;
+        typedef PathGenerator<rsg_type>::sample_type sample_type;
+
+        BigNatural seed = 42;
+        Time length = 10;
+        Size timeSteps = 12, blockSize = 17;
+        PathGenerator<rsg_type> generator(
+            process, length, timeSteps,
+            PseudoRandom::make_sequence_generator(timeSteps, seed),
+            brownianBridge);
+        PathGenerator<rsg_type> blockGenerator(
+            process, length, timeSteps,
+            PseudoRandom::make_sequence_generator(timeSteps, seed),
+            brownianBridge);
+
+        // the second block must continue the sequence of the first one
+        for (Size k = 0; k < 2; ++k) {
+            const Matrix& block = blockGenerator.nextBlock(blockSize);
+            for (Size j = 0; j < blockSize; ++j) {
+                const sample_type& sample = generator.next();
+                for (Size i = 0; i < sample.value.length(); ++i) {
+                    if (!closeTo(block[i][j], sample.value[i]))
+                        BOOST_ERROR("using "
+                                    << tag << " process "
+                                    << (brownianBridge ? "with " : "without ")
+                                    << "brownian bridge: block path " << j
+                                    << " at step " << i << " ("
+                                    << std::setprecision(16) << block[i][j]
+                                    << ") differs from single path ("
+                                    << sample.value[i] << ")");
+                }
+            }
+        }
+
+        const Matrix& block = blockGenerator.antitheticBlock();
+        const sample_type& sample = generator.antithetic();
+        for (Size i = 0; i < sample.value.length(); ++i) {
+            if (!closeTo(block[i][blockSize - 1], sample.value[i]))
+                BOOST_ERROR("using "
+                            << tag << " process "
+                            << (brownianBridge ? "with " : "without ")
+                            << "brownian bridge: antithetic block path at "
+                            << "step " << i << " (" << std::setprecision(16)
+                            << block[i][blockSize - 1]
+                            << ") differs from single path ("
+                            << sample.value[i] << ")");
+        }
+    }
+
+    void testMultipleBlock(const boost::shared_ptr<StochasticProcess>& process,
+                           const std::string& tag) {
+        typedef PseudoRandom::rsg_type rsg_type;
+        typedef MultiPathGenerator<rsg_type>::sample_type sample_type;
+
+        BigNatural seed = 42;
+        Time length = 10;
+        Size timeSteps = 12, blockSize = 17;
+        Size factors = process->factors();
+        MultiPathGenerator<rsg_type> generator(
+            process, TimeGrid(length, timeSteps),
+            PseudoRandom::make_sequence_generator(timeSteps * factors, seed));
+        MultiPathGenerator<rsg_type> blockGenerator(
+            process, TimeGrid(length, timeSteps),
+            PseudoRandom::make_sequence_generator(timeSteps * factors, seed));
+
+        for (Size k = 0; k < 2; ++k) {
+            const std::vector<Matrix>& block =
+                blockGenerator.nextBlock(blockSize);
+            for (Size j = 0; j < blockSize; ++j) {
+                const sample_type& sample = generator.next();
+                for (Size a = 0; a < process->size(); ++a) {
+                    for (Size i = 0; i <= timeSteps; ++i) {
+                        if (!closeTo(block[i][a][j], sample.value[a][i]))
+                            BOOST_ERROR("using "
+                                        << tag << " process: block path " << j
+                                        << ", state variable " << a
+                                        << " at step " << i << " ("
+                                        << std::setprecision(16)
+                                        << block[i][a][j]
+                                        << ") differs from single path ("
+                                        << sample.value[a][i] << ")");
+                    }
+                }
+            }
+        }
+
+        const std::vector<Matrix>& block = blockGenerator.antitheticBlock();
+        const sample_type& sample = generator.antithetic();
+        for (Size a = 0; a < process->size(); ++a) {
+            for (Size i = 0; i <= timeSteps; ++i) {
+                if (!closeTo(block[i][a][blockSize - 1], sample.value[a][i]))
+                    BOOST_ERROR("using "
+                                << tag << " process: antithetic block path, "
+                                << "state variable " << a << " at step " << i
+                                << " (" << std::setprecision(16)
+                                << block[i][a][blockSize - 1]
+                                << ") differs from single path ("
+                                << sample.value[a][i] << ")");
+            }
+        }
+    }
+
+}
+
+
+void PathGeneratorTest::testBlockPathGenerator() {
+
+    BOOST_TEST_MESSAGE("Testing block path generation against single "
+                       "paths...");
+
+    SavedSettings backup;
+
+    Settings::instance().evaluationDate() = Date(26,April,2005);
+
+    Handle<Quote> x0(boost::shared_ptr<Quote>(new SimpleQuote(100.0)));
+    Handle<YieldTermStructure> r(flatRate(0.05, Actual360()));
+    Handle<YieldTermStructure> q(flatRate(0.02, Actual360()));
+    Handle<BlackVolTermStructure> sigma(flatVol(0.20, Actual360()));
+
+    boost::shared_ptr<StochasticProcess1D> bs(
+                                 new BlackScholesMertonProcess(x0,q,r,sigma));
+    testSingleBlock(bs, "Black-Scholes", false);
+    testSingleBlock(bs, "Black-Scholes", true);
+
+    Real t[] = {2.0, 5.0};
+    Real v[] = {0.01, 0.012, 0.008};
+    // the process keeps references to the parameter arrays
+    Array times(t, t + 2), vols(v, v + 3), reversions(1, 0.02),
+        adjusters(3, 1.0);
+    boost::shared_ptr<StochasticProcess1D> gsr(
+        new GsrProcess(times, vols, reversions, adjusters, 20.0));
+    testSingleBlock(gsr, "gsr", false);
+
+    // generic implementation
+    testSingleBlock(boost::shared_ptr<StochasticProcess1D>(
+                                     new OrnsteinUhlenbeckProcess(0.1, 0.20)),
+                    "Ornstein-Uhlenbeck", false);
+
+    HestonProcess::Discretization schemes[] = {
+        HestonProcess::PartialTruncation, HestonProcess::FullTruncation,
+        HestonProcess::Reflection, HestonProcess::QuadraticExponential,
+        HestonProcess::QuadraticExponentialMartingale,
+        HestonProcess::NonCentralChiSquareVariance };
+    for (Size i = 0; i < LENGTH(schemes); ++i) {
+        testMultipleBlock(
+            boost::shared_ptr<StochasticProcess>(
+                new HestonProcess(r, q, x0, 0.04, 1.2, 0.05, 0.4, -0.6,
+                                  schemes[i])),
+            "Heston (scheme " + boost::lexical_cast<std::string>(i) + ")");
+    }
+
+    Matrix correlation(2,2);
+    correlation[0][0] = correlation[1][1] = 1.0;
+    correlation[0][1] = correlation[1][0] = 0.7;
+    std::vector<boost::shared_ptr<StochasticProcess1D> > processes(2, bs);
+    testMultipleBlock(boost::shared_ptr<StochasticProcess>(
+                          new StochasticProcessArray(processes, correlation)),
+                      "Black-Scholes array");
+}
+
+
 test_suite* PathGeneratorTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("Path generation tests");
     suite->add(QUANTLIB_TEST_CASE(&PathGeneratorTest::testPathGenerator));
     // FLOATING_POINT_EXCEPTION
     suite->add(QUANTLIB_TEST_CASE(&PathGeneratorTest::testMultiPathGenerator));
+    suite->add(QUANTLIB_TEST_CASE(&PathGeneratorTest::testBlockPathGenerator));
     return suite;
 }
 
@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2005, 2006, 2007, 2008, 2009 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -44,10 +45,12 @@
 #include <ql/math/interpolations/cubicinterpolation.hpp>
 #include <ql/math/interpolations/convexmonotoneinterpolation.hpp>
 #include <ql/math/comparison.hpp>
+#include <ql/math/randomnumbers/mt19937uniformrng.hpp>
 #include <ql/quotes/simplequote.hpp>
 #include <ql/utilities/dataformatters.hpp>
 #include <ql/pricingengines/bond/discountingbondengine.hpp>
 #include <ql/pricingengines/swap/discountingswapengine.hpp>
+#include <boost/timer.hpp>
 #include <iomanip>
 
 using namespace QuantLib;
@@ -758,6 +761,124 @@ void PiecewiseYieldCurveTest::testLocalBootstrapConsistency() {
                                               vars, ConvexMonotone(), 1.0e-7);
 }
 
+void PiecewiseYieldCurveTest::testGlobalBootstrap() {
+    BOOST_TEST_MESSAGE(
+        "Testing consistency of global-bootstrap algorithm...");
+
+    CommonVars vars;
+
+    Cubic cubic(CubicInterpolation::Spline, true,
+                CubicInterpolation::SecondDerivative, 0.0,
+                CubicInterpolation::SecondDerivative, 0.0);
+    testCurveConsistency<ZeroYield,Cubic,GlobalBootstrap>(vars, cubic);
+    testCurveConsistency<Discount,LogLinear,GlobalBootstrap>(vars);
+
+    // the global and the iterative bootstrap must find the same curve,
+    // also when it is recalculated after a quote change
+    PiecewiseYieldCurve<ZeroYield,Cubic,GlobalBootstrap> global(
+                    vars.settlement, vars.instruments, Actual360(), cubic);
+    PiecewiseYieldCurve<ZeroYield,Cubic,IterativeBootstrap> iterative(
+                    vars.settlement, vars.instruments, Actual360(), cubic);
+
+    Real tolerance = 1.0e-9;
+    for (Size k=0; k<2; ++k) {
+        if (k == 1)
+            vars.rates[vars.deposits+3]->setValue(
+                                   vars.rates[vars.deposits+3]->value()+0.001);
+        std::vector<Real> globalData = global.data(),
+                          iterativeData = iterative.data();
+        for (Size i=0; i<globalData.size(); ++i) {
+            if (std::fabs(globalData[i]-iterativeData[i]) > tolerance)
+                BOOST_ERROR("global and iterative bootstrap differ at " <<
+                            io::ordinal(i) << " node" <<
+                            (k == 1 ? " after quote change" : "") <<
+                            std::setprecision(12) <<
+                            "\n    global:    " << globalData[i] <<
+                            "\n    iterative: " << iterativeData[i]);
+        }
+    }
+
+    // check the quote jacobian against bump and rebootstrap
+    Matrix jacobian = global.bootstrap().jacobian();
+    std::vector<Real> data = global.data();
+    BOOST_REQUIRE(jacobian.rows() == data.size()-1 &&
+                  jacobian.columns() == vars.rates.size());
+
+    Real h = 1.0e-6;
+    tolerance = 1.0e-4;
+    for (Size k=0; k<vars.rates.size(); ++k) {
+        Real rate = vars.rates[k]->value();
+        vars.rates[k]->setValue(rate+h);
+        std::vector<Real> bumped = global.data();
+        vars.rates[k]->setValue(rate);
+        for (Size i=0; i<jacobian.rows(); ++i) {
+            Real expected = (bumped[i+1]-data[i+1])/h;
+            if (std::fabs(jacobian[i][k]-expected) > tolerance)
+                BOOST_ERROR("wrong sensitivity of " << io::ordinal(i+1) <<
+                            " node w.r.t. " << io::ordinal(k+1) << " quote" <<
+                            std::setprecision(8) <<
+                            "\n    jacobian:          " << jacobian[i][k] <<
+                            "\n    finite difference: " << expected);
+        }
+    }
+}
+
+void PiecewiseYieldCurveTest::testIncrementalBootstrap() {
+    BOOST_TEST_MESSAGE(
+        "Testing incremental bootstrap on a stream of quote changes...");
+
+    // the curves bootstrapped from scratch use their own helpers, which
+    // are relinked to each of them
+    CommonVars vars, fullVars;
+
+    PiecewiseYieldCurve<Discount,LogLinear> curve(vars.settlement,
+                                                  vars.instruments,
+                                                  Actual360());
+    curve.nodes();
+
+    // replay a stream of random single quote ticks, after each tick
+    // the incrementally recalculated curve must coincide with a curve
+    // bootstrapped from scratch
+    MersenneTwisterUniformRng rng(42);
+    Size ticks = 500, n = vars.rates.size();
+    Real tolerance = 1.0e-9, incrementalTime = 0.0, fullTime = 0.0;
+    boost::timer timer;
+
+    for (Size t=0; t<ticks; ++t) {
+        Size k = std::min(static_cast<Size>(rng.nextReal()*n), n-1);
+        Real rate = vars.rates[k]->value() + (rng.nextReal()-0.5)*0.0002;
+        vars.rates[k]->setValue(rate);
+        fullVars.rates[k]->setValue(rate);
+
+        timer.restart();
+        std::vector<Real> data = curve.data();
+        incrementalTime += timer.elapsed();
+
+        timer.restart();
+        PiecewiseYieldCurve<Discount,LogLinear> fullCurve(
+                                                       fullVars.settlement,
+                                                       fullVars.instruments,
+                                                       Actual360());
+        std::vector<Real> expected = fullCurve.data();
+        fullTime += timer.elapsed();
+
+        for (Size i=0; i<data.size(); ++i) {
+            if (std::fabs(data[i]-expected[i]) > tolerance)
+                BOOST_FAIL("incremental bootstrap differs at " <<
+                           io::ordinal(i) << " node after " <<
+                           io::ordinal(t+1) << " tick (" <<
+                           io::ordinal(k+1) << " quote)" <<
+                           std::setprecision(12) <<
+                           "\n    incremental: " << data[i] <<
+                           "\n    full:        " << expected[i]);
+        }
+    }
+
+    BOOST_TEST_MESSAGE("    " << ticks << " ticks, incremental bootstrap: "
+                       << incrementalTime << "s, full bootstrap: "
+                       << fullTime << "s");
+}
+
 
 void PiecewiseYieldCurveTest::testObservability() {
 
@@ -1066,6 +1187,10 @@ test_suite* PiecewiseYieldCurveTest::suite() {
              &PiecewiseYieldCurveTest::testConvexMonotoneForwardConsistency));
     suite->add(QUANTLIB_TEST_CASE(
              &PiecewiseYieldCurveTest::testLocalBootstrapConsistency));
+    suite->add(QUANTLIB_TEST_CASE(
+             &PiecewiseYieldCurveTest::testGlobalBootstrap));
+    suite->add(QUANTLIB_TEST_CASE(
+             &PiecewiseYieldCurveTest::testIncrementalBootstrap));
 
     suite->add(QUANTLIB_TEST_CASE(&PiecewiseYieldCurveTest::testObservability));
     suite->add(QUANTLIB_TEST_CASE(&PiecewiseYieldCurveTest::testLiborFixing));
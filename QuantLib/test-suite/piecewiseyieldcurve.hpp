@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2005, 2006, 2008, 2009 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -41,6 +42,8 @@ class PiecewiseYieldCurveTest {
 
     static void testConvexMonotoneForwardConsistency();
     static void testLocalBootstrapConsistency();
+    static void testGlobalBootstrap();
+    static void testIncrementalBootstrap();
 
     static void testObservability();
     static void testLiborFixing();
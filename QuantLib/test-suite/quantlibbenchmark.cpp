@@ -2,6 +2,7 @@
 
 /*
  Copyright (C) 2006, 2008, 2010 Klaus Spanderen
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -222,8 +223,10 @@ namespace {
 }
 
 #if defined(QL_ENABLE_SESSIONS)
+#include <ql/patterns/threadsession.hpp>
+
 namespace QuantLib {
-    Integer sessionId() { return 0; }
+    Integer sessionId() { return ThreadSession::id(); }
 }
 #endif
 
@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2004, 2005, 2006, 2007 Ferdinando Ametrano
  Copyright (C) 2004, 2005, 2006, 2007, 2008 StatPro Italia srl
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -241,9 +242,11 @@ namespace {
 }
 
 #if defined(QL_ENABLE_SESSIONS)
+#include <ql/patterns/threadsession.hpp>
+
 namespace QuantLib {
 
-    Integer sessionId() { return 0; }
+    Integer sessionId() { return ThreadSession::id(); }
 
 }
 #endif
@@ -4,7 +4,7 @@
  Copyright (C) 2003 Ferdinando Ametrano
  Copyright (C) 2003 RiskMap srl
  Copyright (C) 2005 Gary Kennedy
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -389,11 +389,107 @@ void StatisticsTest::testIncrementalStatistics() {
                                  << tol);
 }
 
+void StatisticsTest::testMergeStatistics() {
+
+    BOOST_TEST_MESSAGE("Testing merged statistics...");
+
+    MersenneTwisterUniformRng mt(42);
+
+    Statistics stat, stat1, stat2, stat3;
+    IncrementalStatistics inc, inc1, inc2, inc3;
+    SequenceStatistics seq, seq1, seq2, seq3;
+
+    const Size n = 10000;
+    std::vector<Real> x(2);
+    for (Size i = 0; i < n; ++i) {
+        x[0] = 2.0 * (mt.nextReal() - 0.5) * 1234.0;
+        x[1] = x[0] * mt.nextReal();
+        Real w = mt.nextReal();
+        stat.add(x[0], w);
+        inc.add(x[0], w);
+        seq.add(x, w);
+        // chunks as they are produced by a static omp schedule
+        if (i < 3000) {
+            stat1.add(x[0], w);
+            inc1.add(x[0], w);
+            seq1.add(x, w);
+        } else if (i < 7000) {
+            stat2.add(x[0], w);
+            inc2.add(x[0], w);
+            seq2.add(x, w);
+        } else {
+            stat3.add(x[0], w);
+            inc3.add(x[0], w);
+            seq3.add(x, w);
+        }
+    }
+
+    Statistics statm;
+    statm.merge(stat1);
+    statm.merge(stat2);
+    statm.merge(stat3);
+    IncrementalStatistics incm;
+    incm.merge(inc1);
+    incm.merge(inc2);
+    incm.merge(inc3);
+    SequenceStatistics seqm;
+    seqm.merge(seq1);
+    seqm.merge(seq2);
+    seqm.merge(seq3);
+
+    // merging general statistics must reproduce the serial results exactly
+    if (statm.samples() != stat.samples() ||
+        statm.weightSum() != stat.weightSum() || statm.mean() != stat.mean() ||
+        statm.variance() != stat.variance() ||
+        statm.skewness() != stat.skewness() ||
+        statm.kurtosis() != stat.kurtosis() ||
+        statm.percentile(0.95) != stat.percentile(0.95))
+        BOOST_ERROR("merged statistics differ from serial ones:"
+                    << std::setprecision(16) << "\n    samples:  "
+                    << statm.samples() << " / " << stat.samples()
+                    << "\n    mean:     " << statm.mean() << " / "
+                    << stat.mean() << "\n    variance: " << statm.variance()
+                    << " / " << stat.variance());
+
+    Real tol = 1.0E-10;
+    Real values[][2] = {{incm.mean(), inc.mean()},
+                        {incm.variance(), inc.variance()},
+                        {incm.skewness(), inc.skewness()},
+                        {incm.kurtosis(), inc.kurtosis()},
+                        {incm.weightSum(), inc.weightSum()},
+                        {incm.min(), inc.min()},
+                        {incm.max(), inc.max()},
+                        {incm.downsideVariance(), inc.downsideVariance()}};
+    for (Size i = 0; i < LENGTH(values); ++i) {
+        if (std::fabs(values[i][0] - values[i][1]) >
+            tol * std::max(1.0, std::fabs(values[i][1])))
+            BOOST_ERROR("merged incremental statistics #"
+                        << i << " (" << std::setprecision(16) << values[i][0]
+                        << ") differs from serial one (" << values[i][1]
+                        << ")");
+    }
+    if (incm.samples() != inc.samples() ||
+        incm.downsideSamples() != inc.downsideSamples())
+        BOOST_ERROR("merged incremental statistics sample numbers differ "
+                    "from serial ones");
+
+    Matrix cov = seq.covariance(), covm = seqm.covariance();
+    for (Size i = 0; i < 2; ++i) {
+        for (Size j = 0; j < 2; ++j) {
+            if (std::fabs(cov[i][j] - covm[i][j]) > tol * std::fabs(cov[i][j]))
+                BOOST_ERROR("merged covariance ("
+                            << i << "," << j << ") = " << covm[i][j]
+                            << " differs from serial one " << cov[i][j]);
+        }
+    }
+}
+
 test_suite* StatisticsTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("Statistics tests");
     suite->add(QUANTLIB_TEST_CASE(&StatisticsTest::testStatistics));
     suite->add(QUANTLIB_TEST_CASE(&StatisticsTest::testSequenceStatistics));
     suite->add(QUANTLIB_TEST_CASE(&StatisticsTest::testConvergenceStatistics));
     suite->add(QUANTLIB_TEST_CASE(&StatisticsTest::testIncrementalStatistics));
+    suite->add(QUANTLIB_TEST_CASE(&StatisticsTest::testMergeStatistics));
     return suite;
 }
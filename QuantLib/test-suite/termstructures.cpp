@@ -2,7 +2,7 @@
 
 /*
  Copyright (C) 2003 RiskMap srl
- Copyright (C) 2015 Peter Caspers
+ Copyright (C) 2015, 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -26,6 +26,9 @@
 #include <ql/termstructures/yield/impliedtermstructure.hpp>
 #include <ql/termstructures/yield/forwardspreadedtermstructure.hpp>
 #include <ql/termstructures/yield/zerospreadedtermstructure.hpp>
+#include <ql/termstructures/yield/discountcurve.hpp>
+#include <ql/termstructures/yield/zerocurve.hpp>
+#include <ql/termstructures/yield/forwardcurve.hpp>
 #include <ql/experimental/yield/clonedyieldtermstructure.hpp>
 #include <ql/time/calendars/target.hpp>
 #include <ql/time/calendars/nullcalendar.hpp>
@@ -590,6 +593,84 @@ void TermStructureTest::testClonedYieldTermStructure() {
     }
 }
 
+namespace {
+
+    void checkBatchDiscount(const YieldTermStructure& curve,
+                            const std::vector<Time>& times,
+                            const std::string& name) {
+        std::vector<DiscountFactor> d;
+        curve.discount(times, d, true);
+        if (d.size() != times.size())
+            BOOST_FAIL(name << ": batch discount returned " << d.size()
+                            << " discount factors, expected "
+                            << times.size());
+        for (Size i = 0; i < times.size(); ++i) {
+            DiscountFactor expected = curve.discount(times[i], true);
+            if (std::fabs(d[i] - expected) > 1.0E-14 * expected)
+                BOOST_ERROR(name << ": batch discount differs from "
+                            "pointwise discount at t = " << times[i]
+                            << "\n    batch:     " << d[i]
+                            << "\n    pointwise: " << expected
+                            << "\n    error:     " << d[i] - expected);
+        }
+    }
+
+}
+
+void TermStructureTest::testBatchDiscount() {
+
+    BOOST_TEST_MESSAGE("Testing batched discount factors...");
+
+    CommonVars vars;
+
+    Date today = Settings::instance().evaluationDate();
+    Actual360 dc;
+
+    std::vector<Date> dates;
+    std::vector<Real> dfs, zeros, fwds;
+    Integer years[] = { 0, 1, 2, 3, 5, 7, 10, 15, 20 };
+    for (Size i = 0; i < LENGTH(years); ++i) {
+        dates.push_back(today + years[i]*Years);
+        Time t = dc.yearFraction(today, dates.back());
+        zeros.push_back(0.02 + 0.002 * t - 0.00005 * t * t);
+        fwds.push_back(0.02 + 0.004 * t - 0.00015 * t * t);
+        dfs.push_back(std::exp(-zeros.back() * t));
+    }
+
+    // sorted times including t = 0, node times and times beyond the
+    // last node
+    std::vector<Time> times;
+    for (Size i = 0; i <= 300; ++i)
+        times.push_back(0.1 * i);
+    times.push_back(dc.yearFraction(today, dates[4]));
+    std::sort(times.begin(), times.end());
+
+    std::vector<Handle<Quote> > jumps(1, Handle<Quote>(
+        boost::make_shared<SimpleQuote>(0.995)));
+    std::vector<Date> jumpDates(1, today + 4*Years);
+
+    InterpolatedDiscountCurve<LogLinear> discountCurve(dates, dfs, dc);
+    checkBatchDiscount(discountCurve, times, "discount curve");
+    InterpolatedDiscountCurve<LogLinear> jumpCurve(dates, dfs, dc,
+                                                   NullCalendar(),
+                                                   jumps, jumpDates);
+    checkBatchDiscount(jumpCurve, times, "discount curve with jumps");
+    InterpolatedZeroCurve<Cubic> zeroCurve(dates, zeros, dc);
+    checkBatchDiscount(zeroCurve, times, "zero curve");
+    InterpolatedForwardCurve<BackwardFlat> forwardCurve(dates, fwds, dc);
+    checkBatchDiscount(forwardCurve, times, "forward curve");
+
+    Handle<YieldTermStructure> h(vars.termStructure);
+    vars.termStructure->enableExtrapolation();
+    checkBatchDiscount(*vars.termStructure, times, "piecewise curve");
+
+    Handle<Quote> spread(boost::make_shared<SimpleQuote>(0.01));
+    ZeroSpreadedTermStructure zSpreaded(h, spread, Compounded, Annual);
+    checkBatchDiscount(zSpreaded, times, "zero-spreaded curve");
+    ForwardSpreadedTermStructure fSpreaded(h, spread);
+    checkBatchDiscount(fSpreaded, times, "forward-spreaded curve");
+}
+
 test_suite* TermStructureTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("Term structure tests");
     suite->add(QUANTLIB_TEST_CASE(&TermStructureTest::testReferenceChange));
@@ -605,6 +686,7 @@ test_suite* TermStructureTest::suite() {
                              &TermStructureTest::testLinkToNullUnderlying));
     suite->add(QUANTLIB_TEST_CASE(
                              &TermStructureTest::testClonedYieldTermStructure));
+    suite->add(QUANTLIB_TEST_CASE(&TermStructureTest::testBatchDiscount));
     return suite;
 }
 
@@ -3,6 +3,7 @@
 /*
  Copyright (C) 2006 Joseph Wang
  Copyright (C) 2010 Liquidnet Holdings, Inc.
+ Copyright (C) 2016 Peter Caspers
 
  This file is part of QuantLib, a free-software/open-source library
  for financial quantitative analysts and developers - http://quantlib.org/
@@ -23,6 +24,8 @@
 #include <ql/timeseries.hpp>
 #include <ql/prices.hpp>
 #include <ql/time/calendars/unitedstates.hpp>
+#include <ql/indexes/ibor/euribor.hpp>
+#include <ql/indexes/indexmanager.hpp>
 
 #if defined(__GNUC__) && (((__GNUC__ == 4) && (__GNUC_MINOR__ >= 8)) || (__GNUC__ > 4))
 #pragma GCC diagnostic push
@@ -30,14 +33,42 @@
 #endif
 
 #include <boost/unordered_map.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
 
 #if defined(__GNUC__) && (((__GNUC__ == 4) && (__GNUC_MINOR__ >= 8)) || (__GNUC__ > 4))
 #pragma GCC diagnostic pop
 #endif
 
+#include <cstdio>
+#include <cstdlib>
+
 using namespace QuantLib;
 using namespace boost::unit_test_framework;
 
+namespace {
+
+    // file in the temporary directory, removed on destruction
+    class TemporaryFile {
+      public:
+        explicit TemporaryFile(const std::string& name) {
+            const char* variables[] = { "TMPDIR", "TMP", "TEMP" };
+            std::string directory = "/tmp";
+            for (Size i = 0; i < 3; ++i) {
+                if (const char* d = std::getenv(variables[i])) {
+                    directory = d;
+                    break;
+                }
+            }
+            name_ = directory + "/" + name;
+        }
+        ~TemporaryFile() { std::remove(name_.c_str()); }
+        const std::string& name() const { return name_; }
+      private:
+        std::string name_;
+    };
+
+}
+
 void TimeSeriesTest::testConstruction() {
 
     BOOST_TEST_MESSAGE("Testing time series construction...");
@@ -193,11 +224,121 @@ void TimeSeriesTest::testIterators() {
     }
 }
 
+void TimeSeriesTest::testFixingHistory() {
+
+    BOOST_TEST_MESSAGE("Testing contiguous fixing histories...");
+
+    SavedSettings backup;
+    IndexHistoryCleaner cleaner;
+
+    Date today(15, March, 2016);
+    Settings::instance().evaluationDate() = today;
+
+    boost::shared_ptr<IborIndex> index(new Euribor6M);
+    std::string name = index->name();
+    Calendar calendar = index->fixingCalendar();
+
+    std::vector<Date> dates;
+    std::vector<Real> values;
+    for (Date d = calendar.adjust(today - 20 * Years); d < today;
+         d = calendar.advance(d, 1, Days)) {
+        dates.push_back(d);
+        values.push_back(0.01 + 1.0E-6 * dates.size());
+    }
+
+    Flag flag;
+    flag.registerWith(IndexManager::instance().notifier(name));
+
+    index->addFixings(dates.begin(), dates.end(), values.begin());
+
+    if (!flag.isUp())
+        BOOST_ERROR("observer not notified of added fixings");
+
+    const FixingHistory& history =
+        IndexManager::instance().getFixingHistory(name);
+    if (history.size() != dates.size())
+        BOOST_ERROR("fixing history holds " << history.size()
+                    << " fixings, expected " << dates.size());
+    if (history.firstDate() != dates.front() ||
+        history.lastDate() != dates.back())
+        BOOST_ERROR("fixing history covers [" << history.firstDate() << ", "
+                    << history.lastDate() << "], expected ["
+                    << dates.front() << ", " << dates.back() << "]");
+
+    const TimeSeries<Real>& series = IndexManager::instance().getHistory(name);
+    if (series.size() != dates.size())
+        BOOST_ERROR("time series holds " << series.size()
+                    << " fixings, expected " << dates.size());
+
+    std::string lowerCaseName = boost::algorithm::to_lower_copy(name);
+    Size id = IndexManager::instance().id(lowerCaseName);
+    if (id != IndexManager::instance().id(name))
+        BOOST_ERROR("index names interned case-sensitively");
+    for (Size i = 0; i < dates.size(); ++i) {
+        if (index->fixing(dates[i]) != values[i] ||
+            series[dates[i]] != values[i] ||
+            IndexManager::instance().fixing(lowerCaseName, dates[i]) !=
+                values[i] ||
+            IndexManager::instance().fixing(id, dates[i]) != values[i])
+            BOOST_FAIL("fixing mismatch at " << dates[i] << ":"
+                       << "\n    index:         " << index->fixing(dates[i])
+                       << "\n    time series:   " << series[dates[i]]
+                       << "\n    expected:      " << values[i]);
+    }
+    for (Date d = dates.front(); d < dates.back(); ++d) {
+        if (!calendar.isBusinessDay(d) && history[d] != Null<Real>())
+            BOOST_FAIL("unexpected fixing at " << d);
+    }
+
+    // existing fixings are not overwritten silently
+    bool raised = false;
+    try {
+        index->addFixing(dates.back(), 0.5);
+    } catch (Error&) {
+        raised = true;
+    }
+    if (!raised)
+        BOOST_ERROR("duplicated fixing was accepted");
+    flag.lower();
+    index->addFixing(dates.back(), 0.5, true);
+    if (history[dates.back()] != 0.5 || !flag.isUp())
+        BOOST_ERROR("fixing was not overwritten");
+    values.back() = 0.5;
+
+    // bulk storage
+    TemporaryFile file("quantlib-fixing-history.dat");
+    IndexManager::instance().saveHistories(file.name());
+    IndexManager::instance().clearHistories();
+    if (IndexManager::instance().hasHistory(name))
+        BOOST_ERROR("fixings not cleared");
+
+    flag.lower();
+    IndexManager::instance().loadHistories(file.name());
+
+    if (!flag.isUp())
+        BOOST_ERROR("observer not notified of loaded fixings");
+    if (IndexManager::instance().histories() != std::vector<std::string>(
+                                  1, boost::algorithm::to_upper_copy(name)))
+        BOOST_ERROR("unexpected histories loaded");
+    if (IndexManager::instance().id(name) != id)
+        BOOST_ERROR("index id changed after reloading the fixings");
+    if (history.size() != dates.size())
+        BOOST_ERROR("loaded fixing history holds " << history.size()
+                    << " fixings, expected " << dates.size());
+    for (Size i = 0; i < dates.size(); ++i) {
+        if (index->fixing(dates[i]) != values[i])
+            BOOST_FAIL("loaded fixing mismatch at " << dates[i] << ":"
+                       << "\n    index:         " << index->fixing(dates[i])
+                       << "\n    expected:      " << values[i]);
+    }
+}
+
 test_suite* TimeSeriesTest::suite() {
     test_suite* suite = BOOST_TEST_SUITE("time series tests");
     suite->add(QUANTLIB_TEST_CASE(&TimeSeriesTest::testConstruction));
     suite->add(QUANTLIB_TEST_CASE(&TimeSeriesTest::testIntervalPrice));
     suite->add(QUANTLIB_TEST_CASE(&TimeSeriesTest::testIterators));
+    suite->add(QUANTLIB_TEST_CASE(&TimeSeriesTest::testFixingHistory));
     return suite;
 }
 